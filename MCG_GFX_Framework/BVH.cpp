@@ -0,0 +1,218 @@
+#include "BVH.h"
+
+// Included libraries
+#include <algorithm>
+#include <cfloat>
+
+// BVH
+namespace MRT
+{
+	namespace
+	{
+		// Amount of bins the surface area heuristic is evaluated over
+		const int binCount{ 16 };
+		// Leaves are always made at this size or below
+		const int minLeafSize{ 2 };
+		// Leaves are never made above this size unless the primitives can't be split
+		const int maxLeafSize{ 8 };
+		// Depth after which splits fall back to the median
+		const int medianDepth{ 48 };
+
+		// Axis aligned box used while building
+		struct Bounds
+		{
+			rvec3 min{ FLT_MAX }, max{ -FLT_MAX };
+
+			void Grow(const rvec3& _min, const rvec3& _max) { min = glm::min(min, _min); max = glm::max(max, _max); }
+			void Grow(const rvec3& _point) { min = glm::min(min, _point); max = glm::max(max, _point); }
+			real HalfArea() const
+			{
+				rvec3 e = max - min;
+				return e.x < 0 ? 0 : (e.x * e.y) + (e.y * e.z) + (e.z * e.x);
+			}
+		};
+
+		rvec3 Centroid(const BVHBuildItem& _item) { return (_item.boundsMin + _item.boundsMax) * (real)0.5; }
+
+		// A node waiting to be split
+		struct BuildTask
+		{
+			int node, depth;
+		};
+	}
+
+	void BuildBVH(std::vector<BVHBuildItem>& _items, std::vector<BVHNode>& _nodes, std::vector<unsigned int>& _refs)
+	{
+		_nodes.clear();
+		_refs.clear();
+		const int itemCount = (int)_items.size();
+		if (itemCount == 0) return;
+
+		// A binary tree with leaves of at least 1 primitive never has more than 2n - 1 nodes
+		_nodes.reserve((size_t)itemCount * 2);
+		_nodes.push_back(BVHNode());
+		_nodes[0].leftFirst = 0;
+		_nodes[0].count = itemCount;
+
+		std::vector<BuildTask> tasks;
+		tasks.push_back({ 0, 0 });
+		while (!tasks.empty())
+		{
+			BuildTask task = tasks.back();
+			tasks.pop_back();
+			const int first = _nodes[task.node].leftFirst, count = _nodes[task.node].count;
+
+			// Fit the node to its primitives
+			Bounds bounds, centroids;
+			for (int i = first; i < first + count; ++i)
+			{
+				bounds.Grow(_items[i].boundsMin, _items[i].boundsMax);
+				centroids.Grow(Centroid(_items[i]));
+			}
+			_nodes[task.node].boundsMin = bounds.min;
+			_nodes[task.node].boundsMax = bounds.max;
+			if (count <= minLeafSize) continue;
+
+			// Split along the axis the centroids spread over the most
+			rvec3 extent = centroids.max - centroids.min;
+			int axis = 0;
+			if (extent.y > extent.x) axis = 1;
+			if (extent.z > extent[axis]) axis = 2;
+			const real axisMin = centroids.min[axis], axisExtent = extent[axis];
+			// Every centroid is in the same place, nothing to split
+			if (axisExtent <= 0) continue;
+
+			int mid = first;
+			if (task.depth < medianDepth)
+			{
+				// Bin the centroids along the axis
+				Bounds binBounds[binCount];
+				int binItems[binCount]{ 0 };
+				const real binScale = binCount / axisExtent;
+				for (int i = first; i < first + count; ++i)
+				{
+					int bin = glm::min(binCount - 1, (int)((Centroid(_items[i])[axis] - axisMin) * binScale));
+					binBounds[bin].Grow(_items[i].boundsMin, _items[i].boundsMax);
+					++binItems[bin];
+				}
+
+				// Sweep from both sides to get the cost of splitting after every bin
+				real leftArea[binCount - 1], rightArea[binCount - 1];
+				int leftItems[binCount - 1], rightItems[binCount - 1];
+				Bounds left, right;
+				int leftSum = 0, rightSum = 0;
+				for (int b = 0; b < binCount - 1; ++b)
+				{
+					left.Grow(binBounds[b].min, binBounds[b].max);
+					leftSum += binItems[b];
+					leftArea[b] = left.HalfArea();
+					leftItems[b] = leftSum;
+
+					right.Grow(binBounds[binCount - 1 - b].min, binBounds[binCount - 1 - b].max);
+					rightSum += binItems[binCount - 1 - b];
+					rightArea[binCount - 2 - b] = right.HalfArea();
+					rightItems[binCount - 2 - b] = rightSum;
+				}
+
+				int bestSplit = -1;
+				real bestCost = FLT_MAX;
+				for (int b = 0; b < binCount - 1; ++b)
+				{
+					if (leftItems[b] == 0 || rightItems[b] == 0) continue;
+					real cost = (leftArea[b] * leftItems[b]) + (rightArea[b] * rightItems[b]);
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestSplit = b;
+					}
+				}
+
+				// Keep small nodes as leaves when splitting doesnt pay off
+				if (bestSplit < 0) continue;
+				if (count <= maxLeafSize && bestCost >= bounds.HalfArea() * count) continue;
+
+				BVHBuildItem* split = std::partition(_items.data() + first, _items.data() + first + count,
+					[&](const BVHBuildItem& _item)
+					{
+						return glm::min(binCount - 1, (int)((Centroid(_item)[axis] - axisMin) * binScale)) <= bestSplit;
+					});
+				mid = (int)(split - _items.data());
+			}
+			else
+			{
+				// Median split, halves the node every level
+				mid = first + (count / 2);
+				std::nth_element(_items.begin() + first, _items.begin() + mid, _items.begin() + first + count,
+					[axis](const BVHBuildItem& _a, const BVHBuildItem& _b) { return Centroid(_a)[axis] < Centroid(_b)[axis]; });
+			}
+
+			// Children are stored next to each other
+			int leftChild = (int)_nodes.size();
+			_nodes.push_back(BVHNode());
+			_nodes.push_back(BVHNode());
+			_nodes[leftChild].leftFirst = first;
+			_nodes[leftChild].count = mid - first;
+			_nodes[leftChild + 1].leftFirst = mid;
+			_nodes[leftChild + 1].count = first + count - mid;
+			_nodes[task.node].leftFirst = leftChild;
+			_nodes[task.node].count = 0;
+
+			tasks.push_back({ leftChild, task.depth + 1 });
+			tasks.push_back({ leftChild + 1, task.depth + 1 });
+		}
+
+		_refs.resize(itemCount);
+		for (int i = 0; i < itemCount; ++i)
+			_refs[i] = _items[i].ref;
+	}
+
+	void GetBVHParents(const std::vector<BVHNode>& _nodes, std::vector<int>& _parents)
+	{
+		_parents.assign(_nodes.size(), -1);
+		for (int n = 0; n < (int)_nodes.size(); ++n)
+		{
+			if (_nodes[n].count > 0) continue;
+			_parents[_nodes[n].leftFirst] = n;
+			_parents[_nodes[n].leftFirst + 1] = n;
+		}
+	}
+
+	real GetBVHCost(const std::vector<BVHNode>& _nodes)
+	{
+		real cost = 0;
+		for (const BVHNode& node : _nodes)
+			cost += GetNodeArea(node) * (node.count > 0 ? node.count : 1);
+		return cost;
+	}
+
+	real RefitBVH(std::vector<BVHNode>& _nodes, const std::vector<int>& _parents, const std::vector<BVHBuildItem>& _items, int _leaf)
+	{
+		real costChange = 0;
+		int n = _leaf;
+		while (n >= 0)
+		{
+			BVHNode& node = _nodes[n];
+			Bounds bounds;
+			if (node.count > 0)
+			{
+				for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+					bounds.Grow(_items[i].boundsMin, _items[i].boundsMax);
+			}
+			else
+			{
+				bounds.Grow(_nodes[node.leftFirst].boundsMin, _nodes[node.leftFirst].boundsMax);
+				bounds.Grow(_nodes[node.leftFirst + 1].boundsMin, _nodes[node.leftFirst + 1].boundsMax);
+			}
+
+			// Nodes above an unchanged node are unchanged too
+			if (bounds.min == node.boundsMin && bounds.max == node.boundsMax) break;
+
+			real oldArea = GetNodeArea(node);
+			node.boundsMin = bounds.min;
+			node.boundsMax = bounds.max;
+			costChange += (GetNodeArea(node) - oldArea) * (node.count > 0 ? node.count : 1);
+			n = _parents[n];
+		}
+		return costChange;
+	}
+}
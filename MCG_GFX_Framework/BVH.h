@@ -0,0 +1,130 @@
+#ifndef _BVH_H_
+#define _BVH_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+#include "Ray.h"
+#include "Primitive.h"
+#include "Sphere.h"
+#include "Circle.h"
+
+namespace MRT
+{
+	// BVHNode
+	// - A node of the bounding volume hierarchy, 32 bytes so two fit in a cache line
+	// - Leaves (count > 0) own the primitive references [leftFirst, leftFirst + count)
+	// - Interior nodes (count == 0) have their children at leftFirst and leftFirst + 1
+	// - Plain data, can be written to and mapped straight from disk
+	struct BVHNode
+	{
+		rvec3 boundsMin;
+		int leftFirst{ 0 };
+		rvec3 boundsMax;
+		int count{ 0 };
+	};
+
+	// Primitive references stored in the BVH leaves
+	// The top 2 bits hold the PrimitiveType, the rest the index into that types array
+	constexpr unsigned int MakePrimitiveRef(PrimitiveType _type, unsigned int _index) { return ((unsigned int)_type << 30) | _index; }
+	constexpr PrimitiveType GetRefType(unsigned int _ref) { return (PrimitiveType)(_ref >> 30); }
+	constexpr unsigned int GetRefIndex(unsigned int _ref) { return _ref & 0x3FFFFFFFu; }
+
+	// BVHBuildItem
+	// - A primitive reference with its bounds, the input of BuildBVH
+	struct BVHBuildItem
+	{
+		rvec3 boundsMin, boundsMax;
+		unsigned int ref{ 0 };
+	};
+
+	// Generated BVH walk of a baked scene (see BakedScene.h)
+	// @param _origin : The ray origin
+	// @param _direction : The unit ray direction
+	// @param _length : The ray length, set to the hit distance
+	// @param _fAnyHit : Stop at the first primitive hit instead of the closest
+	// @param _ref : Returned primitive reference of the hit
+	// @returns bool : true if a primitive was hit
+	typedef bool (*BakedWalkFunction)(const rvec3& _origin, const rvec3& _direction, real& _length, bool _fAnyHit, unsigned int& _ref);
+
+	// SceneView
+	// - The flat scene the RayTracer traces against
+	// - Points either at arrays built from the primitives manager or into a mapped snapshot
+	struct SceneView
+	{
+		const SphereRecord* spheres{ nullptr };
+		const CircleRecord* circles{ nullptr };
+		const BVHNode* nodes{ nullptr };
+		const unsigned int* refs{ nullptr };
+		int sphereCount{ 0 }, circleCount{ 0 }, nodeCount{ 0 }, refCount{ 0 };
+		// Set for baked scenes, walked in place of the BVH (the arrays above hold the same scene)
+		BakedWalkFunction walk{ nullptr };
+	};
+
+	// Deepest a BVH built by BuildBVH can go, sized for the traversal stack
+	const int bvhMaxDepth{ 64 };
+
+	// Build a bounding volume hierarchy
+	// - Splits are picked with the binned surface area heuristic
+	// - Past a depth of 48 splits fall back to the median so the depth stays under bvhMaxDepth
+	// @param _items : The primitives to build over, reordered into leaf order
+	// @param _nodes : Returned nodes, the root is node 0
+	// @param _refs : Returned primitive references in leaf order
+	void BuildBVH(std::vector<BVHBuildItem>& _items, std::vector<BVHNode>& _nodes, std::vector<unsigned int>& _refs);
+
+	// Work out the parent of every node
+	// @param _nodes : The BVH nodes
+	// @param _parents : Returned parent index per node (-1 for the root)
+	void GetBVHParents(const std::vector<BVHNode>& _nodes, std::vector<int>& _parents);
+
+	// Get the surface area heuristic cost of a BVH
+	// Interior nodes cost their area, leaves their area times their primitive count
+	// @param _nodes : The BVH nodes
+	// @returns real : The cost, divide by the root area to compare trees of different sizes
+	real GetBVHCost(const std::vector<BVHNode>& _nodes);
+
+	// Get the half surface area of a node, the unit GetBVHCost works in
+	// @param _node : The node
+	// @returns real : The half surface area
+	inline real GetNodeArea(const BVHNode& _node)
+	{
+		rvec3 e = _node.boundsMax - _node.boundsMin;
+		return e.x < 0 ? 0 : (e.x * e.y) + (e.y * e.z) + (e.z * e.x);
+	}
+
+	// Refit a leaf and its ancestors after primitives inside it changed bounds
+	// - Walks up the tree until a node's bounds stop changing, O(log n) for a balanced tree
+	// - The tree structure is kept, so the tree gets worse the further primitives move
+	// @param _nodes : The BVH nodes
+	// @param _parents : Parent index per node from GetBVHParents
+	// @param _items : Primitive bounds in leaf order (the items given to BuildBVH)
+	// @param _leaf : The leaf holding the changed primitives
+	// @returns real : The change in GetBVHCost
+	real RefitBVH(std::vector<BVHNode>& _nodes, const std::vector<int>& _parents, const std::vector<BVHBuildItem>& _items, int _leaf);
+
+	// Check a ray against the bounds of a node (slab test)
+	// @param _node : The node to check
+	// @param _origin : The ray origin
+	// @param _invDir : 1 / ray direction, per component
+	// @param _maxLength : The current ray length, further bounds are missed
+	// @param _near : Returned distance the ray enters the bounds
+	// @returns bool : true if the ray enters the bounds before _maxLength
+	inline bool IntersectBounds(const BVHNode& _node, const rvec3& _origin, const rvec3& _invDir, real _maxLength, real& _near)
+	{
+		real tx1 = (_node.boundsMin.x - _origin.x) * _invDir.x, tx2 = (_node.boundsMax.x - _origin.x) * _invDir.x;
+		real tMin = glm::min(tx1, tx2), tMax = glm::max(tx1, tx2);
+		real ty1 = (_node.boundsMin.y - _origin.y) * _invDir.y, ty2 = (_node.boundsMax.y - _origin.y) * _invDir.y;
+		tMin = glm::max(tMin, glm::min(ty1, ty2)); tMax = glm::min(tMax, glm::max(ty1, ty2));
+		real tz1 = (_node.boundsMin.z - _origin.z) * _invDir.z, tz2 = (_node.boundsMax.z - _origin.z) * _invDir.z;
+		tMin = glm::max(tMin, glm::min(tz1, tz2)); tMax = glm::min(tMax, glm::max(tz1, tz2));
+
+		_near = tMin;
+		return tMax >= glm::max(tMin, (real)0) && tMin <= _maxLength;
+	}
+}
+
+#endif // !_BVH_H_
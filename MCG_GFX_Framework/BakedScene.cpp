@@ -0,0 +1,123 @@
+#include "BakedScene.h"
+
+// Included libraries
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+
+// Baked Scene
+namespace MRT
+{
+	namespace
+	{
+		// Check a name can be used as a C++ identifier
+		bool IsIdentifier(const char* _name)
+		{
+			if (_name == nullptr || _name[0] == '\0' || (_name[0] >= '0' && _name[0] <= '9')) return false;
+			for (const char* c = _name; *c != '\0'; ++c)
+			{
+				if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '_')) return false;
+			}
+			return true;
+		}
+
+		// Format values as a braced initializer
+		// Reals are written with enough digits to read back to the same value
+		// @param _values : The values
+		// @param _count : The amount of values
+		// @returns std::string : The initializer, "{ a, b, c }"
+		std::string FormatReals(const real* _values, int _count)
+		{
+			std::string text("{ ");
+			char buffer[32];
+			for (int i = 0; i < _count; ++i)
+			{
+				std::snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<real>::max_digits10, (double)_values[i]);
+				text += buffer;
+				text += (i + 1 < _count) ? ", " : "";
+			}
+			return text;
+		}
+
+		// Format the end of a record initializer
+		// @param _color : The record color
+		// @param _texture : The record texture index
+		// @returns std::string : The color and texture, ", r, g, b, texture }"
+		std::string FormatColor(const ColorPixel& _color, int _texture)
+		{
+			char buffer[96];
+			std::snprintf(buffer, sizeof(buffer), ", %.9g, %.9g, %.9g, %d }", _color.r, _color.g, _color.b, _texture);
+			return buffer;
+		}
+	}
+
+	bool WriteBakedScene(const char* _path, const char* _name, const SceneView& _scene)
+	{
+		// The struct holds a member called name, which it cant share with the struct
+		if (!IsIdentifier(_name) || std::string(_name) == "name" || _scene.nodeCount == 0) return false;
+		// Every reference has to point at a baked record
+		if (_scene.refCount != _scene.sphereCount + _scene.circleCount || _scene.refCount > maxBakedPrimitives) return false;
+
+		std::ofstream file(_path, std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		const std::string name(_name);
+		std::string guard("_BAKED_");
+		for (char c : name) guard += (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+		guard += "_H_";
+
+		file << "// Baked scene '" << name << "', written by MRT::WriteBakedScene\n" <<
+			"// " << _scene.sphereCount << " spheres, " << _scene.circleCount << " circles, " << _scene.nodeCount << " BVH nodes\n" <<
+			"// Load it with RayTracer::LoadBakedScene(MRT::MakeBakedScene<MRT::Baked::" << name << ">())\n\n" <<
+			"#ifndef " << guard << "\n#define " << guard << "\n\n" <<
+			"#include \"BakedScene.h\"\n\n" <<
+			"namespace MRT\n{\n\tnamespace Baked\n\t{\n" <<
+			"\t\tstruct " << name << "\n\t\t{\n" <<
+			"\t\t\tstatic constexpr const char* name{ \"" << name << "\" };\n" <<
+			"\t\t\tstatic constexpr int sphereCount{ " << _scene.sphereCount << " }, circleCount{ " << _scene.circleCount <<
+			" }, nodeCount{ " << _scene.nodeCount << " }, refCount{ " << _scene.refCount << " };\n";
+
+		// Arrays cant be empty, scenes without spheres or circles get a single unused entry
+		file << "\t\t\tstatic constexpr BakedSphere spheres[]{\n";
+		for (int i = 0; i < _scene.sphereCount; ++i)
+		{
+			const SphereRecord& sphere = _scene.spheres[i];
+			const real values[5]{ sphere.position.x, sphere.position.y, sphere.position.z, sphere.radius, sphere.radiusSqr };
+			file << "\t\t\t\t" << FormatReals(values, 5) << FormatColor(sphere.color, sphere.texture) << ",\n";
+		}
+		if (_scene.sphereCount == 0) file << "\t\t\t\t{ 0, 0, 0, 0, 0, 0, 0, 0, -1 },\n";
+
+		file << "\t\t\t};\n\t\t\tstatic constexpr BakedCircle circles[]{\n";
+		for (int i = 0; i < _scene.circleCount; ++i)
+		{
+			const CircleRecord& circle = _scene.circles[i];
+			const real values[8]{ circle.position.x, circle.position.y, circle.position.z,
+				circle.direction.x, circle.direction.y, circle.direction.z, circle.radius, circle.radiusSqr };
+			file << "\t\t\t\t" << FormatReals(values, 8) << FormatColor(circle.color, circle.texture) << ",\n";
+		}
+		if (_scene.circleCount == 0) file << "\t\t\t\t{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1 },\n";
+
+		file << "\t\t\t};\n\t\t\tstatic constexpr BakedNode nodes[]{\n";
+		for (int i = 0; i < _scene.nodeCount; ++i)
+		{
+			const BVHNode& node = _scene.nodes[i];
+			const real values[6]{ node.boundsMin.x, node.boundsMin.y, node.boundsMin.z, node.boundsMax.x, node.boundsMax.y, node.boundsMax.z };
+			file << "\t\t\t\t" << FormatReals(values, 6) << ", " << node.leftFirst << ", " << node.count << " },\n";
+		}
+
+		// References are written as they are stored (see MakePrimitiveRef)
+		file << "\t\t\t};\n\t\t\tstatic constexpr unsigned int refs[]{";
+		for (int i = 0; i < _scene.refCount; ++i)
+			file << ((i % 8 == 0) ? "\n\t\t\t\t" : " ") << _scene.refs[i] << "u,";
+		file << "\n\t\t\t};\n\t\t};\n\t}\n}\n\n#endif // !" << guard << "\n";
+
+		file.close();
+		if (file.fail())
+		{
+			std::remove(_path);
+			return false;
+		}
+		return true;
+	}
+}
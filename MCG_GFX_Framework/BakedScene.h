@@ -0,0 +1,203 @@
+#ifndef _BAKEDSCENE_H_
+#define _BAKEDSCENE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <utility>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+#include "BVH.h"
+
+namespace MRT
+{
+	// Most primitives a scene can have to be baked, the generated code grows with the scene
+	// (around 800KB and 15 seconds to compile per 1000 primitives)
+	const int maxBakedPrimitives{ 1024 };
+
+	// Baked scene data
+	// - Literal copies of the scene records and BVH nodes, written by WriteBakedScene as constexpr arrays
+	struct BakedSphere
+	{
+		real x, y, z, radius, radiusSqr;
+		float r, g, b;
+		int texture;
+	};
+	struct BakedCircle
+	{
+		real x, y, z, directionX, directionY, directionZ, radius, radiusSqr;
+		float r, g, b;
+		int texture;
+	};
+	struct BakedNode
+	{
+		real minX, minY, minZ, maxX, maxY, maxZ;
+		int leftFirst, count;
+	};
+
+	// BakedScene
+	// - A scene compiled into the program from a header written by WriteBakedScene
+	// - Holds the baked arrays and the generated BVH walk, get it with MakeBakedScene
+	// - Load it with RayTracer::LoadBakedScene
+	struct BakedScene
+	{
+		const char* name{ nullptr };
+		const BakedSphere* spheres{ nullptr };
+		const BakedCircle* circles{ nullptr };
+		const BakedNode* nodes{ nullptr };
+		const unsigned int* refs{ nullptr };
+		int sphereCount{ 0 }, circleCount{ 0 }, nodeCount{ 0 }, refCount{ 0 };
+		// The BVH walk with every node and primitive unrolled
+		BakedWalkFunction walk{ nullptr };
+	};
+
+	// BakedWalk
+	// - The BVH walk of a baked scene, unrolled at compile time
+	// - Every node and primitive test is its own function with the bounds and records as constants,
+	//   nothing is read from the scene arrays and there is no traversal stack
+	// - Nodes are visited in the same order and tested with the same maths as RayTracer::IntersectScene,
+	//   so baked scenes render the same image
+	// @param Scene : A struct written by WriteBakedScene
+	template<typename Scene>
+	struct BakedWalk
+	{
+		// The ray being walked
+		struct State
+		{
+			rvec3 origin, direction, invDir;
+			real length;
+			unsigned int ref;
+			bool fHit, fAnyHit;
+		};
+
+		// Test the ray against a node's bounds
+		// @param _state : The ray
+		// @param _near : Returned distance the ray enters the node
+		// @returns bool : true if the ray enters the node within its length
+		template<int Node>
+		static bool Enter(const State& _state, real& _near)
+		{
+			constexpr BakedNode baked = Scene::nodes[Node];
+			BVHNode node;
+			node.boundsMin = rvec3(baked.minX, baked.minY, baked.minZ);
+			node.boundsMax = rvec3(baked.maxX, baked.maxY, baked.maxZ);
+			return IntersectBounds(node, _state.origin, _state.invDir, _state.length, _near);
+		}
+
+		// Test the ray against a primitive of a leaf
+		// @param _state : The ray, its length and hit are set if the primitive is hit closer
+		// @returns bool : true if the walk can stop (any hit walks only)
+		template<int Ref>
+		static bool Test(State& _state)
+		{
+			constexpr unsigned int ref = Scene::refs[Ref];
+			bool hit = false;
+			if constexpr (GetRefType(ref) == PrimitiveType::Sphere)
+			{
+				constexpr BakedSphere baked = Scene::spheres[GetRefIndex(ref)];
+				SphereRecord sphere;
+				sphere.position = rvec3(baked.x, baked.y, baked.z);
+				sphere.radiusSqr = baked.radiusSqr;
+				hit = Sphere::IntersectRecordLength(sphere, _state.origin, _state.direction, _state.length);
+			}
+			else
+			{
+				constexpr BakedCircle baked = Scene::circles[GetRefIndex(ref)];
+				CircleRecord circle;
+				circle.position = rvec3(baked.x, baked.y, baked.z);
+				circle.direction = rvec3(baked.directionX, baked.directionY, baked.directionZ);
+				circle.radiusSqr = baked.radiusSqr;
+				hit = Circle::IntersectRecordLength(circle, _state.origin, _state.direction, _state.length);
+			}
+			if (!hit) return false;
+			_state.ref = ref;
+			_state.fHit = true;
+			return _state.fAnyHit;
+		}
+
+		// Test the ray against every primitive of a leaf
+		// @param _state : The ray
+		// @returns bool : true if the walk can stop
+		template<int First, int... Refs>
+		static bool Leaf(State& _state, std::integer_sequence<int, Refs...>)
+		{
+			return (Test<First + Refs>(_state) || ...);
+		}
+
+		// Visit a node the ray entered, the closer child first
+		// @param _state : The ray
+		// @returns bool : true if the walk can stop
+		template<int Node>
+		static bool Visit(State& _state)
+		{
+			constexpr BakedNode node = Scene::nodes[Node];
+			if constexpr (node.count > 0)
+			{
+				return Leaf<node.leftFirst>(_state, std::make_integer_sequence<int, node.count>());
+			}
+			else
+			{
+				real nearLeft, nearRight;
+				bool hitLeft = Enter<node.leftFirst>(_state, nearLeft);
+				bool hitRight = Enter<node.leftFirst + 1>(_state, nearRight);
+				// The further child is skipped if a hit was found in front of it
+				if (hitLeft && hitRight)
+				{
+					if (nearLeft <= nearRight)
+						return Visit<node.leftFirst>(_state) || (nearRight <= _state.length && Visit<node.leftFirst + 1>(_state));
+					return Visit<node.leftFirst + 1>(_state) || (nearLeft <= _state.length && Visit<node.leftFirst>(_state));
+				}
+				if (hitLeft) return Visit<node.leftFirst>(_state);
+				if (hitRight) return Visit<node.leftFirst + 1>(_state);
+				return false;
+			}
+		}
+
+		// Find the closest (or any) primitive a ray hits, see BakedWalkFunction
+		static bool Walk(const rvec3& _origin, const rvec3& _direction, real& _length, bool _fAnyHit, unsigned int& _ref)
+		{
+			State state{ _origin, _direction, rvec3(1 / _direction.x, 1 / _direction.y, 1 / _direction.z), _length, 0, false, _fAnyHit };
+			real near;
+			if (!Enter<0>(state, near)) return false;
+			Visit<0>(state);
+			if (!state.fHit) return false;
+			_length = state.length;
+			_ref = state.ref;
+			return true;
+		}
+	};
+
+	// Get the baked scene of a struct written by WriteBakedScene
+	// @param Scene : The baked scene struct, e.g MRT::Baked::Name
+	// @returns BakedScene : The scene, pass it to RayTracer::LoadBakedScene
+	template<typename Scene>
+	BakedScene MakeBakedScene()
+	{
+		BakedScene scene;
+		scene.name = Scene::name;
+		scene.spheres = Scene::spheres;
+		scene.circles = Scene::circles;
+		scene.nodes = Scene::nodes;
+		scene.refs = Scene::refs;
+		scene.sphereCount = Scene::sphereCount;
+		scene.circleCount = Scene::circleCount;
+		scene.nodeCount = Scene::nodeCount;
+		scene.refCount = Scene::refCount;
+		scene.walk = &BakedWalk<Scene>::Walk;
+		return scene;
+	}
+
+	// Write a scene as a C++ header for MakeBakedScene
+	// - The records, BVH nodes and references are written as constexpr arrays in MRT::Baked::<name>,
+	//   include the header in a build and load it with RayTracer::LoadBakedScene
+	// - Values are written with enough digits to read back exactly
+	// - The scene cant contain generic primitives, be empty or have more than maxBakedPrimitives
+	// @param _path : The header to write
+	// @param _name : The struct name, has to be a C++ identifier
+	// @param _scene : The scene arrays and BVH to bake
+	// @returns bool : true on success
+	bool WriteBakedScene(const char* _path, const char* _name, const SceneView& _scene);
+}
+
+#endif // !_BAKEDSCENE_H_
@@ -0,0 +1,437 @@
+#include "Benchmark.h"
+
+// Included libraries
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Core modules
+#include "Sphere.h"
+#include "Circle.h"
+#include "Camera.h"
+
+// Kernel Benchmark
+namespace MRT
+{
+	namespace
+	{
+		// Length given to benchmark rays, further than anything they can hit
+		const real rayLength{ 10000 };
+
+		// Kernel answers are added here so the compiler cant throw the calls away
+		volatile int sink{ 0 };
+
+		// Deterministic random numbers (0 to 1.f), rand() differs between platforms
+		float NextRandom(unsigned int& _state)
+		{
+			_state = (_state * 1664525u) + 1013904223u;
+			return (_state >> 8) * (1.f / 16777216.f);
+		}
+
+		// Random unit vector
+		rvec3 RandomDirection(unsigned int& _state)
+		{
+			for (;;)
+			{
+				rvec3 v(NextRandom(_state) * 2 - 1, NextRandom(_state) * 2 - 1, NextRandom(_state) * 2 - 1);
+				real lengthSqr = glm::dot(v, v);
+				if (lengthSqr > (real)0.01f && lengthSqr <= 1) return v / glm::sqrt(lengthSqr);
+			}
+		}
+
+		// Random unit vector at a right angle to a direction
+		rvec3 RandomPerpendicular(unsigned int& _state, rvec3 _direction)
+		{
+			for (;;)
+			{
+				rvec3 v = glm::cross(_direction, RandomDirection(_state));
+				real lengthSqr = glm::dot(v, v);
+				if (lengthSqr > (real)0.01f) return v / glm::sqrt(lengthSqr);
+			}
+		}
+
+		// Create a ray from a point towards a target, ready to intersect
+		Ray MakeRay(rvec3 _origin, rvec3 _target)
+		{
+			Ray ray(_origin, glm::normalize(_target - _origin));
+			HitInformation hitInfo;
+			hitInfo.length = rayLength;
+			ray.SetHitInfo(hitInfo);
+			return ray;
+		}
+
+		// Read the time stamp counter, 0 where there isnt one
+		unsigned long long ReadTimeStamp()
+		{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return 0;
+#endif
+		}
+
+		// PerfCounters
+		// - Cycle, instruction and cache miss counters of the calling thread
+		// - Read through perf events on Linux, unavailable elsewhere or when the kernel refuses them
+		class PerfCounters
+		{
+		private:
+			// Cycles lead the group so all three are counted over the same time
+			int cycles{ -1 }, instructions{ -1 }, misses{ -1 };
+
+#ifdef __linux__
+			int OpenCounter(std::uint64_t _config, int _group)
+			{
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = _config;
+				attr.disabled = _group < 0 ? 1 : 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP;
+				return (int)syscall(__NR_perf_event_open, &attr, 0, -1, _group, 0);
+			}
+#endif
+
+			void Close()
+			{
+#ifdef __linux__
+				if (misses >= 0) close(misses);
+				if (instructions >= 0) close(instructions);
+				if (cycles >= 0) close(cycles);
+#endif
+				cycles = instructions = misses = -1;
+			}
+
+		public:
+			// Open the counters
+			// @returns bool : false if any counter is unavailable
+			bool Open()
+			{
+#ifdef __linux__
+				cycles = OpenCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+				if (cycles >= 0)
+				{
+					instructions = OpenCounter(PERF_COUNT_HW_INSTRUCTIONS, cycles);
+					misses = OpenCounter(PERF_COUNT_HW_CACHE_MISSES, cycles);
+				}
+				if (cycles >= 0 && instructions >= 0 && misses >= 0) return true;
+#endif
+				Close();
+				return false;
+			}
+
+			// Zero the counters and start counting
+			void Start()
+			{
+#ifdef __linux__
+				ioctl(cycles, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+				ioctl(cycles, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+			}
+
+			// Stop counting and read the counters
+			// @param _cycles : Returned CPU cycles
+			// @param _instructions : Returned instructions retired
+			// @param _misses : Returned last level cache misses
+			// @returns bool : false if the counters couldnt be read (or didnt count, like on some virtual machines)
+			bool Stop(long long& _cycles, long long& _instructions, long long& _misses)
+			{
+#ifdef __linux__
+				ioctl(cycles, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+				std::uint64_t values[4]{ 0 };
+				if (read(cycles, values, sizeof(values)) != (ssize_t)sizeof(values) || values[0] != 3 || values[1] == 0) return false;
+				_cycles = (long long)values[1];
+				_instructions = (long long)values[2];
+				_misses = (long long)values[3];
+				return true;
+#else
+				return false;
+#endif
+			}
+
+			PerfCounters() {}
+			PerfCounters(const PerfCounters&) = delete;
+			PerfCounters& operator=(const PerfCounters&) = delete;
+			~PerfCounters() { Close(); }
+		};
+	}
+
+	bool KernelBenchmark::Matches(const std::string& _filter, const char* _kernel)
+	{
+		return std::strncmp(_kernel, _filter.c_str(), _filter.size()) == 0;
+	}
+
+	template <typename Op>
+	void KernelBenchmark::Measure(const char* _kernel, int _count, Op&& _op, BenchmarkResult& _result)
+	{
+		_result.kernel = _kernel;
+		_result.operations = _count;
+
+		PerfCounters counters;
+		const bool fCounters = counters.Open();
+
+		// Warm up pass, pulls the inputs into the caches and counts the hits (every pass gets the same answers)
+		int hits = 0;
+		for (int i = 0; i < _count; ++i) hits += _op(i) ? 1 : 0;
+		_result.hitRate = (float)hits / (float)_count;
+
+		double bestNs = 0;
+		for (int run = 0; run < timedRuns; ++run)
+		{
+			int passHits = 0;
+			if (fCounters) counters.Start();
+			unsigned long long stampStart = ReadTimeStamp();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < _count; ++i) passHits += _op(i) ? 1 : 0;
+
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			unsigned long long stamps = ReadTimeStamp() - stampStart;
+			long long cycles = 0, instructions = 0, misses = 0;
+			bool fRead = fCounters && counters.Stop(cycles, instructions, misses);
+			sink = sink + passHits;
+
+			// Only the fastest pass is kept
+			if (run > 0 && ns >= bestNs) continue;
+			bestNs = ns;
+			_result.nsPerOp = ns / _count;
+			_result.fCounters = fRead;
+			_result.fReferenceCycles = !fRead;
+			if (fRead)
+			{
+				_result.opsPerCycle = (double)_count / cycles;
+				_result.instructionsPerCycle = (double)instructions / cycles;
+				_result.cacheMissesPerOp = (double)misses / _count;
+			}
+			else
+			{
+				_result.opsPerCycle = stamps > 0 ? (double)_count / stamps : 0;
+				_result.instructionsPerCycle = _result.cacheMissesPerOp = 0;
+			}
+		}
+	}
+
+	void KernelBenchmark::RunSpheres(const std::string& _filter, std::vector<BenchmarkResult>& _results)
+	{
+		const bool fHits = Matches(_filter, "sphere hits"), fMisses = Matches(_filter, "sphere misses");
+		if (!fHits && !fMisses) return;
+
+		unsigned int state = 1;
+		std::vector<Sphere> spheres;
+		spheres.reserve(objectCount);
+		for (int i = 0; i < objectCount; ++i)
+		{
+			rvec3 position(RandomDirection(state) * (real)(NextRandom(state) * 50));
+			spheres.emplace_back(position, (real)(0.5f + NextRandom(state) * 2), ColorPixel{ NextRandom(state), NextRandom(state), NextRandom(state) });
+		}
+
+		// Input i is traced against sphere (i % objectCount)
+		std::vector<Ray> hitRays, missRays;
+		hitRays.reserve(inputCount);
+		missRays.reserve(inputCount);
+		for (int i = 0; i < inputCount; ++i)
+		{
+			Sphere& sphere = spheres[i % objectCount];
+			rvec3 center = sphere.GetPosition();
+			real radius = sphere.GetRadius();
+			rvec3 origin = center + RandomDirection(state) * (radius * (real)(4 + NextRandom(state) * 20));
+
+			// Hits aim somewhere inside the sphere
+			rvec3 target = center + RandomDirection(state) * (radius * (real)(0.9f * NextRandom(state)));
+			hitRays.push_back(MakeRay(origin, target));
+
+			// Half the misses point away and take the first early out, half pass beside the sphere
+			// (at least 1.5 radii to the side from 4 radii away keeps them outside it)
+			if (i & 1) missRays.push_back(MakeRay(origin, origin - (target - origin)));
+			else
+			{
+				rvec3 side = RandomPerpendicular(state, glm::normalize(center - origin));
+				missRays.push_back(MakeRay(origin, center + side * (radius * (real)(1.5f + NextRandom(state) * 3))));
+			}
+		}
+
+		BenchmarkResult result;
+		result.fHitTest = true;
+		if (fHits)
+		{
+			Measure("sphere hits", inputCount, [&](int _i) { Ray ray = hitRays[_i]; return spheres[_i % objectCount].Intersect(ray); }, result);
+			_results.push_back(result);
+		}
+		if (fMisses)
+		{
+			Measure("sphere misses", inputCount, [&](int _i) { Ray ray = missRays[_i]; return spheres[_i % objectCount].Intersect(ray); }, result);
+			_results.push_back(result);
+		}
+	}
+
+	void KernelBenchmark::RunCircles(const std::string& _filter, std::vector<BenchmarkResult>& _results)
+	{
+		const bool fCircleHits = Matches(_filter, "circle hits"), fCircleMisses = Matches(_filter, "circle misses"),
+			fPlaneHits = Matches(_filter, "plane hits"), fPlaneMisses = Matches(_filter, "plane misses");
+		if (!fCircleHits && !fCircleMisses && !fPlaneHits && !fPlaneMisses) return;
+
+		unsigned int state = 2;
+		std::vector<Circle> circles;
+		circles.reserve(objectCount);
+		for (int i = 0; i < objectCount; ++i)
+		{
+			rvec3 position(RandomDirection(state) * (real)(NextRandom(state) * 50));
+			circles.emplace_back(position, RandomDirection(state), (real)(0.5f + NextRandom(state) * 2), ColorPixel{ NextRandom(state), NextRandom(state), NextRandom(state) });
+		}
+
+		// Circles are hit by rays travelling along their direction (see Circle::IntersectRecord)
+		std::vector<Ray> hitRays, missRays;
+		hitRays.reserve(inputCount);
+		missRays.reserve(inputCount);
+		for (int i = 0; i < inputCount; ++i)
+		{
+			Circle& circle = circles[i % objectCount];
+			rvec3 center = circle.GetPosition(), normal = circle.GetDirection();
+			real radius = circle.GetRadius();
+			real distance = radius * (real)(2 + NextRandom(state) * 20);
+			rvec3 origin = center - normal * distance + RandomPerpendicular(state, normal) * (distance * (real)NextRandom(state));
+
+			// Hits aim somewhere inside the circle
+			rvec3 inside = center + RandomPerpendicular(state, normal) * (radius * (real)(0.9f * NextRandom(state)));
+			hitRays.push_back(MakeRay(origin, inside));
+
+			// Half the misses come from behind and take the first early out, half hit the plane outside the circle
+			if (i & 1) missRays.push_back(MakeRay(origin + normal * (2 * distance), inside));
+			else missRays.push_back(MakeRay(origin, center + RandomPerpendicular(state, normal) * (radius * (real)(1.2f + NextRandom(state) * 3))));
+		}
+
+		BenchmarkResult result;
+		result.fHitTest = true;
+		if (fCircleHits)
+		{
+			Measure("circle hits", inputCount, [&](int _i) { Ray ray = hitRays[_i]; return circles[_i % objectCount].Intersect(ray); }, result);
+			_results.push_back(result);
+		}
+		if (fCircleMisses)
+		{
+			Measure("circle misses", inputCount, [&](int _i) { Ray ray = missRays[_i]; return circles[_i % objectCount].Intersect(ray); }, result);
+			_results.push_back(result);
+		}
+		// The plane test doesnt change the ray, so no copy is made
+		// Plane misses share the circle misses, the half outside the circle still hits the plane
+		if (fPlaneHits)
+		{
+			Measure("plane hits", inputCount, [&](int _i) { return circles[_i % objectCount].IntersectPlane(hitRays[_i]) > 0; }, result);
+			_results.push_back(result);
+		}
+		if (fPlaneMisses)
+		{
+			Measure("plane misses", inputCount, [&](int _i) { return circles[_i % objectCount].IntersectPlane(missRays[_i]) > 0; }, result);
+			_results.push_back(result);
+		}
+	}
+
+	void KernelBenchmark::RunCamera(const std::string& _filter, std::vector<BenchmarkResult>& _results)
+	{
+		if (!Matches(_filter, "castray")) return;
+
+		const int width = 1280, height = 720;
+		Camera camera(width, height);
+		if (!camera.IsInit()) return;
+		camera.SetPosition({ 1, 2, 10 });
+		camera.LookAt({ 0, 0, 0 });
+
+		// Pixels are visited in a random order like tiles spread over worker threads would
+		unsigned int state = 3;
+		std::vector<int> pixels(inputCount);
+		std::vector<glm::fvec2> samples(inputCount);
+		for (int i = 0; i < inputCount; ++i)
+		{
+			pixels[i] = (int)(NextRandom(state) * (width * height));
+			samples[i] = glm::fvec2(NextRandom(state), NextRandom(state));
+		}
+
+		BenchmarkResult result;
+		Measure("castray", inputCount, [&](int _i)
+			{
+				Ray ray;
+				camera.CastRay(pixels[_i] % width, pixels[_i] / width, ray, samples[_i].x, samples[_i].y);
+				return ray.GetDirection().z < 0;
+			}, result);
+		_results.push_back(result);
+	}
+
+	void KernelBenchmark::RunShading(const std::string& _filter, std::vector<BenchmarkResult>& _results)
+	{
+		const bool fShade = Matches(_filter, "shade headlight"), fLit = Matches(_filter, "shade lit");
+		if (!fShade && !fLit) return;
+
+		const int width = 320, height = 240;
+		RayTracer raytracer(width, height);
+		if (!raytracer.IsInit()) return;
+		raytracer.SetCameraPosition({ 0, 0, 10 });
+
+		// Spheres over a floor, the same kind of scene the regression suite renders
+		unsigned int state = 4;
+		raytracer.AddPrimitive(new Circle({ 0, -3, 0 }, { 0, 1, 0 }, 40, { 0.5f, 0.5f, 0.5f }));
+		for (int i = 0; i < 200; ++i)
+		{
+			rvec3 position((NextRandom(state) - 0.5f) * 12, (NextRandom(state) - 0.5f) * 6, -NextRandom(state) * 15);
+			raytracer.AddPrimitive(new Sphere(position, (real)(0.2f + NextRandom(state) * 0.6f), { NextRandom(state), NextRandom(state), NextRandom(state) }));
+		}
+		raytracer.PrepareScene();
+
+		// Shade rays that were traced into the scene, misses are never shaded
+		std::vector<Ray> hitRays;
+		hitRays.reserve(inputCount);
+		for (int attempt = 0; attempt < inputCount * 4 && (int)hitRays.size() < inputCount; ++attempt)
+		{
+			Ray ray;
+			raytracer.camera.CastRay((int)(NextRandom(state) * width), (int)(NextRandom(state) * height), ray, NextRandom(state), NextRandom(state));
+			if (raytracer.IntersectScene(ray)) hitRays.push_back(ray);
+		}
+		if (hitRays.empty()) return;
+		const int count = (int)hitRays.size();
+
+		// Shading doesnt change the ray, so no copy is made
+		BenchmarkResult result;
+		if (fShade)
+		{
+			Measure("shade headlight", count, [&](int _i) { ColorPixel color = raytracer.Shade(hitRays[_i]); return color.r + color.g + color.b > 0; }, result);
+			_results.push_back(result);
+		}
+
+		// Scene lights add shadow rays through the BVH, sphere lights over the floor
+		if (fLit)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				rvec3 position((NextRandom(state) - 0.5f) * 20, 4 + NextRandom(state) * 4, -NextRandom(state) * 20);
+				raytracer.AddLight(position, { 4, 4, 4 }, (real)(NextRandom(state) * 0.5f));
+			}
+			raytracer.PrepareScene();
+			Measure("shade lit", count, [&](int _i) { ColorPixel color = raytracer.Shade(hitRays[_i]); return color.r + color.g + color.b > 0; }, result);
+			_results.push_back(result);
+		}
+	}
+
+	bool KernelBenchmark::Run(const char* _filter, std::vector<BenchmarkResult>& _results)
+	{
+		std::string filter(_filter);
+		_results.clear();
+		RunSpheres(filter, _results);
+		RunCircles(filter, _results);
+		RunCamera(filter, _results);
+		RunShading(filter, _results);
+		return !_results.empty();
+	}
+}
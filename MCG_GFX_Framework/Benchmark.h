@@ -0,0 +1,94 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+// Included libraries
+#include <string>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "RayTracer.h"
+
+namespace MRT
+{
+	// BenchmarkResult
+	// - Timing of a single kernel over its whole input set
+	struct BenchmarkResult
+	{
+		// The kernel and input set, e.g "sphere hits"
+		std::string kernel;
+		// Calls made per timed pass
+		int operations{ 0 };
+		// The kernel reports hits, only the intersection kernels do
+		bool fHitTest{ false };
+		// Fraction of calls that reported a hit (0 to 1.f), shows how hit or miss heavy the inputs are
+		float hitRate{ 0 };
+
+		// Time per call of the fastest timed pass (nanoseconds)
+		double nsPerOp{ 0 };
+		// Calls per CPU cycle, 0 when no cycle count could be read
+		double opsPerCycle{ 0 };
+		// The cycle count came from the time stamp counter rather than the cycle counter
+		// The time stamp counter ticks at a fixed rate, so turbo and power saving skew it
+		bool fReferenceCycles{ false };
+
+		// Hardware counters were read (Linux perf events only)
+		bool fCounters{ false };
+		// Instructions retired per cycle
+		double instructionsPerCycle{ 0 };
+		// Last level cache misses per call
+		double cacheMissesPerOp{ 0 };
+	};
+
+	// KernelBenchmark
+	// - Times each hot kernel on its own over large randomized input sets
+	// - Kernels: Sphere::Intersect, Circle::Intersect, Plane::IntersectPlane, Camera::CastRay and RayTracer::Shade
+	// - Intersection kernels run a hit heavy and a miss heavy input set, misses take the early outs
+	// - Inputs are generated from a fixed seed, so every run times the same inputs
+	// - Runs on the calling thread, the fastest of a few passes is kept to filter out noise
+	class KernelBenchmark
+	{
+	private:
+		// Inputs per kernel, large enough to spill out of the first level caches
+		static const int inputCount{ 1 << 16 };
+		// Objects the inputs are spread over
+		static const int objectCount{ 1024 };
+		// Timed passes per kernel
+		static const int timedRuns{ 5 };
+
+		// Check a kernel name passes the filter
+		// @param _filter : The filter, matches the start of the name ("" matches every kernel)
+		// @param _kernel : The kernel name
+		// @returns bool : true if the kernel should run
+		bool Matches(const std::string& _filter, const char* _kernel);
+
+		// Time a kernel over its input set
+		// @param _kernel : The kernel name
+		// @param _count : Calls per pass
+		// @param _op : Called with the input index, returns true on a hit
+		// @param _result : Returned timings
+		template <typename Op>
+		void Measure(const char* _kernel, int _count, Op&& _op, BenchmarkResult& _result);
+
+		// Benchmark the sphere kernels
+		void RunSpheres(const std::string& _filter, std::vector<BenchmarkResult>& _results);
+
+		// Benchmark the circle and plane kernels
+		void RunCircles(const std::string& _filter, std::vector<BenchmarkResult>& _results);
+
+		// Benchmark camera ray generation
+		void RunCamera(const std::string& _filter, std::vector<BenchmarkResult>& _results);
+
+		// Benchmark shading, with the headlight only and with scene lights
+		void RunShading(const std::string& _filter, std::vector<BenchmarkResult>& _results);
+
+	public:
+		// Run every kernel matching a filter
+		// @param _filter : Kernel name prefix e.g "sphere", "shade" ("" for every kernel)
+		// @param _results : Returned result per kernel and input set
+		// @returns bool : false if no kernel matched
+		bool Run(const char* _filter, std::vector<BenchmarkResult>& _results);
+	};
+}
+
+#endif // !_BENCHMARK_H_
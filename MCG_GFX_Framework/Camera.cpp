@@ -1,11 +1,31 @@
 #include "Camera.h"
 
+// Core modules
+#include "Timeline.h"
+
 // Raytracing camera
 namespace MRT
 {
 	void Camera::ConstructCamMatrix()
 	{
-		camToWorld = glm::translate(glm::fmat4(1.0f), position) * camRotation * glm::fmat4(1.0f);
+		camToWorld = glm::translate(rmat4(1.0f), position) * camRotation * rmat4(1.0f);
+		UpdateRayParams();
+	}
+
+	void Camera::UpdateRayParams()
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			rayParams.column0[axis] = (float)camToWorld[0][axis];
+			rayParams.column1[axis] = (float)camToWorld[1][axis];
+			rayParams.column2[axis] = (float)camToWorld[2][axis];
+			rayParams.column3[axis] = (float)camToWorld[3][axis];
+		}
+		rayParams.imageWidth = (float)imageWidth;
+		rayParams.imageHeight = (float)imageHeight;
+		rayParams.aspectX = (float)imageAspectX;
+		rayParams.aspectY = (float)imageAspectY;
+		rayParams.fov = (float)fov;
 	}
 
 	bool Camera::DrawToPlane(const int& _x, const int& _y, ColorPixel _color)
@@ -19,8 +39,19 @@ namespace MRT
 		return true;
 	}
 
+	bool Camera::DrawToSurfacePlane(const int& _x, const int& _y, SurfacePixel _surface)
+	{
+		// Check pixel coord is in bounds on plane
+		if (_x < 0 || _x >= imageWidth || _y < 0 || _y >= imageHeight) return false;
+
+		surfacePlane[(_y * imageWidth) + _x] = _surface;
+
+		return true;
+	}
+
 	void Camera::DisplayPlane()
 	{
+		TimelineScope scope("Display");
 		// Loop through entire array
 		for (int y = 0; y < imageHeight; ++y)
 		{
@@ -39,6 +70,42 @@ namespace MRT
 
 	}
 
+	void Camera::CopyToFront(const int& _x0, const int& _y0, const int& _x1, const int& _y1)
+	{
+		// Clamp the region to the plane
+		int x0 = glm::max(_x0, 0), x1 = glm::min(_x1, imageWidth);
+		int y0 = glm::max(_y0, 0), y1 = glm::min(_y1, imageHeight);
+		TimelineScope scope("Copy to front");
+
+		for (int y = y0; y < y1; ++y)
+		{
+			int row = y * imageWidth;
+			for (int x = x0; x < x1; ++x)
+				frontPlane[row + x] = imagePlane[row + x];
+		}
+	}
+
+	void Camera::DisplayFront(const int& _x0, const int& _y0, const int& _x1, const int& _y1)
+	{
+		// Clamp the region to the plane
+		int x0 = glm::max(_x0, 0), x1 = glm::min(_x1, imageWidth);
+		int y0 = glm::max(_y0, 0), y1 = glm::min(_y1, imageHeight);
+		TimelineScope scope("Display tiles");
+
+		for (int y = y0; y < y1; ++y)
+		{
+			int row = y * imageWidth;
+			for (int x = x0; x < x1; ++x)
+			{
+				int index = row + x;
+				MCG::DrawPixel({ x, y }, {
+					frontPlane[index].r,
+					frontPlane[index].g,
+					frontPlane[index].b });
+			}
+		}
+	}
+
 	void Camera::DisplayPlanePixel(const int& _x, const int& _y)
 	{
 		// Check pixel coord is in bounds on plane
@@ -57,18 +124,25 @@ namespace MRT
 		// Check pixel coord is in bounds on plane
 		if (_x < 0 || _x >= imageWidth || _y < 0 || _y >= imageHeight) return;
 
+#if defined(MRT_KERNELS_RAYGEN)
+		float direction[3];
+		GetKernels().generateRays(rayParams, _y, _x, 1, _sampleX, _sampleY, direction, direction + 1, direction + 2);
+		_ray.hitInfo.length = maxViewingDistance;
+		_ray.origin = rvec3(rayParams.column3[0], rayParams.column3[1], rayParams.column3[2]);
+		_ray.direction = rvec3(direction[0], direction[1], direction[2]);
+#else
 		// Convert pixel coord to NDC space (0,1)
-		float wX = (_x + _sampleX) / imageWidth, wY = (_y + _sampleY) / imageHeight;
+		real wX = (_x + _sampleX) / imageWidth, wY = (_y + _sampleY) / imageHeight;
 		// Convert NDC to screen space (-1,1)
 		wX = ((wX * 2) - 1) * imageAspectX * fov; wY = (1 - (wY * 2)) * imageAspectY * fov;
 
 		// Create a 4 column vector to multiply with camToWorld
-		glm::fvec4 wP(wX, wY, -1, 1);
+		rvec4 wP(wX, wY, -1, 1);
 		// Transform pixel from screen/camera space to world space
 		wP = camToWorld * wP;
 
 		// Create a 4 column vector of the ray origin
-		glm::fvec4 rO(_ray.origin.x, _ray.origin.y, _ray.origin.z, 1);
+		rvec4 rO(_ray.origin.x, _ray.origin.y, _ray.origin.z, 1);
 		// Multiply with camToWorld, transforms origin
 		rO = camToWorld * rO;
 
@@ -76,39 +150,115 @@ namespace MRT
 		_ray.hitInfo.length = maxViewingDistance;
 
 		// Set origin to transformed rO (excluding w)
-		_ray.origin = glm::fvec3(rO.x, rO.y, rO.z);
+		_ray.origin = rvec3(rO.x, rO.y, rO.z);
 		// Subtract rays origin from the world space pixel coord
-		_ray.direction = glm::fvec3(wP.x, wP.y, wP.z) - _ray.origin;
+		_ray.direction = rvec3(wP.x, wP.y, wP.z) - _ray.origin;
 		// Convert ray direction into unit vector
-		_ray.direction = glm::normalize(_ray.direction);
+		_ray.direction = NormalizeFast(_ray.direction);
+#endif
+	}
+
+	void Camera::CastRow(const int& _y, const int& _x0, const int& _count, Ray* _rays, const float& _sampleX, const float& _sampleY)
+	{
+		if (_y < 0 || _y >= imageHeight) return;
+		const int x0 = glm::max(_x0, 0), x1 = glm::min(_x0 + _count, imageWidth);
+		Ray* rays = _rays + (x0 - _x0);
+
+#if defined(MRT_KERNELS_RAYGEN)
+		const GenerateRaysKernel generateRays = GetKernels().generateRays;
+		const rvec3 origin(rayParams.column3[0], rayParams.column3[1], rayParams.column3[2]);
+
+		// Directions are generated a block at a time into the stack
+		const int blockSize = 64;
+		float directionX[blockSize], directionY[blockSize], directionZ[blockSize];
+		for (int x = x0; x < x1; x += blockSize)
+		{
+			const int count = glm::min(blockSize, x1 - x);
+			generateRays(rayParams, _y, x, count, _sampleX, _sampleY, directionX, directionY, directionZ);
+			for (int i = 0; i < count; ++i)
+			{
+				Ray& ray = rays[(x - x0) + i];
+				ray = Ray(origin, rvec3(directionX[i], directionY[i], directionZ[i]));
+				ray.hitInfo.length = maxViewingDistance;
+			}
+		}
+#else
+		for (int x = x0; x < x1; ++x)
+		{
+			rays[x - x0] = Ray();
+			CastRay(x, _y, rays[x - x0], _sampleX, _sampleY);
+		}
+#endif
+	}
+
+	bool Camera::ProjectBounds(const rvec3& _min, const rvec3& _max, int& _x0, int& _y0, int& _x1, int& _y1)
+	{
+		// Camera axes and origin in world space, the camera looks down -Z
+		const rvec3 right(camToWorld[0][0], camToWorld[0][1], camToWorld[0][2]);
+		const rvec3 up(camToWorld[1][0], camToWorld[1][1], camToWorld[1][2]);
+		const rvec3 back(camToWorld[2][0], camToWorld[2][1], camToWorld[2][2]);
+		const rvec3 origin(camToWorld[3][0], camToWorld[3][1], camToWorld[3][2]);
+
+		// Screen space bounds of the corners, in the space CastRay maps pixels to
+		real minX = 0, maxX = 0, minY = 0, maxY = 0, nearest = 0;
+		int behind = 0, projected = 0;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			const rvec3 offset = rvec3(corner & 1 ? _max.x : _min.x, corner & 2 ? _max.y : _min.y, corner & 4 ? _max.z : _min.z) - origin;
+			const real depth = -glm::dot(offset, back);
+			nearest = corner == 0 ? depth : glm::min(nearest, depth);
+			if (depth <= 0) ++behind;
+			// Corners too close to the camera plane dont project to a usable point
+			if (depth <= (real)1e-6f) continue;
+
+			const real x = glm::dot(offset, right) / (depth * imageAspectX * fov);
+			const real y = glm::dot(offset, up) / (depth * imageAspectY * fov);
+			minX = projected == 0 ? x : glm::min(minX, x); maxX = projected == 0 ? x : glm::max(maxX, x);
+			minY = projected == 0 ? y : glm::min(minY, y); maxY = projected == 0 ? y : glm::max(maxY, y);
+			++projected;
+		}
+		if (behind == 8 || nearest > maxViewingDistance) return false;
+
+		_x0 = 0; _y0 = 0; _x1 = imageWidth; _y1 = imageHeight;
+		if (projected < 8) return true;
 
+		// Screen space to pixels, with a pixel to spare either side for rounding
+		const real pixelLeft = (minX + 1) * (real)0.5f * imageWidth, pixelRight = (maxX + 1) * (real)0.5f * imageWidth;
+		const real pixelTop = (1 - maxY) * (real)0.5f * imageHeight, pixelBottom = (1 - minY) * (real)0.5f * imageHeight;
+		if (pixelRight < -1 || pixelLeft > imageWidth + 1 || pixelBottom < -1 || pixelTop > imageHeight + 1) return false;
+		_x0 = glm::max(0, (int)glm::floor(pixelLeft) - 1);
+		_x1 = glm::min(imageWidth, (int)glm::floor(pixelRight) + 2);
+		_y0 = glm::max(0, (int)glm::floor(pixelTop) - 1);
+		_y1 = glm::min(imageHeight, (int)glm::floor(pixelBottom) + 2);
+		return _x0 < _x1 && _y0 < _y1;
 	}
 
-	void Camera::SetFOV(float _angleDeg)
+	void Camera::SetFOV(real _angleDeg)
 	{
 		// Sets the FOV, uses trig to scale 
 		// the plane in screen/camera space
 		fov = glm::tan(glm::radians(_angleDeg) / 2);
+		UpdateRayParams();
 	}
 
-	void Camera::SetPosition(glm::fvec3 _position)
+	void Camera::SetPosition(rvec3 _position)
 	{
 		// Set the new position and then construct the new matrix
 		position = _position;
 		ConstructCamMatrix();
 	}
 
-	void Camera::SetRotation(glm::fvec3 _axis, float _angle)
+	void Camera::SetRotation(rvec3 _axis, real _angle)
 	{
 		// Set the new rotation and then construct the new matrix
-		camRotation = glm::rotate(glm::fmat4(1.0f), glm::radians(_angle), _axis);
+		camRotation = glm::rotate(rmat4(1.0f), glm::radians(_angle), _axis);
 		ConstructCamMatrix();
 	}
 
-	void Camera::LookAt(glm::fvec3 _point)
+	void Camera::LookAt(rvec3 _point)
 	{
 		// Get the inverse of the view matrix which gives the rotation
-		camRotation = glm::inverse(glm::lookAt(position, _point, glm::fvec3(0, 1, 0)));
+		camRotation = glm::inverse(glm::lookAt(position, _point, rvec3(0, 1, 0)));
 		ConstructCamMatrix();
 	}
 
@@ -122,18 +272,30 @@ namespace MRT
 	{
 		// Create an array of color pixels for the image plane
 		imagePlane = new ColorPixel[_pixelWidth * _pixelHeight];
-		// Check that the image plane has been allocated
-		fInitialised = (imagePlane != nullptr);
+		frontPlane = new ColorPixel[_pixelWidth * _pixelHeight];
+		surfacePlane = new SurfacePixel[_pixelWidth * _pixelHeight];
+		accumulationPlane = new ColorPixel[_pixelWidth * _pixelHeight];
+		samplePlane = new int[_pixelWidth * _pixelHeight]{ 0 };
+		costPlane = new PixelCost[_pixelWidth * _pixelHeight];
+		// Check that the image planes have been allocated
+		fInitialised = (imagePlane != nullptr && frontPlane != nullptr && surfacePlane != nullptr &&
+			accumulationPlane != nullptr && samplePlane != nullptr && costPlane != nullptr);
 
 		if (fInitialised)
 		{
 			// Calculate aspect ratios
-			imageAspectX = (_pixelWidth > _pixelHeight ? (float)_pixelWidth / (float)_pixelHeight : 1.f);
-			imageAspectY = (_pixelHeight > _pixelWidth ? (float)_pixelHeight / (float)_pixelWidth : 1.f);
+			imageAspectX = (_pixelWidth > _pixelHeight ? (real)_pixelWidth / (real)_pixelHeight : 1.f);
+			imageAspectY = (_pixelHeight > _pixelWidth ? (real)_pixelHeight / (real)_pixelWidth : 1.f);
 		}
+		UpdateRayParams();
 	}
 	Camera::~Camera()
 	{
 		delete[] imagePlane;
+		delete[] frontPlane;
+		delete[] surfacePlane;
+		delete[] accumulationPlane;
+		delete[] samplePlane;
+		delete[] costPlane;
 	}
 }
\ No newline at end of file
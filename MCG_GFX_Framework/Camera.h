@@ -6,7 +6,9 @@
 
 // Core modules
 #include "UtilityModules.h"
+#include "Precision.h"
 #include "Ray.h"
+#include "Kernels.h"
 
 namespace MRT
 {
@@ -21,29 +23,45 @@ namespace MRT
 	private:
 		// The image plane
 		ColorPixel* imagePlane{ nullptr };
+		// The front plane, a copy of finished parts of the image plane
+		// Background renders write to the image plane while the front plane is displayed
+		ColorPixel* frontPlane{ nullptr };
+		// The surface plane, per pixel normals and depth (used to guide post-passes)
+		SurfacePixel* surfacePlane{ nullptr };
+		// Progressive rendering planes, the summed color and amount of samples per pixel
+		ColorPixel* accumulationPlane{ nullptr };
+		int* samplePlane{ nullptr };
+		// The cost plane, per pixel render cost (only filled in while cost tracking is on)
+		PixelCost* costPlane{ nullptr };
 
 		// Image aspect ratios
-		float imageAspectX{ 1.0f }, imageAspectY{ 1.0f };
+		real imageAspectX{ 1.0f }, imageAspectY{ 1.0f };
 		// Image dimensions
 		int imageWidth{ 0 }, imageHeight{ 0 };
 
 		// Field of view (default ~60 degrees)
-		float fov{ 0.57f };
+		real fov{ 0.57f };
 
 		// Max viewing render distance (default 10000)
-		float maxViewingDistance{ 10000.0f };
+		real maxViewingDistance{ 10000.0f };
 
 		// Camera matrix (used for rotation & translation)
 		// Converts camera to world space
-		glm::fmat4 camToWorld;
+		rmat4 camToWorld;
 		// Rotation matrix 
-		glm::fmat4 camRotation;
+		rmat4 camRotation;
 
 		// Construct camToWorld matrix
 		void ConstructCamMatrix();
 
+		// Camera constants given to the ray generation kernel, kept up to date with the matrix and fov
+		RayRowParams rayParams;
+
+		// Copy the matrix and fov into the ray generation constants
+		void UpdateRayParams();
+
 		// Camera position
-		glm::fvec3 position;
+		rvec3 position;
 
 		// Camera flags
 		// Check camera has been instantiated 
@@ -58,42 +76,93 @@ namespace MRT
 		// @returns bool : true on success
 		bool DrawToPlane(const int& _x, const int& _y, ColorPixel _color);
 
+		// Draw to surface plane
+		// @param _x : The X coordinate of the plane (0 to imageWidth-1)
+		// @param _y : The Y coordinate of the plane (0 to imageHeight-1)
+		// @param _surface : The normal and depth of the pixel
+		// @returns bool : true on success
+		bool DrawToSurfacePlane(const int& _x, const int& _y, SurfacePixel _surface);
+
 		// Display the whole image plane
 		void DisplayPlane();
 
+		// Copy a region of the image plane to the front plane
+		// @param _x0 : The left edge of the region
+		// @param _y0 : The top edge of the region
+		// @param _x1 : The right edge of the region (exclusive)
+		// @param _y1 : The bottom edge of the region (exclusive)
+		void CopyToFront(const int& _x0, const int& _y0, const int& _x1, const int& _y1);
+
+		// Display a region of the front plane
+		// @param _x0 : The left edge of the region
+		// @param _y0 : The top edge of the region
+		// @param _x1 : The right edge of the region (exclusive)
+		// @param _y1 : The bottom edge of the region (exclusive)
+		void DisplayFront(const int& _x0, const int& _y0, const int& _x1, const int& _y1);
+
 		// Display a specific pixel of the image plane
 		// @param _x : The X coordinate of the plane (0 to imageWidth-1)
 		// @param _y : The Y coordinate of the plane (0 to imageHeight-1)
 		void DisplayPlanePixel(const int& _x, const int& _y);
 
 		// Cast a ray
+		// The precise float tier works the direction out through the ray generation kernel (see Kernels.h),
+		// so rays cast one at a time or a row at a time are identical
 		// @param _x : The current pixel X coordinate on the image plane (0 to imageWidth-1)
 		// @param _y : The current pixel Y coordinate on the image plane (0 to imageHeight-1)
-		// @param _ray : The ray that will be setup for tracing
+		// @param _ray : The ray that will be setup for tracing (a new ray, it starts at the camera)
 		// @param _sampleX : The sample X coordinate on a pixel (0 to 1.f)
 		// @param _sampleY : The sample Y coordinate on a pixel (0 to 1.f)
 		void CastRay(const int& _x, const int& _y, Ray& _ray, const float& _sampleX, const float& _sampleY);
 
+		// Cast the rays of a run of pixels on a row, every pixel uses the same sample position
+		// The run is clamped to the row, the other tiers cast each ray with CastRay
+		// @param _y : The pixel row (0 to imageHeight-1)
+		// @param _x0 : The first pixel on the row
+		// @param _count : The amount of pixels
+		// @param _rays : Returned rays, one per pixel (overwritten)
+		// @param _sampleX : The sample X coordinate on every pixel (0 to 1.f)
+		// @param _sampleY : The sample Y coordinate on every pixel (0 to 1.f)
+		void CastRow(const int& _y, const int& _x0, const int& _count, Ray* _rays, const float& _sampleX, const float& _sampleY);
+
+		// Get the point every primary ray starts from
+		// @returns rvec3 : The ray origin (world space)
+		rvec3 GetRayOrigin() { return rvec3(camToWorld[3][0], camToWorld[3][1], camToWorld[3][2]); }
+
+		// Get the pixels a box can cover, the bounds of its corners projected onto the image plane
+		// - Assumes the camera matrix is a rotation and translation, like SetRotation and LookAt make
+		// - Boxes reaching behind the camera cover the whole image
+		// @param _min : The minimum corner of the box (world space)
+		// @param _max : The maximum corner of the box (world space)
+		// @param _x0, _y0 : Returned top left pixel
+		// @param _x1, _y1 : Returned bottom right pixel (exclusive)
+		// @returns bool : false if the box is off screen, behind the camera or past the render distance
+		bool ProjectBounds(const rvec3& _min, const rvec3& _max, int& _x0, int& _y0, int& _x1, int& _y1);
+
+		// Get the angle a single pixel covers, used to work out ray footprints
+		// @returns real : The width of a pixel one unit in front of the camera
+		real GetPixelSpread() { return (2.f * imageAspectY * fov) / (real)imageHeight; }
+
 		// Set FOV
 		// @param _angleDeg : An angle in degrees (0 to PI)
-		void SetFOV(float _angleDeg);
+		void SetFOV(real _angleDeg);
 
 		// Set camera position in world
 		// @param _position : The new position of the camera
-		void SetPosition(glm::fvec3 _position);
+		void SetPosition(rvec3 _position);
 
 		// Set max render distance
 		// @param _distance : The new distance
-		void SetRenderDistance(float _distance) { maxViewingDistance = _distance; }
+		void SetRenderDistance(real _distance) { maxViewingDistance = _distance; }
 
 		// Rotate camera
 		// @param _axis : The axis to apply the rotation around
 		// @param _angle : The angle to be applied (degrees)
-		void SetRotation(glm::fvec3 _axis, float _angle);
+		void SetRotation(rvec3 _axis, real _angle);
 
 		// Look at point
 		// @param _point : The position vector to look at
-		void LookAt(glm::fvec3 _point);
+		void LookAt(rvec3 _point);
 
 		// Check camera is initialised
 		// @returns bool : true when successfully initialised
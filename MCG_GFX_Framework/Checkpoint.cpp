@@ -0,0 +1,178 @@
+#include "Checkpoint.h"
+
+// Included libraries
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+// Core modules
+#include "Timeline.h"
+#include "MappedFile.h"
+
+// Render Checkpoint
+namespace MRT
+{
+	namespace
+	{
+		const char checkpointMagic[8]{ 'M', 'R', 'T', 'C', 'H', 'K', 'P', 'T' };
+		const std::uint32_t checkpointEndianTag{ 0x01020304u };
+
+		// CheckpointHeader
+		// - Start of a checkpoint file, followed by the image, accumulation, sample,
+		//   surface and cost planes (width * height entries each) and the occlusion records
+		// - Sizes are stored so a build with a different layout or precision rejects the file
+		struct CheckpointHeader
+		{
+			char magic[8]{ 0 };
+			std::uint32_t version{ 0 };
+			std::uint32_t endianTag{ 0 };
+			std::uint32_t headerSize{ 0 }, realSize{ 0 };
+			std::uint32_t colorSize{ 0 }, surfaceSize{ 0 }, costSize{ 0 }, occlusionSize{ 0 };
+			std::uint64_t sceneKey{ 0 };
+			SnapshotCamera camera;
+			std::int32_t width{ 0 }, height{ 0 };
+			std::int32_t pass{ 0 }, passes{ 0 }, row{ 0 };
+			std::int64_t traces{ 0 };
+			float elapsedMs{ 0 };
+			std::int32_t occlusionRecords{ 0 };
+		};
+
+		// Fill a header with the layout of this build
+		// @param _header : Returned header
+		void FillLayout(CheckpointHeader& _header)
+		{
+			std::memcpy(_header.magic, checkpointMagic, sizeof(checkpointMagic));
+			_header.version = checkpointVersion;
+			_header.endianTag = checkpointEndianTag;
+			_header.headerSize = sizeof(CheckpointHeader);
+			_header.realSize = sizeof(real);
+			_header.colorSize = sizeof(ColorPixel);
+			_header.surfaceSize = sizeof(SurfacePixel);
+			_header.costSize = sizeof(PixelCost);
+			_header.occlusionSize = sizeof(OcclusionRecord);
+		}
+
+		// Get the size of a checkpoint file
+		// @param _pixels : The pixels per plane
+		// @param _records : The occlusion records
+		// @returns std::uint64_t : The size in bytes
+		std::uint64_t GetFileSize(std::uint64_t _pixels, std::uint64_t _records)
+		{
+			return sizeof(CheckpointHeader) + _pixels * (2 * sizeof(ColorPixel) + sizeof(int) + sizeof(SurfacePixel) + sizeof(PixelCost)) +
+				_records * sizeof(OcclusionRecord);
+		}
+	}
+
+	bool ReadCheckpoint(const char* _path, RenderCheckpoint& _checkpoint)
+	{
+		std::ifstream file(_path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) return false;
+		const std::uint64_t fileSize = (std::uint64_t)file.tellg();
+		file.seekg(0);
+
+		CheckpointHeader header, expected;
+		FillLayout(expected);
+		if (fileSize < sizeof(header)) return false;
+		file.read((char*)&header, sizeof(header));
+		if (!file || std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+			header.version != expected.version || header.endianTag != expected.endianTag ||
+			header.headerSize != expected.headerSize || header.realSize != expected.realSize ||
+			header.colorSize != expected.colorSize || header.surfaceSize != expected.surfaceSize ||
+			header.costSize != expected.costSize || header.occlusionSize != expected.occlusionSize) return false;
+		if (header.width <= 0 || header.height <= 0 || header.occlusionRecords < 0) return false;
+		const std::uint64_t pixels = (std::uint64_t)header.width * header.height;
+		if (fileSize != GetFileSize(pixels, (std::uint64_t)header.occlusionRecords)) return false;
+
+		_checkpoint.sceneKey = header.sceneKey;
+		_checkpoint.camera = header.camera;
+		_checkpoint.width = header.width;
+		_checkpoint.height = header.height;
+		_checkpoint.pass = header.pass;
+		_checkpoint.passes = header.passes;
+		_checkpoint.row = header.row;
+		_checkpoint.traces = header.traces;
+		_checkpoint.elapsedMs = header.elapsedMs;
+
+		_checkpoint.image.resize((size_t)pixels);
+		_checkpoint.accumulation.resize((size_t)pixels);
+		_checkpoint.samples.resize((size_t)pixels);
+		_checkpoint.surfaces.resize((size_t)pixels);
+		_checkpoint.costs.resize((size_t)pixels);
+		_checkpoint.occlusion.resize((size_t)header.occlusionRecords);
+		file.read((char*)_checkpoint.image.data(), (std::streamsize)(pixels * sizeof(ColorPixel)));
+		file.read((char*)_checkpoint.accumulation.data(), (std::streamsize)(pixels * sizeof(ColorPixel)));
+		file.read((char*)_checkpoint.samples.data(), (std::streamsize)(pixels * sizeof(int)));
+		file.read((char*)_checkpoint.surfaces.data(), (std::streamsize)(pixels * sizeof(SurfacePixel)));
+		file.read((char*)_checkpoint.costs.data(), (std::streamsize)(pixels * sizeof(PixelCost)));
+		file.read((char*)_checkpoint.occlusion.data(), (std::streamsize)(_checkpoint.occlusion.size() * sizeof(OcclusionRecord)));
+		return (bool)file;
+	}
+
+	bool WriteCheckpoint(const char* _path, const RenderCheckpoint& _checkpoint)
+	{
+		const size_t pixels = (size_t)_checkpoint.width * _checkpoint.height;
+		if (pixels == 0 || _checkpoint.image.size() != pixels || _checkpoint.accumulation.size() != pixels ||
+			_checkpoint.samples.size() != pixels || _checkpoint.surfaces.size() != pixels || _checkpoint.costs.size() != pixels) return false;
+		TimelineScope scope("Write checkpoint");
+
+		CheckpointHeader header;
+		FillLayout(header);
+		header.sceneKey = _checkpoint.sceneKey;
+		header.camera = _checkpoint.camera;
+		header.width = _checkpoint.width;
+		header.height = _checkpoint.height;
+		header.pass = _checkpoint.pass;
+		header.passes = _checkpoint.passes;
+		header.row = _checkpoint.row;
+		header.traces = _checkpoint.traces;
+		header.elapsedMs = _checkpoint.elapsedMs;
+		header.occlusionRecords = (std::int32_t)_checkpoint.occlusion.size();
+
+		std::string tempPath = std::string(_path) + ".tmp";
+		bool written;
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) return false;
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)_checkpoint.image.data(), (std::streamsize)(pixels * sizeof(ColorPixel)));
+			file.write((const char*)_checkpoint.accumulation.data(), (std::streamsize)(pixels * sizeof(ColorPixel)));
+			file.write((const char*)_checkpoint.samples.data(), (std::streamsize)(pixels * sizeof(int)));
+			file.write((const char*)_checkpoint.surfaces.data(), (std::streamsize)(pixels * sizeof(SurfacePixel)));
+			file.write((const char*)_checkpoint.costs.data(), (std::streamsize)(pixels * sizeof(PixelCost)));
+			file.write((const char*)_checkpoint.occlusion.data(), (std::streamsize)(_checkpoint.occlusion.size() * sizeof(OcclusionRecord)));
+			file.close();
+			written = !file.fail();
+		}
+		if (!written)
+		{
+			std::remove(tempPath.c_str());
+			return false;
+		}
+		// Flushed before it replaces the last checkpoint, which has to survive the machine going down
+		return CommitFile(tempPath.c_str(), _path, true);
+	}
+
+	bool CheckpointWriter::Write(const std::string& _path, RenderCheckpoint& _checkpoint)
+	{
+		if (fWriting) return false;
+		// The last worker has finished, it only needs joining
+		if (worker.joinable()) worker.join();
+
+		std::swap(pending, _checkpoint);
+		pendingPath = _path;
+		fWriting = true;
+		worker = std::thread([this]()
+		{
+			fLastWritten = WriteCheckpoint(pendingPath.c_str(), pending);
+			fWriting = false;
+		});
+		return true;
+	}
+
+	bool CheckpointWriter::Wait()
+	{
+		if (worker.joinable()) worker.join();
+		return fLastWritten;
+	}
+}
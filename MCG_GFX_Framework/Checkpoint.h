@@ -0,0 +1,100 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "SceneSnapshot.h"
+#include "OcclusionCache.h"
+
+namespace MRT
+{
+	// Current checkpoint format version, bumped whenever the header or plane layout changes
+	const std::uint32_t checkpointVersion{ 2 };
+
+	// RenderCheckpoint
+	// - Everything a progressive render needs to carry on where it stopped
+	// - Samples are placed by their index and seeded from their ray, so the pass, row and
+	//   trace count are the whole sampler state, resuming traces the same samples again
+	struct RenderCheckpoint
+	{
+		// Hash of the scene and render settings the planes were traced with
+		std::uint64_t sceneKey{ 0 };
+		SnapshotCamera camera;
+		int width{ 0 }, height{ 0 };
+
+		// Progressive state (see RayTracer::RenderProgressive)
+		int pass{ 0 }, passes{ 0 }, row{ 0 };
+		long long traces{ 0 };
+		float elapsedMs{ 0 };
+
+		// The camera planes, row major
+		std::vector<ColorPixel> image, accumulation;
+		std::vector<int> samples;
+		std::vector<SurfacePixel> surfaces;
+		std::vector<PixelCost> costs;
+
+		// Ambient occlusion records in insert order, the cache the remaining passes are shaded from
+		std::vector<OcclusionRecord> occlusion;
+	};
+
+	// Read a checkpoint file
+	// @param _path : The file to read
+	// @param _checkpoint : Returned checkpoint
+	// @returns bool : false if the file is missing, truncated or from a build with a different layout
+	bool ReadCheckpoint(const char* _path, RenderCheckpoint& _checkpoint);
+
+	// Write a checkpoint file
+	// Written to "<path>.tmp" first and renamed over the path once complete, the last
+	// checkpoint survives a process killed part way through writing the next
+	// @param _path : The file to write
+	// @param _checkpoint : The checkpoint
+	// @returns bool : true on success
+	bool WriteCheckpoint(const char* _path, const RenderCheckpoint& _checkpoint);
+
+	// CheckpointWriter
+	// - Writes checkpoints on a background thread so the render carries on meanwhile
+	// - A checkpoint handed over while the last one is still being written is dropped
+	//   instead of waiting, the next one catches up
+	// - Buffers are swapped with the caller, so repeated checkpoints dont allocate
+	class CheckpointWriter
+	{
+	private:
+		std::thread worker;
+		std::atomic<bool> fWriting{ false };
+		// Result of the last finished write
+		std::atomic<bool> fLastWritten{ false };
+		RenderCheckpoint pending;
+		std::string pendingPath;
+
+	public:
+		// Start writing a checkpoint
+		// @param _path : The file to write
+		// @param _checkpoint : The checkpoint, swapped with the buffers of the last write
+		// @returns bool : false if a write is still running (nothing is written)
+		bool Write(const std::string& _path, RenderCheckpoint& _checkpoint);
+
+		// Wait for the running write to finish
+		// @returns bool : true if the last write succeeded
+		bool Wait();
+
+		// Check a write is running
+		// @returns bool : true while writing
+		bool IsWriting() const { return fWriting; }
+
+		CheckpointWriter() = default;
+		~CheckpointWriter() { Wait(); }
+
+		CheckpointWriter(const CheckpointWriter&) = delete;
+		CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+	};
+}
+
+#endif // !_CHECKPOINT_H_
@@ -0,0 +1,360 @@
+#include "ChunkedScene.h"
+
+// Included libraries
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+// Core modules
+#include "Sphere.h"
+#include "Circle.h"
+
+// Chunked Scene
+namespace MRT
+{
+	namespace
+	{
+		const char chunkIndexMagic[8]{ 'M', 'R', 'T', 'C', 'H', 'U', 'N', 'K' };
+		const std::uint32_t chunkIndexEndianTag{ 0x01020304u };
+
+		// Append records to a file
+		// @param _fresh : Start the file over, drops anything left by an earlier build
+		template <typename Record>
+		bool AppendRecords(const std::string& _path, const std::vector<Record>& _records, bool _fresh)
+		{
+			if (_records.empty()) return true;
+			std::FILE* file = std::fopen(_path.c_str(), _fresh ? "wb" : "ab");
+			if (file == nullptr) return false;
+			bool written = std::fwrite(_records.data(), sizeof(Record), _records.size(), file) == _records.size();
+			return (std::fclose(file) == 0) && written;
+		}
+
+		// Read spilled records back in front of the buffered ones, then remove the file
+		template <typename Record>
+		bool ReadRecords(const std::string& _path, std::uint32_t _count, std::vector<Record>& _records)
+		{
+			if (_count == 0) return true;
+			std::vector<Record> spilled(_count);
+			std::FILE* file = std::fopen(_path.c_str(), "rb");
+			if (file == nullptr) return false;
+			bool read = std::fread(spilled.data(), sizeof(Record), _count, file) == _count;
+			std::fclose(file);
+			std::remove(_path.c_str());
+			if (!read) return false;
+
+			spilled.insert(spilled.end(), _records.begin(), _records.end());
+			_records.swap(spilled);
+			return true;
+		}
+	}
+
+	std::string GetChunkPath(const std::string& _path, int _chunk)
+	{
+		return _path + "." + std::to_string(_chunk);
+	}
+
+	int ChunkBuilder::GetCell(rvec3 _point)
+	{
+		rvec3 local = (_point - gridMin) * cellScale;
+		int x = glm::max(0, glm::min(gridSize - 1, (int)local.x));
+		int y = glm::max(0, glm::min(gridSize - 1, (int)local.y));
+		int z = glm::max(0, glm::min(gridSize - 1, (int)local.z));
+		return (z * gridSize + y) * gridSize + x;
+	}
+
+	std::string ChunkBuilder::GetCellPath(int _cell, char _kind)
+	{
+		return GetChunkPath(path, _cell) + "." + _kind + ".tmp";
+	}
+
+	bool ChunkBuilder::SpillCell(int _cell)
+	{
+		Cell& cell = cells[_cell];
+		if (!AppendRecords(GetCellPath(_cell, 's'), cell.spheres, cell.spilledSpheres == 0) ||
+			!AppendRecords(GetCellPath(_cell, 'c'), cell.circles, cell.spilledCircles == 0))
+		{
+			fFailed = true;
+			return false;
+		}
+		cell.spilledSpheres += (std::uint32_t)cell.spheres.size();
+		cell.spilledCircles += (std::uint32_t)cell.circles.size();
+		cell.spheres.clear();
+		cell.circles.clear();
+		return true;
+	}
+
+	bool ChunkBuilder::Begin(const char* _path, rvec3 _boundsMin, rvec3 _boundsMax, int _gridSize)
+	{
+		if (fOpen || _path == nullptr) return false;
+		rvec3 extent = _boundsMax - _boundsMin;
+		if (extent.x < 0 || extent.y < 0 || extent.z < 0) return false;
+
+		path = _path;
+		gridSize = glm::max(1, glm::min(16, _gridSize));
+		gridMin = _boundsMin;
+		// Flat axes get a single cell
+		for (int axis = 0; axis < 3; ++axis)
+			cellScale[axis] = extent[axis] > 0 ? gridSize / extent[axis] : 0;
+		cells.assign((size_t)gridSize * gridSize * gridSize, Cell());
+		fOpen = true;
+		fFailed = false;
+		return true;
+	}
+
+	bool ChunkBuilder::AddSphere(const SphereRecord& _record)
+	{
+		if (!fOpen || fFailed) return false;
+		int cell = GetCell(_record.position);
+		cells[cell].spheres.push_back(_record);
+		return cells[cell].spheres.size() < cellBufferSize || SpillCell(cell);
+	}
+
+	bool ChunkBuilder::AddCircle(const CircleRecord& _record)
+	{
+		if (!fOpen || fFailed) return false;
+		int cell = GetCell(_record.position);
+		cells[cell].circles.push_back(_record);
+		return cells[cell].circles.size() < cellBufferSize || SpillCell(cell);
+	}
+
+	bool ChunkBuilder::Finish(const SnapshotCamera& _camera)
+	{
+		if (!fOpen || fFailed)
+		{
+			Abort();
+			return false;
+		}
+
+		std::vector<ChunkInfo> chunks;
+		std::vector<BVHBuildItem> items;
+		std::vector<BVHNode> nodes;
+		std::vector<unsigned int> refs;
+		for (int c = 0; c < (int)cells.size(); ++c)
+		{
+			Cell& cell = cells[c];
+			if (!ReadRecords(GetCellPath(c, 's'), cell.spilledSpheres, cell.spheres) ||
+				!ReadRecords(GetCellPath(c, 'c'), cell.spilledCircles, cell.circles))
+			{
+				Abort();
+				return false;
+			}
+			if (cell.spheres.empty() && cell.circles.empty()) continue;
+
+			// Build the chunk's own BVH
+			items.resize(cell.spheres.size() + cell.circles.size());
+			for (size_t i = 0; i < cell.spheres.size(); ++i)
+			{
+				items[i].ref = MakePrimitiveRef(PrimitiveType::Sphere, (unsigned int)i);
+				Sphere::GetRecordBounds(cell.spheres[i], items[i].boundsMin, items[i].boundsMax);
+			}
+			for (size_t i = 0; i < cell.circles.size(); ++i)
+			{
+				BVHBuildItem& item = items[cell.spheres.size() + i];
+				item.ref = MakePrimitiveRef(PrimitiveType::Circle, (unsigned int)i);
+				Circle::GetRecordBounds(cell.circles[i], item.boundsMin, item.boundsMax);
+			}
+			BuildBVH(items, nodes, refs);
+
+			SceneView scene;
+			scene.spheres = cell.spheres.data();
+			scene.circles = cell.circles.data();
+			scene.nodes = nodes.data();
+			scene.refs = refs.data();
+			scene.sphereCount = (int)cell.spheres.size();
+			scene.circleCount = (int)cell.circles.size();
+			scene.nodeCount = (int)nodes.size();
+			scene.refCount = (int)refs.size();
+
+			std::string chunkPath = GetChunkPath(path, (int)chunks.size());
+			if (!WriteSnapshot(chunkPath.c_str(), scene, _camera))
+			{
+				Abort();
+				return false;
+			}
+
+			ChunkInfo info;
+			info.boundsMin = nodes[0].boundsMin;
+			info.boundsMax = nodes[0].boundsMax;
+			info.sphereCount = (std::uint32_t)scene.sphereCount;
+			info.circleCount = (std::uint32_t)scene.circleCount;
+			info.fileSize = (std::uint64_t)std::ifstream(chunkPath, std::ios::binary | std::ios::ate).tellg();
+			chunks.push_back(info);
+
+			// Free the cell before the next chunk is built
+			std::vector<SphereRecord>().swap(cell.spheres);
+			std::vector<CircleRecord>().swap(cell.circles);
+			cell.spilledSpheres = cell.spilledCircles = 0;
+		}
+
+		ChunkIndexHeader header;
+		std::memcpy(header.magic, chunkIndexMagic, sizeof(chunkIndexMagic));
+		header.version = chunkIndexVersion;
+		header.endianTag = chunkIndexEndianTag;
+		header.headerSize = sizeof(ChunkIndexHeader);
+		header.chunkSize = sizeof(ChunkInfo);
+		header.realSize = sizeof(real);
+		header.chunkCount = (std::uint32_t)chunks.size();
+		header.camera = _camera;
+
+		// The index goes last and is swapped in whole, it never points at missing chunks
+		std::string tempPath = path + ".tmp";
+		bool written;
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write((const char*)&header, sizeof(header));
+			if (!chunks.empty()) file.write((const char*)chunks.data(), (std::streamsize)(chunks.size() * sizeof(ChunkInfo)));
+			file.close();
+			written = !file.fail();
+		}
+#ifdef _WIN32
+		// rename doesnt replace existing files on windows
+		if (written) std::remove(path.c_str());
+#endif
+		if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0)
+		{
+			std::remove(tempPath.c_str());
+			Abort();
+			return false;
+		}
+
+		cells.clear();
+		fOpen = false;
+		return true;
+	}
+
+	void ChunkBuilder::Abort()
+	{
+		if (!fOpen) return;
+		for (int c = 0; c < (int)cells.size(); ++c)
+		{
+			if (cells[c].spilledSpheres > 0) std::remove(GetCellPath(c, 's').c_str());
+			if (cells[c].spilledCircles > 0) std::remove(GetCellPath(c, 'c').c_str());
+		}
+		cells.clear();
+		fOpen = false;
+	}
+
+	ChunkBuilder::~ChunkBuilder()
+	{
+		Abort();
+	}
+
+	void ChunkCache::Evict(int _chunk)
+	{
+		ResidentChunk& chunk = resident[_chunk];
+		if (!chunk.file.IsOpen()) return;
+		residentBytes -= chunk.file.GetSize();
+		chunk.file.Close();
+		chunk.scene = SceneView();
+		++evictions;
+	}
+
+	bool ChunkCache::Open(const char* _path)
+	{
+		Close();
+
+		std::ifstream file(_path, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		// Check the index was written by a compatible build
+		ChunkIndexHeader header;
+		if (!file.read((char*)&header, sizeof(header))) return false;
+		if (std::memcmp(header.magic, chunkIndexMagic, sizeof(chunkIndexMagic)) != 0) return false;
+		if (header.version != chunkIndexVersion || header.endianTag != chunkIndexEndianTag) return false;
+		if (header.headerSize != sizeof(ChunkIndexHeader) || header.chunkSize != sizeof(ChunkInfo) ||
+			header.realSize != sizeof(real)) return false;
+
+		std::vector<ChunkInfo> entries(header.chunkCount);
+		if (header.chunkCount > 0 && !file.read((char*)entries.data(), (std::streamsize)(entries.size() * sizeof(ChunkInfo)))) return false;
+
+		// Build the top level BVH over the chunk bounds
+		std::vector<BVHBuildItem> items(entries.size());
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			items[i].boundsMin = entries[i].boundsMin;
+			items[i].boundsMax = entries[i].boundsMax;
+			items[i].ref = MakePrimitiveRef(PrimitiveType::Generic, (unsigned int)i);
+		}
+		if (!items.empty()) BuildBVH(items, nodes, refs);
+
+		path = _path;
+		chunks.swap(entries);
+		resident = std::vector<ResidentChunk>(chunks.size());
+		camera = header.camera;
+		fOpen = true;
+		return true;
+	}
+
+	void ChunkCache::Close()
+	{
+		path.clear();
+		chunks.clear();
+		resident = std::vector<ResidentChunk>();
+		nodes.clear();
+		refs.clear();
+		camera = SnapshotCamera();
+		residentBytes = 0;
+		useClock = 0;
+		loads = evictions = 0;
+		fOpen = false;
+	}
+
+	const SceneView* ChunkCache::Acquire(int _chunk)
+	{
+		if (!fOpen || _chunk < 0 || _chunk >= (int)chunks.size()) return nullptr;
+		ResidentChunk& chunk = resident[_chunk];
+		chunk.lastUse = ++useClock;
+		if (chunk.file.IsOpen()) return &chunk.scene;
+
+		// Make room first so the budget holds while mapping
+		const size_t size = (size_t)chunks[_chunk].fileSize;
+		while (residentBytes > 0 && residentBytes + size > budget)
+		{
+			int oldest = -1;
+			for (int i = 0; i < (int)resident.size(); ++i)
+			{
+				if (resident[i].file.IsOpen() && (oldest < 0 || resident[i].lastUse < resident[oldest].lastUse))
+					oldest = i;
+			}
+			if (oldest < 0) break;
+			Evict(oldest);
+		}
+
+		SnapshotCamera state;
+		std::string chunkPath = GetChunkPath(path, _chunk);
+		if (!chunk.file.Open(chunkPath.c_str()) ||
+			!ReadSnapshot(chunk.file.GetData(), chunk.file.GetSize(), chunk.scene, state) ||
+			chunk.scene.sphereCount != (int)chunks[_chunk].sphereCount ||
+			chunk.scene.circleCount != (int)chunks[_chunk].circleCount)
+		{
+			chunk.file.Close();
+			chunk.scene = SceneView();
+			return nullptr;
+		}
+
+		residentBytes += chunk.file.GetSize();
+		++loads;
+		return &chunk.scene;
+	}
+
+	void ChunkCache::SetBudget(size_t _bytes)
+	{
+		budget = _bytes;
+	}
+
+	void ChunkCache::Swap(ChunkCache& _other)
+	{
+		std::swap(path, _other.path);
+		chunks.swap(_other.chunks);
+		resident.swap(_other.resident);
+		std::swap(camera, _other.camera);
+		nodes.swap(_other.nodes);
+		refs.swap(_other.refs);
+		std::swap(residentBytes, _other.residentBytes);
+		std::swap(useClock, _other.useClock);
+		std::swap(loads, _other.loads);
+		std::swap(evictions, _other.evictions);
+		std::swap(fOpen, _other.fOpen);
+	}
+}
@@ -0,0 +1,270 @@
+#ifndef _CHUNKEDSCENE_H_
+#define _CHUNKEDSCENE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "BVH.h"
+#include "MappedFile.h"
+#include "SceneSnapshot.h"
+
+namespace MRT
+{
+	// Current chunk index format version, bumped whenever ChunkInfo or the header changes
+	const std::uint32_t chunkIndexVersion{ 1 };
+
+	// ChunkInfo
+	// - An entry in a chunked scene index
+	struct ChunkInfo
+	{
+		// Bounds of every primitive in the chunk, chunks can overlap
+		rvec3 boundsMin, boundsMax;
+		std::uint32_t sphereCount{ 0 }, circleCount{ 0 };
+		// Size of the chunk file, used to keep the cache inside its budget before mapping
+		std::uint64_t fileSize{ 0 };
+	};
+
+	// ChunkIndexHeader
+	// - Start of a chunked scene index file, followed by one ChunkInfo per chunk
+	// - Each chunk is a scene snapshot of its own, stored next to the index as "<index>.<chunk>"
+	struct ChunkIndexHeader
+	{
+		char magic[8]{ 0 };
+		std::uint32_t version{ 0 };
+		// Written as 0x01020304, a different byte order reads back differently
+		std::uint32_t endianTag{ 0 };
+		std::uint32_t headerSize{ 0 }, chunkSize{ 0 };
+		// Size of the scalar the file was written with (see Precision.h)
+		std::uint32_t realSize{ 0 };
+		std::uint32_t chunkCount{ 0 };
+		SnapshotCamera camera;
+	};
+
+	// Get the file a chunk is stored in
+	// @param _path : The chunk index file
+	// @param _chunk : The chunk index
+	// @returns std::string : "<path>.<chunk>"
+	std::string GetChunkPath(const std::string& _path, int _chunk);
+
+	// ChunkBuilder
+	// - Splits a stream of records into a grid of spatial chunks on disk
+	// - Records are binned by their center, so only a small buffer per cell is kept in memory
+	//   and full buffers are spilled to "<index>.<cell>.s.tmp" / ".c.tmp"
+	// - Finish builds each chunk's BVH one chunk at a time, the largest chunk has to fit in memory
+	class ChunkBuilder
+	{
+	private:
+		// Records buffered per cell before theyre spilled
+		static const int cellBufferSize{ 256 };
+
+		// Records of a grid cell waiting to be written
+		struct Cell
+		{
+			std::vector<SphereRecord> spheres;
+			std::vector<CircleRecord> circles;
+			// Records already spilled to the cell's temporary files
+			std::uint32_t spilledSpheres{ 0 }, spilledCircles{ 0 };
+		};
+
+		std::string path;
+		std::vector<Cell> cells;
+		rvec3 gridMin, cellScale;
+		int gridSize{ 0 };
+		bool fOpen{ false };
+		bool fFailed{ false };
+
+		// Get the cell a point is binned into
+		// @param _point : The point
+		// @returns int : The cell index
+		int GetCell(rvec3 _point);
+
+		// Append a cell's buffered records to its temporary files
+		// @param _cell : The cell index
+		// @returns bool : false if the files couldnt be written
+		bool SpillCell(int _cell);
+
+		// Get a cell's temporary file
+		// @param _cell : The cell index
+		// @param _kind : 's' for spheres, 'c' for circles
+		// @returns std::string : The file path
+		std::string GetCellPath(int _cell, char _kind);
+
+	public:
+		// Start a chunked scene
+		// @param _path : The chunk index file to write, chunks are written next to it
+		// @param _boundsMin : Minimum of the scene bounds, records outside are clamped into the grid
+		// @param _boundsMax : Maximum of the scene bounds
+		// @param _gridSize : Cells per axis (1 to 16)
+		// @returns bool : false if already started or the bounds are empty
+		bool Begin(const char* _path, rvec3 _boundsMin, rvec3 _boundsMax, int _gridSize);
+
+		// Add a sphere
+		// @param _record : The sphere record
+		// @returns bool : false if not started or a spill failed
+		bool AddSphere(const SphereRecord& _record);
+
+		// Add a circle
+		// @param _record : The circle record
+		// @returns bool : false if not started or a spill failed
+		bool AddCircle(const CircleRecord& _record);
+
+		// Write every chunk and the index, empty cells are dropped
+		// @param _camera : The camera state stored in the index and every chunk
+		// @returns bool : true on success
+		bool Finish(const SnapshotCamera& _camera);
+
+		// Throw the scene away and remove the temporary files
+		void Abort();
+
+		ChunkBuilder() {}
+		ChunkBuilder(const ChunkBuilder&) = delete;
+		ChunkBuilder& operator=(const ChunkBuilder&) = delete;
+		~ChunkBuilder();
+	};
+
+	// ChunkCache
+	// - Pages the chunks of a chunked scene in and out on demand
+	// - Chunks are mapped in place (see MappedFile) and unmapped least recently used first
+	//   once the mapped bytes go over the budget, so memory use stays bounded
+	// - A top level BVH over the chunk bounds finds the chunks a ray reaches
+	class ChunkCache
+	{
+	private:
+		// A mapped chunk
+		struct ResidentChunk
+		{
+			MappedFile file;
+			SceneView scene;
+			// Acquire count when last used, the lowest is evicted first
+			long long lastUse{ 0 };
+		};
+
+		std::string path;
+		std::vector<ChunkInfo> chunks;
+		std::vector<ResidentChunk> resident;
+		SnapshotCamera camera;
+		// Top level BVH, references are chunk indices
+		std::vector<BVHNode> nodes;
+		std::vector<unsigned int> refs;
+
+		size_t budget{ (size_t)512 << 20 }, residentBytes{ 0 };
+		long long useClock{ 0 };
+		int loads{ 0 }, evictions{ 0 };
+		bool fOpen{ false };
+
+		// Unmap a chunk
+		// @param _chunk : The chunk index
+		void Evict(int _chunk);
+
+	public:
+		// Open a chunk index, no chunk is mapped until its acquired
+		// @param _path : The index file written by ChunkBuilder
+		// @returns bool : true if the index is valid
+		bool Open(const char* _path);
+
+		// Unmap every chunk and forget the index
+		void Close();
+
+		// Check an index is open
+		// @returns bool : true if open
+		bool IsOpen() { return fOpen; }
+
+		// Get the amount of chunks
+		// @returns int : The chunk count
+		int GetChunkCount() { return (int)chunks.size(); }
+
+		// Get a chunks index entry
+		// @param _chunk : The chunk index
+		// @returns const ChunkInfo& : The entry
+		const ChunkInfo& GetChunk(int _chunk) { return chunks[_chunk]; }
+
+		// Get the camera state stored in the index
+		// @returns const SnapshotCamera& : The camera state
+		const SnapshotCamera& GetCamera() { return camera; }
+
+		// Check a chunk is mapped
+		// @param _chunk : The chunk index
+		// @returns bool : true if mapped
+		bool IsResident(int _chunk) { return resident[_chunk].file.IsOpen(); }
+
+		// Map a chunk, evicting others to stay inside the budget
+		// - Views returned by earlier calls can be unmapped, only use the latest
+		// - A chunk larger than the whole budget is still mapped on its own
+		// @param _chunk : The chunk index
+		// @returns const SceneView* : The chunk scene, nullptr if the file is missing or invalid
+		const SceneView* Acquire(int _chunk);
+
+		// Find the chunks a ray reaches
+		// @param _origin : The ray origin
+		// @param _direction : The ray direction
+		// @param _maxLength : How far along the ray to look
+		// @param _visit : Called with the chunk index and the distance the ray enters its bounds
+		template <typename Visit>
+		void GatherChunks(rvec3 _origin, rvec3 _direction, real _maxLength, Visit&& _visit);
+
+		// Set how many bytes of chunks can be mapped at once
+		// @param _bytes : The budget
+		void SetBudget(size_t _bytes);
+
+		// Get how many bytes of chunks are mapped
+		// @returns size_t : The mapped bytes
+		size_t GetResidentBytes() { return residentBytes; }
+
+		// Get the amount of chunk loads since opening
+		// @returns int : The load count
+		int GetLoads() { return loads; }
+
+		// Get the amount of chunk evictions since opening
+		// @returns int : The eviction count
+		int GetEvictions() { return evictions; }
+
+		// Swap the open index and mapped chunks with another ChunkCache, budgets stay put
+		// @param _other : The cache to swap with
+		void Swap(ChunkCache& _other);
+
+		ChunkCache() {}
+		ChunkCache(const ChunkCache&) = delete;
+		ChunkCache& operator=(const ChunkCache&) = delete;
+	};
+
+	template <typename Visit>
+	void ChunkCache::GatherChunks(rvec3 _origin, rvec3 _direction, real _maxLength, Visit&& _visit)
+	{
+		if (nodes.empty()) return;
+		rvec3 invD(1 / _direction.x, 1 / _direction.y, 1 / _direction.z);
+
+		int stack[bvhMaxDepth + 1];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const BVHNode& node = nodes[stack[--top]];
+			real near;
+			if (!IntersectBounds(node, _origin, invD, _maxLength, near)) continue;
+
+			if (node.count > 0)
+			{
+				// Leaf bounds cover several chunks, check each chunk on its own
+				for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+				{
+					const int chunk = (int)GetRefIndex(refs[i]);
+					BVHNode bounds;
+					bounds.boundsMin = chunks[chunk].boundsMin;
+					bounds.boundsMax = chunks[chunk].boundsMax;
+					if (IntersectBounds(bounds, _origin, invD, _maxLength, near)) _visit(chunk, near);
+				}
+				continue;
+			}
+			stack[top++] = node.leftFirst;
+			stack[top++] = node.leftFirst + 1;
+		}
+	}
+}
+
+#endif // !_CHUNKEDSCENE_H_
@@ -5,31 +5,59 @@ namespace MRT
 {
 	bool Circle::Intersect(Ray& _ray)
 	{
-		// Get the ray length by checking the entire plane for an intersection
-		float mL = IntersectPlane(_ray);
-		// If length is 0, theres no intersection
-		if (mL == 0) return false;
+		return IntersectRecord(GetRecord(), _ray);
+	}
 
-		// Check if intersect length is greater than current ray length
-		if (_ray.GetLength() < mL) return false;
+	void Circle::GetBounds(rvec3& _min, rvec3& _max)
+	{
+		GetRecordBounds(GetRecord(), _min, _max);
+	}
 
-		// Get ray hit position
-		glm::fvec3 rH = _ray.GetOrigin() + (_ray.GetDirection() * mL);
-		// Get the length of the hit position to the circle center
-		glm::fvec3 c = rH - position;
+	bool Circle::IntersectRecord(const CircleRecord& _circle, Ray& _ray)
+	{
+		// Get ray origin and direction
+		rvec3 rO = _ray.GetOrigin(), rD = _ray.GetDirection();
+		real mL = _ray.GetLength();
+		if (!IntersectRecordLength(_circle, rO, rD, mL)) return false;
 
-		// Get the dot product and see if the ray is projected inside the circle radius
-		// keeping it squared saves performance (dont need to sqrt the dot product)
-		if (glm::dot(c, c) > radiusSqr) return false;
+		// Get ray hit position
+		rvec3 rH = rO + (rD * mL);
+		rvec3 c = rH - _circle.position;
 
 		// Send hit information to the ray
-		HitInformation hitInfo{ mL, glm::normalize(direction * rH), color };
+		HitInformation hitInfo{ mL, glm::normalize(_circle.direction * rH), _circle.color, _circle.texture };
+		if (_circle.texture >= 0)
+		{
+			// Planar mapping, the texture is stretched over the circles bounding square
+			rvec3 n = glm::normalize(_circle.direction);
+			rvec3 tangent = glm::normalize(glm::cross(glm::abs(n.x) > 0.9f ? rvec3(0, 1, 0) : rvec3(1, 0, 0), n));
+			rvec3 bitangent = glm::cross(n, tangent);
+			real invDiameter = 0.5f / _circle.radius;
+			hitInfo.uv = glm::fvec2((float)(0.5f + (glm::dot(c, tangent) * invDiameter)), (float)(0.5f + (glm::dot(c, bitangent) * invDiameter)));
+			hitInfo.uvScale = (float)(2 * _circle.radius);
+		}
 		_ray.SetHitInfo(hitInfo);
 
 		return true;
 	}
 
-	Circle::Circle(glm::fvec3 _position, glm::fvec3 _direction, float _radius, ColorPixel _color)
+	void Circle::GetRecordBounds(const CircleRecord& _circle, rvec3& _min, rvec3& _max)
+	{
+		rvec3 extent(_circle.radius);
+		real lengthSqr = glm::dot(_circle.direction, _circle.direction);
+		if (lengthSqr > 0)
+		{
+			// A disc spans radius * sqrt(1 - n^2) along each axis
+			rvec3 n = _circle.direction / glm::sqrt(lengthSqr);
+			extent.x *= glm::sqrt(glm::max((real)0, 1 - n.x * n.x));
+			extent.y *= glm::sqrt(glm::max((real)0, 1 - n.y * n.y));
+			extent.z *= glm::sqrt(glm::max((real)0, 1 - n.z * n.z));
+		}
+		_min = _circle.position - extent;
+		_max = _circle.position + extent;
+	}
+
+	Circle::Circle(rvec3 _position, rvec3 _direction, real _radius, ColorPixel _color)
 		:
 		Plane(_position, _direction, _color),
 		radius{ _radius }
@@ -37,4 +65,4 @@ namespace MRT
 		// Precalculate the square of the radius
 		radiusSqr = radius * radius;
 	}
-}
\ No newline at end of file
+}
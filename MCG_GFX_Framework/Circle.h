@@ -12,23 +12,130 @@
 
 namespace MRT
 {
+	// CircleRecord
+	// - Flat copy of a circle used by the RayTracer scene arrays
+	// - Plain data, can be written to and mapped straight from disk
+	struct CircleRecord
+	{
+		rvec3 position, direction;
+		real radius{ 0 }, radiusSqr{ 0 };
+		ColorPixel color;
+		int texture{ -1 };
+	};
+
 	// Circle
 	// - Extends Plane
 	// - Used for creating 2D circles in a 3D environment
 	class Circle : public Plane
 	{
 	private:
-		float radius{ 0 }, radiusSqr{ 0 };
+		real radius{ 0 }, radiusSqr{ 0 };
 
 	public:
 		// Check if ray intersects circle
 		// Uses the algebraic form of a plane to calculate intersection
 		// @param _ray : The ray to check for an intersection
-		// @returns float : The ray length, if (> 0) intersection occurred
+		// @returns real : The ray length, if (> 0) intersection occurred
 		bool Intersect(Ray& _ray) override;
 
-		Circle(glm::fvec3 _position, glm::fvec3 _direction, float _radius, ColorPixel _color = { 1, 0, 0 });
+		// Get the bounding box of the circle
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		void GetBounds(rvec3& _min, rvec3& _max) override;
+
+		// Set the radius
+		// @param _radius : The new radius
+		void SetRadius(real _radius) { radius = _radius; radiusSqr = _radius * _radius; }
+
+		// Get the radius
+		// @returns real : The radius
+		real GetRadius() { return radius; }
+
+		// Get the primitive type
+		// @returns PrimitiveType : Always PrimitiveType::Circle
+		PrimitiveType GetType() override { return PrimitiveType::Circle; }
+
+		// Get a flat copy of the circle
+		// @returns CircleRecord : The circle data
+		CircleRecord GetRecord() { return { position, direction, radius, radiusSqr, color, texture }; }
+
+		// Check if ray intersects a circle record
+		// Shared by Circle objects and the RayTracer scene arrays
+		// @param _circle : The circle to check against
+		// @param _ray : The ray to check for an intersection
+		// @returns bool : true if intersecting
+		static bool IntersectRecord(const CircleRecord& _circle, Ray& _ray);
+
+		// Check if a ray intersects a circle record, only works out the distance
+		// Inline like Sphere::IntersectRecordLength
+		// @param _circle : The circle to check against
+		// @param _origin : The ray origin
+		// @param _direction : The unit ray direction
+		// @param _length : The ray length, set to the hit distance if the circle is hit closer
+		// @returns bool : true if intersecting
+		static bool IntersectRecordLength(const CircleRecord& _circle, const rvec3& _origin, const rvec3& _direction, real& _length);
+
+		// Check if a primary ray intersects a circle record, only works out the distance
+		// Like Sphere::IntersectPrimaryLength the origin terms are worked out once per frame
+		// @param _circle : The circle to check against
+		// @param _origin : The camera position
+		// @param _planeDistance : The distance from the camera to the circle plane along its direction,
+		//                         0 or less and no primary ray can hit the circle
+		// @param _direction : The unit ray direction
+		// @param _length : The ray length, set to the hit distance if the circle is hit closer
+		// @returns bool : true if intersecting
+		static bool IntersectPrimaryLength(const CircleRecord& _circle, const rvec3& _origin, real _planeDistance, const rvec3& _direction, real& _length);
+
+		// Get the bounding box of a circle record
+		// Only extends along the axes the circle is not facing
+		// @param _circle : The circle to bound
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		static void GetRecordBounds(const CircleRecord& _circle, rvec3& _min, rvec3& _max);
+
+		Circle(rvec3 _position, rvec3 _direction, real _radius, ColorPixel _color = { 1, 0, 0 });
 	};
+
+	inline bool Circle::IntersectRecordLength(const CircleRecord& _circle, const rvec3& _origin, const rvec3& _direction, real& _length)
+	{
+		const rvec3& rO = _origin;
+		const rvec3& rD = _direction;
+
+		// Check the entire plane for an intersection (see Plane::IntersectPlane)
+		real d = glm::dot(rD, _circle.direction);
+		if (d <= (real)1e-6) return false;
+		real mL = glm::dot(_circle.position - rO, _circle.direction) / d;
+		// If length is 0 or less, the plane is behind the ray
+		if (mL <= 0) return false;
+
+		// Check if intersect length is greater than current ray length
+		if (_length < mL) return false;
+
+		// Get the length of the hit position to the circle center
+		rvec3 c = (rO + (rD * mL)) - _circle.position;
+
+		// Get the dot product and see if the ray is projected inside the circle radius
+		// keeping it squared saves performance (dont need to sqrt the dot product)
+		if (glm::dot(c, c) > _circle.radiusSqr) return false;
+
+		_length = mL;
+		return true;
+	}
+
+	inline bool Circle::IntersectPrimaryLength(const CircleRecord& _circle, const rvec3& _origin, real _planeDistance, const rvec3& _direction, real& _length)
+	{
+		real d = glm::dot(_direction, _circle.direction);
+		if (d <= (real)1e-6) return false;
+		real mL = _planeDistance / d;
+		if (_length < mL) return false;
+
+		// Hit position relative to the circle center
+		rvec3 c = (_origin + (_direction * mL)) - _circle.position;
+		if (glm::dot(c, c) > _circle.radiusSqr) return false;
+
+		_length = mL;
+		return true;
+	}
 }
 
 #endif // !_CIRCLE_H_
@@ -0,0 +1,76 @@
+#include "CostMap.h"
+
+// Included libraries
+#include <algorithm>
+#include <fstream>
+
+// Cost Map
+namespace MRT
+{
+	namespace
+	{
+		// Heatmap color stops, evenly spaced from cheapest to most expensive
+		const ColorPixel heatmapStops[]{
+			{ 0, 0, 0 },
+			{ 0.35f, 0, 0.6f },
+			{ 0.9f, 0.15f, 0.15f },
+			{ 1, 0.65f, 0 },
+			{ 1, 1, 1 }
+		};
+		const int heatmapStopCount{ (int)(sizeof(heatmapStops) / sizeof(heatmapStops[0])) };
+
+		// Get the heatmap color of a normalised cost
+		// @param _t : The cost (0 to 1.f)
+		// @returns ColorPixel : The color
+		ColorPixel GetHeatColor(float _t)
+		{
+			float position = std::max(0.f, std::min(1.f, _t)) * (heatmapStopCount - 1);
+			int stop = std::min((int)position, heatmapStopCount - 2);
+			float blend = position - stop;
+			const ColorPixel& a = heatmapStops[stop];
+			const ColorPixel& b = heatmapStops[stop + 1];
+			return { a.r + (b.r - a.r) * blend, a.g + (b.g - a.g) * blend, a.b + (b.b - a.b) * blend };
+		}
+	}
+
+	float GetCostValue(const PixelCost& _cost, CostMetric _metric)
+	{
+		switch (_metric)
+		{
+		case CostMetric::Tests: return _cost.tests;
+		case CostMetric::Steps: return _cost.steps;
+		case CostMetric::Samples: return _cost.samples;
+		default: return _cost.nanoseconds;
+		}
+	}
+
+	float BuildCostHeatmap(const PixelCost* _costs, int _count, CostMetric _metric, std::vector<ColorPixel>& _image)
+	{
+		_image.resize(_count);
+		if (_count <= 0) return 0;
+
+		// Find the 99th percentile
+		std::vector<float> values(_count);
+		for (int i = 0; i < _count; ++i)
+			values[i] = GetCostValue(_costs[i], _metric);
+		std::vector<float>::iterator percentile = values.begin() + (int)((_count - 1) * 0.99f);
+		std::nth_element(values.begin(), percentile, values.end());
+		float scale = *percentile;
+		// Fall back to the maximum when most pixels cost nothing
+		if (scale <= 0) scale = *std::max_element(values.begin(), values.end());
+
+		const float invScale = scale > 0 ? 1.f / scale : 0;
+		for (int i = 0; i < _count; ++i)
+			_image[i] = GetHeatColor(GetCostValue(_costs[i], _metric) * invScale);
+		return scale;
+	}
+
+	bool WriteCostBuffer(const char* _path, const PixelCost* _costs, int _count)
+	{
+		std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+		file.write((const char*)_costs, (std::streamsize)(sizeof(PixelCost) * (size_t)_count));
+		file.close();
+		return !file.fail();
+	}
+}
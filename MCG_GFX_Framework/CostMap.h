@@ -0,0 +1,47 @@
+#ifndef _COSTMAP_H_
+#define _COSTMAP_H_
+
+// Included libraries
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+
+namespace MRT
+{
+	// CostMetric
+	// - The part of a PixelCost shown by a heatmap
+	enum class CostMetric
+	{
+		Tests,
+		Steps,
+		Samples,
+		Time
+	};
+
+	// Get one metric of a pixel cost
+	// @param _cost : The pixel cost
+	// @param _metric : The metric to get
+	// @returns float : The metric value
+	float GetCostValue(const PixelCost& _cost, CostMetric _metric);
+
+	// Turn a cost plane into a false color heatmap
+	// - Goes black, purple, red, orange then white as the cost rises
+	// - Scaled so the 99th percentile is white, a few extreme pixels cant wash the rest of the image out
+	// @param _costs : The cost plane
+	// @param _count : The amount of pixels
+	// @param _metric : The metric to show
+	// @param _image : Returned heatmap, same layout as the cost plane
+	// @returns float : The metric value shown as white
+	float BuildCostHeatmap(const PixelCost* _costs, int _count, CostMetric _metric, std::vector<ColorPixel>& _image);
+
+	// Write a cost plane as a raw float buffer
+	// Four floats per pixel (tests, steps, samples, nanoseconds) in native byte order, row major from the top left
+	// @param _path : The file to write
+	// @param _costs : The cost plane
+	// @param _count : The amount of pixels
+	// @returns bool : true on success
+	bool WriteCostBuffer(const char* _path, const PixelCost* _costs, int _count);
+}
+
+#endif // !_COSTMAP_H_
@@ -0,0 +1,252 @@
+#include "Denoiser.h"
+
+// Included libraries
+#include <algorithm>
+
+// Core modules
+#include "Parallel.h"
+#include "Timeline.h"
+
+// SSE2 is always available on x64, use it when the compiler says so
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MRT_DENOISER_SSE
+#include <emmintrin.h>
+#endif
+
+// Denoiser
+namespace MRT
+{
+	namespace
+	{
+		// B3 spline a-trous filter taps
+		const float kernel[5]{ 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+		// Smallest depth used when comparing relative depths
+		const float depthEpsilon{ 1e-3f };
+
+		// Approximation of exp(-x) for x >= 0
+		// Uses the reciprocal of the 4th order taylor series, it never goes negative
+		// and is cheap enough to vectorise (the vector version gives the same results)
+		inline float ExpNeg(float _x)
+		{
+			return 1.f / (1.f + _x * (1.f + _x * (0.5f + _x * (1.f / 6.f + _x * (1.f / 24.f)))));
+		}
+
+#ifdef MRT_DENOISER_SSE
+		inline __m128 ExpNeg(__m128 _x)
+		{
+			__m128 p = _mm_add_ps(_mm_set1_ps(1.f / 6.f), _mm_mul_ps(_x, _mm_set1_ps(1.f / 24.f)));
+			p = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_x, p));
+			p = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(_x, p));
+			p = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(_x, p));
+			return _mm_div_ps(_mm_set1_ps(1.f), p);
+		}
+
+		inline __m128 Square(__m128 _x) { return _mm_mul_ps(_x, _x); }
+#endif
+	}
+
+	bool Denoiser::Reserve(int _pixels)
+	{
+		if (_pixels == bufferSize) return true;
+		Release();
+
+		for (int i = 0; i < 2; ++i)
+		{
+			colorR[i] = new float[_pixels];
+			colorG[i] = new float[_pixels];
+			colorB[i] = new float[_pixels];
+		}
+		normalX = new float[_pixels];
+		normalY = new float[_pixels];
+		normalZ = new float[_pixels];
+		depth = new float[_pixels];
+
+		bufferSize = _pixels;
+		return true;
+	}
+
+	void Denoiser::Release()
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			delete[] colorR[i]; colorR[i] = nullptr;
+			delete[] colorG[i]; colorG[i] = nullptr;
+			delete[] colorB[i]; colorB[i] = nullptr;
+		}
+		delete[] normalX; normalX = nullptr;
+		delete[] normalY; normalY = nullptr;
+		delete[] normalZ; normalZ = nullptr;
+		delete[] depth; depth = nullptr;
+		bufferSize = 0;
+		filtered = -1;
+	}
+
+	void Denoiser::FilterRow(int _y, int _width, int _height, int _step, int _src, float _invColor)
+	{
+		const float* sR = colorR[_src], * sG = colorG[_src], * sB = colorB[_src];
+		float* dR = colorR[_src ^ 1], * dG = colorG[_src ^ 1], * dB = colorB[_src ^ 1];
+		const float invNormal = 1.f / (sigmaNormal * sigmaNormal), invDepth = 1.f / (sigmaDepth * sigmaDepth);
+		const int row = _y * _width, reach = 2 * _step;
+
+		int x = 0;
+		while (x < _width)
+		{
+#ifdef MRT_DENOISER_SSE
+			// Filter 4 pixels at once when every horizontal tap is inside the image
+			if (x >= reach && x + 3 + reach < _width)
+			{
+				const int p = row + x;
+				__m128 pR = _mm_loadu_ps(sR + p), pG = _mm_loadu_ps(sG + p), pB = _mm_loadu_ps(sB + p),
+					pNX = _mm_loadu_ps(normalX + p), pNY = _mm_loadu_ps(normalY + p), pNZ = _mm_loadu_ps(normalZ + p),
+					pZ = _mm_loadu_ps(depth + p);
+				// Relative depth differences are scaled by the center depth
+				__m128 pInvZ = _mm_div_ps(_mm_set1_ps(1.f), _mm_add_ps(pZ, _mm_set1_ps(depthEpsilon)));
+				__m128 sumR = _mm_setzero_ps(), sumG = _mm_setzero_ps(), sumB = _mm_setzero_ps(), sumW = _mm_setzero_ps();
+
+				for (int ky = 0; ky < 5; ++ky)
+				{
+					int yy = _y + (ky - 2) * _step;
+					if (yy < 0 || yy >= _height) continue;
+					for (int kx = 0; kx < 5; ++kx)
+					{
+						const int q = yy * _width + x + (kx - 2) * _step;
+						__m128 qR = _mm_loadu_ps(sR + q), qG = _mm_loadu_ps(sG + q), qB = _mm_loadu_ps(sB + q);
+
+						__m128 dColor = _mm_add_ps(_mm_add_ps(Square(_mm_sub_ps(qR, pR)), Square(_mm_sub_ps(qG, pG))), Square(_mm_sub_ps(qB, pB)));
+						__m128 dNormal = _mm_add_ps(_mm_add_ps(
+							Square(_mm_sub_ps(_mm_loadu_ps(normalX + q), pNX)),
+							Square(_mm_sub_ps(_mm_loadu_ps(normalY + q), pNY))),
+							Square(_mm_sub_ps(_mm_loadu_ps(normalZ + q), pNZ)));
+						__m128 dDepth = Square(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(depth + q), pZ), pInvZ));
+
+						__m128 e = _mm_add_ps(_mm_add_ps(
+							_mm_mul_ps(dColor, _mm_set1_ps(_invColor)),
+							_mm_mul_ps(dNormal, _mm_set1_ps(invNormal))),
+							_mm_mul_ps(dDepth, _mm_set1_ps(invDepth)));
+						__m128 w = _mm_mul_ps(ExpNeg(e), _mm_set1_ps(kernel[ky] * kernel[kx]));
+
+						sumR = _mm_add_ps(sumR, _mm_mul_ps(qR, w));
+						sumG = _mm_add_ps(sumG, _mm_mul_ps(qG, w));
+						sumB = _mm_add_ps(sumB, _mm_mul_ps(qB, w));
+						sumW = _mm_add_ps(sumW, w);
+					}
+				}
+
+				// The center tap always has weight, sumW is never 0
+				_mm_storeu_ps(dR + p, _mm_div_ps(sumR, sumW));
+				_mm_storeu_ps(dG + p, _mm_div_ps(sumG, sumW));
+				_mm_storeu_ps(dB + p, _mm_div_ps(sumB, sumW));
+				x += 4;
+				continue;
+			}
+#endif
+			// Scalar path, used on image borders (and when SSE isnt available)
+			const int p = row + x;
+			const float pInvZ = 1.f / (depth[p] + depthEpsilon);
+			float sumR = 0, sumG = 0, sumB = 0, sumW = 0;
+
+			for (int ky = 0; ky < 5; ++ky)
+			{
+				int yy = _y + (ky - 2) * _step;
+				if (yy < 0 || yy >= _height) continue;
+				for (int kx = 0; kx < 5; ++kx)
+				{
+					int xx = x + (kx - 2) * _step;
+					if (xx < 0 || xx >= _width) continue;
+					const int q = yy * _width + xx;
+
+					float cR = sR[q] - sR[p], cG = sG[q] - sG[p], cB = sB[q] - sB[p];
+					float nX = normalX[q] - normalX[p], nY = normalY[q] - normalY[p], nZ = normalZ[q] - normalZ[p];
+					float z = (depth[q] - depth[p]) * pInvZ;
+
+					float e = (cR * cR + cG * cG + cB * cB) * _invColor +
+						(nX * nX + nY * nY + nZ * nZ) * invNormal +
+						(z * z) * invDepth;
+					float w = ExpNeg(e) * (kernel[ky] * kernel[kx]);
+
+					sumR += sR[q] * w;
+					sumG += sG[q] * w;
+					sumB += sB[q] * w;
+					sumW += w;
+				}
+			}
+
+			dR[p] = sumR / sumW;
+			dG[p] = sumG / sumW;
+			dB[p] = sumB / sumW;
+			++x;
+		}
+	}
+
+	void Denoiser::SetIterations(int _iterations)
+	{
+		iterations = std::max(1, std::min(8, _iterations));
+	}
+
+	void Denoiser::SetSigmas(float _color, float _normal, float _depth)
+	{
+		// Keep strengths away from 0, they get squared and inverted
+		sigmaColor = std::max(_color, 1e-4f);
+		sigmaNormal = std::max(_normal, 1e-4f);
+		sigmaDepth = std::max(_depth, 1e-4f);
+	}
+
+	bool Denoiser::Apply(ColorPixel* _image, const SurfacePixel* _surface, int _width, int _height)
+	{
+		return Filter(_image, _surface, _width, _height) && Resolve(_image);
+	}
+
+	bool Denoiser::Filter(const ColorPixel* _image, const SurfacePixel* _surface, int _width, int _height)
+	{
+		filtered = -1;
+		if (_image == nullptr || _surface == nullptr || _width <= 0 || _height <= 0) return false;
+		if (!Reserve(_width * _height)) return false;
+		TimelineScope scope("Denoise");
+
+		// Split the image and guides into planar buffers
+		ParallelFor(_height, [&](int _y)
+		{
+			for (int i = _y * _width, end = i + _width; i < end; ++i)
+			{
+				colorR[0][i] = _image[i].r; colorG[0][i] = _image[i].g; colorB[0][i] = _image[i].b;
+				normalX[i] = _surface[i].nx; normalY[i] = _surface[i].ny; normalZ[i] = _surface[i].nz;
+				depth[i] = _surface[i].depth;
+			}
+		});
+
+		// Run every a-trous pass, doubling the gap between taps each time
+		int src = 0;
+		float invColor = 1.f / (sigmaColor * sigmaColor);
+		for (int pass = 0; pass < iterations; ++pass)
+		{
+			const int step = 1 << pass;
+			ParallelFor(_height, [&](int _y) { FilterRow(_y, _width, _height, step, src, invColor); });
+			src ^= 1;
+			// Halving sigma quadruples its inverse square
+			invColor *= 4.f;
+		}
+
+		filtered = src;
+		filteredPixels = _width * _height;
+		return true;
+	}
+
+	bool Denoiser::Resolve(ColorPixel* _image)
+	{
+		if (_image == nullptr || filtered < 0) return false;
+
+		// Write the filtered color back to the image plane
+		const int src = filtered;
+		for (int i = 0; i < filteredPixels; ++i)
+			_image[i] = { colorR[src][i], colorG[src][i], colorB[src][i] };
+		return true;
+	}
+
+	Denoiser::Denoiser()
+	{}
+	Denoiser::~Denoiser()
+	{
+		Release();
+	}
+}
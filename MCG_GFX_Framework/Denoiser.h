@@ -0,0 +1,89 @@
+#ifndef _DENOISER_H_
+#define _DENOISER_H_
+
+// Core modules
+#include "UtilityModules.h"
+
+namespace MRT
+{
+	// Denoiser
+	// - Edge-avoiding a-trous wavelet filter, used as a post-pass on the image plane
+	// - Guided by the per pixel normals and depth the RayTracer saves while rendering
+	// - Works on planar (one array per channel) copies of the image so rows can be filtered
+	//   4 pixels at a time with SSE, rows are split across threads
+	class Denoiser
+	{
+	private:
+		// Amount of a-trous passes, every pass doubles the filter footprint (5, 9, 17, 33...)
+		int iterations{ 4 };
+
+		// Edge stopping strengths, lower values keep edges sharper
+		// Color strength is halved on every pass so detail isnt washed out
+		float sigmaColor{ 0.6f }, sigmaNormal{ 0.3f }, sigmaDepth{ 0.1f };
+
+		// Planar working buffers
+		// Color is ping-ponged between two sets, guides are read only
+		float* colorR[2]{ nullptr, nullptr }, * colorG[2]{ nullptr, nullptr }, * colorB[2]{ nullptr, nullptr };
+		float* normalX{ nullptr }, * normalY{ nullptr }, * normalZ{ nullptr }, * depth{ nullptr };
+		// Size of the working buffers in pixels
+		int bufferSize{ 0 };
+		// The color set holding the last filtered image, -1 before Filter
+		int filtered{ -1 };
+		int filteredPixels{ 0 };
+
+		// Allocate working buffers big enough for an image
+		// @param _pixels : The amount of pixels in the image
+		// @returns bool : true if the buffers are allocated
+		bool Reserve(int _pixels);
+
+		// Free all working buffers
+		void Release();
+
+		// Filter a single row of the image for one a-trous pass
+		// @param _y : The row to filter
+		// @param _width : The image width
+		// @param _height : The image height
+		// @param _step : The distance between filter taps (1 << pass)
+		// @param _src : The color set to read from (0 or 1)
+		// @param _invColor : 1 / sigmaColor^2 for this pass
+		void FilterRow(int _y, int _width, int _height, int _step, int _src, float _invColor);
+
+	public:
+		// Set the amount of filter passes
+		// @param _iterations : The amount of passes (1 to 8)
+		void SetIterations(int _iterations);
+
+		// Set the edge stopping strengths
+		// @param _color : Color difference strength
+		// @param _normal : Normal difference strength
+		// @param _depth : Relative depth difference strength
+		void SetSigmas(float _color, float _normal, float _depth);
+
+		// Denoise an image in place (Filter then Resolve)
+		// @param _image : The image plane to filter
+		// @param _surface : The normal and depth guides for the image plane
+		// @param _width : The image width
+		// @param _height : The image height
+		// @returns bool : true on success
+		bool Apply(ColorPixel* _image, const SurfacePixel* _surface, int _width, int _height);
+
+		// Filter an image into the working buffers, the image is only read
+		// Lets the image keep being presented while it is filtered
+		// @param _image : The image plane to filter
+		// @param _surface : The normal and depth guides for the image plane
+		// @param _width : The image width
+		// @param _height : The image height
+		// @returns bool : true on success
+		bool Filter(const ColorPixel* _image, const SurfacePixel* _surface, int _width, int _height);
+
+		// Write the last filtered image back
+		// @param _image : The image plane Filter read
+		// @returns bool : false if nothing has been filtered
+		bool Resolve(ColorPixel* _image);
+
+		Denoiser();
+		~Denoiser();
+	};
+}
+
+#endif // !_DENOISER_H_
@@ -0,0 +1,333 @@
+#include "DistanceField.h"
+
+// Included libraries
+#include <cmath>
+#include <limits>
+
+// Distance Field
+namespace MRT
+{
+	namespace
+	{
+		// Closest a ray has to get to the surface to hit it, grows with the distance travelled
+		const real surfaceEpsilon{ (real)1e-4f };
+
+		// Get the signed distance to a part's shape
+		// @param _part : The part
+		// @param _point : The point in object space
+		// @returns real : The distance, negative inside
+		real ShapeDistance(const SDFPart& _part, const rvec3& _point)
+		{
+			const rvec3 p = _point - _part.center;
+			switch (_part.shape)
+			{
+			case SDFShape::Sphere: return glm::length(p) - _part.size.x;
+			case SDFShape::Box:
+			{
+				real qx = glm::abs(p.x) - _part.size.x, qy = glm::abs(p.y) - _part.size.y, qz = glm::abs(p.z) - _part.size.z;
+				real ox = glm::max(qx, (real)0), oy = glm::max(qy, (real)0), oz = glm::max(qz, (real)0);
+				return glm::sqrt(ox * ox + oy * oy + oz * oz) + glm::min(glm::max(qx, glm::max(qy, qz)), (real)0);
+			}
+			case SDFShape::Torus:
+			{
+				real ring = glm::sqrt(p.x * p.x + p.z * p.z) - _part.size.x;
+				return glm::sqrt(ring * ring + p.y * p.y) - _part.size.y;
+			}
+			case SDFShape::Capsule:
+			{
+				// Distance to the centre line
+				rvec3 line(p.x, p.y - glm::clamp(p.y, -_part.size.y, _part.size.y), p.z);
+				return glm::length(line) - _part.size.x;
+			}
+			case SDFShape::Cylinder:
+			{
+				real dx = glm::sqrt(p.x * p.x + p.z * p.z) - _part.size.x, dy = glm::abs(p.y) - _part.size.y;
+				real ox = glm::max(dx, (real)0), oy = glm::max(dy, (real)0);
+				return glm::sqrt(ox * ox + oy * oy) + glm::min(glm::max(dx, dy), (real)0);
+			}
+			}
+			return std::numeric_limits<real>::max();
+		}
+
+		// Get the local bounds of a part's shape
+		// @param _part : The part
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		void ShapeBounds(const SDFPart& _part, rvec3& _min, rvec3& _max)
+		{
+			rvec3 extent;
+			switch (_part.shape)
+			{
+			case SDFShape::Sphere: { extent = rvec3(_part.size.x); break; }
+			case SDFShape::Box: { extent = _part.size; break; }
+			case SDFShape::Torus: { extent = rvec3(_part.size.x + _part.size.y, _part.size.y, _part.size.x + _part.size.y); break; }
+			case SDFShape::Capsule: { extent = rvec3(_part.size.x, _part.size.y + _part.size.x, _part.size.x); break; }
+			case SDFShape::Cylinder: { extent = rvec3(_part.size.x, _part.size.y, _part.size.x); break; }
+			}
+			_min = _part.center - extent;
+			_max = _part.center + extent;
+		}
+
+		// Polynomial smooth minimum
+		// Never further than _k / 4 below the true minimum, and its gradient is a blend of both
+		// inputs so it stays a valid distance bound for sphere tracing
+		// @param _a, _b : The distances
+		// @param _k : The blend width (0 for a hard minimum)
+		// @returns real : The blended distance
+		real SmoothMin(real _a, real _b, real _k)
+		{
+			if (_k <= 0) return glm::min(_a, _b);
+			real h = glm::max(_k - glm::abs(_a - _b), (real)0) / _k;
+			return glm::min(_a, _b) - h * h * _k * (real)0.25f;
+		}
+	}
+
+	DistanceField::CacheBrick::CacheBrick()
+	{
+		for (std::atomic<float>& cell : distance)
+			cell.store(std::numeric_limits<float>::quiet_NaN(), std::memory_order_relaxed);
+	}
+
+	real DistanceField::EvaluateLocal(const rvec3& _point) const
+	{
+		if (parts.empty()) return std::numeric_limits<real>::max();
+
+		real distance = ShapeDistance(parts[0], _point);
+		for (size_t i = 1; i < parts.size(); ++i)
+		{
+			const SDFPart& part = parts[i];
+			real shape = ShapeDistance(part, _point);
+			switch (part.blend)
+			{
+			case SDFBlend::Union: { distance = glm::min(distance, shape); break; }
+			case SDFBlend::SmoothUnion: { distance = SmoothMin(distance, shape, part.smoothness); break; }
+			case SDFBlend::Subtract: { distance = glm::max(distance, -shape); break; }
+			case SDFBlend::SmoothSubtract: { distance = -SmoothMin(-distance, shape, part.smoothness); break; }
+			case SDFBlend::Intersect: { distance = glm::max(distance, shape); break; }
+			case SDFBlend::SmoothIntersect: { distance = -SmoothMin(-distance, -shape, part.smoothness); break; }
+			}
+		}
+		return distance;
+	}
+
+	void DistanceField::Rebuild()
+	{
+		ClearCache();
+		fEmpty = parts.empty();
+		if (fEmpty) return;
+
+		// Unions grow the bounds, smooth unions by up to a quarter of their width as well,
+		// subtracting never grows them and intersecting shrinks them to the overlap
+		ShapeBounds(parts[0], boundsMin, boundsMax);
+		for (size_t i = 1; i < parts.size(); ++i)
+		{
+			const SDFPart& part = parts[i];
+			rvec3 partMin, partMax;
+			ShapeBounds(part, partMin, partMax);
+			switch (part.blend)
+			{
+			case SDFBlend::SmoothUnion:
+			case SDFBlend::Union:
+			{
+				real grow = part.blend == SDFBlend::SmoothUnion ? glm::max(part.smoothness, (real)0) * (real)0.25f : 0;
+				boundsMin = glm::min(boundsMin, partMin) - rvec3(grow);
+				boundsMax = glm::max(boundsMax, partMax) + rvec3(grow);
+				break;
+			}
+			case SDFBlend::Intersect:
+			case SDFBlend::SmoothIntersect:
+			{
+				boundsMin = glm::max(boundsMin, partMin);
+				boundsMax = glm::min(boundsMax, partMax);
+				break;
+			}
+			default: break;
+			}
+		}
+		if (boundsMin.x > boundsMax.x || boundsMin.y > boundsMax.y || boundsMin.z > boundsMax.z)
+		{
+			fEmpty = true;
+			return;
+		}
+
+		// Pad the bounds a little so surfaces on them arent lost to rounding
+		rvec3 extent = boundsMax - boundsMin;
+		real longest = glm::max(extent.x, glm::max(extent.y, extent.z));
+		rvec3 pad(longest * (real)1e-3f + (real)1e-4f);
+		boundsMin -= pad;
+		boundsMax += pad;
+		extent = boundsMax - boundsMin;
+		longest = glm::max(extent.x, glm::max(extent.y, extent.z));
+
+		// Lay out the cache grid, bricks are only allocated once a ray reaches them
+		cacheOrigin = boundsMin;
+		cellSize = longest / cacheCells;
+		int brickCount = 1;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cells[axis] = glm::max(1, (int)std::ceil(extent[axis] / cellSize));
+			bricks[axis] = (cells[axis] + brickCells - 1) / brickCells;
+			brickCount *= bricks[axis];
+		}
+		cache.reset(new std::atomic<CacheBrick*>[brickCount]);
+		for (int i = 0; i < brickCount; ++i)
+			cache[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	void DistanceField::ClearCache()
+	{
+		if (!cache) return;
+		const int brickCount = bricks[0] * bricks[1] * bricks[2];
+		for (int i = 0; i < brickCount; ++i)
+			delete cache[i].load(std::memory_order_relaxed);
+		cache.reset();
+	}
+
+	real DistanceField::GetCellDistance(int _x, int _y, int _z)
+	{
+		std::atomic<CacheBrick*>& slot = cache[(((_z / brickCells) * bricks[1]) + (_y / brickCells)) * bricks[0] + (_x / brickCells)];
+		CacheBrick* brick = slot.load(std::memory_order_acquire);
+		if (brick == nullptr)
+		{
+			// Threads can race to allocate a brick, the loser throws its copy away
+			CacheBrick* fresh = new CacheBrick();
+			if (slot.compare_exchange_strong(brick, fresh, std::memory_order_acq_rel)) brick = fresh;
+			else delete fresh;
+		}
+
+		std::atomic<float>& cell = brick->distance[(((_z % brickCells) * brickCells) + (_y % brickCells)) * brickCells + (_x % brickCells)];
+		float distance = cell.load(std::memory_order_relaxed);
+		// Every thread works out the same value, so racing threads store the same distance
+		if (distance != distance)
+		{
+			distance = (float)EvaluateLocal(cacheOrigin + (rvec3((real)_x, (real)_y, (real)_z) + (real)0.5f) * cellSize);
+			cell.store(distance, std::memory_order_relaxed);
+		}
+		return distance;
+	}
+
+	bool DistanceField::Intersect(Ray& _ray)
+	{
+		if (fEmpty) return false;
+
+		// Trace in object space, clipped to the bounds
+		const rvec3 origin = _ray.GetOrigin() - position, direction = _ray.GetDirection();
+		const rvec3 invD(1 / direction.x, 1 / direction.y, 1 / direction.z);
+		real tNear = 0, tFar = _ray.GetLength();
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			real t1 = (boundsMin[axis] - origin[axis]) * invD[axis], t2 = (boundsMax[axis] - origin[axis]) * invD[axis];
+			tNear = glm::max(tNear, glm::min(t1, t2));
+			tFar = glm::min(tFar, glm::max(t1, t2));
+		}
+		if (!(tNear <= tFar)) return false;
+
+		// Rays starting inside march out to the far side, like spheres
+		real t = tNear;
+		const real side = EvaluateLocal(origin + direction * t) < 0 ? (real)-1 : (real)1;
+		// Half the diagonal of a cell, cells further than this from the surface hold none of it
+		const real cellReach = cellSize * (real)0.8660254f;
+		const real minStep = cellSize * (real)1e-3f, cellScale = 1 / cellSize;
+		// Steps are over-relaxed until one overshoots, the last distance and step are kept to spot that
+		real relax = overRelaxation, previous = 0, lastStep = 0;
+
+		for (int step = 0; step < maxSteps; ++step)
+		{
+			const rvec3 point = origin + direction * t;
+			int cell[3];
+			for (int axis = 0; axis < 3; ++axis)
+				cell[axis] = glm::clamp((int)((point[axis] - cacheOrigin[axis]) * cellScale), 0, cells[axis] - 1);
+			const real cached = glm::abs(GetCellDistance(cell[0], cell[1], cell[2]));
+
+			real advance;
+			// An over-relaxed step is always checked against the exact distance
+			if (cached > cellReach && lastStep <= previous)
+			{
+				// The cell is empty, move to where the ray leaves it or further if the cached distance allows
+				const rvec3 cellMin = cacheOrigin + rvec3((real)cell[0], (real)cell[1], (real)cell[2]) * cellSize;
+				const rvec3 center = cellMin + rvec3(cellSize * (real)0.5f);
+				real exit = std::numeric_limits<real>::max();
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (direction[axis] > 0) exit = glm::min(exit, (cellMin[axis] + cellSize - point[axis]) * invD[axis]);
+					else if (direction[axis] < 0) exit = glm::min(exit, (cellMin[axis] - point[axis]) * invD[axis]);
+				}
+				advance = glm::max(glm::max(exit, cached - glm::length(point - center)), (real)0) + minStep;
+				previous = lastStep = 0;
+			}
+			else
+			{
+				// Near the surface, step by the exact distance
+				const real distance = side * EvaluateLocal(point);
+				if (lastStep > previous && distance + previous < lastStep)
+				{
+					// The spheres around this point and the last dont overlap so the step may have jumped the surface,
+					// go back to where the last distance reached and stop relaxing
+					t += previous - lastStep;
+					relax = 1;
+					lastStep = previous;
+					continue;
+				}
+				if (distance < surfaceEpsilon * glm::max((real)1, t))
+				{
+					// Tetrahedron gradient for the normal, four evaluations
+					const real h = glm::max(surfaceEpsilon * glm::max((real)1, t), minStep);
+					const rvec3 k0(1, -1, -1), k1(-1, -1, 1), k2(-1, 1, -1), k3(1, 1, 1);
+					rvec3 normal = k0 * EvaluateLocal(point + k0 * h) + k1 * EvaluateLocal(point + k1 * h) +
+						k2 * EvaluateLocal(point + k2 * h) + k3 * EvaluateLocal(point + k3 * h);
+
+					HitInformation hitInfo{ t, NormalizeFast(normal), color, -1 };
+					_ray.SetHitInfo(hitInfo);
+					return true;
+				}
+				advance = distance * relax;
+				previous = distance;
+				lastStep = advance;
+			}
+
+			t += advance;
+			if (t > tFar)
+			{
+				// An over-relaxed step past the end could have jumped the surface too, retake it at full length
+				if (lastStep <= previous) return false;
+				t += previous - lastStep;
+				relax = 1;
+				lastStep = previous;
+				if (t > tFar) return false;
+			}
+		}
+		return false;
+	}
+
+	void DistanceField::GetBounds(rvec3& _min, rvec3& _max)
+	{
+		if (fEmpty)
+		{
+			_min = _max = position;
+			return;
+		}
+		_min = position + boundsMin;
+		_max = position + boundsMax;
+	}
+
+	void DistanceField::AddPart(const SDFPart& _part)
+	{
+		parts.push_back(_part);
+		Rebuild();
+	}
+
+	void DistanceField::ClearParts()
+	{
+		parts.clear();
+		Rebuild();
+	}
+
+	DistanceField::DistanceField(rvec3 _position, ColorPixel _color)
+		:
+		Primitive(_position, _color)
+	{}
+	DistanceField::~DistanceField()
+	{
+		ClearCache();
+	}
+}
@@ -0,0 +1,134 @@
+#ifndef _DISTANCEFIELD_H_
+#define _DISTANCEFIELD_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Ray.h"
+#include "Primitive.h"
+
+namespace MRT
+{
+	// The analytic shapes a DistanceField is built from, all Y up
+	// Sphere : size.x radius
+	// Box : size half extents
+	// Torus : size.x ring radius, size.y tube radius, the ring lies flat on XZ
+	// Capsule : size.x radius, size.y half length of the centre line
+	// Cylinder : size.x radius, size.y half height
+	enum class SDFShape { Sphere, Box, Torus, Capsule, Cylinder };
+
+	// How a part is combined with the parts added before it
+	// Smooth blends round off the seam over the part's smoothness distance
+	enum class SDFBlend { Union, SmoothUnion, Subtract, SmoothSubtract, Intersect, SmoothIntersect };
+
+	// SDFPart
+	// - One shape of a DistanceField and how it is blended in
+	struct SDFPart
+	{
+		SDFShape shape{ SDFShape::Sphere };
+		SDFBlend blend{ SDFBlend::Union };
+		// Centre relative to the object position
+		rvec3 center{ 0 };
+		// Shape dimensions, see SDFShape
+		rvec3 size{ 1 };
+		// Width of the rounded seam for smooth blends
+		real smoothness{ 0 };
+	};
+
+	// DistanceField
+	// - Extends Primitive
+	// - Blended and carved shapes described by a signed distance function, traced by sphere tracing
+	// - Parts are folded together in the order they are added, the first part's blend is ignored
+	// - The bounds are worked out from the parts and blends, rays outside them are rejected by the BVH
+	// - Distances are cached in a coarse grid over the bounds, filled a brick at a time as rays reach it,
+	//   so rays stride over empty cells without evaluating the parts
+	// - Textures arent mapped onto distance fields
+	class DistanceField : public Primitive
+	{
+	private:
+		// Cells along the longest side of the bounds
+		static const int cacheCells{ 32 };
+		// Cells along each side of a brick, bricks are allocated when a ray first enters them
+		static const int brickCells{ 4 };
+		// Most steps a ray takes before giving up, reached only at grazing angles
+		static const int maxSteps{ 256 };
+		// Exact distance steps are stretched by this much (enhanced sphere tracing), cutting the steps
+		// rays take along a surface, overshooting steps are caught and retaken at their full length
+		static constexpr float overRelaxation{ 1.5f };
+
+		// Cached signed distances at the cell centres of a brick, NaN until worked out
+		struct CacheBrick
+		{
+			std::atomic<float> distance[brickCells * brickCells * brickCells];
+			CacheBrick();
+		};
+
+		std::vector<SDFPart> parts;
+		// Local space bounds of the parts, empty when nothing is left after the blends
+		rvec3 boundsMin{ 0 }, boundsMax{ 0 };
+		bool fEmpty{ true };
+
+		// Cache grid over the local bounds
+		rvec3 cacheOrigin{ 0 };
+		real cellSize{ 1 };
+		int cells[3]{ 1, 1, 1 }, bricks[3]{ 1, 1, 1 };
+		std::unique_ptr<std::atomic<CacheBrick*>[]> cache;
+
+		// Work out the bounds and lay out an empty cache grid, after the parts change
+		void Rebuild();
+
+		// Free every cache brick
+		void ClearCache();
+
+		// Get the cached distance at the centre of a cell, works it out on first use
+		// @param _x, _y, _z : The cell coordinates
+		// @returns real : The signed distance at the cell centre
+		real GetCellDistance(int _x, int _y, int _z);
+
+	public:
+		// Check if ray intersects the distance field
+		// Sphere traces the ray through the bounds, skipping cells the cache shows are empty
+		// @param _ray : The ray to check for an intersection
+		// @returns bool : true if intersecting
+		bool Intersect(Ray& _ray) override;
+
+		// Get the bounding box of the distance field
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		void GetBounds(rvec3& _min, rvec3& _max) override;
+
+		// Add a part
+		// Objects in a RayTracer need RayTracer::UpdatePrimitive afterwards
+		// @param _part : The part to add
+		void AddPart(const SDFPart& _part);
+
+		// Remove every part
+		void ClearParts();
+
+		// Get the parts
+		// @returns const std::vector<SDFPart>& : The parts in the order they are blended
+		const std::vector<SDFPart>& GetParts() { return parts; }
+
+		// Get the signed distance to the surface
+		// @param _point : The world space point
+		// @returns real : The distance, negative inside (a lower bound near smooth blends)
+		real GetDistance(const rvec3& _point) { return EvaluateLocal(_point - position); }
+
+		// Get the signed distance to the surface in object space
+		// @param _point : The point relative to the object position
+		// @returns real : The distance, negative inside
+		real EvaluateLocal(const rvec3& _point) const;
+
+		DistanceField(rvec3 _position, ColorPixel _color = { 1, 0, 0 });
+		~DistanceField();
+		DistanceField(const DistanceField&) = delete;
+		DistanceField& operator=(const DistanceField&) = delete;
+	};
+}
+
+#endif // !_DISTANCEFIELD_H_
@@ -0,0 +1,78 @@
+#include "ImageFile.h"
+
+// Included libraries
+#include <fstream>
+
+// Core modules
+#include "Kernels.h"
+#include "Timeline.h"
+
+// Image File
+namespace MRT
+{
+	namespace
+	{
+		// Read the next number from a PPM header, skipping whitespace and comments
+		bool ReadHeaderValue(std::ifstream& _file, int& _value)
+		{
+			int c = _file.get();
+			while (c != EOF && (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#'))
+			{
+				if (c == '#') while (c != EOF && c != '\n') c = _file.get();
+				c = _file.get();
+			}
+			if (c < '0' || c > '9') return false;
+
+			_value = 0;
+			while (c >= '0' && c <= '9')
+			{
+				_value = (_value * 10) + (c - '0');
+				if (_value > 65535) return false;
+				c = _file.get();
+			}
+			// A single whitespace character ends the value
+			return c != EOF;
+		}
+
+		// Rows are converted as one run of channels by the tonemap kernel
+		static_assert(sizeof(ColorPixel) == sizeof(float) * 3, "ColorPixel has to be 3 packed floats");
+	}
+
+	bool WriteImagePPM(const char* _path, const ColorPixel* _image, int _width, int _height)
+	{
+		if (_image == nullptr || _width <= 0 || _height <= 0) return false;
+		TimelineScope scope("Write image");
+		std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file << "P6\n" << _width << " " << _height << "\n255\n";
+		std::vector<unsigned char> row((size_t)_width * 3);
+		const TonemapKernel tonemap = GetKernels().tonemap;
+		for (int y = 0; y < _height; ++y)
+		{
+			tonemap(&_image[(size_t)y * _width].r, _width * 3, row.data());
+			file.write((const char*)row.data(), (std::streamsize)row.size());
+		}
+		return file.good();
+	}
+
+	bool ReadImagePPM(const char* _path, std::vector<ColorPixel>& _image, int& _width, int& _height)
+	{
+		std::ifstream file(_path, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		char magic[2];
+		int maxValue;
+		if (!file.read(magic, 2) || magic[0] != 'P' || magic[1] != '6') return false;
+		if (!ReadHeaderValue(file, _width) || !ReadHeaderValue(file, _height) || !ReadHeaderValue(file, maxValue)) return false;
+		if (_width <= 0 || _height <= 0 || maxValue != 255) return false;
+
+		std::vector<unsigned char> bytes((size_t)_width * _height * 3);
+		if (!file.read((char*)bytes.data(), (std::streamsize)bytes.size())) return false;
+
+		_image.resize((size_t)_width * _height);
+		for (size_t i = 0; i < _image.size(); ++i)
+			_image[i] = { bytes[i * 3] / 255.f, bytes[i * 3 + 1] / 255.f, bytes[i * 3 + 2] / 255.f };
+		return true;
+	}
+}
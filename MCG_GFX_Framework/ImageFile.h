@@ -0,0 +1,29 @@
+#ifndef _IMAGEFILE_H_
+#define _IMAGEFILE_H_
+
+// Included libraries
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+
+namespace MRT
+{
+	// Write an image as a binary PPM (P6), colors are clamped to 0 to 1.f and stored as 8 bits
+	// @param _path : The file to write
+	// @param _image : The image, row major from the top left
+	// @param _width : The image width
+	// @param _height : The image height
+	// @returns bool : true on success
+	bool WriteImagePPM(const char* _path, const ColorPixel* _image, int _width, int _height);
+
+	// Read a binary PPM (P6) with 8 bit channels
+	// @param _path : The file to read
+	// @param _image : Returned image, normalised (0 to 1.f)
+	// @param _width : Returned image width
+	// @param _height : Returned image height
+	// @returns bool : true on success
+	bool ReadImagePPM(const char* _path, std::vector<ColorPixel>& _image, int& _width, int& _height);
+}
+
+#endif // !_IMAGEFILE_H_
@@ -0,0 +1,397 @@
+#include "Kernels.h"
+
+// Included libraries
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// CPUID is only read on x86, other targets only have the scalar kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MRT_KERNELS_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Kernels
+namespace MRT
+{
+	// Defined in KernelsSSE42.cpp, KernelsAVX2.cpp and KernelsAVX512.cpp, nullptr when not built
+	const KernelTable* GetSSE42Kernels();
+	const KernelTable* GetAVX2Kernels();
+	const KernelTable* GetAVX512Kernels();
+
+	namespace
+	{
+		const char* isaNames[]{ "scalar", "sse4.2", "avx2", "avx512" };
+
+		// The kernels in use, picked on first use
+		std::atomic<const KernelTable*> activeKernels{ nullptr };
+
+		// Scalar kernels, the reference the other instruction sets are checked against
+		int IntersectSpheresScalar(const float* _centerX, const float* _centerY, const float* _centerZ, const float* _radiusSqr,
+			int _count, const float* _origin, const float* _direction, float _length)
+		{
+			int best = -1;
+			for (int i = 0; i < _count; ++i)
+			{
+				// Same steps as Sphere::IntersectRecord
+				float lX = _centerX[i] - _origin[0], lY = _centerY[i] - _origin[1], lZ = _centerZ[i] - _origin[2];
+				float lPD = ((lX * _direction[0]) + (lY * _direction[1])) + (lZ * _direction[2]);
+				if (!(lPD >= 0)) continue;
+				float mL = (((lX * lX) + (lY * lY)) + (lZ * lZ)) - (lPD * lPD);
+				if (!(mL <= _radiusSqr[i])) continue;
+				float sHL = std::sqrt(_radiusSqr[i] - mL);
+				float intersect = lPD - sHL;
+				if (intersect < 0) intersect = lPD + sHL;
+				if (!(intersect >= 0) || !(intersect <= _length)) continue;
+				_length = intersect;
+				best = i;
+			}
+			return best;
+		}
+
+		unsigned int IntersectBoundsScalar(const RayPacket& _packet, const float* _boundsMin, const float* _boundsMax, float* _near)
+		{
+			// Same steps as IntersectBounds, min and max pick like glm (the first value unless the second is smaller/larger)
+			auto min = [](float _x, float _y) { return _y < _x ? _y : _x; };
+			auto max = [](float _x, float _y) { return _x < _y ? _y : _x; };
+
+			unsigned int entered = 0;
+			for (int r = 0; r < rayPacketLanes; ++r)
+			{
+				float tx1 = (_boundsMin[0] - _packet.originX[r]) * _packet.inverseX[r], tx2 = (_boundsMax[0] - _packet.originX[r]) * _packet.inverseX[r];
+				float tMin = min(tx1, tx2), tMax = max(tx1, tx2);
+				float ty1 = (_boundsMin[1] - _packet.originY[r]) * _packet.inverseY[r], ty2 = (_boundsMax[1] - _packet.originY[r]) * _packet.inverseY[r];
+				tMin = max(tMin, min(ty1, ty2)); tMax = min(tMax, max(ty1, ty2));
+				float tz1 = (_boundsMin[2] - _packet.originZ[r]) * _packet.inverseZ[r], tz2 = (_boundsMax[2] - _packet.originZ[r]) * _packet.inverseZ[r];
+				tMin = max(tMin, min(tz1, tz2)); tMax = min(tMax, max(tz1, tz2));
+
+				if (!(tMax >= max(tMin, 0.f)) || !(tMin <= _packet.length[r])) continue;
+				_near[r] = tMin;
+				entered |= 1u << r;
+			}
+			return entered;
+		}
+
+		void GenerateRaysScalar(const RayRowParams& _params, int _y, int _x0, int _count, float _sampleX, float _sampleY,
+			float* _directionX, float* _directionY, float* _directionZ)
+		{
+			// Same steps as Camera::CastRay, the matrix product is summed in glm's order
+			float wY = (1 - ((((float)_y + _sampleY) / _params.imageHeight) * 2)) * _params.aspectY * _params.fov;
+			float rowX = _params.column1[0] * wY, rowY = _params.column1[1] * wY, rowZ = _params.column1[2] * wY;
+			float constX = -_params.column2[0] + _params.column3[0], constY = -_params.column2[1] + _params.column3[1],
+				constZ = -_params.column2[2] + _params.column3[2];
+
+			for (int i = 0; i < _count; ++i)
+			{
+				float wX = ((((float)(_x0 + i) + _sampleX) / _params.imageWidth) * 2 - 1) * _params.aspectX * _params.fov;
+				float dX = (((_params.column0[0] * wX) + rowX) + constX) - _params.column3[0];
+				float dY = (((_params.column0[1] * wX) + rowY) + constY) - _params.column3[1];
+				float dZ = (((_params.column0[2] * wX) + rowZ) + constZ) - _params.column3[2];
+				float inverseLength = 1.f / std::sqrt(((dX * dX) + (dY * dY)) + (dZ * dZ));
+				_directionX[i] = dX * inverseLength;
+				_directionY[i] = dY * inverseLength;
+				_directionZ[i] = dZ * inverseLength;
+			}
+		}
+
+		void TonemapScalar(const float* _values, int _count, unsigned char* _bytes)
+		{
+			for (int i = 0; i < _count; ++i)
+			{
+				float value = _values[i];
+				if (!(value > 0)) value = 0;
+				if (value > 1) value = 1;
+				_bytes[i] = (unsigned char)(value * 255.f + 0.5f);
+			}
+		}
+
+		const KernelTable scalarKernels{ KernelISA::Scalar, "scalar", IntersectSpheresScalar, IntersectBoundsScalar, GenerateRaysScalar, TonemapScalar };
+
+#ifdef MRT_KERNELS_X86
+		void ReadCPUID(unsigned int _leaf, unsigned int _subleaf, unsigned int _registers[4])
+		{
+#if defined(_MSC_VER)
+			__cpuidex((int*)_registers, (int)_leaf, (int)_subleaf);
+#else
+			__cpuid_count(_leaf, _subleaf, _registers[0], _registers[1], _registers[2], _registers[3]);
+#endif
+		}
+
+		// Register state the OS saves on a context switch, wider registers are unusable unless saved
+		unsigned long long ReadXCR0()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int low, high;
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return ((unsigned long long)high << 32) | low;
+#endif
+		}
+
+		// Read which instruction sets the CPU and OS support
+		void DetectISAs(bool _supported[(int)KernelISA::Count])
+		{
+			unsigned int registers[4]{ 0 };
+			ReadCPUID(0, 0, registers);
+			const unsigned int maxLeaf = registers[0];
+			if (maxLeaf < 1) return;
+
+			ReadCPUID(1, 0, registers);
+			const unsigned int features = registers[2];
+			// SSE4.2 kernels also use the SSE4.1 blends and packs
+			_supported[(int)KernelISA::SSE42] = (features & (1u << 19)) != 0 && (features & (1u << 20)) != 0;
+
+			// AVX needs the OS to save the YMM registers (OSXSAVE then XCR0 bits 1 and 2)
+			if ((features & (1u << 27)) == 0 || (features & (1u << 28)) == 0 || maxLeaf < 7) return;
+			const unsigned long long xcr0 = ReadXCR0();
+			if ((xcr0 & 0x6) != 0x6) return;
+
+			ReadCPUID(7, 0, registers);
+			const unsigned int extended = registers[1];
+			_supported[(int)KernelISA::AVX2] = (extended & (1u << 5)) != 0;
+			// AVX-512 also needs the opmask and ZMM registers saved (XCR0 bits 5 to 7)
+			_supported[(int)KernelISA::AVX512] = (extended & (1u << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+		}
+#endif
+
+		// Read an environment variable
+		// @returns std::string : The value, empty if not set
+		std::string ReadEnvironment(const char* _name)
+		{
+#if defined(_MSC_VER)
+			char* value = nullptr;
+			size_t length = 0;
+			std::string result;
+			if (_dupenv_s(&value, &length, _name) == 0 && value != nullptr) result = value;
+			std::free(value);
+			return result;
+#else
+			const char* value = std::getenv(_name);
+			return value != nullptr ? value : "";
+#endif
+		}
+
+		const KernelTable* PickKernels()
+		{
+			KernelISA isa;
+			std::string name = ReadEnvironment("MRT_KERNELS");
+			if (!name.empty() && FindKernelISA(name, isa) && IsKernelISASupported(isa)) return GetKernelTable(isa);
+
+			for (int i = (int)KernelISA::Count - 1; i > 0; --i)
+			{
+				if (IsKernelISASupported((KernelISA)i)) return GetKernelTable((KernelISA)i);
+			}
+			return &scalarKernels;
+		}
+
+		// Deterministic random numbers (0 to 1.f), rand() differs between platforms
+		float NextRandom(unsigned int& _state)
+		{
+			_state = (_state * 1664525u) + 1013904223u;
+			return (_state >> 8) * (1.f / 16777216.f);
+		}
+
+		float RandomRange(unsigned int& _state, float _min, float _max)
+		{
+			return _min + (NextRandom(_state) * (_max - _min));
+		}
+	}
+
+	const KernelTable* GetKernelTable(KernelISA _isa)
+	{
+		switch (_isa)
+		{
+		case KernelISA::Scalar: return &scalarKernels;
+		case KernelISA::SSE42: return GetSSE42Kernels();
+		case KernelISA::AVX2: return GetAVX2Kernels();
+		case KernelISA::AVX512: return GetAVX512Kernels();
+		default: return nullptr;
+		}
+	}
+
+	bool IsKernelISASupported(KernelISA _isa)
+	{
+		// CPUID doesnt change while running, read it once
+		static const struct Support
+		{
+			bool fISA[(int)KernelISA::Count]{ true };
+			Support()
+			{
+#ifdef MRT_KERNELS_X86
+				DetectISAs(fISA);
+#endif
+			}
+		} support;
+
+		if ((int)_isa < 0 || _isa >= KernelISA::Count) return false;
+		return support.fISA[(int)_isa] && GetKernelTable(_isa) != nullptr;
+	}
+
+	const KernelTable& GetKernels()
+	{
+		const KernelTable* kernels = activeKernels.load(std::memory_order_acquire);
+		if (kernels == nullptr)
+		{
+			// Threads racing here all pick the same kernels
+			kernels = PickKernels();
+			activeKernels.store(kernels, std::memory_order_release);
+		}
+		return *kernels;
+	}
+
+	bool SetKernelISA(KernelISA _isa)
+	{
+		if (!IsKernelISASupported(_isa)) return false;
+		activeKernels.store(GetKernelTable(_isa), std::memory_order_release);
+		return true;
+	}
+
+	bool FindKernelISA(const std::string& _name, KernelISA& _isa)
+	{
+		for (int i = 0; i < (int)KernelISA::Count; ++i)
+		{
+			if (_name != isaNames[i]) continue;
+			_isa = (KernelISA)i;
+			return true;
+		}
+		return false;
+	}
+
+	bool CheckKernels(std::vector<KernelCheckResult>& _results)
+	{
+		const int calls{ 2000 }, maxCount{ 40 };
+		float centerX[maxCount], centerY[maxCount], centerZ[maxCount], radiusSqr[maxCount];
+		float expectedX[maxCount], expectedY[maxCount], expectedZ[maxCount], directionX[maxCount], directionY[maxCount], directionZ[maxCount];
+		float values[maxCount * 3];
+		RayPacket packet;
+		float expectedNear[rayPacketLanes], near[rayPacketLanes];
+		unsigned char expectedBytes[maxCount * 3], bytes[maxCount * 3];
+
+		_results.clear();
+		bool passed = true;
+		for (int i = 1; i < (int)KernelISA::Count; ++i)
+		{
+			KernelCheckResult result;
+			result.isa = (KernelISA)i;
+			result.fSupported = IsKernelISASupported(result.isa);
+			if (!result.fSupported)
+			{
+				_results.push_back(result);
+				continue;
+			}
+			const KernelTable& kernels = *GetKernelTable(result.isa);
+
+			// Every set sees the same inputs
+			unsigned int state = 7;
+			for (int call = 0; call < calls; ++call)
+			{
+				const int count = 1 + (int)(NextRandom(state) * (maxCount - 1));
+
+				// Spheres scattered around a ray, about half of them in its path
+				float origin[3]{ RandomRange(state, -5, 5), RandomRange(state, -5, 5), RandomRange(state, -5, 5) };
+				float direction[3]{ RandomRange(state, -1, 1), RandomRange(state, -1, 1), 1 };
+				float inverseLength = 1.f / std::sqrt(((direction[0] * direction[0]) + (direction[1] * direction[1])) + (direction[2] * direction[2]));
+				for (int axis = 0; axis < 3; ++axis) direction[axis] *= inverseLength;
+				for (int s = 0; s < count; ++s)
+				{
+					float along = RandomRange(state, -5, 40);
+					centerX[s] = origin[0] + direction[0] * along + RandomRange(state, -3, 3);
+					centerY[s] = origin[1] + direction[1] * along + RandomRange(state, -3, 3);
+					centerZ[s] = origin[2] + direction[2] * along + RandomRange(state, -3, 3);
+					radiusSqr[s] = RandomRange(state, 0.1f, 4);
+				}
+				// Repeated spheres check ties go to the last one
+				if (count > 2 && (call & 3) == 0)
+				{
+					centerX[count - 1] = centerX[0]; centerY[count - 1] = centerY[0]; centerZ[count - 1] = centerZ[0];
+					radiusSqr[count - 1] = radiusSqr[0];
+				}
+				float length = (call & 1) ? 10000.f : RandomRange(state, 1, 30);
+				int expected = IntersectSpheresScalar(centerX, centerY, centerZ, radiusSqr, count, origin, direction, length);
+				result.intersectMismatches += kernels.intersectSpheres(centerX, centerY, centerZ, radiusSqr, count, origin, direction, length) != expected;
+				++result.intersectCalls;
+
+				// A box around the ray with a packet of rays fanned out from near its origin
+				// Some rays run along an axis and some start on a box face, covering the infinite and NaN slab distances
+				float boundsMin[3], boundsMax[3];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					float center = origin[axis] + direction[axis] * RandomRange(state, -5, 30);
+					float extent = RandomRange(state, 0, 6);
+					boundsMin[axis] = center - extent;
+					boundsMax[axis] = center + extent;
+				}
+				for (int r = 0; r < rayPacketLanes; ++r)
+				{
+					float rayOrigin[3], rayDirection[3];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						rayOrigin[axis] = origin[axis] + RandomRange(state, -2, 2);
+						rayDirection[axis] = direction[axis] + RandomRange(state, -0.3f, 0.3f);
+					}
+					float pick = NextRandom(state);
+					int axis = (int)(NextRandom(state) * 3) % 3;
+					if (pick < 0.1f) rayDirection[axis] = 0;
+					else if (pick < 0.15f) { rayDirection[axis] = 0; rayOrigin[axis] = boundsMin[axis]; }
+					packet.originX[r] = rayOrigin[0]; packet.originY[r] = rayOrigin[1]; packet.originZ[r] = rayOrigin[2];
+					packet.inverseX[r] = 1 / rayDirection[0]; packet.inverseY[r] = 1 / rayDirection[1]; packet.inverseZ[r] = 1 / rayDirection[2];
+					pick = NextRandom(state);
+					packet.length[r] = pick < 0.1f ? -1.f : pick < 0.5f ? 10000.f : RandomRange(state, 0, 30);
+				}
+				unsigned int expectedMask = IntersectBoundsScalar(packet, boundsMin, boundsMax, expectedNear);
+				unsigned int mask = kernels.intersectBounds(packet, boundsMin, boundsMax, near);
+				bool nearMatches = true;
+				for (int r = 0; r < rayPacketLanes; ++r)
+				{
+					if ((expectedMask & (1u << r)) != 0) nearMatches &= std::memcmp(&expectedNear[r], &near[r], sizeof(float)) == 0;
+				}
+				result.boundsMismatches += mask != expectedMask || !nearMatches;
+				++result.boundsCalls;
+
+				// A random (not orthonormal) camera matrix covers every term of the product
+				RayRowParams params;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					params.column0[axis] = RandomRange(state, -1, 1);
+					params.column1[axis] = RandomRange(state, -1, 1);
+					params.column2[axis] = RandomRange(state, -1, 1);
+					params.column3[axis] = RandomRange(state, -50, 50);
+				}
+				params.imageWidth = (float)(64 + (int)(NextRandom(state) * 1920));
+				params.imageHeight = (float)(64 + (int)(NextRandom(state) * 1080));
+				params.aspectX = params.imageWidth > params.imageHeight ? params.imageWidth / params.imageHeight : 1.f;
+				params.aspectY = params.imageHeight > params.imageWidth ? params.imageHeight / params.imageWidth : 1.f;
+				params.fov = RandomRange(state, 0.1f, 1.5f);
+				const int y = (int)(NextRandom(state) * params.imageHeight), x0 = (int)(NextRandom(state) * (params.imageWidth - maxCount));
+				const float sampleX = NextRandom(state), sampleY = NextRandom(state);
+				GenerateRaysScalar(params, y, x0, count, sampleX, sampleY, expectedX, expectedY, expectedZ);
+				kernels.generateRays(params, y, x0, count, sampleX, sampleY, directionX, directionY, directionZ);
+				result.rayMismatches += std::memcmp(expectedX, directionX, count * sizeof(float)) != 0 ||
+					std::memcmp(expectedY, directionY, count * sizeof(float)) != 0 || std::memcmp(expectedZ, directionZ, count * sizeof(float)) != 0;
+				++result.rayCalls;
+
+				// Channels past both ends, exact ends and NaN
+				const int channels = count * 3;
+				for (int c = 0; c < channels; ++c)
+				{
+					float pick = NextRandom(state);
+					values[c] = pick < 0.05f ? std::nanf("") : pick < 0.1f ? 0.f : pick < 0.15f ? 1.f : RandomRange(state, -0.5f, 1.5f);
+				}
+				TonemapScalar(values, channels, expectedBytes);
+				kernels.tonemap(values, channels, bytes);
+				result.tonemapMismatches += std::memcmp(expectedBytes, bytes, channels) != 0;
+				++result.tonemapCalls;
+			}
+
+			passed &= result.intersectMismatches == 0 && result.boundsMismatches == 0 && result.rayMismatches == 0 && result.tonemapMismatches == 0;
+			_results.push_back(result);
+		}
+		return passed;
+	}
+}
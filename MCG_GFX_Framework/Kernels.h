@@ -0,0 +1,146 @@
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+// Included libraries
+#include <string>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+
+// Kernels are float only, the double tier keeps its scalar paths
+// Ray generation also stays scalar in the fast tier, its approximate normalisation isnt vectorised
+#if !defined(MRT_PRECISION_DOUBLE)
+#define MRT_KERNELS_INTERSECT
+#if !defined(MRT_PRECISION_FAST)
+#define MRT_KERNELS_RAYGEN
+#endif
+#endif
+
+namespace MRT
+{
+	// Instruction sets kernels are built for, in order of preference
+	enum class KernelISA { Scalar, SSE42, AVX2, AVX512, Count };
+
+	// RayRowParams
+	// - Camera constants needed to generate primary rays (see Camera::CastRay)
+	struct RayRowParams
+	{
+		// Camera to world matrix columns
+		float column0[3], column1[3], column2[3], column3[3];
+		float imageWidth, imageHeight;
+		float aspectX, aspectY, fov;
+	};
+
+	// Closest hit of a ray against a run of spheres
+	// - Gives the same answer Sphere::IntersectRecord does testing the spheres in order
+	// @param _centerX, _centerY, _centerZ, _radiusSqr : The spheres
+	// @param _count : The amount of spheres
+	// @param _origin, _direction : The ray (xyz)
+	// @param _length : The current ray length, only closer hits count
+	// @returns int : The sphere hit (the last one on a tie), -1 for none
+	typedef int (*IntersectSpheresKernel)(const float* _centerX, const float* _centerY, const float* _centerZ, const float* _radiusSqr,
+		int _count, const float* _origin, const float* _direction, float _length);
+
+	// Primary ray directions for a run of pixels on a row, every ray starts at the camera (column3)
+	// - Gives the same directions Camera::CastRay does
+	// @param _params : The camera constants
+	// @param _y : The pixel row
+	// @param _x0 : The first pixel on the row
+	// @param _count : The amount of pixels
+	// @param _sampleX, _sampleY : The sample position on every pixel (0 to 1.f)
+	// @param _directionX, _directionY, _directionZ : Returned unit directions
+	typedef void (*GenerateRaysKernel)(const RayRowParams& _params, int _y, int _x0, int _count, float _sampleX, float _sampleY,
+		float* _directionX, float* _directionY, float* _directionZ);
+
+	// Rays tested together by the bounds kernel
+	const int rayPacketLanes{ 16 };
+
+	// RayPacket
+	// - Rays tested against a box together, kept as arrays per axis
+	// - Unused lanes are given a length of -1 so they never enter a box
+	struct RayPacket
+	{
+		float originX[rayPacketLanes], originY[rayPacketLanes], originZ[rayPacketLanes];
+		// 1 / ray direction
+		float inverseX[rayPacketLanes], inverseY[rayPacketLanes], inverseZ[rayPacketLanes];
+		// The current ray lengths, further boxes are missed
+		float length[rayPacketLanes];
+	};
+
+	// Test every ray of a packet against a box
+	// - Each ray gets the answer IntersectBounds (see BVH.h) gives it
+	// @param _packet : The rays
+	// @param _boundsMin, _boundsMax : The box corners (xyz)
+	// @param _near : Returned distance each ray enters the box (only set for rays that enter it)
+	// @returns unsigned int : A bit per ray, set if the ray enters the box before its length
+	typedef unsigned int (*IntersectBoundsKernel)(const RayPacket& _packet, const float* _boundsMin, const float* _boundsMax, float* _near);
+
+	// Convert color channels to bytes, clamped to 0 to 1.f and rounded (NaN goes to 0)
+	// @param _values : The channels
+	// @param _count : The amount of channels
+	// @param _bytes : Returned bytes
+	typedef void (*TonemapKernel)(const float* _values, int _count, unsigned char* _bytes);
+
+	// KernelTable
+	// - One instruction set's build of every kernel
+	struct KernelTable
+	{
+		KernelISA isa;
+		const char* name;
+		IntersectSpheresKernel intersectSpheres;
+		IntersectBoundsKernel intersectBounds;
+		GenerateRaysKernel generateRays;
+		TonemapKernel tonemap;
+	};
+
+	// Get an instruction set's kernels
+	// @param _isa : The instruction set
+	// @returns const KernelTable* : The kernels, nullptr if they werent built (only x86 builds the SIMD variants)
+	const KernelTable* GetKernelTable(KernelISA _isa);
+
+	// Check the CPU (and OS) can run an instruction set
+	// @param _isa : The instruction set
+	// @returns bool : true if its kernels were built and can run
+	bool IsKernelISASupported(KernelISA _isa);
+
+	// Get the kernels in use
+	// - Picked on first use, the best instruction set CPUID reports, unless the MRT_KERNELS
+	//   environment variable names another ("scalar", "sse4.2", "avx2" or "avx512")
+	// @returns const KernelTable& : The kernels
+	const KernelTable& GetKernels();
+
+	// Use an instruction set's kernels, for testing
+	// Not safe while rendering, stop renders first
+	// @param _isa : The instruction set
+	// @returns bool : false if its not supported, the kernels in use are kept
+	bool SetKernelISA(KernelISA _isa);
+
+	// Find an instruction set by name
+	// @param _name : "scalar", "sse4.2", "avx2" or "avx512"
+	// @param _isa : Returned instruction set
+	// @returns bool : false if the name is unknown
+	bool FindKernelISA(const std::string& _name, KernelISA& _isa);
+
+	// KernelCheckResult
+	// - Result of checking an instruction set's kernels against the scalar kernels
+	struct KernelCheckResult
+	{
+		KernelISA isa{ KernelISA::Scalar };
+		// The CPU can run the kernels, unsupported sets arent checked
+		bool fSupported{ false };
+		// Calls whose results differ from the scalar kernels in any bit
+		int intersectMismatches{ 0 }, boundsMismatches{ 0 }, rayMismatches{ 0 }, tonemapMismatches{ 0 };
+		// Calls made per kernel
+		int intersectCalls{ 0 }, boundsCalls{ 0 }, rayCalls{ 0 }, tonemapCalls{ 0 };
+	};
+
+	// Check every supported instruction set gives the same results as the scalar kernels
+	// Inputs are randomized, including odd sizes to cover the tails of every vector width
+	// @param _results : Returned result per instruction set (the scalar set is left out)
+	// @returns bool : true if every supported set matched exactly
+	bool CheckKernels(std::vector<KernelCheckResult>& _results);
+}
+
+#endif // !_KERNELS_H_
@@ -0,0 +1,193 @@
+#include "Kernels.h"
+
+// Only built for x86, other targets only have the scalar kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MRT_KERNELS_AVX2
+#endif
+
+#ifdef MRT_KERNELS_AVX2
+// Included libraries
+#include <cfloat>
+#include <immintrin.h>
+
+// Built without changing the project flags, the functions are marked for AVX2 instead
+// (MSVC compiles the intrinsics without it)
+// FMA is left off, fusing a multiply and add changes the rounding from the scalar kernels
+#if defined(__GNUC__) || defined(__clang__)
+#define MRT_TARGET __attribute__((target("avx2")))
+#else
+#define MRT_TARGET
+#endif
+#endif
+
+// AVX2 Kernels
+namespace MRT
+{
+#ifdef MRT_KERNELS_AVX2
+	namespace
+	{
+		// Test a block of 8 spheres
+		// @returns __m256 : The hit distance per sphere, FLT_MAX for misses and unused lanes
+		MRT_TARGET inline __m256 IntersectBlock(__m256 _centerX, __m256 _centerY, __m256 _centerZ, __m256 _radiusSqr, __m256 _lanes,
+			const __m256* _origin, const __m256* _direction)
+		{
+			const __m256 zero = _mm256_setzero_ps();
+			__m256 lX = _mm256_sub_ps(_centerX, _origin[0]), lY = _mm256_sub_ps(_centerY, _origin[1]), lZ = _mm256_sub_ps(_centerZ, _origin[2]);
+			__m256 lPD = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lX, _direction[0]), _mm256_mul_ps(lY, _direction[1])), _mm256_mul_ps(lZ, _direction[2]));
+			__m256 mL = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lX, lX), _mm256_mul_ps(lY, lY)), _mm256_mul_ps(lZ, lZ)), _mm256_mul_ps(lPD, lPD));
+			__m256 sHL = _mm256_sqrt_ps(_mm256_sub_ps(_radiusSqr, mL));
+			__m256 start = _mm256_sub_ps(lPD, sHL);
+			__m256 intersect = _mm256_blendv_ps(start, _mm256_add_ps(lPD, sHL), _mm256_cmp_ps(start, zero, _CMP_LT_OQ));
+
+			__m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(lPD, zero, _CMP_GE_OQ), _mm256_cmp_ps(mL, _radiusSqr, _CMP_LE_OQ)),
+				_mm256_cmp_ps(intersect, zero, _CMP_GE_OQ));
+			return _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), intersect, _mm256_and_ps(valid, _lanes));
+		}
+
+		// Find the closest lane of a block, ties go to the last lane
+		// @returns int : The lane, -1 if none is within _length (which is set to the closest)
+		MRT_TARGET inline int ClosestLane(__m256 _intersect, float& _length)
+		{
+			__m256 closest = _mm256_min_ps(_intersect, _mm256_permute2f128_ps(_intersect, _intersect, 1));
+			closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(2, 3, 0, 1)));
+			closest = _mm256_min_ps(closest, _mm256_shuffle_ps(closest, closest, _MM_SHUFFLE(1, 0, 3, 2)));
+			float distance = _mm256_cvtss_f32(closest);
+			if (!(distance <= _length) || distance == FLT_MAX) return -1;
+
+			int mask = _mm256_movemask_ps(_mm256_cmp_ps(_intersect, closest, _CMP_EQ_OQ));
+			int lane = 7;
+			while ((mask & (1 << lane)) == 0) --lane;
+			_length = distance;
+			return lane;
+		}
+
+		MRT_TARGET int IntersectSpheres(const float* _centerX, const float* _centerY, const float* _centerZ, const float* _radiusSqr,
+			int _count, const float* _origin, const float* _direction, float _length)
+		{
+			const __m256 origin[3]{ _mm256_set1_ps(_origin[0]), _mm256_set1_ps(_origin[1]), _mm256_set1_ps(_origin[2]) };
+			const __m256 direction[3]{ _mm256_set1_ps(_direction[0]), _mm256_set1_ps(_direction[1]), _mm256_set1_ps(_direction[2]) };
+
+			int best = -1;
+			for (int i = 0; i < _count; i += 8)
+			{
+				// The last block loads through a mask, lanes past the end read as 0 and are masked out
+				__m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(_count - i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				__m256 intersect = IntersectBlock(_mm256_maskload_ps(_centerX + i, lanes), _mm256_maskload_ps(_centerY + i, lanes),
+					_mm256_maskload_ps(_centerZ + i, lanes), _mm256_maskload_ps(_radiusSqr + i, lanes), _mm256_castsi256_ps(lanes), origin, direction);
+				int lane = ClosestLane(intersect, _length);
+				if (lane >= 0) best = i + lane;
+			}
+			_mm256_zeroupper();
+			return best;
+		}
+
+		MRT_TARGET unsigned int IntersectBounds(const RayPacket& _packet, const float* _boundsMin, const float* _boundsMax, float* _near)
+		{
+			// min and max take their operands swapped to pick like glm (see the scalar kernel)
+			const __m256 minX = _mm256_set1_ps(_boundsMin[0]), minY = _mm256_set1_ps(_boundsMin[1]), minZ = _mm256_set1_ps(_boundsMin[2]);
+			const __m256 maxX = _mm256_set1_ps(_boundsMax[0]), maxY = _mm256_set1_ps(_boundsMax[1]), maxZ = _mm256_set1_ps(_boundsMax[2]);
+			unsigned int entered = 0;
+			for (int r = 0; r < rayPacketLanes; r += 8)
+			{
+				__m256 originX = _mm256_loadu_ps(_packet.originX + r), inverseX = _mm256_loadu_ps(_packet.inverseX + r);
+				__m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(minX, originX), inverseX), tx2 = _mm256_mul_ps(_mm256_sub_ps(maxX, originX), inverseX);
+				__m256 tMin = _mm256_min_ps(tx2, tx1), tMax = _mm256_max_ps(tx2, tx1);
+				__m256 originY = _mm256_loadu_ps(_packet.originY + r), inverseY = _mm256_loadu_ps(_packet.inverseY + r);
+				__m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(minY, originY), inverseY), ty2 = _mm256_mul_ps(_mm256_sub_ps(maxY, originY), inverseY);
+				tMin = _mm256_max_ps(_mm256_min_ps(ty2, ty1), tMin); tMax = _mm256_min_ps(_mm256_max_ps(ty2, ty1), tMax);
+				__m256 originZ = _mm256_loadu_ps(_packet.originZ + r), inverseZ = _mm256_loadu_ps(_packet.inverseZ + r);
+				__m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(minZ, originZ), inverseZ), tz2 = _mm256_mul_ps(_mm256_sub_ps(maxZ, originZ), inverseZ);
+				tMin = _mm256_max_ps(_mm256_min_ps(tz2, tz1), tMin); tMax = _mm256_min_ps(_mm256_max_ps(tz2, tz1), tMax);
+
+				__m256 hit = _mm256_and_ps(_mm256_cmp_ps(tMax, _mm256_max_ps(_mm256_setzero_ps(), tMin), _CMP_GE_OQ),
+					_mm256_cmp_ps(tMin, _mm256_loadu_ps(_packet.length + r), _CMP_LE_OQ));
+				_mm256_storeu_ps(_near + r, tMin);
+				entered |= (unsigned int)_mm256_movemask_ps(hit) << r;
+			}
+			_mm256_zeroupper();
+			return entered;
+		}
+
+		MRT_TARGET void GenerateRays(const RayRowParams& _params, int _y, int _x0, int _count, float _sampleX, float _sampleY,
+			float* _directionX, float* _directionY, float* _directionZ)
+		{
+			// Row constants are worked out like the scalar kernel
+			float wY = (1 - ((((float)_y + _sampleY) / _params.imageHeight) * 2)) * _params.aspectY * _params.fov;
+			__m256 row[3], constant[3], column0[3], column3[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				row[axis] = _mm256_set1_ps(_params.column1[axis] * wY);
+				constant[axis] = _mm256_set1_ps(-_params.column2[axis] + _params.column3[axis]);
+				column0[axis] = _mm256_set1_ps(_params.column0[axis]);
+				column3[axis] = _mm256_set1_ps(_params.column3[axis]);
+			}
+			const __m256 sampleX = _mm256_set1_ps(_sampleX), width = _mm256_set1_ps(_params.imageWidth), two = _mm256_set1_ps(2),
+				one = _mm256_set1_ps(1), aspectX = _mm256_set1_ps(_params.aspectX), fov = _mm256_set1_ps(_params.fov);
+
+			for (int i = 0; i < _count; i += 8)
+			{
+				__m256 x = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(_x0 + i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+				__m256 wX = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_add_ps(x, sampleX), width), two), one), aspectX), fov);
+
+				__m256 d[3];
+				for (int axis = 0; axis < 3; ++axis)
+					d[axis] = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(column0[axis], wX), row[axis]), constant[axis]), column3[axis]);
+				__m256 lengthSqr = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d[0], d[0]), _mm256_mul_ps(d[1], d[1])), _mm256_mul_ps(d[2], d[2]));
+				__m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSqr));
+
+				// The last block stores through a mask
+				__m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(_count - i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				_mm256_maskstore_ps(_directionX + i, lanes, _mm256_mul_ps(d[0], inverseLength));
+				_mm256_maskstore_ps(_directionY + i, lanes, _mm256_mul_ps(d[1], inverseLength));
+				_mm256_maskstore_ps(_directionZ + i, lanes, _mm256_mul_ps(d[2], inverseLength));
+			}
+			_mm256_zeroupper();
+		}
+
+		// Clamp, scale and round 8 channels
+		MRT_TARGET inline __m256i TonemapBlock(__m256 _values)
+		{
+			// max returns its second operand for NaN, so NaN goes to 0 like the scalar kernel
+			__m256 clamped = _mm256_min_ps(_mm256_max_ps(_values, _mm256_setzero_ps()), _mm256_set1_ps(1));
+			return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(255.f)), _mm256_set1_ps(0.5f)));
+		}
+
+		// Pack 32 channels to bytes, packing works within 128 bit halves so the result is put back in order
+		MRT_TARGET inline __m256i PackBlocks(const float* _values)
+		{
+			__m256i low = _mm256_packus_epi32(TonemapBlock(_mm256_loadu_ps(_values)), TonemapBlock(_mm256_loadu_ps(_values + 8)));
+			__m256i high = _mm256_packus_epi32(TonemapBlock(_mm256_loadu_ps(_values + 16)), TonemapBlock(_mm256_loadu_ps(_values + 24)));
+			return _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		}
+
+		MRT_TARGET void Tonemap(const float* _values, int _count, unsigned char* _bytes)
+		{
+			int i = 0;
+			for (; i + 32 <= _count; i += 32)
+				_mm256_storeu_si256((__m256i*)(_bytes + i), PackBlocks(_values + i));
+
+			if (i < _count)
+			{
+				float tail[32]{};
+				unsigned char bytes[32];
+				for (int t = 0; i + t < _count; ++t) tail[t] = _values[i + t];
+				_mm256_storeu_si256((__m256i*)bytes, PackBlocks(tail));
+				for (int t = 0; i + t < _count; ++t) _bytes[i + t] = bytes[t];
+			}
+			_mm256_zeroupper();
+		}
+
+		const KernelTable avx2Kernels{ KernelISA::AVX2, "avx2", IntersectSpheres, IntersectBounds, GenerateRays, Tonemap };
+	}
+
+	const KernelTable* GetAVX2Kernels()
+	{
+		return &avx2Kernels;
+	}
+#else
+	const KernelTable* GetAVX2Kernels()
+	{
+		return nullptr;
+	}
+#endif
+}
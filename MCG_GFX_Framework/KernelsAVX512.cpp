@@ -0,0 +1,165 @@
+#include "Kernels.h"
+
+// Only built for x86, other targets only have the scalar kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MRT_KERNELS_AVX512
+#endif
+
+#ifdef MRT_KERNELS_AVX512
+// Included libraries
+#include <cfloat>
+#include <immintrin.h>
+
+// Built without changing the project flags, the functions are marked for AVX-512 instead
+// (MSVC compiles the intrinsics without it)
+#if defined(__GNUC__) || defined(__clang__)
+#define MRT_TARGET __attribute__((target("avx512f")))
+#else
+#define MRT_TARGET
+#endif
+
+// AVX-512 comes with FMA, keep multiplies and adds apart so the rounding matches the scalar kernels
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+#endif
+
+// AVX-512 Kernels
+namespace MRT
+{
+#ifdef MRT_KERNELS_AVX512
+	namespace
+	{
+		// Lanes of a 16 wide block still inside a run
+		inline __mmask16 GetLanes(int _remaining)
+		{
+			return _remaining >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << _remaining) - 1);
+		}
+
+		MRT_TARGET int IntersectSpheres(const float* _centerX, const float* _centerY, const float* _centerZ, const float* _radiusSqr,
+			int _count, const float* _origin, const float* _direction, float _length)
+		{
+			const __m512 originX = _mm512_set1_ps(_origin[0]), originY = _mm512_set1_ps(_origin[1]), originZ = _mm512_set1_ps(_origin[2]);
+			const __m512 directionX = _mm512_set1_ps(_direction[0]), directionY = _mm512_set1_ps(_direction[1]), directionZ = _mm512_set1_ps(_direction[2]);
+			const __m512 zero = _mm512_setzero_ps();
+
+			int best = -1;
+			for (int i = 0; i < _count; i += 16)
+			{
+				const __mmask16 lanes = GetLanes(_count - i);
+				__m512 radiusSqr = _mm512_maskz_loadu_ps(lanes, _radiusSqr + i);
+				__m512 lX = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, _centerX + i), originX);
+				__m512 lY = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, _centerY + i), originY);
+				__m512 lZ = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, _centerZ + i), originZ);
+				__m512 lPD = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lX, directionX), _mm512_mul_ps(lY, directionY)), _mm512_mul_ps(lZ, directionZ));
+				__m512 mL = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lX, lX), _mm512_mul_ps(lY, lY)), _mm512_mul_ps(lZ, lZ)), _mm512_mul_ps(lPD, lPD));
+				__m512 sHL = _mm512_sqrt_ps(_mm512_sub_ps(radiusSqr, mL));
+				__m512 start = _mm512_sub_ps(lPD, sHL);
+				__m512 intersect = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(start, zero, _CMP_LT_OQ), start, _mm512_add_ps(lPD, sHL));
+
+				__mmask16 valid = lanes & _mm512_cmp_ps_mask(lPD, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(mL, radiusSqr, _CMP_LE_OQ) &
+					_mm512_cmp_ps_mask(intersect, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(intersect, _mm512_set1_ps(_length), _CMP_LE_OQ);
+				if (valid == 0) continue;
+
+				// Closest valid lane, ties go to the last lane
+				float distance = _mm512_mask_reduce_min_ps(valid, intersect);
+				unsigned int closest = valid & _mm512_cmp_ps_mask(intersect, _mm512_set1_ps(distance), _CMP_EQ_OQ);
+				int lane = 15;
+				while ((closest & (1u << lane)) == 0) --lane;
+				_length = distance;
+				best = i + lane;
+			}
+			_mm256_zeroupper();
+			return best;
+		}
+
+		MRT_TARGET unsigned int IntersectBounds(const RayPacket& _packet, const float* _boundsMin, const float* _boundsMax, float* _near)
+		{
+			// The whole packet fits one register, min and max take their operands swapped to pick like glm (see the scalar kernel)
+			static_assert(rayPacketLanes == 16, "The AVX-512 bounds kernel tests 16 rays at once");
+			__m512 originX = _mm512_loadu_ps(_packet.originX), inverseX = _mm512_loadu_ps(_packet.inverseX);
+			__m512 tx1 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMin[0]), originX), inverseX);
+			__m512 tx2 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMax[0]), originX), inverseX);
+			__m512 tMin = _mm512_min_ps(tx2, tx1), tMax = _mm512_max_ps(tx2, tx1);
+			__m512 originY = _mm512_loadu_ps(_packet.originY), inverseY = _mm512_loadu_ps(_packet.inverseY);
+			__m512 ty1 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMin[1]), originY), inverseY);
+			__m512 ty2 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMax[1]), originY), inverseY);
+			tMin = _mm512_max_ps(_mm512_min_ps(ty2, ty1), tMin); tMax = _mm512_min_ps(_mm512_max_ps(ty2, ty1), tMax);
+			__m512 originZ = _mm512_loadu_ps(_packet.originZ), inverseZ = _mm512_loadu_ps(_packet.inverseZ);
+			__m512 tz1 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMin[2]), originZ), inverseZ);
+			__m512 tz2 = _mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(_boundsMax[2]), originZ), inverseZ);
+			tMin = _mm512_max_ps(_mm512_min_ps(tz2, tz1), tMin); tMax = _mm512_min_ps(_mm512_max_ps(tz2, tz1), tMax);
+
+			__mmask16 entered = _mm512_cmp_ps_mask(tMax, _mm512_max_ps(_mm512_setzero_ps(), tMin), _CMP_GE_OQ) &
+				_mm512_cmp_ps_mask(tMin, _mm512_loadu_ps(_packet.length), _CMP_LE_OQ);
+			_mm512_storeu_ps(_near, tMin);
+			_mm256_zeroupper();
+			return entered;
+		}
+
+		MRT_TARGET void GenerateRays(const RayRowParams& _params, int _y, int _x0, int _count, float _sampleX, float _sampleY,
+			float* _directionX, float* _directionY, float* _directionZ)
+		{
+			// Row constants are worked out like the scalar kernel
+			float wY = (1 - ((((float)_y + _sampleY) / _params.imageHeight) * 2)) * _params.aspectY * _params.fov;
+			__m512 row[3], constant[3], column0[3], column3[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				row[axis] = _mm512_set1_ps(_params.column1[axis] * wY);
+				constant[axis] = _mm512_set1_ps(-_params.column2[axis] + _params.column3[axis]);
+				column0[axis] = _mm512_set1_ps(_params.column0[axis]);
+				column3[axis] = _mm512_set1_ps(_params.column3[axis]);
+			}
+			const __m512 sampleX = _mm512_set1_ps(_sampleX), width = _mm512_set1_ps(_params.imageWidth), two = _mm512_set1_ps(2),
+				one = _mm512_set1_ps(1), aspectX = _mm512_set1_ps(_params.aspectX), fov = _mm512_set1_ps(_params.fov);
+			const __m512i steps = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+			for (int i = 0; i < _count; i += 16)
+			{
+				__m512 x = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(_x0 + i), steps));
+				__m512 wX = _mm512_mul_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(_mm512_div_ps(_mm512_add_ps(x, sampleX), width), two), one), aspectX), fov);
+
+				__m512 d[3];
+				for (int axis = 0; axis < 3; ++axis)
+					d[axis] = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(column0[axis], wX), row[axis]), constant[axis]), column3[axis]);
+				__m512 lengthSqr = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(d[0], d[0]), _mm512_mul_ps(d[1], d[1])), _mm512_mul_ps(d[2], d[2]));
+				__m512 inverseLength = _mm512_div_ps(one, _mm512_sqrt_ps(lengthSqr));
+
+				const __mmask16 lanes = GetLanes(_count - i);
+				_mm512_mask_storeu_ps(_directionX + i, lanes, _mm512_mul_ps(d[0], inverseLength));
+				_mm512_mask_storeu_ps(_directionY + i, lanes, _mm512_mul_ps(d[1], inverseLength));
+				_mm512_mask_storeu_ps(_directionZ + i, lanes, _mm512_mul_ps(d[2], inverseLength));
+			}
+			_mm256_zeroupper();
+		}
+
+		MRT_TARGET void Tonemap(const float* _values, int _count, unsigned char* _bytes)
+		{
+			const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1), scale = _mm512_set1_ps(255.f), half = _mm512_set1_ps(0.5f);
+			for (int i = 0; i < _count; i += 16)
+			{
+				const __mmask16 lanes = GetLanes(_count - i);
+				// max returns its second operand for NaN, so NaN goes to 0 like the scalar kernel
+				__m512 clamped = _mm512_min_ps(_mm512_max_ps(_mm512_maskz_loadu_ps(lanes, _values + i), zero), one);
+				__m512i channels = _mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(clamped, scale), half));
+				_mm512_mask_cvtusepi32_storeu_epi8(_bytes + i, lanes, channels);
+			}
+			_mm256_zeroupper();
+		}
+
+		const KernelTable avx512Kernels{ KernelISA::AVX512, "avx512", IntersectSpheres, IntersectBounds, GenerateRays, Tonemap };
+	}
+
+	const KernelTable* GetAVX512Kernels()
+	{
+		return &avx512Kernels;
+	}
+#else
+	const KernelTable* GetAVX512Kernels()
+	{
+		return nullptr;
+	}
+#endif
+}
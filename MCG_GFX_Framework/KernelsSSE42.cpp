@@ -0,0 +1,205 @@
+#include "Kernels.h"
+
+// Only built for x86, other targets only have the scalar kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MRT_KERNELS_SSE42
+#endif
+
+#ifdef MRT_KERNELS_SSE42
+// Included libraries
+#include <cfloat>
+#include <nmmintrin.h>
+
+// Built without changing the project flags, the functions are marked for SSE4.2 instead
+// (MSVC compiles the intrinsics without it)
+#if defined(__GNUC__) || defined(__clang__)
+#define MRT_TARGET __attribute__((target("sse4.2")))
+#else
+#define MRT_TARGET
+#endif
+#endif
+
+// SSE4.2 Kernels
+namespace MRT
+{
+#ifdef MRT_KERNELS_SSE42
+	namespace
+	{
+		// Test a block of 4 spheres
+		// @returns __m128 : The hit distance per sphere, FLT_MAX for misses and unused lanes
+		MRT_TARGET inline __m128 IntersectBlock(__m128 _centerX, __m128 _centerY, __m128 _centerZ, __m128 _radiusSqr, __m128 _lanes,
+			const __m128* _origin, const __m128* _direction)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			__m128 lX = _mm_sub_ps(_centerX, _origin[0]), lY = _mm_sub_ps(_centerY, _origin[1]), lZ = _mm_sub_ps(_centerZ, _origin[2]);
+			__m128 lPD = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lX, _direction[0]), _mm_mul_ps(lY, _direction[1])), _mm_mul_ps(lZ, _direction[2]));
+			__m128 mL = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(lX, lX), _mm_mul_ps(lY, lY)), _mm_mul_ps(lZ, lZ)), _mm_mul_ps(lPD, lPD));
+			__m128 sHL = _mm_sqrt_ps(_mm_sub_ps(_radiusSqr, mL));
+			__m128 start = _mm_sub_ps(lPD, sHL);
+			__m128 intersect = _mm_blendv_ps(start, _mm_add_ps(lPD, sHL), _mm_cmplt_ps(start, zero));
+
+			__m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(lPD, zero), _mm_cmple_ps(mL, _radiusSqr)), _mm_cmpge_ps(intersect, zero));
+			return _mm_blendv_ps(_mm_set1_ps(FLT_MAX), intersect, _mm_and_ps(valid, _lanes));
+		}
+
+		// Find the closest lane of a block, ties go to the last lane
+		// @returns int : The lane, -1 if none is within _length (which is set to the closest)
+		MRT_TARGET inline int ClosestLane(__m128 _intersect, float& _length)
+		{
+			__m128 closest = _mm_min_ps(_intersect, _mm_shuffle_ps(_intersect, _intersect, _MM_SHUFFLE(2, 3, 0, 1)));
+			closest = _mm_min_ps(closest, _mm_shuffle_ps(closest, closest, _MM_SHUFFLE(1, 0, 3, 2)));
+			float distance = _mm_cvtss_f32(closest);
+			if (!(distance <= _length) || distance == FLT_MAX) return -1;
+
+			int mask = _mm_movemask_ps(_mm_cmpeq_ps(_intersect, closest));
+			int lane = 3;
+			while ((mask & (1 << lane)) == 0) --lane;
+			_length = distance;
+			return lane;
+		}
+
+		MRT_TARGET int IntersectSpheres(const float* _centerX, const float* _centerY, const float* _centerZ, const float* _radiusSqr,
+			int _count, const float* _origin, const float* _direction, float _length)
+		{
+			const __m128 origin[3]{ _mm_set1_ps(_origin[0]), _mm_set1_ps(_origin[1]), _mm_set1_ps(_origin[2]) };
+			const __m128 direction[3]{ _mm_set1_ps(_direction[0]), _mm_set1_ps(_direction[1]), _mm_set1_ps(_direction[2]) };
+			const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			int best = -1, i = 0;
+			for (; i + 4 <= _count; i += 4)
+			{
+				__m128 intersect = IntersectBlock(_mm_loadu_ps(_centerX + i), _mm_loadu_ps(_centerY + i), _mm_loadu_ps(_centerZ + i),
+					_mm_loadu_ps(_radiusSqr + i), all, origin, direction);
+				int lane = ClosestLane(intersect, _length);
+				if (lane >= 0) best = i + lane;
+			}
+
+			// Copy the last few spheres into a full block, the unused lanes are masked out
+			if (i < _count)
+			{
+				float tail[4][4]{};
+				for (int t = 0; i + t < _count; ++t)
+				{
+					tail[0][t] = _centerX[i + t]; tail[1][t] = _centerY[i + t]; tail[2][t] = _centerZ[i + t]; tail[3][t] = _radiusSqr[i + t];
+				}
+				__m128 lanes = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(_count - i)));
+				__m128 intersect = IntersectBlock(_mm_loadu_ps(tail[0]), _mm_loadu_ps(tail[1]), _mm_loadu_ps(tail[2]), _mm_loadu_ps(tail[3]),
+					lanes, origin, direction);
+				int lane = ClosestLane(intersect, _length);
+				if (lane >= 0) best = i + lane;
+			}
+			return best;
+		}
+
+		MRT_TARGET unsigned int IntersectBounds(const RayPacket& _packet, const float* _boundsMin, const float* _boundsMax, float* _near)
+		{
+			// min and max take their operands swapped to pick like glm (see the scalar kernel)
+			const __m128 minX = _mm_set1_ps(_boundsMin[0]), minY = _mm_set1_ps(_boundsMin[1]), minZ = _mm_set1_ps(_boundsMin[2]);
+			const __m128 maxX = _mm_set1_ps(_boundsMax[0]), maxY = _mm_set1_ps(_boundsMax[1]), maxZ = _mm_set1_ps(_boundsMax[2]);
+			unsigned int entered = 0;
+			for (int r = 0; r < rayPacketLanes; r += 4)
+			{
+				__m128 originX = _mm_loadu_ps(_packet.originX + r), inverseX = _mm_loadu_ps(_packet.inverseX + r);
+				__m128 tx1 = _mm_mul_ps(_mm_sub_ps(minX, originX), inverseX), tx2 = _mm_mul_ps(_mm_sub_ps(maxX, originX), inverseX);
+				__m128 tMin = _mm_min_ps(tx2, tx1), tMax = _mm_max_ps(tx2, tx1);
+				__m128 originY = _mm_loadu_ps(_packet.originY + r), inverseY = _mm_loadu_ps(_packet.inverseY + r);
+				__m128 ty1 = _mm_mul_ps(_mm_sub_ps(minY, originY), inverseY), ty2 = _mm_mul_ps(_mm_sub_ps(maxY, originY), inverseY);
+				tMin = _mm_max_ps(_mm_min_ps(ty2, ty1), tMin); tMax = _mm_min_ps(_mm_max_ps(ty2, ty1), tMax);
+				__m128 originZ = _mm_loadu_ps(_packet.originZ + r), inverseZ = _mm_loadu_ps(_packet.inverseZ + r);
+				__m128 tz1 = _mm_mul_ps(_mm_sub_ps(minZ, originZ), inverseZ), tz2 = _mm_mul_ps(_mm_sub_ps(maxZ, originZ), inverseZ);
+				tMin = _mm_max_ps(_mm_min_ps(tz2, tz1), tMin); tMax = _mm_min_ps(_mm_max_ps(tz2, tz1), tMax);
+
+				__m128 hit = _mm_and_ps(_mm_cmpge_ps(tMax, _mm_max_ps(_mm_setzero_ps(), tMin)), _mm_cmple_ps(tMin, _mm_loadu_ps(_packet.length + r)));
+				_mm_storeu_ps(_near + r, tMin);
+				entered |= (unsigned int)_mm_movemask_ps(hit) << r;
+			}
+			return entered;
+		}
+
+		MRT_TARGET void GenerateRays(const RayRowParams& _params, int _y, int _x0, int _count, float _sampleX, float _sampleY,
+			float* _directionX, float* _directionY, float* _directionZ)
+		{
+			// Row constants are worked out like the scalar kernel
+			float wY = (1 - ((((float)_y + _sampleY) / _params.imageHeight) * 2)) * _params.aspectY * _params.fov;
+			__m128 row[3], constant[3], column0[3], column3[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				row[axis] = _mm_set1_ps(_params.column1[axis] * wY);
+				constant[axis] = _mm_set1_ps(-_params.column2[axis] + _params.column3[axis]);
+				column0[axis] = _mm_set1_ps(_params.column0[axis]);
+				column3[axis] = _mm_set1_ps(_params.column3[axis]);
+			}
+			const __m128 sampleX = _mm_set1_ps(_sampleX), width = _mm_set1_ps(_params.imageWidth), two = _mm_set1_ps(2), one = _mm_set1_ps(1),
+				aspectX = _mm_set1_ps(_params.aspectX), fov = _mm_set1_ps(_params.fov);
+
+			float tail[3][4];
+			for (int i = 0; i < _count; i += 4)
+			{
+				__m128 x = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(_x0 + i), _mm_setr_epi32(0, 1, 2, 3)));
+				__m128 wX = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_div_ps(_mm_add_ps(x, sampleX), width), two), one), aspectX), fov);
+
+				__m128 d[3];
+				for (int axis = 0; axis < 3; ++axis)
+					d[axis] = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(column0[axis], wX), row[axis]), constant[axis]), column3[axis]);
+				__m128 lengthSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], d[0]), _mm_mul_ps(d[1], d[1])), _mm_mul_ps(d[2], d[2]));
+				__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSqr));
+
+				if (i + 4 <= _count)
+				{
+					_mm_storeu_ps(_directionX + i, _mm_mul_ps(d[0], inverseLength));
+					_mm_storeu_ps(_directionY + i, _mm_mul_ps(d[1], inverseLength));
+					_mm_storeu_ps(_directionZ + i, _mm_mul_ps(d[2], inverseLength));
+					continue;
+				}
+				_mm_storeu_ps(tail[0], _mm_mul_ps(d[0], inverseLength));
+				_mm_storeu_ps(tail[1], _mm_mul_ps(d[1], inverseLength));
+				_mm_storeu_ps(tail[2], _mm_mul_ps(d[2], inverseLength));
+				for (int t = 0; i + t < _count; ++t)
+				{
+					_directionX[i + t] = tail[0][t]; _directionY[i + t] = tail[1][t]; _directionZ[i + t] = tail[2][t];
+				}
+			}
+		}
+
+		// Clamp, scale and round 4 channels
+		MRT_TARGET inline __m128i TonemapBlock(__m128 _values)
+		{
+			// max returns its second operand for NaN, so NaN goes to 0 like the scalar kernel
+			__m128 clamped = _mm_min_ps(_mm_max_ps(_values, _mm_setzero_ps()), _mm_set1_ps(1));
+			return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+		}
+
+		MRT_TARGET void Tonemap(const float* _values, int _count, unsigned char* _bytes)
+		{
+			int i = 0;
+			for (; i + 16 <= _count; i += 16)
+			{
+				__m128i low = _mm_packus_epi32(TonemapBlock(_mm_loadu_ps(_values + i)), TonemapBlock(_mm_loadu_ps(_values + i + 4)));
+				__m128i high = _mm_packus_epi32(TonemapBlock(_mm_loadu_ps(_values + i + 8)), TonemapBlock(_mm_loadu_ps(_values + i + 12)));
+				_mm_storeu_si128((__m128i*)(_bytes + i), _mm_packus_epi16(low, high));
+			}
+			if (i == _count) return;
+
+			float tail[16]{};
+			unsigned char bytes[16];
+			for (int t = 0; i + t < _count; ++t) tail[t] = _values[i + t];
+			__m128i low = _mm_packus_epi32(TonemapBlock(_mm_loadu_ps(tail)), TonemapBlock(_mm_loadu_ps(tail + 4)));
+			__m128i high = _mm_packus_epi32(TonemapBlock(_mm_loadu_ps(tail + 8)), TonemapBlock(_mm_loadu_ps(tail + 12)));
+			_mm_storeu_si128((__m128i*)bytes, _mm_packus_epi16(low, high));
+			for (int t = 0; i + t < _count; ++t) _bytes[i + t] = bytes[t];
+		}
+
+		const KernelTable sse42Kernels{ KernelISA::SSE42, "sse4.2", IntersectSpheres, IntersectBounds, GenerateRays, Tonemap };
+	}
+
+	const KernelTable* GetSSE42Kernels()
+	{
+		return &sse42Kernels;
+	}
+#else
+	const KernelTable* GetSSE42Kernels()
+	{
+		return nullptr;
+	}
+#endif
+}
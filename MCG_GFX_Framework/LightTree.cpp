@@ -0,0 +1,126 @@
+#include "LightTree.h"
+
+// Light Tree
+namespace MRT
+{
+	float GetLightPower(const LightRecord& _light)
+	{
+		const float pi = 3.14159265f;
+		float emission = (_light.emission.r + _light.emission.g + _light.emission.b) / 3.f;
+		// Points emit over the whole sphere of directions, sphere surfaces over a hemisphere per point
+		if (_light.radius <= 0) return 4.f * pi * emission;
+		return 4.f * pi * pi * (float)(_light.radius * _light.radius) * emission;
+	}
+
+	float LightTree::GetImportance(float _power, const rvec3& _boundsMin, const rvec3& _boundsMax, const rvec3& _point) const
+	{
+		if (_power <= 0) return 0;
+
+		// Squared distance to the bounds, clamped by their size so points inside dont blow up
+		rvec3 closest = glm::max(_boundsMin, glm::min(_point, _boundsMax));
+		rvec3 offset = closest - _point;
+		rvec3 halfExtent = (_boundsMax - _boundsMin) * (real)0.5;
+		real distanceSqr = glm::max(glm::dot(offset, offset), glm::dot(halfExtent, halfExtent));
+		return _power / (float)glm::max(distanceSqr, (real)1e-4f);
+	}
+
+	void LightTree::Build(const std::vector<LightRecord>& _lights)
+	{
+		nodes.clear();
+		refs.clear();
+		nodePower.clear();
+		lightPower.resize(_lights.size());
+		lightBounds.clear();
+		if (_lights.empty()) return;
+
+		lightBounds.resize(_lights.size());
+		for (size_t i = 0; i < _lights.size(); ++i)
+		{
+			const LightRecord& light = _lights[i];
+			rvec3 extent(glm::max(light.radius, (real)0));
+			lightBounds[i].boundsMin = light.position - extent;
+			lightBounds[i].boundsMax = light.position + extent;
+			lightBounds[i].ref = MakePrimitiveRef(PrimitiveType::Generic, (unsigned int)i);
+			lightPower[i] = GetLightPower(light);
+		}
+		// BuildBVH reorders its items, the bounds are kept in light order
+		std::vector<BVHBuildItem> items(lightBounds);
+		BuildBVH(items, nodes, refs);
+
+		// Children always come after their parent, so summing backwards fills every node
+		nodePower.assign(nodes.size(), 0.f);
+		for (int n = (int)nodes.size() - 1; n >= 0; --n)
+		{
+			const BVHNode& node = nodes[n];
+			if (node.count > 0)
+			{
+				for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+					nodePower[n] += lightPower[GetRefIndex(refs[i])];
+			}
+			else nodePower[n] = nodePower[node.leftFirst] + nodePower[node.leftFirst + 1];
+		}
+	}
+
+	int LightTree::Sample(const rvec3& _point, float _u, float& _probability) const
+	{
+		_probability = 0;
+		if (nodes.empty() || nodePower[0] <= 0) return -1;
+
+		float probability = 1.f;
+		int n = 0;
+		while (nodes[n].count == 0)
+		{
+			const BVHNode& left = nodes[nodes[n].leftFirst];
+			const BVHNode& right = nodes[nodes[n].leftFirst + 1];
+			float importanceLeft = GetImportance(nodePower[nodes[n].leftFirst], left.boundsMin, left.boundsMax, _point);
+			float importanceRight = GetImportance(nodePower[nodes[n].leftFirst + 1], right.boundsMin, right.boundsMax, _point);
+			float total = importanceLeft + importanceRight;
+			if (total <= 0) return -1;
+
+			// Reuse the random number for the next choice by rescaling it
+			float pLeft = importanceLeft / total;
+			if (_u < pLeft)
+			{
+				_u = pLeft > 0 ? _u / pLeft : 0;
+				probability *= pLeft;
+				n = nodes[n].leftFirst;
+			}
+			else
+			{
+				_u = pLeft < 1 ? (_u - pLeft) / (1 - pLeft) : 0;
+				probability *= 1 - pLeft;
+				n = nodes[n].leftFirst + 1;
+			}
+			_u = glm::min(_u, 0.99999994f);
+		}
+
+		// Leaves hold a few lights, pick one by its own importance
+		const BVHNode& leaf = nodes[n];
+		float total = 0;
+		for (int i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; ++i)
+		{
+			const BVHBuildItem& light = lightBounds[GetRefIndex(refs[i])];
+			total += GetImportance(lightPower[GetRefIndex(refs[i])], light.boundsMin, light.boundsMax, _point);
+		}
+		if (total <= 0) return -1;
+
+		float target = _u * total;
+		int picked = -1;
+		float pickedImportance = 0;
+		for (int i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; ++i)
+		{
+			const unsigned int index = GetRefIndex(refs[i]);
+			const BVHBuildItem& light = lightBounds[index];
+			float importance = GetImportance(lightPower[index], light.boundsMin, light.boundsMax, _point);
+			if (importance <= 0) continue;
+			// Rounding can leave the target past the last light, which then takes it
+			picked = (int)index;
+			pickedImportance = importance;
+			if (target < importance) break;
+			target -= importance;
+		}
+
+		_probability = probability * (pickedImportance / total);
+		return picked;
+	}
+}
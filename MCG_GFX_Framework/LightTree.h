@@ -0,0 +1,74 @@
+#ifndef _LIGHTTREE_H_
+#define _LIGHTTREE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+#include "BVH.h"
+
+namespace MRT
+{
+	// LightRecord
+	// - A point light (radius 0) or an emissive sphere light
+	// - Lights only light the scene, add a Sphere as well for the light to be seen
+	struct LightRecord
+	{
+		rvec3 position;
+		real radius{ 0 };
+		// Point lights: intensity, falls off with the squared distance
+		// Sphere lights: emitted radiance of the surface
+		ColorPixel emission;
+	};
+
+	// Get the total power of a light, used to pick bright lights more often
+	// @param _light : The light
+	// @returns float : The power, averaged over the color channels
+	float GetLightPower(const LightRecord& _light);
+
+	// LightTree
+	// - A BVH over the lights, every node knows the total power below it
+	// - Picks one light per sample by walking down the tree, each child chosen with a probability
+	//   of its power over its squared distance to the shading point, O(log n) per light
+	// - Every light that could light the point has a non zero chance of being picked,
+	//   dividing by the returned probability keeps the estimate unbiased
+	class LightTree
+	{
+	private:
+		std::vector<BVHNode> nodes;
+		std::vector<unsigned int> refs;
+		// Total power per node
+		std::vector<float> nodePower;
+		// Power and bounds per light, indexed like the lights
+		std::vector<float> lightPower;
+		std::vector<BVHBuildItem> lightBounds;
+
+		// Get how much a node or light is likely to light a point
+		// @param _power : Total power of the node
+		// @param _boundsMin, _boundsMax : Bounds of the node
+		// @param _point : The shading point
+		// @returns float : The importance (0 if no power)
+		float GetImportance(float _power, const rvec3& _boundsMin, const rvec3& _boundsMax, const rvec3& _point) const;
+
+	public:
+		// Build the tree over a set of lights
+		// @param _lights : The lights, indices into this array are returned by Sample
+		void Build(const std::vector<LightRecord>& _lights);
+
+		// Check the tree holds any lights
+		// @returns bool : true if empty
+		bool IsEmpty() const { return nodes.empty(); }
+
+		// Pick a light for a shading point
+		// @param _point : The shading point
+		// @param _u : A uniform random number (0 to 1.f)
+		// @param _probability : Returned probability of picking the light
+		// @returns int : The light index, -1 if no light has any power
+		int Sample(const rvec3& _point, float _u, float& _probability) const;
+	};
+}
+
+#endif // !_LIGHTTREE_H_
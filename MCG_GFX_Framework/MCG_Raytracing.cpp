@@ -1,17 +1,144 @@
 #include "MCG_Raytracing.h"
 
+// Included libraries
+#include <charconv>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 // Scene Manager
 namespace MRT
 {
+	namespace
+	{
+		// FNV-1a hash of an instruction name
+		// @param _name : The instruction name
+		// @returns unsigned int : The hash
+		unsigned int HashInstruction(std::string_view _name)
+		{
+			unsigned int hash = 2166136261u;
+			for (char c : _name)
+			{
+				hash ^= (unsigned char)c;
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+
+		// Parse a float argument in place, a leading '+' is allowed
+		// @param _arg : The argument
+		// @param _value : Returned value
+		// @returns bool : false if the argument isnt entirely a number
+		bool ParseFloat(std::string_view _arg, float& _value)
+		{
+			if (!_arg.empty() && _arg[0] == '+') _arg.remove_prefix(1);
+			const char* end = _arg.data() + _arg.size();
+			std::from_chars_result result = std::from_chars(_arg.data(), end, _value);
+			return result.ec == std::errc() && result.ptr == end;
+		}
+
+		// Parse a row of float arguments
+		// @param _args : The first argument
+		// @param _values : Returned values
+		// @param _count : The amount of arguments to parse
+		// @returns bool : false if any argument isnt a number
+		bool ParseFloats(const std::string_view* _args, float* _values, int _count)
+		{
+			for (int i = 0; i < _count; ++i)
+				if (!ParseFloat(_args[i], _values[i])) return false;
+			return true;
+		}
+
+		// Parse an integer argument in place, a leading '+' is allowed
+		// @param _arg : The argument
+		// @param _value : Returned value
+		// @returns bool : false if the argument isnt entirely a number
+		bool ParseInt(std::string_view _arg, int& _value)
+		{
+			if (!_arg.empty() && _arg[0] == '+') _arg.remove_prefix(1);
+			const char* end = _arg.data() + _arg.size();
+			std::from_chars_result result = std::from_chars(_arg.data(), end, _value);
+			return result.ec == std::errc() && result.ptr == end;
+		}
+
+		// Parse a distance field shape name
+		// @param _arg : The argument, sphere/box/torus/capsule/cylinder
+		// @param _shape : Returned shape
+		// @returns bool : false if the name is unknown
+		bool ParseShape(std::string_view _arg, SDFShape& _shape)
+		{
+			const std::string_view names[]{ "sphere", "box", "torus", "capsule", "cylinder" };
+			for (int i = 0; i < 5; ++i)
+				if (_arg == names[i]) { _shape = (SDFShape)i; return true; }
+			return false;
+		}
+
+		// Parse a distance field blend name
+		// @param _arg : The argument, union/smoothunion/subtract/smoothsubtract/intersect/smoothintersect
+		// @param _blend : Returned blend
+		// @returns bool : false if the name is unknown
+		bool ParseBlend(std::string_view _arg, SDFBlend& _blend)
+		{
+			const std::string_view names[]{ "union", "smoothunion", "subtract", "smoothsubtract", "intersect", "smoothintersect" };
+			for (int i = 0; i < 6; ++i)
+				if (_arg == names[i]) { _blend = (SDFBlend)i; return true; }
+			return false;
+		}
+
+		// Check the console is a person typing rather than a piped in script
+		// @returns bool : true if stdin is a terminal
+		bool IsInteractive()
+		{
+#ifdef _WIN32
+			return _isatty(_fileno(stdin)) != 0;
+#else
+			return isatty(fileno(stdin)) != 0;
+#endif
+		}
+	}
+
 	void SceneManager::FillInstructionList()
 	{
 		// Setting it like this allows for future instructions to be made
-		instructionSet = 12;
-		instructions = new std::string[]{
+		static const std::string_view instructionNames[]{
 			"exit", "help", "uioff", "render",
 			"clear", "color", "move", "rotate",
-			"lookat", "fov", "circle", "sphere"
+			"lookat", "fov", "circle", "sphere",
+			"samples", "denoise", "preview", "status",
+			"cancel", "save", "load", "regress",
+			"texture", "place", "chunk", "stream",
+			"cost", "heatmap", "light", "lightsamples",
+			"headlight", "bench", "kernels", "views",
+			"raycast", "bake", "sdf", "sdfpart",
+			"occlusion", "tilecache", "rasterize", "timeline",
+			"checkpoint", "resume"
 		};
+		instructionSet = (int)(sizeof(instructionNames) / sizeof(instructionNames[0]));
+		instructions = instructionNames;
+
+		// Hash every instruction into the lookup table, collisions move on to the next free slot
+		for (int slot = 0; slot < instructionTableSize; ++slot)
+			instructionTable[slot] = -1;
+		for (int inst = 0; inst < instructionSet; ++inst)
+		{
+			unsigned int slot = HashInstruction(instructions[inst]) & (instructionTableSize - 1);
+			while (instructionTable[slot] != -1)
+				slot = (slot + 1) & (instructionTableSize - 1);
+			instructionTable[slot] = inst;
+		}
+	}
+
+	bool SceneManager::RunPreview()
+	{
+		// A background render holds the window until it finishes or a change cancels it
+		if (!fPreview || renderJob != nullptr || raytracer->IsPreviewComplete()) return false;
+
+		// A few rows at a time, the next frame presents them so framing can be checked at 1/8 resolution
+		raytracer->RefinePreview(previewSliceMs);
+		return true;
 	}
 
 	void SceneManager::InstHelp()
@@ -20,7 +147,10 @@ namespace MRT
 			"Contents are ordered as followed: [instruction name] : (parameters) : {description}\n\n" <<
 			"exit : \n n/a \n: Exit the application\n\n" << 
 			"help : \n n/a \n: Displays the help page\n\n" <<
-			"render : \n n/a \n: Render the scene through software raytracing\n\n" <<
+			"render : \n [budget]: float:Milliseconds(optional) \n: Render the scene through software raytracing\n" <<
+				" Without a budget the scene renders in the background, tiles are shown as they finish\n" <<
+				" With a budget the image is refined progressively (coarse to full resolution, then extra samples)\n" <<
+				" and stops once the budget is used, running it again continues from where it stopped\n\n" <<
 			"uioff : \n n/a \n: Turns the user input off, allows for the graphic window to be moved\n\n" <<
 			"clear : \n n/a \n: Clears all objects on the current scene\n\n" <<
 			"color : \n [bgColor]: float:Red(0 to 1) float:Green(0 to 1) float:Blue(0 to 1) \n: Change the background color of the scene\n\n" <<
@@ -29,10 +159,70 @@ namespace MRT
 			"lookat : \n [camTarget]: float:X float:Y float:Z \n: Set the camera rotation matrix to look at a target point\n\n" <<
 			"fov : \n [camFOV]: float:angleDegrees \n: Set the camera FOV in degrees\n\n" <<
 			"circle : \n [circlePosition]: float:X float:Y float:Z \n [circleDireciton]: float:axisX float:axisY float:axisZ \n " << 
-				"[circleRadius]: float:Radius \n [circleColor]: float:Red(0 to 1) float:Green(0 to 1) float:Blue(0 to 1) \n: " <<
-					"Add a 2D circle object to the scene\n\n" <<
-			"sphere : \n [spherePosition]: float:X float:Y float:Z \n [sphereRadius]: float:Radius \n [sphereColor]: float:Red(0 to 1) float:Green(0 to 1) float:Blue(0 to 1) \n: " <<
-				"Add a sphere object to the scene\n\n" 
+				"[circleRadius]: float:Radius \n [circleColor]: float:Red(0 to 1) float:Green(0 to 1) float:Blue(0 to 1) \n [circleTexture]: int:Texture(optional) \n: " <<
+					"Add a 2D circle object to the scene, prints the object id\n\n" <<
+			"sphere : \n [spherePosition]: float:X float:Y float:Z \n [sphereRadius]: float:Radius \n [sphereColor]: float:Red(0 to 1) float:Green(0 to 1) float:Blue(0 to 1) \n " <<
+				"[sphereTexture]: int:Texture(optional) \n: Add a sphere object to the scene, prints the object id\n\n" <<
+			"place : \n [objectId]: int:Id \n [objectPosition]: float:X float:Y float:Z \n: Move an object, the BVH is refit in place\n" <<
+				" and rebuilt in the background once refitting has slowed tracing down too much\n\n" <<
+			"light : \n [lightPosition]: float:X float:Y float:Z \n [lightEmission]: float:Red float:Green float:Blue \n [lightRadius]: float:Radius(optional) \n: " <<
+				"Add a point light, or a sphere light with a radius (lights arent drawn, add a sphere to see it)\n\n" <<
+			"lightsamples : \n [samplesPerPoint]: int:Amount(1 to 16) \n: Set the amount of lights picked per shading point, thousands of lights\n" <<
+				" cost about the same as a few\n\n" <<
+			"headlight : \n [strength]: float:Strength \n: Set the strength of the light coming from the camera (1 by default)\n\n" <<
+			"occlusion : \n [distance]: float:Distance \n [samples]: int:Rays(optional, 4 to 256) \n: Darken the headlight where objects within the distance\n" <<
+				" block it (0 turns it off), occlusion is cached in the scene so moving the camera reuses it\n\n" <<
+			"tilecache : \n [cacheEnabled]: int:Enabled(0 or 1) \n [budget]: int:Megabytes(optional, 256 by default) \n [spillFolder]: string:Folder(optional) \n:" <<
+				" Toggle the tile cache, renders copy tiles whose camera, settings and objects havent changed instead of tracing them,\n" <<
+				" tiles over the budget are written to the spill folder and read back from it, shows what the cache has served\n\n" <<
+			"rasterize : \n [rasterEnabled]: int:Enabled(0 or 1) \n: Find what every pixel sees by rasterizing spheres and circles into an id and depth buffer\n" <<
+				" instead of tracing primary rays, shading still traces from the hits (scenes with other objects are traced)\n\n" <<
+			"timeline : \n [recordEnabled]: int:Enabled(0 or 1) \n [path]: string:Path(optional) \n: Start recording what every render thread does\n" <<
+				" (throwing away the last recording), or stop and save it as Chrome trace JSON (open in chrome://tracing or ui.perfetto.dev)\n\n" <<
+			"checkpoint : \n [path]: string:Path(optional) \n [interval]: float:Seconds(optional, 60 by default) \n: Save budgeted renders to the path\n" <<
+				" every interval of render time and when they finish, written in the background (no path turns it off)\n\n" <<
+			"resume : \n [path]: string:Path \n: Continue a budgeted render from a checkpoint, the scene and settings have to match\n" <<
+				" (the camera is restored), 'render' with a budget then carries on to the same image as an uninterrupted render\n\n" <<
+			"bench : \n [kernel]: string:Name(optional) \n: Time the hot kernels on their own, sphere hits/misses, circle hits/misses, plane hits/misses,\n" <<
+				" castray, shade headlight and shade lit (a name can be shortened e.g \"sphere\" runs both sphere sets)\n\n" <<
+			"kernels : \n [set]: string:scalar|sse4.2|avx2|avx512|check(optional) \n: Show or override the instruction set the intersection, ray and tonemap kernels use\n" <<
+				" (picked from the CPU at startup, or the MRT_KERNELS environment variable), check compares every set against scalar\n\n" <<
+			"views : \n [preset]: string:stereo|cubemap|equirect [path]: string:Path [size]: float:Size(optional) \n: Render several views from the camera in one pass\n" <<
+				" and save them to <path>_<view>.ppm, size is the eye distance for stereo (1 by default), the face size for cubemap\n" <<
+				" (screen height by default) or the width for equirect (twice the screen width by default)\n\n" <<
+			"raycast : \n [rayOrigin]: float:X float:Y float:Z \n [rayDirection]: float:X float:Y float:Z \n: Find the closest object a ray hits,\n" <<
+				" shows its id, distance and normal (goes through the same batch query simulations use)\n\n" <<
+			"bake : \n [path]: string:File [name]: string:Name \n: Bake the scene (spheres and circles, up to 1024) into a C++ header,\n" <<
+				" compile it in and load it with RayTracer::LoadBakedScene to trace it through generated code\n\n" <<
+			"sdf : \n [objectPosition]: float:X float:Y float:Z \n [shape]: string:sphere|box|torus|capsule|cylinder \n [size]: float:X float:Y float:Z \n" <<
+				" [objectColor]: float:Red float:Green float:Blue \n: Add a distance field object made of one shape, sphere uses size X as the radius,\n" <<
+				" box the half extents, torus X as the ring and Y as the tube radius, capsule and cylinder X as the radius and Y as half the height\n\n" <<
+			"sdfpart : \n [objectId]: int:Id \n [shape]: string:Shape \n [partCenter]: float:X float:Y float:Z \n [size]: float:X float:Y float:Z \n" <<
+				" [blend]: string:union|smoothunion|subtract|smoothsubtract|intersect|smoothintersect \n [smoothness]: float:Width(optional) \n:" <<
+				" Blend another shape into a distance field object, the centre is relative to the object\n\n" <<
+			"samples : \n [samplesPerPixel]: int:Amount(1 to 64) \n: Set the amount of samples taken per pixel\n\n" <<
+			"denoise : \n [denoiseEnabled]: int:Enabled(0 or 1) \n: Toggle the edge-aware denoising pass that runs after rendering\n\n" <<
+			"preview : \n [previewEnabled]: int:Enabled(0 or 1) \n: Toggle the preview, after every change the scene is shown at 1/8 resolution\n" <<
+				" and refined to full resolution a pass at a time between inputs, a following render reuses the previewed pixels\n\n" <<
+			"status : \n n/a \n: Show the progress of the background render\n\n" <<
+			"cancel : \n n/a \n: Cancel the background render, changing the scene or camera also cancels it\n\n" <<
+			"save : \n [path]: string:File \n: Save the scene, camera and built BVH to a snapshot file\n\n" <<
+			"load : \n [path]: string:File \n: Replace the scene and camera with a snapshot file, the file is mapped\n" <<
+				" and traced in place so even huge scenes load instantly\n\n" <<
+			"chunk : \n [path]: string:File \n [gridSize]: int:ChunksPerAxis(1 to 16) \n: Save the scene split into spatial chunks for streaming,\n" <<
+				" each chunk is written next to the index file as '<path>.<chunk>'\n\n" <<
+			"stream : \n [path]: string:File \n [budget]: int:Megabytes(optional) \n: Replace the scene and camera with a chunked scene, chunks are\n" <<
+				" loaded as rays reach them and unloaded once more than the budget (512MB by default) is loaded,\n" <<
+				" streamed scenes are only lit by the headlight (lights and occlusion are skipped)\n\n" <<
+			"cost : \n [costEnabled]: int:Enabled(0 or 1) \n: Toggle recording the render cost of every pixel (intersection tests,\n" <<
+				" traversal steps, samples and time), cheap enough to leave on\n\n" <<
+			"heatmap : \n [path]: string:File(without extension) \n [metric]: string:tests/steps/samples/time(optional) \n: Write the pixel costs\n" <<
+				" of the last render as a false color heatmap '<path>.ppm' (time by default) and a raw float buffer '<path>.raw'\n\n" <<
+			"texture : \n [path]: string:File(binary PPM) \n: Load a texture, its index can be given to spheres and circles (tinted by their color)\n\n" <<
+			"regress : \n [directory]: string:Path \n [mode]: string:update or float:Threshold(optional, 0 to 1, 0.25 by default) \n:" <<
+				" Render the reference scenes headless and check them against the golden images and rays/sec baseline in the directory,\n" <<
+				" the threshold is the fraction of the baseline throughput allowed to be lost. 'update' stores new goldens and baseline instead,\n" <<
+				" neither is shipped as they depend on the machine and build, run 'update' on a known good build first\n\n"
 			<< std::endl;
 	}
 
@@ -42,217 +232,970 @@ namespace MRT
 		std::cout << "User input has been disabled, to renable please reopen the application.\n" << std::endl;
 	}
 
-	void SceneManager::InstRender()
+	bool SceneManager::InstRender(const std::string_view* _argv, int _argc)
+	{
+		// render
+		if (_argc == 1)
+		{
+			renderJob = raytracer->RenderAsync();
+			if (renderJob == nullptr) return false;
+			if (fEcho) std::cout << "Rendering scene in the background, type 'status' to check on it or 'cancel' to stop it.\n" << std::endl;
+			return true;
+		}
+
+		// render float:BudgetMs
+		float budget;
+		if (_argc != 2 || !ParseFloat(_argv[1], budget)) return false;
+		if (budget <= 0) return false;
+
+		bool complete = raytracer->RenderProgressive(budget);
+		RenderProgress progress = raytracer->GetProgress();
+		if (!fEcho) return true;
+		std::cout << "Rendered pass " << glm::min(progress.pass + 1, progress.passes) << " of " << progress.passes <<
+			" (" << (int)(progress.completion * 100.f) << "% complete, " << progress.samplesCompleted << " samples per pixel) in " <<
+			progress.elapsedMs << "ms total.\n";
+		if (complete) std::cout << "Scene successfully rendered.\n" << std::endl;
+		else std::cout << "Run 'render " << budget << "' again to keep refining.\n" << std::endl;
+		return true;
+	}
+
+	void SceneManager::InstStatus()
+	{
+		if (renderJob == nullptr)
+		{
+			std::cout << "No render is running.\n" << std::endl;
+			return;
+		}
+
+		std::cout << "Rendering, " << (int)(renderJob->GetProgress() * 100.f) << "% of tiles done after " <<
+			renderJob->GetElapsed() << "ms.\n" << std::endl;
+	}
+
+	void SceneManager::InstCancel()
 	{
-		std::cout << "Rendering scene, please wait..." << std::endl;
-		raytracer->RenderScene();
-		std::cout << "Scene successfully rendered.\n" << std::endl;
+		// The render loop reports the cancellation
+		if (renderJob == nullptr) std::cout << "No render is running.\n" << std::endl;
+		raytracer->CancelRender();
 	}
 
 	void SceneManager::InstClear()
 	{
 		raytracer->ClearPrimitives();
-		std::cout << "Cleared scene.\n" << std::endl;
+		if (fEcho) std::cout << "Cleared scene.\n" << std::endl;
 	}
 
-	bool SceneManager::InstColor(std::string* _argv, int& _argc)
+	bool SceneManager::InstColor(const std::string_view* _argv, int _argc)
 	{
 		// color float:R float:G float:B
-		if (_argc != 4) return false;
-		float r = std::strtof(_argv[1].c_str(), NULL), g = std::strtof(_argv[2].c_str(), NULL),
-			b = std::strtof(_argv[3].c_str(), NULL);
+		float args[3];
+		if (_argc != 4 || !ParseFloats(_argv + 1, args, 3)) return false;
+		float r = args[0], g = args[1], b = args[2];
 
 		raytracer->SetBackgroundColor({ r, g, b });
-		std::cout << "Scene background color set to: {" << r << ", " << g << ", " << b << "}.\n" << std::endl;
+		if (fEcho) std::cout << "Scene background color set to: {" << r << ", " << g << ", " << b << "}.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstMove(std::string* _argv, int& _argc)
+	bool SceneManager::InstMove(const std::string_view* _argv, int _argc)
 	{
 		// move float:X float:Y float:Z
-		if (_argc != 4) return false;
-		float x = std::strtof(_argv[1].c_str(), NULL), y = std::strtof(_argv[2].c_str(), NULL),
-			z = std::strtof(_argv[3].c_str(), NULL);
+		float args[3];
+		if (_argc != 4 || !ParseFloats(_argv + 1, args, 3)) return false;
+		float x = args[0], y = args[1], z = args[2];
 
 		raytracer->SetCameraPosition({ x, y, z });
-		std::cout << "Camera position set to: {" << x << ", " << y << ", " << z << "}.\n" << std::endl;
+		if (fEcho) std::cout << "Camera position set to: {" << x << ", " << y << ", " << z << "}.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstRotate(std::string* _argv, int& _argc)
+	bool SceneManager::InstRotate(const std::string_view* _argv, int _argc)
 	{
 		// rotate float:X float:Y float:Z float:Degrees
-		if (_argc != 5) return false;
-		float x = std::strtof(_argv[1].c_str(), NULL), y = std::strtof(_argv[2].c_str(), NULL),
-			z = std::strtof(_argv[3].c_str(), NULL), degrees = std::strtof(_argv[4].c_str(), NULL);
+		float args[4];
+		if (_argc != 5 || !ParseFloats(_argv + 1, args, 4)) return false;
+		float x = args[0], y = args[1], z = args[2], degrees = args[3];
 
 		raytracer->SetCameraRotation({ x, y, z }, degrees);
-		std::cout << "Camera rotation set to: " << degrees << 
+		if (fEcho) std::cout << "Camera rotation set to: " << degrees << 
 			" degrees around " << "{" << x << ", " << y << ", " << z << "} axis.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstLookat(std::string* _argv, int& _argc)
+	bool SceneManager::InstLookat(const std::string_view* _argv, int _argc)
 	{
 		// lookat float:X float:Y float:Z
-		if (_argc != 4) return false;
-		float x = std::strtof(_argv[1].c_str(), NULL), y = std::strtof(_argv[2].c_str(), NULL),
-			z = std::strtof(_argv[3].c_str(), NULL);
+		float args[3];
+		if (_argc != 4 || !ParseFloats(_argv + 1, args, 3)) return false;
+		float x = args[0], y = args[1], z = args[2];
 
 		raytracer->SetCameraTarget({ x, y, z });
-		std::cout << "Camera rotation set to: " << "{" << x << ", " << y << ", " << z << "} target position.\n" << std::endl;
+		if (fEcho) std::cout << "Camera rotation set to: " << "{" << x << ", " << y << ", " << z << "} target position.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstFOV(std::string* _argv, int& _argc)
+	bool SceneManager::InstFOV(const std::string_view* _argv, int _argc)
 	{
 		// fov float:Degrees
-		if (_argc != 2) return false;
-		float degrees = std::strtof(_argv[1].c_str(), NULL);
+		float degrees;
+		if (_argc != 2 || !ParseFloat(_argv[1], degrees)) return false;
 
 		raytracer->SetCameraFOV(degrees);
-		std::cout << "Camera FOV set to: " << degrees << " degrees.\n" << std::endl;
+		if (fEcho) std::cout << "Camera FOV set to: " << degrees << " degrees.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstCircle(std::string* _argv, int& _argc)
+	bool SceneManager::InstCircle(const std::string_view* _argv, int _argc)
 	{
 		// circle float:X float:Y float:Z float:FaceX float:FaceY float:FaceZ float:Radius
 		// float:R float:G float:B
-		if (_argc != 11) return false;
-		float x = std::strtof(_argv[1].c_str(), NULL), y = std::strtof(_argv[2].c_str(), NULL),
-			z = std::strtof(_argv[3].c_str(), NULL), faceX = std::strtof(_argv[4].c_str(), NULL),
-			faceY = std::strtof(_argv[5].c_str(), NULL), faceZ = std::strtof(_argv[6].c_str(), NULL),
-			radius = std::strtof(_argv[7].c_str(), NULL), r = std::strtof(_argv[8].c_str(), NULL), 
-			g = std::strtof(_argv[9].c_str(), NULL), b = std::strtof(_argv[10].c_str(), NULL);
+		// [int:Texture]
+		float args[10];
+		int texture = -1;
+		if ((_argc != 11 && _argc != 12) || !ParseFloats(_argv + 1, args, 10)) return false;
+		if (_argc == 12 && !ParseInt(_argv[11], texture)) return false;
+		float x = args[0], y = args[1], z = args[2], faceX = args[3], faceY = args[4], faceZ = args[5],
+			radius = args[6], r = args[7], g = args[8], b = args[9];
 
 		MRT::Circle* circle = new MRT::Circle({ x, y, z }, { faceX, faceY, faceZ }, radius, { r, g, b });
 		if (circle == nullptr) return false;
+		circle->SetTexture(texture);
 
-		raytracer->AddPrimitive(circle);
-		std::cout << "Added circle to scene at position: " << "{" << x << ", " << y << ", " << z << "}.\nWith a radius set to: " <<
+		int id = raytracer->AddPrimitive(circle);
+		if (id < 0)
+		{
+			delete circle;
+			std::cout << "Could not add the circle, a streamed scene has to be cleared first.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Added circle " << id << " to scene at position: " << "{" << x << ", " << y << ", " << z << "}.\nWith a radius set to: " <<
 			radius << ".\nFacing direction: " << "{" << x << ", " << y << ", " << z <<
 			"}.\nAnd a color set to: " << "{" << r << ", " << g << ", " << b << "}.\n" << std::endl;
 		return true;
 	}
 
-	bool SceneManager::InstSphere(std::string* _argv, int& _argc)
+	bool SceneManager::InstSphere(const std::string_view* _argv, int _argc)
 	{
 		// sphere float:X float:Y float:Z float:Radius float:R float:G float:B
-		if (_argc != 8) return false;
-		float x = std::strtof(_argv[1].c_str(), NULL), y = std::strtof(_argv[2].c_str(), NULL),
-			z = std::strtof(_argv[3].c_str(), NULL), radius = std::strtof(_argv[4].c_str(), NULL),
-			r = std::strtof(_argv[5].c_str(), NULL), g = std::strtof(_argv[6].c_str(), NULL),
-			b = std::strtof(_argv[7].c_str(), NULL);
+		// [int:Texture]
+		float args[7];
+		int texture = -1;
+		if ((_argc != 8 && _argc != 9) || !ParseFloats(_argv + 1, args, 7)) return false;
+		if (_argc == 9 && !ParseInt(_argv[8], texture)) return false;
+		float x = args[0], y = args[1], z = args[2], radius = args[3], r = args[4], g = args[5], b = args[6];
 
 		MRT::Sphere* sphere = new MRT::Sphere({ x, y, z }, radius, { r, g, b });
 		if (sphere == nullptr) return false;
+		sphere->SetTexture(texture);
 
-		raytracer->AddPrimitive(sphere);
-		std::cout << "Added sphere to scene at position: " << "{" << x << ", " << y << ", " << z << "}.\nWith a radius set to: " <<
+		int id = raytracer->AddPrimitive(sphere);
+		if (id < 0)
+		{
+			delete sphere;
+			std::cout << "Could not add the sphere, a streamed scene has to be cleared first.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Added sphere " << id << " to scene at position: " << "{" << x << ", " << y << ", " << z << "}.\nWith a radius set to: " <<
 			radius << ".\nAnd a color set to: " << "{" << r << ", " << g << ", " << b << "}.\n" << std::endl;
 		return true;
 	}
 
+	bool SceneManager::InstPlace(const std::string_view* _argv, int _argc)
+	{
+		// place int:Id float:X float:Y float:Z
+		int id;
+		float args[3];
+		if (_argc != 5 || !ParseInt(_argv[1], id) || !ParseFloats(_argv + 2, args, 3)) return false;
+
+		if (!raytracer->MovePrimitive(id, { args[0], args[1], args[2] }))
+		{
+			std::cout << "There is no object with the id " << id << ".\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Moved object " << id << " to position: " << "{" << args[0] << ", " << args[1] << ", " << args[2] << "}.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstLight(const std::string_view* _argv, int _argc)
+	{
+		// light float:X float:Y float:Z float:R float:G float:B [float:Radius]
+		float args[7]{ 0 };
+		if ((_argc != 7 && _argc != 8) || !ParseFloats(_argv + 1, args, _argc - 1)) return false;
+		if (args[6] < 0) return false;
+
+		int light = raytracer->AddLight({ args[0], args[1], args[2] }, { args[3], args[4], args[5] }, args[6]);
+		if (light < 0) return false;
+		if (fEcho) std::cout << "Added " << (args[6] > 0 ? "sphere" : "point") << " light " << light << " at position: " <<
+			"{" << args[0] << ", " << args[1] << ", " << args[2] << "}.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstLightSamples(const std::string_view* _argv, int _argc)
+	{
+		// lightsamples int:Amount
+		int samples;
+		if (_argc != 2 || !ParseInt(_argv[1], samples)) return false;
+		if (samples < 1 || samples > 16) return false;
+
+		raytracer->SetLightSamples(samples);
+		if (fEcho) std::cout << "Light samples per shading point set to: " << samples << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstHeadlight(const std::string_view* _argv, int _argc)
+	{
+		// headlight float:Strength
+		float strength;
+		if (_argc != 2 || !ParseFloat(_argv[1], strength)) return false;
+		if (strength < 0) return false;
+
+		raytracer->SetHeadlight(strength);
+		if (fEcho) std::cout << "Headlight strength set to: " << strength << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstOcclusion(const std::string_view* _argv, int _argc)
+	{
+		// occlusion float:Distance [int:Samples]
+		float distance;
+		int samples = 32;
+		if ((_argc != 2 && _argc != 3) || !ParseFloat(_argv[1], distance)) return false;
+		if (_argc == 3 && !ParseInt(_argv[2], samples)) return false;
+		if (distance < 0 || samples < 4 || samples > 256) return false;
+
+		raytracer->SetOcclusion(distance, samples);
+		if (fEcho)
+		{
+			if (distance > 0) std::cout << "Ambient occlusion set to a distance of: " << distance << ", with " << samples << " rays per record.\n" << std::endl;
+			else std::cout << "Ambient occlusion turned off.\n" << std::endl;
+		}
+		return true;
+	}
+
+	bool SceneManager::InstTileCache(const std::string_view* _argv, int _argc)
+	{
+		// tilecache int:Enabled [int:Megabytes] [string:Folder]
+		int enabled, budget = 256;
+		if (_argc < 2 || _argc > 4 || !ParseInt(_argv[1], enabled)) return false;
+		if (_argc >= 3 && !ParseInt(_argv[2], budget)) return false;
+		if (budget < 0) return false;
+		std::string folder;
+		if (_argc == 4) folder = std::string(_argv[3]);
+
+		raytracer->SetTileCache(enabled != 0, budget, folder);
+		if (fEcho)
+		{
+			TileCacheStats stats = raytracer->GetTileCacheStats();
+			std::cout << "Tile cache " << (enabled != 0 ? "enabled" : "disabled") << ", " << stats.hits << " tiles served from memory, " <<
+				stats.diskHits << " from disk and " << stats.misses << " traced, " << stats.tiles << " tiles (" <<
+				(stats.bytes >> 10) << "KB) held.\n" << std::endl;
+		}
+		return true;
+	}
+
+	bool SceneManager::InstRasterize(const std::string_view* _argv, int _argc)
+	{
+		// rasterize int:Enabled
+		int enabled;
+		if (_argc != 2 || !ParseInt(_argv[1], enabled)) return false;
+
+		raytracer->SetRasterVisibility(enabled != 0);
+		if (fEcho) std::cout << "Rasterized primary visibility " << (enabled != 0 ? "enabled" : "disabled") << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstTimeline(const std::string_view* _argv, int _argc)
+	{
+		// timeline int:Enabled [string:Path]
+		int enabled;
+		if ((_argc != 2 && _argc != 3) || !ParseInt(_argv[1], enabled)) return false;
+		if (enabled != 0 && _argc == 3) return false;
+
+		SetTimelineEnabled(enabled != 0);
+		if (enabled != 0)
+		{
+			if (fEcho) std::cout << "Timeline recording started.\n" << std::endl;
+			return true;
+		}
+
+		if (_argc == 3)
+		{
+			const std::string path(_argv[2]);
+			if (!SaveTimeline(path.c_str()))
+			{
+				std::cout << "Could not save the timeline to '" << path << "'.\n" << std::endl;
+				return true;
+			}
+			if (fEcho) std::cout << "Timeline of " << GetTimelineEventCount() << " events saved to '" << path << "'.\n" << std::endl;
+		}
+		else if (fEcho) std::cout << "Timeline recording stopped.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstCheckpoint(const std::string_view* _argv, int _argc)
+	{
+		// checkpoint
+		if (_argc == 1)
+		{
+			raytracer->SetCheckpoint(std::string(), 0);
+			if (fEcho) std::cout << "Render checkpoints disabled.\n" << std::endl;
+			return true;
+		}
+
+		// checkpoint string:Path [float:Seconds]
+		float seconds = 60.f;
+		if (_argc > 3 || (_argc == 3 && !ParseFloat(_argv[2], seconds))) return false;
+		if (seconds <= 0) return false;
+
+		const std::string path(_argv[1]);
+		raytracer->SetCheckpoint(path, seconds * 1000.f);
+		if (fEcho) std::cout << "Budgeted renders are checkpointed to '" << path << "' every " << seconds << "s of render time.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstResume(const std::string_view* _argv, int _argc)
+	{
+		// resume string:Path
+		if (_argc != 2) return false;
+		const std::string path(_argv[1]);
+
+		if (!raytracer->ResumeCheckpoint(path.c_str()))
+		{
+			std::cout << "Could not resume from '" << path << "', it has to be a checkpoint of the current scene and settings.\n" << std::endl;
+			return true;
+		}
+		if (!fEcho) return true;
+		RenderProgress progress = raytracer->GetProgress();
+		std::cout << "Resumed at pass " << glm::min(progress.pass + 1, progress.passes) << " of " << progress.passes <<
+			" (" << (int)(progress.completion * 100.f) << "% complete), run 'render' with a budget to carry on.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstSamples(const std::string_view* _argv, int _argc)
+	{
+		// samples int:Amount
+		int samples;
+		if (_argc != 2 || !ParseInt(_argv[1], samples)) return false;
+		if (samples < 1 || samples > 64) return false;
+
+		raytracer->SetSamples(samples);
+		if (fEcho) std::cout << "Samples per pixel set to: " << samples << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstDenoise(const std::string_view* _argv, int _argc)
+	{
+		// denoise int:Enabled
+		int enabled;
+		if (_argc != 2 || !ParseInt(_argv[1], enabled)) return false;
+
+		raytracer->SetDenoise(enabled != 0);
+		if (fEcho) std::cout << "Denoising " << (enabled != 0 ? "enabled" : "disabled") << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstPreview(const std::string_view* _argv, int _argc)
+	{
+		// preview int:Enabled
+		int enabled;
+		if (_argc != 2 || !ParseInt(_argv[1], enabled)) return false;
+		fPreview = enabled != 0;
+
+		if (fEcho) std::cout << "Preview " << (fPreview ? "enabled" : "disabled") << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstSave(const std::string_view* _argv, int _argc)
+	{
+		// save string:Path
+		if (_argc != 2) return false;
+		std::string path(_argv[1]);
+
+		if (!raytracer->SaveSnapshot(path.c_str()))
+		{
+			std::cout << "Could not save the scene to '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Scene saved to: " << path << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstLoad(const std::string_view* _argv, int _argc)
+	{
+		// load string:Path
+		if (_argc != 2) return false;
+		std::string path(_argv[1]);
+
+		if (!raytracer->LoadSnapshot(path.c_str()))
+		{
+			std::cout << "Could not load a scene snapshot from '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Scene loaded from: " << path << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstTexture(const std::string_view* _argv, int _argc)
+	{
+		// texture string:Path
+		if (_argc != 2) return false;
+		std::string path(_argv[1]);
+
+		int texture = raytracer->LoadTexture(path.c_str());
+		if (texture < 0)
+		{
+			std::cout << "Could not load a texture from '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Loaded texture " << texture << " from: " << path << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstChunk(const std::string_view* _argv, int _argc)
+	{
+		// chunk string:Path int:GridSize
+		int gridSize;
+		if (_argc != 3 || !ParseInt(_argv[2], gridSize)) return false;
+		if (gridSize < 1 || gridSize > 16) return false;
+		std::string path(_argv[1]);
+
+		if (!raytracer->SaveChunkedScene(path.c_str(), gridSize))
+		{
+			std::cout << "Could not save the chunked scene to '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Chunked scene saved to: " << path << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstStream(const std::string_view* _argv, int _argc)
+	{
+		// stream string:Path [int:BudgetMB]
+		int budget = 512;
+		if (_argc != 2 && _argc != 3) return false;
+		if (_argc == 3 && (!ParseInt(_argv[2], budget) || budget < 1)) return false;
+		std::string path(_argv[1]);
+
+		if (!raytracer->OpenChunkedScene(path.c_str()))
+		{
+			std::cout << "Could not open a chunked scene from '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		MRT::ChunkCache& streamed = raytracer->GetStreamedScene();
+		streamed.SetBudget((size_t)budget << 20);
+		if (fEcho) std::cout << "Streaming " << streamed.GetChunkCount() << " chunks from: " << path <<
+			", with up to " << budget << "MB loaded at once.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstCost(const std::string_view* _argv, int _argc)
+	{
+		// cost int:Enabled
+		int enabled;
+		if (_argc != 2 || !ParseInt(_argv[1], enabled)) return false;
+
+		raytracer->SetCostTracking(enabled != 0);
+		if (fEcho) std::cout << "Cost tracking " << (enabled != 0 ? "enabled" : "disabled") << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstHeatmap(const std::string_view* _argv, int _argc)
+	{
+		// heatmap string:Path [string:Metric]
+		if (_argc != 2 && _argc != 3) return false;
+		MRT::CostMetric metric = MRT::CostMetric::Time;
+		if (_argc == 3)
+		{
+			if (_argv[2] == "tests") metric = MRT::CostMetric::Tests;
+			else if (_argv[2] == "steps") metric = MRT::CostMetric::Steps;
+			else if (_argv[2] == "samples") metric = MRT::CostMetric::Samples;
+			else if (_argv[2] != "time") return false;
+		}
+		std::string path(_argv[1]);
+
+		float scale;
+		if (!raytracer->SaveCostMap(path.c_str(), metric, scale))
+		{
+			std::cout << "Could not save the heatmap to '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Heatmap saved to: " << path << ".ppm and " << path << ".raw, white is " << scale <<
+			(metric == MRT::CostMetric::Time ? "ns" : "") << " per pixel.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstRegress(const std::string_view* _argv, int _argc)
+	{
+		// regress string:Directory [update | float:Threshold]
+		if (_argc != 2 && _argc != 3) return false;
+		bool update = _argc == 3 && _argv[2] == "update";
+		float threshold = 0;
+		if (_argc == 3 && !update && (!ParseFloat(_argv[2], threshold) || threshold < 0 || threshold > 1)) return false;
+		std::string directory(_argv[1]);
+
+		RegressionSuite suite;
+		if (_argc == 3 && !update) suite.SetSpeedThreshold(threshold);
+		std::vector<RegressionResult> results;
+		bool passed = update ? suite.Update(directory.c_str(), results) : suite.Run(directory.c_str(), results);
+
+		// Results are always reported, regressions need to be seen even when a script is piped in
+		for (const RegressionResult& result : results)
+		{
+			std::cout << result.scene << ": " << (int)result.raysPerSecond << " rays/sec";
+			if (!update)
+			{
+				if (result.fBaselineMissing) std::cout << " (no baseline)";
+				else std::cout << " (baseline " << (int)result.baselineRaysPerSecond << ")" << (result.fSpeedPassed ? "" : " SLOWER");
+				if (result.fGoldenMissing) std::cout << ", no golden image";
+				else std::cout << ", mean error " << result.meanError << ", max error " << result.maxError <<
+					", " << result.badPixels * 100.f << "% pixels differ" << (result.fImagePassed ? "" : " MISMATCH");
+			}
+			std::cout << "\n";
+		}
+		if (update) std::cout << (passed ? "Golden images and baseline updated.\n" : "Could not write the golden images and baseline.\n") << std::endl;
+		else std::cout << (passed ? "Regression suite passed.\n" : "Regression suite FAILED.\n") << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstBench(const std::string_view* _argv, int _argc)
+	{
+		// bench [string:Kernel]
+		if (_argc > 2) return false;
+		std::string filter(_argc == 2 ? _argv[1] : std::string_view());
+
+		KernelBenchmark benchmark;
+		std::vector<BenchmarkResult> results;
+		if (!benchmark.Run(filter.c_str(), results)) return false;
+
+		// Results are always reported, like the regression suite
+		for (const BenchmarkResult& result : results)
+		{
+			std::cout << result.kernel << ": " << result.nsPerOp << " ns/op";
+			if (result.opsPerCycle > 0) std::cout << ", " << result.opsPerCycle << " ops/cycle" << (result.fReferenceCycles ? " (tsc)" : "");
+			if (result.fHitTest) std::cout << ", " << (int)(result.hitRate * 100.f + 0.5f) << "% hits";
+			if (result.fCounters) std::cout << ", IPC " << result.instructionsPerCycle << ", " << result.cacheMissesPerOp << " cache misses/op";
+			std::cout << "\n";
+		}
+		if (!results.empty() && !results[0].fCounters) std::cout << "Hardware counters unavailable, IPC and cache misses not measured.\n";
+		std::cout << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstKernels(const std::string_view* _argv, int _argc)
+	{
+		// kernels [string:Set|check]
+		if (_argc > 2) return false;
+
+		if (_argc == 2 && _argv[1] == "check")
+		{
+			std::vector<KernelCheckResult> results;
+			bool passed = CheckKernels(results);
+			// Results are always reported, like the regression suite
+			for (const KernelCheckResult& result : results)
+			{
+				std::cout << GetKernelTable(result.isa)->name << ": ";
+				if (!result.fSupported) { std::cout << "not supported\n"; continue; }
+				std::cout << result.intersectMismatches << "/" << result.intersectCalls << " intersect, " <<
+					result.boundsMismatches << "/" << result.boundsCalls << " bounds, " << result.rayMismatches << "/" << result.rayCalls << " ray, " <<
+					result.tonemapMismatches << "/" << result.tonemapCalls << " tonemap calls differ from scalar\n";
+			}
+			std::cout << (passed ? "Kernels match the scalar kernels.\n" : "Kernels MISMATCH the scalar kernels.\n") << std::endl;
+			return true;
+		}
+
+		if (_argc == 2)
+		{
+			KernelISA isa;
+			if (!FindKernelISA(std::string(_argv[1]), isa)) return false;
+			raytracer->CancelRender();
+			if (!SetKernelISA(isa))
+			{
+				std::cout << "This CPU cant run the " << _argv[1] << " kernels.\n" << std::endl;
+				return true;
+			}
+		}
+
+		if (fEcho || _argc == 1)
+		{
+			std::cout << "Using the " << GetKernels().name << " kernels, supported:";
+			for (int i = 0; i < (int)KernelISA::Count; ++i)
+				if (IsKernelISASupported((KernelISA)i)) std::cout << " " << GetKernelTable((KernelISA)i)->name;
+			std::cout << ".\n" << std::endl;
+		}
+		return true;
+	}
+
+	bool SceneManager::InstViews(const std::string_view* _argv, int _argc)
+	{
+		// views string:Preset string:Path [float:Size]
+		if (_argc != 3 && _argc != 4) return false;
+		float size = 0;
+		if (_argc == 4 && (!ParseFloat(_argv[3], size) || size <= 0)) return false;
+
+		MRT::ViewDesc camera = raytracer->GetCameraView();
+		MRT::ViewSet views;
+		bool built;
+		if (_argv[1] == "stereo") built = views.SetStereo(camera, _argc == 4 ? size : 1.f);
+		else if (_argv[1] == "cubemap") built = views.SetCubemap(camera, _argc == 4 ? (int)size : raytracer->GetHeight());
+		else if (_argv[1] == "equirect") built = views.SetEquirect(camera, _argc == 4 ? (int)size : raytracer->GetWidth() * 2);
+		else return false;
+		if (!built) return false;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!raytracer->RenderViews(views))
+		{
+			std::cout << "Could not render the views, streamed scenes cant be rendered as views.\n" << std::endl;
+			return true;
+		}
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::string path(_argv[2]);
+		if (!views.SaveImages(path))
+		{
+			std::cout << "Could not save the views to '" << path << "'.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << views.GetCount() << " views rendered in " << elapsed << "ms, saved to: " << path << "_0.ppm to " <<
+			path << "_" << views.GetCount() - 1 << ".ppm\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstRaycast(const std::string_view* _argv, int _argc)
+	{
+		// raycast float:X float:Y float:Z float:X float:Y float:Z
+		float args[6];
+		if (_argc != 7 || !ParseFloats(_argv + 1, args, 6)) return false;
+		MRT::rvec3 origin(args[0], args[1], args[2]), direction(args[3], args[4], args[5]);
+		if (glm::dot(direction, direction) <= 0) return false;
+		direction = glm::normalize(direction);
+
+		MRT::real distance;
+		int id;
+		MRT::rvec3 normal(0);
+		MRT::RayBatch batch;
+		batch.origins = &origin;
+		batch.directions = &direction;
+		batch.count = 1;
+		batch.distances = &distance;
+		batch.primitives = &id;
+		batch.normals = &normal;
+		if (!raytracer->IntersectRays(batch))
+		{
+			std::cout << "Could not cast the ray, streamed scenes cant be queried.\n" << std::endl;
+			return true;
+		}
+
+		if (id < 0) std::cout << "The ray hit nothing.\n" << std::endl;
+		else std::cout << "The ray hit object " << id << " at a distance of " << distance << ".\nWith a normal of: " <<
+			"{" << normal.x << ", " << normal.y << ", " << normal.z << "}.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstBake(const std::string_view* _argv, int _argc)
+	{
+		// bake string:Path string:Name
+		if (_argc != 3) return false;
+		std::string path(_argv[1]), name(_argv[2]);
+
+		if (!raytracer->BakeScene(path.c_str(), name.c_str()))
+		{
+			std::cout << "Could not bake the scene to '" << path << "', the name has to be a C++ identifier and the scene\n" <<
+				"has to hold 1 to " << MRT::maxBakedPrimitives << " spheres and circles.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Scene baked to: " << path << " as MRT::Baked::" << name << ".\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstSdf(const std::string_view* _argv, int _argc)
+	{
+		// sdf float:X float:Y float:Z string:Shape float:X float:Y float:Z float:R float:G float:B
+		float position[3], args[6];
+		MRT::SDFPart part;
+		if (_argc != 11 || !ParseFloats(_argv + 1, position, 3) || !ParseShape(_argv[4], part.shape) || !ParseFloats(_argv + 5, args, 6)) return false;
+		part.size = MRT::rvec3(args[0], args[1], args[2]);
+		if (part.size.x <= 0 || part.size.y < 0 || part.size.z < 0) return false;
+
+		MRT::DistanceField* field = new MRT::DistanceField({ position[0], position[1], position[2] }, { args[3], args[4], args[5] });
+		field->AddPart(part);
+
+		int id = raytracer->AddPrimitive(field);
+		if (id < 0)
+		{
+			delete field;
+			std::cout << "Could not add the distance field, a streamed scene has to be cleared first.\n" << std::endl;
+			return true;
+		}
+		if (fEcho) std::cout << "Added distance field " << id << " to scene at position: " << "{" << position[0] << ", " << position[1] << ", " <<
+			position[2] << "}.\nWith a " << _argv[4] << " of size: " << "{" << args[0] << ", " << args[1] << ", " << args[2] << "}.\n" << std::endl;
+		return true;
+	}
+
+	bool SceneManager::InstSdfPart(const std::string_view* _argv, int _argc)
+	{
+		// sdfpart int:Id string:Shape float:X float:Y float:Z float:X float:Y float:Z string:Blend [float:Smoothness]
+		int id;
+		float args[7]{ 0 };
+		MRT::SDFPart part;
+		if ((_argc != 10 && _argc != 11) || !ParseInt(_argv[1], id) || !ParseShape(_argv[2], part.shape) ||
+			!ParseFloats(_argv + 3, args, 6) || !ParseBlend(_argv[9], part.blend)) return false;
+		if (_argc == 11 && !ParseFloat(_argv[10], args[6])) return false;
+		part.center = MRT::rvec3(args[0], args[1], args[2]);
+		part.size = MRT::rvec3(args[3], args[4], args[5]);
+		part.smoothness = args[6];
+		if (part.size.x <= 0 || part.size.y < 0 || part.size.z < 0 || part.smoothness < 0) return false;
+
+		if (!raytracer->AddDistanceFieldPart(id, part))
+		{
+			std::cout << "There is no distance field with the id " << id << ".\n" << std::endl;
+			return true;
+		}
+		MRT::DistanceField* field = (MRT::DistanceField*)raytracer->GetPrimitive(id);
+		if (fEcho) std::cout << "Blended a " << _argv[2] << " into distance field " << id << ", it now has " << field->GetParts().size() << " parts.\n" << std::endl;
+		return true;
+	}
+
+	int SceneManager::Tokenise(std::string_view _line, std::string_view* _argv, int _maxArgs)
+	{
+		// Split on whitespace/control characters, runs of them count as one gap
+		int argc = 0;
+		size_t i = 0, length = _line.size();
+		while (i < length)
+		{
+			while (i < length && (unsigned char)_line[i] <= 0x20) ++i;
+			if (i == length) break;
+
+			size_t start = i;
+			while (i < length && (unsigned char)_line[i] > 0x20) ++i;
+
+			// Arguments past the max are counted but not stored
+			if (argc < _maxArgs) _argv[argc] = _line.substr(start, i - start);
+			++argc;
+		}
+		return argc;
+	}
+
+	int SceneManager::FindInstruction(std::string_view _name)
+	{
+		// Probe from the hashed slot until the name or an empty slot is found
+		unsigned int slot = HashInstruction(_name) & (instructionTableSize - 1);
+		while (instructionTable[slot] != -1)
+		{
+			if (instructions[instructionTable[slot]] == _name) return instructionTable[slot];
+			slot = (slot + 1) & (instructionTableSize - 1);
+		}
+		return -1;
+	}
+
+	bool SceneManager::RunInstruction(std::string_view _input)
+	{
+		// Split the input up into args, each arg is a view into the input (nothing is copied)
+		std::string_view argv[maxArguments];
+		int argc = Tokenise(_input, argv, maxArguments);
+		if (argc == 0) return true;
+
+		// Query the first argument with the instruction table
+		int inst = FindInstruction(argv[0]);
+		bool instRan = true;
+		switch (inst)
+		{
+			  // exit
+		case 0: { return false;  break; }
+			  // help
+		case 1: { InstHelp(); break; }
+			  // uiof
+		case 2: { InstUioff(); break; }
+			  // render
+		case 3: { instRan = InstRender(argv, argc);  break; }
+			  // clear
+		case 4: { InstClear(); break; }
+			  // color
+		case 5: { instRan = InstColor(argv, argc); break; }
+			  // move
+		case 6: { instRan = InstMove(argv, argc); break; }
+			  // rotate
+		case 7: { instRan = InstRotate(argv, argc); break; }
+			  // lookat
+		case 8: { instRan = InstLookat(argv, argc); break; }
+			  // fov
+		case 9: { instRan = InstFOV(argv, argc); break; }
+			  // circle
+		case 10: { instRan = InstCircle(argv, argc); break; }
+			  // sphere
+		case 11: { instRan = InstSphere(argv, argc); break; }
+			  // samples
+		case 12: { instRan = InstSamples(argv, argc); break; }
+			  // denoise
+		case 13: { instRan = InstDenoise(argv, argc); break; }
+			  // preview
+		case 14: { instRan = InstPreview(argv, argc); break; }
+			  // status
+		case 15: { InstStatus(); break; }
+			  // cancel
+		case 16: { InstCancel(); break; }
+			  // save
+		case 17: { instRan = InstSave(argv, argc); break; }
+			  // load
+		case 18: { instRan = InstLoad(argv, argc); break; }
+			  // regress
+		case 19: { instRan = InstRegress(argv, argc); break; }
+			  // texture
+		case 20: { instRan = InstTexture(argv, argc); break; }
+			  // place
+		case 21: { instRan = InstPlace(argv, argc); break; }
+			  // chunk
+		case 22: { instRan = InstChunk(argv, argc); break; }
+			  // stream
+		case 23: { instRan = InstStream(argv, argc); break; }
+			  // cost
+		case 24: { instRan = InstCost(argv, argc); break; }
+			  // heatmap
+		case 25: { instRan = InstHeatmap(argv, argc); break; }
+			  // light
+		case 26: { instRan = InstLight(argv, argc); break; }
+			  // lightsamples
+		case 27: { instRan = InstLightSamples(argv, argc); break; }
+			  // headlight
+		case 28: { instRan = InstHeadlight(argv, argc); break; }
+			  // bench
+		case 29: { instRan = InstBench(argv, argc); break; }
+			  // kernels
+		case 30: { instRan = InstKernels(argv, argc); break; }
+			  // views
+		case 31: { instRan = InstViews(argv, argc); break; }
+			  // raycast
+		case 32: { instRan = InstRaycast(argv, argc); break; }
+			  // bake
+		case 33: { instRan = InstBake(argv, argc); break; }
+			  // sdf
+		case 34: { instRan = InstSdf(argv, argc); break; }
+			  // sdfpart
+		case 35: { instRan = InstSdfPart(argv, argc); break; }
+			  // occlusion
+		case 36: { instRan = InstOcclusion(argv, argc); break; }
+			  // tilecache
+		case 37: { instRan = InstTileCache(argv, argc); break; }
+			  // rasterize
+		case 38: { instRan = InstRasterize(argv, argc); break; }
+			  // timeline
+		case 39: { instRan = InstTimeline(argv, argc); break; }
+			  // checkpoint
+		case 40: { instRan = InstCheckpoint(argv, argc); break; }
+			  // resume
+		case 41: { instRan = InstResume(argv, argc); break; }
+		}
+
+		// Generic errors to console if failed to run instructions
+		if (inst < 0)
+		{
+			std::cout << "'" << argv[0] << "' is an unknown instruction, type 'help' to view all usable instructions.\n" << std::endl;
+		}
+		else if (!instRan)
+		{
+			std::cout << "'" << argv[0] << "' instruction was malformed, type 'help' to check the parameters are correct.\n" << std::endl;
+		}
+		return true;
+	}
+
+	void SceneManager::CheckRender()
+	{
+		if (renderJob == nullptr) return;
+
+		// Check before presenting so the last tiles are always shown
+		bool finished = !renderJob->IsRunning();
+		raytracer->PresentRender();
+		if (!finished) return;
+
+		if (renderJob->IsCancelled()) std::cout << "\nRender cancelled.\n" << std::endl;
+		else std::cout << "\nScene successfully rendered in " << renderJob->GetElapsed() << "ms.\n" << std::endl;
+		renderJob = nullptr;
+	}
+
 	void SceneManager::Run()
 	{
 		if (!fInitialised) return;
+
+		// Only iostreams are used, unsyncing from stdio makes reading lines far cheaper
+		std::ios::sync_with_stdio(false);
 		
 		// Application start info
 		std::cout << "MCG RayTracer, created by George Smith (2021). \nTo get started, type " <<
 			"'help' for a full view of all usable instructions (They're case sensitive!). \nThere's a scene already setup, type 'render' to raytrace it. " <<
 			" \nClose the program by typing 'exit'.\n" << std::endl;
 
-		// Declare user input and arguments
-		std::string input, * argv;
+		// Read the console on its own thread so the window keeps updating while waiting for input,
+		// the thread shares the queue so it can safely outlive the scene manager
+		std::shared_ptr<InputQueue> queue = inputQueue;
+		std::thread([queue]()
+		{
+			std::string line, chunk;
+			while (std::getline(std::cin, line))
+			{
+				chunk += line;
+				chunk += '\n';
+
+				// Hand lines over in chunks while more input is already buffered,
+				// a person typing gets every line handed over straight away
+				if (chunk.size() < 65536 && std::cin.rdbuf()->in_avail() > 0) continue;
+
+				std::lock_guard<std::mutex> lock(queue->lock);
+				queue->text += chunk;
+				chunk.clear();
+			}
+		}).detach();
+
+		// Scripts piped into the console only report errors
+		fEcho = IsInteractive();
+
+		if (fEcho) std::cout << "raytracer > " << std::flush;
+		// Lines waiting to be run, and the start of the next one
+		std::string batch;
+		size_t next = 0;
 		while (MCG::ProcessFrame())
 		{
-			if (fUserEnabled)
+			// Present tiles from the background render
+			CheckRender();
+			if (!fUserEnabled) continue;
+
+			// Get user input, take every waiting line at once (scripts arrive much faster than frames)
+			if (next >= batch.size())
 			{
-				std::cout << "raytracer > ";
-				// Get user input
-				std::getline(std::cin, input);
-
-				input = input.substr(0, input.find_last_of("abcdefghijklmnopqrstuvwxyz0123456789.") + 1);
-
-				// Get the total amount of arguments
-				int argc = 1;
-				for (std::string::iterator i = input.begin(); i != input.end(); ++i)
-					if ((*i) <= 0x20) ++argc;
-
-				// Create new array for arguments
-				argv = new std::string[argc];
-				if (argv == nullptr) return;
-				// Split the input string up into args
-				int carg = 0;
-				for (std::string::iterator i = input.begin(); i != input.end(); ++i)
-				{
-					if ((*i) <= 0x20)
-					{
-						++carg;
-						continue;
-					}
-					argv[carg] += (*i);
-				}
-
-				// Query the first argument with instruction list
-				bool instUsed = false, instRan = true;
-				for (int inst = 0; inst < instructionSet; ++inst)
-				{
-					// Can safely assume argv[0] is allocated since argc is 1 by default
-					if (instructions[inst].compare(argv[0]) == 0)
-					{
-						switch (inst)
-						{
-							  // exit
-						case 0: { return;  break; }
-							  // help
-						case 1: { InstHelp(); break; }
-							  // uiof
-						case 2: { InstUioff(); break; }
-							  // render
-						case 3: { InstRender();  break; }
-							  // clear
-						case 4: { InstClear(); break; }
-							  // color
-						case 5: { instRan = InstColor(argv, argc); break; }
-							  // move
-						case 6: { instRan = InstMove(argv, argc); break; }
-							  // rotate
-						case 7: { instRan = InstRotate(argv, argc); break; }
-							  // lookat
-						case 8: { instRan = InstLookat(argv, argc); break; }
-							  // fov
-						case 9: { instRan = InstFOV(argv, argc); break; }
-							  // circle
-						case 10: { instRan = InstCircle(argv, argc); break; }
-							  // sphere
-						case 11: { instRan = InstSphere(argv, argc); break; }
-						}
-						instUsed = true;
-						break;
-					}
-				}
-				// Generic errors to console if failed to run instructions
-				if (!instUsed && argv[0].length() > 0)
-				{
-					std::cout << "'" << argv[0] << "' is an unknown instruction, type 'help' to view all usable instructions.\n" << std::endl;
-				}
-				if (instUsed && !instRan)
-				{
-					std::cout << "'" << argv[0] << "' instruction was malformed, type 'help' to check the parameters are correct.\n" << std::endl;
-				}
-
-				// Delete arguments
-				delete[] argv;
-				argv = nullptr;
+				std::lock_guard<std::mutex> lock(queue->lock);
+				batch.swap(queue->text);
+				// Leaves the old batch memory with the queue to be reused
+				queue->text.clear();
+				next = 0;
+			}
+
+			// Refine the preview while no input is waiting, anything that changed the scene
+			// or camera in the meantime starts it over from the coarsest pass
+			if (batch.empty())
+			{
+				// Dont spin while waiting for input
+				if (!RunPreview()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+
+			// Run lines until this frames time slice is used up, the rest run next frame
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			while (next < batch.size() && fUserEnabled)
+			{
+				// Every line in the batch ends with '\n'
+				size_t end = batch.find('\n', next);
+				std::string_view line(batch.data() + next, end - next);
+				next = end + 1;
+
+				if (!RunInstruction(line)) return;
+				if (fEcho) std::cout << "raytracer > " << std::flush;
+
+				if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(16)) break;
 			}
 		}
 	}
 
 	SceneManager::SceneManager(RayTracer* _raytracer)
 		:
-		raytracer{ _raytracer }
+		raytracer{ _raytracer },
+		inputQueue{ std::make_shared<InputQueue>() }
 	{
 		// Double check that the raytracer is already instantiated
 		fInitialised = (raytracer != nullptr ? raytracer->IsInit() : false);
@@ -4,8 +4,13 @@
 #include "MCG_GFX_Lib.h"
 
 // Included libraries
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 
 // Core modules
 #include "UtilityModules.h"
@@ -15,7 +20,24 @@
 #include "Sphere.h"
 #include "Plane.h"
 #include "Circle.h"
+#include "DistanceField.h"
+#include "Denoiser.h"
+#include "RenderJob.h"
+#include "BVH.h"
+#include "MappedFile.h"
+#include "SceneSnapshot.h"
+#include "ChunkedScene.h"
+#include "CostMap.h"
+#include "LightTree.h"
+#include "Benchmark.h"
+#include "Kernels.h"
+#include "MultiView.h"
+#include "ImageFile.h"
+#include "Texture.h"
 #include "RayTracer.h"
+#include "Regression.h"
+#include "Timeline.h"
+#include "Checkpoint.h"
 
 // This header file groups together all usable modules into a scene manager
 
@@ -26,7 +48,8 @@ namespace MRT
 	// - Allows for custom scenes to be created
 	// - Lets users change parameters and add/remove objects
 	// - Contains pointer to RayTracer system
-	// - Uses <iostream> to query user input
+	// - Uses <iostream> to query user input, read on its own thread so
+	//   the window keeps updating while renders run in the background
 	// (TODO): Add filesystem to read scene instructions from file
 	class SceneManager
 	{
@@ -37,21 +60,68 @@ namespace MRT
 
 		// Instruction list
 		// Things the user can do to the scene/raytracer
-		std::string* instructions;
+		const std::string_view* instructions{ nullptr };
 		// Instructions set (the size of the instructions array)
 		int instructionSet{ 0 };
+		// Hashed lookup table of instruction indices (-1 when empty), size is a power of 2
+		static const int instructionTableSize{ 64 };
+		int instructionTable[instructionTableSize];
+		// Max arguments stored for a single line (including the instruction)
+		static const int maxArguments{ 16 };
+		// Time the preview is refined for per frame (milliseconds)
+		static constexpr float previewSliceMs{ 16.f };
+
+		// Console input shared with the input thread
+		struct InputQueue
+		{
+			std::mutex lock;
+			// Lines waiting to be run, each ends with '\n'
+			std::string text;
+		};
+		std::shared_ptr<InputQueue> inputQueue;
+
+		// The running background render, nullptr when idle
+		RenderJob* renderJob{ nullptr };
 
 		// SceneManager flags
 		// Check system is completely initialised
 		bool fInitialised{ false };
 		// Check that user input is enabled
 		bool fUserEnabled{ true };
+		// Check that the preview is refreshed after every change
+		bool fPreview{ false };
+		// Check that instructions report back (off when a script is piped in)
+		bool fEcho{ true };
 
 	// Internal methods
 	private:
 		// Add all instructions to the instruction list
 		void FillInstructionList();
 
+		// Split a line into arguments without allocating
+		// @param _line : The line to split
+		// @param _argv : Returned arguments, views into _line
+		// @param _maxArgs : The size of _argv, extra arguments are counted but not stored
+		// @returns int : The amount of arguments in the line
+		int Tokenise(std::string_view _line, std::string_view* _argv, int _maxArgs);
+
+		// Find an instruction through the hashed lookup table
+		// @param _name : The instruction name
+		// @returns int : The instruction index, -1 if unknown
+		int FindInstruction(std::string_view _name);
+
+		// Tokenise and run a single line of input
+		// @param _input : The line to run
+		// @returns bool : false if the application should exit
+		bool RunInstruction(std::string_view _input);
+		// Present finished tiles of the background render and report once its done
+		void CheckRender();
+
+		// Refine an out of date preview for a slice of a frame, shown in the window once done
+		// Called between frames, so input is handled within a pass and a change starts the preview over
+		// @returns bool : true if anything was rendered
+		bool RunPreview();
+
 		// Instructions
 		// These all have the same parameters unless specified
 		// @param _argv : The argument array parsed down
@@ -62,24 +132,84 @@ namespace MRT
 		void InstHelp();
 		// Turn user input off
 		void InstUioff();
-		// Renders the scene
-		void InstRender();
+		// Renders the scene, optionally within a time budget
+		bool InstRender(const std::string_view* _argv, int _argc);
+		// Show the progress of the background render
+		void InstStatus();
+		// Cancel the background render
+		void InstCancel();
 		// Clear the scene
 		void InstClear();
 		// Set the scene background color
-		bool InstColor(std::string* _argv, int& _argc);
+		bool InstColor(const std::string_view* _argv, int _argc);
 		// Move the raytracing camera
-		bool InstMove(std::string* _argv, int& _argc);
+		bool InstMove(const std::string_view* _argv, int _argc);
 		// Rotate the raytracing camera around axis
-		bool InstRotate(std::string* _argv, int& _argc);
+		bool InstRotate(const std::string_view* _argv, int _argc);
 		// Set raytracing camera to look at target
-		bool InstLookat(std::string* _argv, int& _argc);
+		bool InstLookat(const std::string_view* _argv, int _argc);
 		// Change field of view of raytracing camera
-		bool InstFOV(std::string* _argv, int& _argc);
+		bool InstFOV(const std::string_view* _argv, int _argc);
 		// Add a circle to the scene
-		bool InstCircle(std::string* _argv, int& _argc);
+		bool InstCircle(const std::string_view* _argv, int _argc);
 		// Add a sphere to the scene
-		bool InstSphere(std::string* _argv, int& _argc);
+		bool InstSphere(const std::string_view* _argv, int _argc);
+		// Move an object in the scene
+		bool InstPlace(const std::string_view* _argv, int _argc);
+		// Add a light to the scene
+		bool InstLight(const std::string_view* _argv, int _argc);
+		// Set the amount of lights sampled per shading point
+		bool InstLightSamples(const std::string_view* _argv, int _argc);
+		// Set the headlight strength
+		bool InstHeadlight(const std::string_view* _argv, int _argc);
+		// Set up ambient occlusion
+		bool InstOcclusion(const std::string_view* _argv, int _argc);
+		// Set up the tile cache
+		bool InstTileCache(const std::string_view* _argv, int _argc);
+		// Toggle rasterized primary visibility
+		bool InstRasterize(const std::string_view* _argv, int _argc);
+		// Record a timeline of the render threads and save it as a Chrome trace
+		bool InstTimeline(const std::string_view* _argv, int _argc);
+		// Checkpoint budgeted renders to a file as they go
+		bool InstCheckpoint(const std::string_view* _argv, int _argc);
+		// Continue a budgeted render from a checkpoint
+		bool InstResume(const std::string_view* _argv, int _argc);
+		// Time the hot kernels on their own
+		bool InstBench(const std::string_view* _argv, int _argc);
+		// Show, override or check the SIMD kernels
+		bool InstKernels(const std::string_view* _argv, int _argc);
+		// Render several views in one pass
+		bool InstViews(const std::string_view* _argv, int _argc);
+		// Find the closest object a ray hits
+		bool InstRaycast(const std::string_view* _argv, int _argc);
+		// Bake the scene into a C++ header
+		bool InstBake(const std::string_view* _argv, int _argc);
+		// Add a distance field object to the scene
+		bool InstSdf(const std::string_view* _argv, int _argc);
+		// Blend another shape into a distance field object
+		bool InstSdfPart(const std::string_view* _argv, int _argc);
+		// Set the amount of samples per pixel
+		bool InstSamples(const std::string_view* _argv, int _argc);
+		// Toggle the denoising post-pass
+		bool InstDenoise(const std::string_view* _argv, int _argc);
+		// Toggle the multi-resolution preview
+		bool InstPreview(const std::string_view* _argv, int _argc);
+		// Save the scene to a snapshot file
+		bool InstSave(const std::string_view* _argv, int _argc);
+		// Load the scene from a snapshot file
+		bool InstLoad(const std::string_view* _argv, int _argc);
+		// Save the scene as a chunked scene for streaming
+		bool InstChunk(const std::string_view* _argv, int _argc);
+		// Stream a chunked scene
+		bool InstStream(const std::string_view* _argv, int _argc);
+		// Toggle per pixel cost tracking
+		bool InstCost(const std::string_view* _argv, int _argc);
+		// Write the pixel cost heatmap
+		bool InstHeatmap(const std::string_view* _argv, int _argc);
+		// Run the image and performance regression suite
+		bool InstRegress(const std::string_view* _argv, int _argc);
+		// Load a texture for objects to use
+		bool InstTexture(const std::string_view* _argv, int _argc);
 
 	public:
 
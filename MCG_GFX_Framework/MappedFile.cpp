@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+
+// Included libraries
+#include <cstdio>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Mapped File
+namespace MRT
+{
+	bool MappedFile::Open(const char* _path)
+	{
+		Close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { Close(); return false; }
+
+		mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) { Close(); return false; }
+
+		data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) { Close(); return false; }
+		size = (size_t)fileSize.QuadPart;
+#else
+		fileHandle = open(_path, O_RDONLY);
+		if (fileHandle < 0) return false;
+
+		struct stat fileStat;
+		if (fstat(fileHandle, &fileStat) != 0 || fileStat.st_size == 0) { Close(); return false; }
+
+		void* mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fileHandle, 0);
+		if (mapping == MAP_FAILED) { Close(); return false; }
+		data = (const unsigned char*)mapping;
+		size = (size_t)fileStat.st_size;
+#endif
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+#ifdef _WIN32
+		if (data != nullptr) UnmapViewOfFile(data);
+		if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+		if (fileHandle != nullptr) CloseHandle(fileHandle);
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		if (data != nullptr) munmap((void*)data, size);
+		if (fileHandle >= 0) close(fileHandle);
+		fileHandle = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	void MappedFile::Swap(MappedFile& _other)
+	{
+		std::swap(data, _other.data);
+		std::swap(size, _other.size);
+		std::swap(fileHandle, _other.fileHandle);
+#ifdef _WIN32
+		std::swap(mappingHandle, _other.mappingHandle);
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool CommitFile(const char* _tempPath, const char* _path, bool _fSync)
+	{
+#ifdef _WIN32
+		if (_fSync)
+		{
+			HANDLE file = CreateFileA(_tempPath, GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			bool flushed = file != INVALID_HANDLE_VALUE && FlushFileBuffers(file);
+			if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+			if (!flushed) { std::remove(_tempPath); return false; }
+		}
+		// rename doesnt replace existing files on windows, MoveFileEx does in one step
+		if (!MoveFileExA(_tempPath, _path, MOVEFILE_REPLACE_EXISTING | (_fSync ? MOVEFILE_WRITE_THROUGH : 0)))
+		{
+			std::remove(_tempPath);
+			return false;
+		}
+#else
+		if (_fSync)
+		{
+			int file = open(_tempPath, O_WRONLY);
+			bool flushed = file >= 0 && fsync(file) == 0;
+			if (file >= 0) close(file);
+			if (!flushed) { std::remove(_tempPath); return false; }
+		}
+		if (std::rename(_tempPath, _path) != 0)
+		{
+			std::remove(_tempPath);
+			return false;
+		}
+		if (_fSync)
+		{
+			// The rename is only on disk once the folder holding it is
+			std::string folder(_path);
+			size_t slash = folder.find_last_of('/');
+			folder = slash == std::string::npos ? "." : (slash == 0 ? "/" : folder.substr(0, slash));
+			int directory = open(folder.c_str(), O_RDONLY);
+			if (directory >= 0)
+			{
+				fsync(directory);
+				close(directory);
+			}
+		}
+#endif
+		return true;
+	}
+}
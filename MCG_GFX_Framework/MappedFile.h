@@ -0,0 +1,71 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+// Included libraries
+#include <cstddef>
+
+namespace MRT
+{
+	// MappedFile
+	// - A read only memory mapping of a whole file
+	// - Pages are loaded by the OS on first touch and shared between every process mapping the file
+	class MappedFile
+	{
+	private:
+		// The mapped bytes and their size
+		const unsigned char* data{ nullptr };
+		size_t size{ 0 };
+
+		// Platform handles
+#ifdef _WIN32
+		void* fileHandle{ nullptr };
+		void* mappingHandle{ nullptr };
+#else
+		int fileHandle{ -1 };
+#endif
+
+	public:
+		// Map a file, closes any file already mapped
+		// @param _path : The file to map
+		// @returns bool : true on success
+		bool Open(const char* _path);
+
+		// Unmap the file
+		void Close();
+
+		// Get the mapped bytes
+		// @returns const unsigned char* : The start of the file, nullptr when nothing is mapped
+		const unsigned char* GetData() { return data; }
+
+		// Get the size of the mapping
+		// @returns size_t : The file size in bytes
+		size_t GetSize() { return size; }
+
+		// Check a file is mapped
+		// @returns bool : true if mapped
+		bool IsOpen() { return data != nullptr; }
+
+		// Swap mappings with another MappedFile
+		// @param _other : The file to swap with
+		void Swap(MappedFile& _other);
+
+		MappedFile() {}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+	};
+
+	// Replace a file with a finished temporary file
+	// - The replace is a single step (MoveFileEx on windows, rename elsewhere), a process killed
+	//   part way leaves either the old or the new file, never neither
+	// - With _fSync the temporary file is flushed to disk first, so a machine going down right
+	//   after the rename cant leave a renamed but empty file
+	// - The temporary file is removed on failure
+	// @param _tempPath : The written temporary file, closed
+	// @param _path : The file to replace
+	// @param _fSync : Flush the file to disk before it replaces the old one
+	// @returns bool : true on success
+	bool CommitFile(const char* _tempPath, const char* _path, bool _fSync);
+}
+
+#endif // !_MAPPEDFILE_H_
@@ -0,0 +1,167 @@
+#include "MultiView.h"
+
+// Core modules
+#include "ImageFile.h"
+
+// Multi View
+namespace MRT
+{
+	namespace
+	{
+		const real pi{ (real)3.14159265358979f };
+
+		// Build a camera to world matrix from a position and the way it looks
+		// @param _position : The camera position
+		// @param _forward : The unit direction the camera looks
+		// @param _up : The unit up direction, at right angles to _forward
+		// @returns rmat4 : The camera to world matrix
+		rmat4 FaceMatrix(const rvec3& _position, const rvec3& _forward, const rvec3& _up)
+		{
+			rvec3 right = glm::cross(_forward, _up);
+			rmat4 matrix(1.0f);
+			matrix[0] = rvec4(right, 0);
+			matrix[1] = rvec4(_up, 0);
+			matrix[2] = rvec4(-_forward, 0);
+			matrix[3] = rvec4(_position, 1);
+			return matrix;
+		}
+	}
+
+	int ViewSet::AddView(const ViewDesc& _desc)
+	{
+		if (_desc.width <= 0 || _desc.height <= 0) return -1;
+		if (_desc.fPaired)
+		{
+			if (views.empty() || views.back().desc.width != _desc.width ||
+				views.back().desc.height != _desc.height || views.back().desc.projection != _desc.projection) return -1;
+			// Count the views already traced with the previous view
+			int group = 1;
+			while (group < (int)views.size() && views[views.size() - group].desc.fPaired) ++group;
+			if (group >= maxGroupSize) return -1;
+		}
+
+		View view;
+		view.desc = _desc;
+		// Aspect ratios are worked out like MRT::Camera
+		view.aspectX = (_desc.width > _desc.height ? (real)_desc.width / (real)_desc.height : 1.f);
+		view.aspectY = (_desc.height > _desc.width ? (real)_desc.height / (real)_desc.width : 1.f);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			view.rayParams.column0[axis] = (float)_desc.camToWorld[0][axis];
+			view.rayParams.column1[axis] = (float)_desc.camToWorld[1][axis];
+			view.rayParams.column2[axis] = (float)_desc.camToWorld[2][axis];
+			view.rayParams.column3[axis] = (float)_desc.camToWorld[3][axis];
+		}
+		view.rayParams.imageWidth = (float)_desc.width;
+		view.rayParams.imageHeight = (float)_desc.height;
+		view.rayParams.aspectX = (float)view.aspectX;
+		view.rayParams.aspectY = (float)view.aspectY;
+		view.rayParams.fov = (float)_desc.fov;
+		view.image.resize((size_t)_desc.width * _desc.height);
+		view.surface.resize((size_t)_desc.width * _desc.height);
+		views.push_back(std::move(view));
+		return (int)views.size() - 1;
+	}
+
+	bool ViewSet::SetStereo(const ViewDesc& _camera, real _separation)
+	{
+		Clear();
+		ViewDesc eye = _camera;
+		eye.projection = ViewProjection::Perspective;
+		eye.fPaired = false;
+
+		// Move each eye half the separation along the camera X axis
+		rvec4 offset = _camera.camToWorld[0] * (_separation * (real)0.5f);
+		eye.camToWorld[3] = _camera.camToWorld[3] - offset;
+		if (AddView(eye) < 0) return false;
+		eye.camToWorld[3] = _camera.camToWorld[3] + offset;
+		eye.fPaired = true;
+		return AddView(eye) >= 0;
+	}
+
+	bool ViewSet::SetCubemap(const ViewDesc& _camera, int _size)
+	{
+		Clear();
+		const rvec3 position(_camera.camToWorld[3]);
+		const rvec3 faces[6][2]{
+			{ { 1, 0, 0 }, { 0, 1, 0 } }, { { -1, 0, 0 }, { 0, 1, 0 } },
+			{ { 0, 1, 0 }, { 0, 0, 1 } }, { { 0, -1, 0 }, { 0, 0, -1 } },
+			{ { 0, 0, 1 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { 0, 1, 0 } }
+		};
+
+		ViewDesc face;
+		// 90 degrees across every face
+		face.fov = 1;
+		face.width = face.height = _size;
+		for (int f = 0; f < 6; ++f)
+		{
+			face.camToWorld = FaceMatrix(position, faces[f][0], faces[f][1]);
+			if (AddView(face) < 0) return false;
+		}
+		return true;
+	}
+
+	bool ViewSet::SetEquirect(const ViewDesc& _camera, int _width)
+	{
+		Clear();
+		if (_width < 2) return false;
+		ViewDesc panorama;
+		panorama.camToWorld = _camera.camToWorld;
+		panorama.projection = ViewProjection::Equirect;
+		panorama.width = _width;
+		panorama.height = _width / 2;
+		return AddView(panorama) >= 0;
+	}
+
+	void ViewSet::CastRay(int _view, int _x, int _y, float _sampleX, float _sampleY, Ray& _ray) const
+	{
+		const View& view = views[_view];
+		const rmat4& camToWorld = view.desc.camToWorld;
+		// Convert pixel coord to NDC space (0,1)
+		real u = (_x + _sampleX) / view.desc.width, v = (_y + _sampleY) / view.desc.height;
+
+		rvec3 origin(camToWorld[3]), direction;
+		if (view.desc.projection == ViewProjection::Equirect)
+		{
+			real longitude = ((u * 2) - 1) * pi, latitude = ((real)0.5f - v) * pi;
+			real ring = glm::cos(latitude);
+			rvec4 local(ring * glm::sin(longitude), glm::sin(latitude), -ring * glm::cos(longitude), 0);
+			direction = rvec3(camToWorld * local);
+		}
+		else
+		{
+			// Worked out like Camera::CastRay, so a view matching the camera gives the same image
+#if defined(MRT_KERNELS_RAYGEN)
+			float kernelDirection[3];
+			GetKernels().generateRays(view.rayParams, _y, _x, 1, _sampleX, _sampleY, kernelDirection, kernelDirection + 1, kernelDirection + 2);
+			_ray = Ray(rvec3(view.rayParams.column3[0], view.rayParams.column3[1], view.rayParams.column3[2]),
+				rvec3(kernelDirection[0], kernelDirection[1], kernelDirection[2]));
+			return;
+#else
+			real wX = ((u * 2) - 1) * view.aspectX * view.desc.fov, wY = (1 - (v * 2)) * view.aspectY * view.desc.fov;
+			rvec4 wP = camToWorld * rvec4(wX, wY, -1, 1);
+			direction = rvec3(wP.x, wP.y, wP.z) - origin;
+#endif
+		}
+
+		_ray = Ray(origin, NormalizeFast(direction));
+	}
+
+	real ViewSet::GetPixelSpread(int _view) const
+	{
+		const View& view = views[_view];
+		if (view.desc.projection == ViewProjection::Equirect) return pi / (real)view.desc.height;
+		return (2.f * view.aspectY * view.desc.fov) / (real)view.desc.height;
+	}
+
+	bool ViewSet::SaveImages(const std::string& _path) const
+	{
+		bool written = true;
+		for (int v = 0; v < (int)views.size(); ++v)
+		{
+			const View& view = views[v];
+			written &= WriteImagePPM((_path + "_" + std::to_string(v) + ".ppm").c_str(), view.image.data(), view.desc.width, view.desc.height);
+		}
+		return written;
+	}
+}
@@ -0,0 +1,131 @@
+#ifndef _MULTIVIEW_H_
+#define _MULTIVIEW_H_
+
+// Included libraries
+#include <string>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+#include "Ray.h"
+#include "Kernels.h"
+
+namespace MRT
+{
+	// How a view maps pixels to ray directions
+	// Perspective : A pinhole camera like MRT::Camera
+	// Equirect : Longitude across the image (-180 to 180 degrees) and latitude down it (90 to -90 degrees)
+	enum class ViewProjection { Perspective, Equirect };
+
+	// ViewDesc
+	// - A camera rendered by RayTracer::RenderViews
+	// - Views look down -Z with +Y up in camera space, like MRT::Camera
+	struct ViewDesc
+	{
+		// Camera to world matrix
+		rmat4 camToWorld{ 1.0f };
+		// tan(fov / 2), the same as MRT::Camera (perspective only)
+		real fov{ 0.57f };
+		ViewProjection projection{ ViewProjection::Perspective };
+		// Image dimensions
+		int width{ 0 }, height{ 0 };
+		// Trace the view together with the previous view, pixel for pixel
+		// Only worth it when the rays of both point almost the same way (stereo eyes),
+		// both views need the same size and projection (up to ViewSet::maxGroupSize views in a row)
+		bool fPaired{ false };
+	};
+
+	// ViewSet
+	// - Several cameras rendered in one pass with RayTracer::RenderViews, each into its own image
+	// - Presets for stereo pairs, cube maps and equirectangular panoramas
+	class ViewSet
+	{
+		// Let MRT::RayTracer fill in the images
+		friend class RayTracer;
+
+	private:
+		// A view and its images
+		struct View
+		{
+			ViewDesc desc;
+			// Image aspect ratios (perspective only)
+			real aspectX{ 1 }, aspectY{ 1 };
+			// Constants for the ray generation kernel (perspective only)
+			RayRowParams rayParams;
+			std::vector<ColorPixel> image;
+			// Normals and depth, guides the denoiser
+			std::vector<SurfacePixel> surface;
+		};
+		std::vector<View> views;
+
+	public:
+		// Most views that can be traced together through ViewDesc::fPaired
+		static const int maxGroupSize{ 4 };
+
+		// Add a view
+		// @param _desc : The view
+		// @returns int : The view index, -1 if its size is empty or it cant be paired with the previous views
+		int AddView(const ViewDesc& _desc);
+
+		// Remove every view
+		void Clear() { views.clear(); }
+
+		// Replace the views with a stereo pair, the left eye is view 0 and the right eye view 1
+		// - The eyes look the same way as the camera, moved apart along its X axis
+		// @param _camera : The camera both eyes are placed around
+		// @param _separation : The distance between the eyes
+		// @returns bool : false if the camera size is empty
+		bool SetStereo(const ViewDesc& _camera, real _separation);
+
+		// Replace the views with the 6 faces of a cube map at the camera position
+		// - Faces are world aligned, ordered +X, -X, +Y, -Y, +Z, -Z
+		// - Each face is seen from the center with +Y up, the +Y face has -Z at the bottom and the -Y face has -Z at the top
+		// @param _camera : The camera the cube map is centered on (only its position is used)
+		// @param _size : The width and height of every face
+		// @returns bool : false if the size is empty
+		bool SetCubemap(const ViewDesc& _camera, int _size);
+
+		// Replace the views with a 360 degree equirectangular panorama at the camera position
+		// - The camera forward direction is at the center of the image
+		// @param _camera : The camera the panorama is centered on
+		// @param _width : The image width (height is half of it)
+		// @returns bool : false if the width is under 2
+		bool SetEquirect(const ViewDesc& _camera, int _width);
+
+		// Get the amount of views
+		// @returns int : The amount of views
+		int GetCount() const { return (int)views.size(); }
+
+		// Get a view
+		// @param _view : The view index (0 to GetCount()-1)
+		// @returns const ViewDesc& : The view
+		const ViewDesc& GetView(int _view) const { return views[_view].desc; }
+
+		// Get a view's image, holds the last render of the view
+		// @param _view : The view index (0 to GetCount()-1)
+		// @returns const ColorPixel* : The image, row major from the top left
+		const ColorPixel* GetImage(int _view) const { return views[_view].image.data(); }
+
+		// Cast a ray through a pixel of a view
+		// @param _view : The view index (0 to GetCount()-1)
+		// @param _x : The pixel X coordinate (0 to width-1)
+		// @param _y : The pixel Y coordinate (0 to height-1)
+		// @param _sampleX : The sample X coordinate on the pixel (0 to 1.f)
+		// @param _sampleY : The sample Y coordinate on the pixel (0 to 1.f)
+		// @param _ray : The ray to set up (its length is left to the caller)
+		void CastRay(int _view, int _x, int _y, float _sampleX, float _sampleY, Ray& _ray) const;
+
+		// Get the angle a single pixel of a view covers, used to work out ray footprints
+		// @param _view : The view index (0 to GetCount()-1)
+		// @returns real : The width of a pixel one unit in front of the camera
+		real GetPixelSpread(int _view) const;
+
+		// Write every view as a binary PPM, "<path>_<view>.ppm"
+		// @param _path : The file path without the view index and extension
+		// @returns bool : true if every view was written
+		bool SaveImages(const std::string& _path) const;
+	};
+}
+
+#endif // !_MULTIVIEW_H_
@@ -0,0 +1,156 @@
+#include "OcclusionCache.h"
+
+// Included libraries
+#include <cmath>
+
+// Occlusion Cache
+namespace MRT
+{
+	int OcclusionCache::GetBucket(int _level, int _x, int _y, int _z)
+	{
+		// Large primes spread neighbouring cells over the buckets
+		unsigned int hash = (unsigned int)_x * 73856093u ^ (unsigned int)_y * 19349663u ^ (unsigned int)_z * 83492791u ^ (unsigned int)_level * 2654435761u;
+		hash ^= hash >> 16;
+		hash *= 0x7feb352du;
+		hash ^= hash >> 15;
+		return (int)(hash & (bucketCount - 1));
+	}
+
+	void OcclusionCache::Reset(real _maxRadius)
+	{
+		if (records == nullptr)
+		{
+			records.reset(new OcclusionRecord[maxRecords]);
+			links.reset(new Link[maxLinks]);
+			buckets.reset(new std::atomic<int>[bucketCount]);
+		}
+		maxRadius = _maxRadius;
+		cellSize = _maxRadius * maxError;
+		Clear();
+	}
+
+	void OcclusionCache::Clear()
+	{
+		if (records == nullptr) return;
+		for (int i = 0; i < bucketCount; ++i)
+			buckets[i].store(-1, std::memory_order_relaxed);
+		recordCount.store(0);
+		linkCount.store(0);
+		levelMask.store(0);
+		contentKey = 0;
+		++generation;
+	}
+
+	void OcclusionCache::Release()
+	{
+		records.reset();
+		links.reset();
+		buckets.reset();
+		recordCount.store(0);
+		linkCount.store(0);
+		levelMask.store(0);
+		contentKey = 0;
+		++generation;
+	}
+
+	int OcclusionCache::GetRecordCount() const
+	{
+		return recordCount.load();
+	}
+
+	real OcclusionCache::GetMinRadius() const
+	{
+		return maxRadius / (real)(1 << (levels - 1));
+	}
+
+	bool OcclusionCache::Lookup(const rvec3& _point, const rvec3& _normal, float& _visibility) const
+	{
+		if (records == nullptr) return false;
+
+		float weightSum = 0, visibilitySum = 0;
+		const unsigned int mask = levelMask.load(std::memory_order_relaxed);
+		real size = cellSize;
+		for (int level = 0; level < levels; ++level, size *= (real)0.5f)
+		{
+			if ((mask & (1u << level)) == 0) continue;
+			const int x = (int)std::floor(_point.x / size), y = (int)std::floor(_point.y / size), z = (int)std::floor(_point.z / size);
+			for (int link = buckets[GetBucket(level, x, y, z)].load(std::memory_order_acquire); link >= 0; link = links[link].next)
+			{
+				const OcclusionRecord& record = records[links[link].record];
+				// Most records are out of reach, rule them out before the square roots
+				rvec3 offset = _point - record.position;
+				real distanceSqr = glm::dot(offset, offset), reach = record.radius * maxError;
+				if (distanceSqr >= reach * reach) continue;
+				real facing = glm::dot(_normal, record.normal);
+				if (facing <= 0) continue;
+				real error = glm::sqrt(distanceSqr) / record.radius + glm::sqrt(glm::max((real)0, 1 - facing));
+				if (error >= maxError) continue;
+				// Records in front of the point see less of what blocks it
+				if (glm::dot(offset, record.normal + _normal) < -record.radius * (real)0.1f) continue;
+
+				// Weights fall to 0 at the edge of a record so neighbouring records blend without seams
+				float weight = 1.f - (float)error / maxError;
+				weightSum += weight;
+				visibilitySum += weight * record.visibility;
+			}
+		}
+		if (weightSum <= 0) return false;
+		_visibility = visibilitySum / weightSum;
+		return true;
+	}
+
+	bool OcclusionCache::Insert(OcclusionRecord _record)
+	{
+		if (records == nullptr) return false;
+		_record.radius = glm::clamp(_record.radius, GetMinRadius(), maxRadius);
+
+		// The finest level whose cells still hold the reach of the record, so it spans at most 2 cells per axis
+		const real reach = _record.radius * maxError;
+		int level = 0;
+		real size = cellSize;
+		while (level + 1 < levels && size * (real)0.5f >= reach)
+		{
+			size *= (real)0.5f;
+			++level;
+		}
+
+		int low[3], high[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			low[axis] = (int)std::floor((_record.position[axis] - reach) / size);
+			high[axis] = (int)std::floor((_record.position[axis] + reach) / size);
+		}
+
+		// Every link the record needs is checked for up front, a full cache is left as it is
+		const int index = recordCount.load(std::memory_order_relaxed);
+		int link = linkCount.load(std::memory_order_relaxed);
+		const int linkTotal = (high[0] - low[0] + 1) * (high[1] - low[1] + 1) * (high[2] - low[2] + 1);
+		if (index >= maxRecords || linkTotal > maxLinks - link) return false;
+		records[index] = _record;
+
+		for (int z = low[2]; z <= high[2]; ++z)
+			for (int y = low[1]; y <= high[1]; ++y)
+				for (int x = low[0]; x <= high[0]; ++x, ++link)
+				{
+					// Pushed onto the front of the bucket, the release publishes the record along with the link
+					std::atomic<int>& bucket = buckets[GetBucket(level, x, y, z)];
+					links[link].record = index;
+					links[link].next = bucket.load(std::memory_order_relaxed);
+					bucket.store(link, std::memory_order_release);
+				}
+		linkCount.store(link, std::memory_order_relaxed);
+		recordCount.store(index + 1, std::memory_order_relaxed);
+		levelMask.fetch_or(1u << level, std::memory_order_relaxed);
+
+		// FNV-1a over the record values, padding never reaches the key
+		const real values[8]{ _record.position.x, _record.position.y, _record.position.z,
+			_record.normal.x, _record.normal.y, _record.normal.z, _record.radius, (real)_record.visibility };
+		const unsigned char* bytes = (const unsigned char*)values;
+		for (size_t i = 0; i < sizeof(values); ++i)
+		{
+			contentKey ^= bytes[i];
+			contentKey *= 1099511628211ull;
+		}
+		return true;
+	}
+}
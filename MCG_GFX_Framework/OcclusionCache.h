@@ -0,0 +1,131 @@
+#ifndef _OCCLUSIONCACHE_H_
+#define _OCCLUSIONCACHE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+
+namespace MRT
+{
+	// OcclusionRecord
+	// - Ambient occlusion worked out at one surface point
+	struct OcclusionRecord
+	{
+		rvec3 position, normal;
+		// Harmonic mean distance to the surrounding objects, the record is reused less far away
+		// from its point the closer they are
+		real radius{ 0 };
+		// Fraction of the hemisphere that isnt blocked (0 to 1.f)
+		float visibility{ 1.f };
+	};
+
+	// OcclusionCache
+	// - World space cache of ambient occlusion records (irradiance caching), occlusion is only
+	//   worked out at a few points and smoothly interpolated between them everywhere else
+	// - A record is reused at points within a fraction of its radius that face the same way,
+	//   so records crowd into corners and creases and spread out over open surfaces
+	// - Records are kept in a hash grid with a level per record size, every record is linked
+	//   into the (up to 8) cells of its level it reaches, a lookup checks one cell per level
+	// - Lookups are lock free and shared by the render threads, records are only inserted by one
+	//   thread at a time (see RayTracer::PrepareOcclusion) so the cache holds the same records
+	//   in the same order however many threads render
+	// - Records dont depend on the camera, so the cache is kept until the scene changes
+	class OcclusionCache
+	{
+	private:
+		// Grid levels, each halves the cell size of the one before
+		static const int levels{ 7 };
+		// Hash buckets, records and cell links the cache can hold
+		static const int bucketCount{ 1 << 18 };
+		static const int maxRecords{ 1 << 18 };
+		static const int maxLinks{ 1 << 20 };
+
+		// A record linked into a grid cell
+		struct Link
+		{
+			int record;
+			int next;
+		};
+
+		std::unique_ptr<OcclusionRecord[]> records;
+		std::unique_ptr<Link[]> links;
+		// First link of every bucket, -1 if empty
+		std::unique_ptr<std::atomic<int>[]> buckets;
+		std::atomic<int> recordCount{ 0 }, linkCount{ 0 };
+		// A bit per grid level holding any records, empty levels are skipped
+		std::atomic<unsigned int> levelMask{ 0 };
+		// Cell size of the top level, fits the largest record reach
+		real cellSize{ 1 };
+		real maxRadius{ 0 };
+		// Hash of every record inserted since the cache was last cleared, in insert order
+		std::uint64_t contentKey{ 0 };
+		// Times the cache has been cleared, tells apart empty caches of different scenes
+		unsigned int generation{ 0 };
+
+		// Get the bucket of a grid cell
+		// @param _level : The grid level
+		// @param _x, _y, _z : The cell coordinates
+		// @returns int : The bucket index
+		static int GetBucket(int _level, int _x, int _y, int _z);
+
+	public:
+		// Largest error a record is reused with, distance over radius plus the normal difference
+		// Lower values place more records and follow the occlusion more closely
+		static constexpr float maxError{ 0.4f };
+
+		// Set up an empty cache
+		// @param _maxRadius : The largest record radius, the occlusion distance
+		void Reset(real _maxRadius);
+
+		// Throw every record away, keeps the memory
+		void Clear();
+
+		// Free the cache
+		void Release();
+
+		// Check the cache is set up
+		// @returns bool : true after Reset until Release
+		bool IsReady() const { return records != nullptr; }
+
+		// Get the amount of records held
+		// @returns int : The record count
+		int GetRecordCount() const;
+
+		// Get the records held, in the order they were inserted
+		// @returns const OcclusionRecord* : GetRecordCount() records, nullptr before Reset
+		const OcclusionRecord* GetRecords() const { return records.get(); }
+
+		// Get a hash of the records held, caches with the same records in the same order share it
+		// @returns std::uint64_t : The hash
+		std::uint64_t GetContentKey() const { return contentKey; }
+
+		// Get the amount of times the cache has been cleared
+		// @returns unsigned int : The count
+		unsigned int GetGeneration() const { return generation; }
+
+		// Get the smallest record radius the grid levels are made for, records are clamped to it
+		// @returns real : The radius
+		real GetMinRadius() const;
+
+		// Interpolate the occlusion at a point from the records that reach it
+		// @param _point : The surface point
+		// @param _normal : The unit surface normal
+		// @param _visibility : Returned visibility (0 to 1.f)
+		// @returns bool : false if no record reaches the point
+		bool Lookup(const rvec3& _point, const rvec3& _normal, float& _visibility) const;
+
+		// Add a record, from one thread at a time
+		// Nothing is added once the records or links run out, a record is never left partly linked
+		// @param _record : The record, its radius is clamped to the cache range
+		// @returns bool : false once the cache is full
+		bool Insert(OcclusionRecord _record);
+	};
+}
+
+#endif // !_OCCLUSIONCACHE_H_
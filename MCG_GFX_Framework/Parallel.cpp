@@ -0,0 +1,143 @@
+#include "Parallel.h"
+
+// Included libraries
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Parallel
+namespace MRT
+{
+	namespace
+	{
+		// ParallelTask
+		// - A range of jobs handed to the pool by one ParallelFor call
+		struct ParallelTask
+		{
+			const std::function<void(int)>* job{ nullptr };
+			int count{ 0 };
+			std::atomic<int> nextJob{ 0 };
+			// Workers still running jobs of the task, guarded by the pool lock
+			int helpers{ 0 };
+		};
+
+		// WorkerPool
+		// - Worker threads created on first use and kept until exit, so a ParallelFor
+		//   costs a wake up instead of creating and joining threads
+		// - Several threads can run ParallelFor at once (and from inside a job), idle workers
+		//   help whichever task still has jobs while every caller works on its own
+		class WorkerPool
+		{
+		private:
+			std::mutex lock;
+			// Wakes workers when a task arrives, and callers when their helpers are done
+			std::condition_variable wake, done;
+			std::vector<ParallelTask*> tasks;
+			std::vector<std::thread> workers;
+			bool fStopping{ false };
+
+			// Run jobs of every task handed in until the pool stops
+			void Work()
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				while (true)
+				{
+					ParallelTask* task = nullptr;
+					wake.wait(guard, [&]()
+					{
+						for (ParallelTask* waiting : tasks)
+						{
+							if (waiting->nextJob.load(std::memory_order_relaxed) < waiting->count)
+							{
+								task = waiting;
+								return true;
+							}
+						}
+						return fStopping;
+					});
+					if (task == nullptr) return;
+
+					// The caller waits for every helper before the task goes out of scope
+					++task->helpers;
+					guard.unlock();
+					for (int job = task->nextJob++; job < task->count; job = task->nextJob++)
+						(*task->job)(job);
+					guard.lock();
+					if (--task->helpers == 0) done.notify_all();
+				}
+			}
+
+		public:
+			// Run every job of a task, the calling thread works on it too
+			// @param _task : The task
+			void Run(ParallelTask& _task)
+			{
+				const int helpers = std::min((int)workers.size(), _task.count - 1);
+				if (helpers > 0)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					tasks.push_back(&_task);
+				}
+				for (int i = 0; i < helpers; ++i)
+					wake.notify_one();
+
+				for (int job = _task.nextJob++; job < _task.count; job = _task.nextJob++)
+					(*_task.job)(job);
+				if (helpers <= 0) return;
+
+				// Every job has been claimed, wait for the ones workers are still running
+				std::unique_lock<std::mutex> guard(lock);
+				for (size_t i = 0; i < tasks.size(); ++i)
+				{
+					if (tasks[i] != &_task) continue;
+					tasks.erase(tasks.begin() + i);
+					break;
+				}
+				done.wait(guard, [&]() { return _task.helpers == 0; });
+			}
+
+			WorkerPool()
+			{
+				// The calling thread counts as a worker
+				const int count = GetWorkerCount() - 1;
+				workers.reserve(count);
+				for (int i = 0; i < count; ++i)
+					workers.emplace_back(&WorkerPool::Work, this);
+			}
+			~WorkerPool()
+			{
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					fStopping = true;
+				}
+				wake.notify_all();
+				for (std::thread& worker : workers)
+					worker.join();
+			}
+		};
+	}
+
+	int GetWorkerCount()
+	{
+		// hardware_concurrency can return 0 when it cant be detected
+		unsigned int threads = std::thread::hardware_concurrency();
+		return threads > 0 ? (int)threads : 1;
+	}
+
+	void ParallelFor(int _count, const std::function<void(int)>& _job)
+	{
+		if (_count <= 0) return;
+
+		// Created once, on the first call
+		static WorkerPool pool;
+
+		// Every thread grabs the next job index until none are left
+		ParallelTask task;
+		task.job = &_job;
+		task.count = _count;
+		pool.Run(task);
+	}
+}
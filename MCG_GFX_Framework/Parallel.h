@@ -0,0 +1,24 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+// Included libraries
+#include <functional>
+
+namespace MRT
+{
+	// Get the amount of worker threads used by ParallelFor
+	// @returns int : The amount of hardware threads (at least 1)
+	int GetWorkerCount();
+
+	// Parallel for
+	// - Splits a range of jobs across every hardware thread
+	// - Runs on a pool of worker threads created by the first call, so calling it often is cheap
+	// - Jobs are handed out through an atomic counter so uneven jobs balance out
+	// - The calling thread works on jobs too, returns once every job has finished
+	// - Can be called from several threads at once and from inside a job
+	// @param _count : The amount of jobs to run (indexed 0 to _count-1)
+	// @param _job : The job function, gets passed the job index
+	void ParallelFor(int _count, const std::function<void(int)>& _job);
+}
+
+#endif // !_PARALLEL_H_
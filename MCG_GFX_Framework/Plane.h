@@ -18,18 +18,29 @@ namespace MRT
 	// - Can not be instantiated (Intersect isnt overridden)
 	class Plane : public Primitive
 	{
+		// Let MRT::KernelBenchmark time the plane test on its own
+		friend class KernelBenchmark;
+
 	protected:
-		glm::fvec3 direction;
+		rvec3 direction;
 
 	protected:
 		// Check if ray intersects plane
 		// Uses the algebraic form of a plane to calculate intersection
 		// @param _ray : The ray to check for an intersection
-		// @returns float : The ray length, if (> 0) intersection occurred
-		float IntersectPlane(Ray& _ray);
+		// @returns real : The ray length, if (> 0) intersection occurred
+		real IntersectPlane(Ray& _ray);
 
 	public:
-		Plane(glm::fvec3& _position, glm::fvec3& _direction, ColorPixel& _color);
+		// Set the facing direction
+		// @param _direction : The new direction
+		void SetDirection(rvec3 _direction) { direction = _direction; }
+
+		// Get the facing direction
+		// @returns rvec3 : The direction
+		rvec3 GetDirection() { return direction; }
+
+		Plane(rvec3& _position, rvec3& _direction, ColorPixel& _color);
 	};
 }
 
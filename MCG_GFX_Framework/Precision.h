@@ -0,0 +1,69 @@
+#ifndef _PRECISION_H_
+#define _PRECISION_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+
+// Precision tiers
+// - The scalar used by rays, cameras, primitives and the BVH is picked when compiling,
+//   each tier is built as its own configuration with one of these defined:
+//   MRT_PRECISION_FAST    : float, normals and camera rays use an approximate reciprocal square root
+//   (nothing)             : float, exact normalisation (the default)
+//   MRT_PRECISION_DOUBLE  : double, for huge scenes where float positions break down
+// - Colors, images and textures are float in every tier
+// - Snapshots store the scalar size, a snapshot only loads in the tier that wrote it
+#if defined(MRT_PRECISION_FAST) && defined(MRT_PRECISION_DOUBLE)
+#error "MRT_PRECISION_FAST and MRT_PRECISION_DOUBLE can not be combined"
+#endif
+
+#if defined(MRT_PRECISION_FAST) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define MRT_PRECISION_RSQRT_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace MRT
+{
+#if defined(MRT_PRECISION_DOUBLE)
+	typedef double real;
+#else
+	typedef float real;
+#endif
+	typedef glm::vec<2, real> rvec2;
+	typedef glm::vec<3, real> rvec3;
+	typedef glm::vec<4, real> rvec4;
+	typedef glm::mat<4, 4, real> rmat4;
+
+	// The name of the tier being built, shown in reports
+#if defined(MRT_PRECISION_FAST)
+	const char* const precisionName{ "fast float" };
+#elif defined(MRT_PRECISION_DOUBLE)
+	const char* const precisionName{ "double" };
+#else
+	const char* const precisionName{ "precise float" };
+#endif
+
+	// Normalise a vector
+	// The fast tier uses an approximate reciprocal square root refined by a single newton step,
+	// the raw estimate (12 bits) leaves ray directions too far off unit length for Sphere::Intersect
+	// @param _v : The vector to normalise (non zero)
+	// @returns rvec3 : The unit vector
+	inline rvec3 NormalizeFast(const rvec3& _v)
+	{
+#if defined(MRT_PRECISION_FAST)
+		float lengthSqr = glm::dot(_v, _v);
+#if defined(MRT_PRECISION_RSQRT_SSE)
+		float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(lengthSqr)));
+#else
+		// Bit level estimate
+		union { float f; unsigned int i; } bits{ lengthSqr };
+		bits.i = 0x5F3759DFu - (bits.i >> 1);
+		float estimate = bits.f;
+#endif
+		return _v * (estimate * (1.5f - (0.5f * lengthSqr * estimate * estimate)));
+#else
+		return glm::normalize(_v);
+#endif
+	}
+}
+
+#endif // !_PRECISION_H_
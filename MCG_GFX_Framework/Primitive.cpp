@@ -1,9 +1,18 @@
 #include "Primitive.h"
 
+// Included libraries
+#include <cfloat>
+
 // Primitive
 namespace MRT
 {
-	Primitive::Primitive(glm::fvec3& _position, ColorPixel& _color)
+	void Primitive::GetBounds(rvec3& _min, rvec3& _max)
+	{
+		_min = rvec3(-FLT_MAX);
+		_max = rvec3(FLT_MAX);
+	}
+
+	Primitive::Primitive(rvec3& _position, ColorPixel& _color)
 		:
 		position(_position),
 		color{ _color }
@@ -6,10 +6,21 @@
 
 // Core modules
 #include "UtilityModules.h"
+#include "Precision.h"
 #include "Ray.h"
 
 namespace MRT
 {
+	// PrimitiveType
+	// - Used to store primitives in flat per type arrays
+	// - Generic primitives are only reachable through their virtual Intersect
+	enum class PrimitiveType : unsigned int
+	{
+		Sphere = 0,
+		Circle = 1,
+		Generic = 2
+	};
+
 	// Primitive
 	// - Base class for all primitive geometry
 	// - Can not be instantiated (pure virtual)
@@ -17,9 +28,11 @@ namespace MRT
 	{
 	protected:
 		// The position of the primitive
-		glm::fvec3 position;
+		rvec3 position;
 		// The color of the primitive
 		ColorPixel color;
+		// The texture of the primitive, tinted by its color (-1 for none)
+		int texture{ -1 };
 
 	public:
 		// Pure virtual intersection function for primitives to override
@@ -27,16 +40,44 @@ namespace MRT
 		// @returns bool : true if intersecting
 		virtual bool Intersect(Ray& _ray) = 0;
 
+		// Get the world space bounding box of the primitive
+		// Defaults to an unbounded box, primitives should override it
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		virtual void GetBounds(rvec3& _min, rvec3& _max);
+
+		// Get the primitive type
+		// @returns PrimitiveType : The type, Generic unless overridden
+		virtual PrimitiveType GetType() { return PrimitiveType::Generic; }
+
 		// Get the position vector
-		// @returns glm::fvec3 : The position vector
-		glm::fvec3 GetPosition() { return position; }
+		// @returns rvec3 : The position vector
+		rvec3 GetPosition() { return position; }
+
+		// Set the position vector
+		// Objects in a RayTracer need RayTracer::UpdatePrimitive afterwards (or use RayTracer::MovePrimitive)
+		// @param _position : The new position
+		void SetPosition(rvec3 _position) { position = _position; }
 
 		// Get the color
 		// @returns ColorPixel : The color
 		ColorPixel GetColor() { return color; }
 
-		Primitive(glm::fvec3& _position, ColorPixel& _color);
+		// Set the color
+		// @param _color : The new color
+		void SetColor(ColorPixel _color) { color = _color; }
+
+		// Set the texture
+		// @param _texture : The texture index from RayTracer::LoadTexture (-1 for none)
+		void SetTexture(int _texture) { texture = _texture; }
+
+		// Get the texture
+		// @returns int : The texture index (-1 for none)
+		int GetTexture() { return texture; }
+
+		Primitive(rvec3& _position, ColorPixel& _color);
 		Primitive();
+		virtual ~Primitive() {}
 	};
 }
 
@@ -3,7 +3,7 @@
 // Ray
 namespace MRT
 {
-	Ray::Ray(glm::fvec3 _origin, glm::fvec3 _dir)
+	Ray::Ray(rvec3 _origin, rvec3 _dir)
 		:
 		origin(_origin), direction(_dir)
 	{
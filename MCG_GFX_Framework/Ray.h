@@ -6,6 +6,7 @@
 
 // Core modules
 #include "UtilityModules.h"
+#include "Precision.h"
 
 namespace MRT
 {
@@ -15,13 +16,20 @@ namespace MRT
 	struct HitInformation
 	{
 		// The current length of the ray to the object
-		float length{ 0 };
+		real length{ 0 };
 
 		// The normal of the object that has been hit
-		glm::fvec3 hitNormal;
+		rvec3 hitNormal;
 
 		// The color of the objects the ray has hit (Additive blending)
 		ColorPixel hitColor;
+
+		// The texture of the object that has been hit (-1 for none)
+		int texture{ -1 };
+		// Texture coordinates of the hit, only set on textured objects
+		glm::fvec2 uv{ 0 };
+		// World space length of one UV unit at the hit, used to work out the texture footprint
+		float uvScale{ 1 };
 	};
 
 	// Ray
@@ -36,7 +44,7 @@ namespace MRT
 	private:
 		// Origin is in world space 
 		// Direction that the ray is pointing, needs to be normalised
-		glm::fvec3 origin, direction;
+		rvec3 origin, direction;
 
 		// The rays hit information
 		// used to work out object distances, shading, lighting, etc
@@ -44,12 +52,12 @@ namespace MRT
 
 	public:
 		// Get the ray origin
-		// @returns glm::fvec3 : The ray origin
-		glm::fvec3 GetOrigin() { return origin; }
+		// @returns rvec3 : The ray origin
+		rvec3 GetOrigin() { return origin; }
 
 		// Get the ray direction
-		// @returns glm::fvec3 : The ray direction
-		glm::fvec3 GetDirection() { return direction; }
+		// @returns rvec3 : The ray direction
+		rvec3 GetDirection() { return direction; }
 
 		// Set ray hit information
 		// @param _info : The information to be saved to the ray
@@ -61,13 +69,13 @@ namespace MRT
 
 		// Get ray length
 		// Very useful to get this variable alone (instead of returning full hitInfo)
-		// @returns float : The current length of the ray
-		float GetLength() { return hitInfo.length; }
+		// @returns real : The current length of the ray
+		real GetLength() { return hitInfo.length; }
 
 		// Instantiation
 		// @param _origin : Optional, sets the ray origin
 		// @param _dir : Optional, sets the ray direction, needs to be normalised
-		Ray(glm::fvec3 _origin = { 0, 0, 0 }, glm::fvec3 _dir = { 0, 0, 0 });
+		Ray(rvec3 _origin = { 0, 0, 0 }, rvec3 _dir = { 0, 0, 0 });
 		~Ray();
 	};
 }
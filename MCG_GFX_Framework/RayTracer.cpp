@@ -1,106 +1,2496 @@
 #include "RayTracer.h"
 
+// Included libraries
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Core modules
+#include "Parallel.h"
+#include "SceneSnapshot.h"
+#include "ImageFile.h"
+#include "Timeline.h"
+
 // The RayTracer
 namespace MRT
 {
-	ColorPixel RayTracer::Shade(Ray& _ray)
+	namespace
+	{
+		// Get a sample position on a pixel (0 to 1.f)
+		// Uses the R2 low discrepancy sequence, sample 0 is the pixel center
+		// @param _sample : The sample index
+		// @param _x : Returned sample X coordinate
+		// @param _y : Returned sample Y coordinate
+		void SamplePosition(int _sample, float& _x, float& _y)
+		{
+			_x = 0.5f + _sample * 0.7548776662f;
+			_y = 0.5f + _sample * 0.5698402910f;
+			_x -= (int)_x;
+			_y -= (int)_y;
+		}
+
+		// Mix the bits of a value (lowbias32 hash)
+		// @param _x : The value
+		// @returns unsigned int : The hashed bits
+		unsigned int HashBits(unsigned int _x)
+		{
+			_x ^= _x >> 16;
+			_x *= 0x7feb352du;
+			_x ^= _x >> 15;
+			_x *= 0x846ca68bu;
+			_x ^= _x >> 16;
+			return _x;
+		}
+
+		// Get the next random number of a sequence
+		// @param _state : The sequence state, moved on by every call
+		// @returns float : Uniform random number (0 to 1.f, exclusive)
+		float NextRandom(unsigned int& _state)
+		{
+			_state = HashBits(_state + 0x9e3779b9u);
+			return (_state >> 8) * (1.f / 16777216.f);
+		}
+
+		// Seed a random sequence from a ray direction
+		// Every pixel sample casts a different direction, so images come out the same every render
+		// @param _direction : The ray direction
+		// @returns unsigned int : The sequence state
+		unsigned int SeedFromDirection(const rvec3& _direction)
+		{
+			float components[3]{ (float)_direction.x, (float)_direction.y, (float)_direction.z };
+			unsigned int bits[3];
+			std::memcpy(bits, components, sizeof(bits));
+			return HashBits(bits[0] ^ HashBits(bits[1] ^ HashBits(bits[2])));
+		}
+
+		// Relative gap shadow rays leave at the surface and the light, stops them hitting either
+		const real shadowBias{ (real)1e-3f };
+
+		// Get the point ambient occlusion is worked out at for a hit
+		// @param _ray : The ray that hit the point
+		// @param _point : Returned hit point
+		// @param _normal : Returned unit normal, on the side of the surface the ray came from
+		void GetOcclusionPoint(Ray& _ray, rvec3& _point, rvec3& _normal)
+		{
+			HitInformation hitInfo = _ray.GetHitInfo();
+			_point = _ray.GetOrigin() + _ray.GetDirection() * hitInfo.length;
+			// Occlude the side of the surface the camera sees
+			_normal = glm::dot(hitInfo.hitNormal, _ray.GetDirection()) > 0 ? -hitInfo.hitNormal : hitInfo.hitNormal;
+		}
+
+		// OcclusionCandidate
+		// - A hit of a frame an occlusion record may be placed at
+		struct OcclusionCandidate
+		{
+			rvec3 point, normal;
+			// Hit distance and the pixel width one unit in front of the camera
+			real length, spread;
+			// Set if the ray hit and no record reaches the point
+			bool fOpen;
+		};
+
+		// Get a steady clock reading for pixel costs
+		// @returns long long : The time in nanoseconds
+		long long GetNanoseconds()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// Hash a scene record for the tile cache
+		// Record hashes are summed, so the objects in a tile hash the same whatever order the BVH holds them in
+		// @param _scene : The scene
+		// @param _ref : The primitive reference of a sphere or circle
+		// @returns std::uint64_t : The record hash
+		std::uint64_t HashRecord(const SceneView& _scene, unsigned int _ref)
+		{
+			ContentHash hash;
+			hash.AddValue((unsigned int)GetRefType(_ref));
+			if (GetRefType(_ref) == PrimitiveType::Sphere)
+			{
+				const SphereRecord& sphere = _scene.spheres[GetRefIndex(_ref)];
+				hash.AddVector(sphere.position);
+				hash.AddValue(sphere.radius);
+				hash.AddColor(sphere.color);
+				hash.AddValue(sphere.texture);
+			}
+			else
+			{
+				const CircleRecord& circle = _scene.circles[GetRefIndex(_ref)];
+				hash.AddVector(circle.position);
+				hash.AddVector(circle.direction);
+				hash.AddValue(circle.radius);
+				hash.AddColor(circle.color);
+				hash.AddValue(circle.texture);
+			}
+			return hash.value;
+		}
+
+		// Add the bytes of a file to a hash
+		// @param _path : The file
+		// @param _hash : The hash
+		void HashFile(const char* _path, ContentHash& _hash)
+		{
+			std::ifstream file(_path, std::ios::binary);
+			char buffer[4096];
+			while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+				_hash.Add(buffer, (size_t)file.gcount());
+		}
+
+#if defined(MRT_KERNELS_INTERSECT)
+		// SphereBatch
+		// - Spheres gathered from a leaf to be tested together through the intersection kernel
+		struct SphereBatch
+		{
+			static const int size{ 16 };
+			float centerX[size], centerY[size], centerZ[size], radiusSqr[size];
+			// The record index of every sphere
+			int records[size];
+			int count{ 0 };
+
+			// Add a sphere to the batch
+			// @param _sphere : The sphere
+			// @param _record : Its record index
+			void Gather(const SphereRecord& _sphere, int _record)
+			{
+				centerX[count] = _sphere.position.x; centerY[count] = _sphere.position.y; centerZ[count] = _sphere.position.z;
+				radiusSqr[count] = _sphere.radiusSqr;
+				records[count++] = _record;
+			}
+
+			// Find the closest sphere of the batch a ray hits
+			// Only the closest is tested again to fill in the hit information
+			// @param _kernel : The intersection kernel
+			// @param _scene : The scene the spheres were gathered from
+			// @param _ray : The ray, only set if the hit is closer than its current length
+			// @returns bool : true if a sphere was hit
+			bool Intersect(IntersectSpheresKernel _kernel, const SceneView& _scene, Ray& _ray) const
+			{
+				rvec3 rO = _ray.GetOrigin(), rD = _ray.GetDirection();
+				const float origin[3]{ rO.x, rO.y, rO.z }, direction[3]{ rD.x, rD.y, rD.z };
+				// A single sphere isnt worth the kernel call
+				int closest = count == 1 ? 0 : _kernel(centerX, centerY, centerZ, radiusSqr, count, origin, direction, _ray.GetLength());
+				return closest >= 0 && Sphere::IntersectRecord(_scene.spheres[records[closest]], _ray);
+			}
+
+			// Find the closest sphere of the batch a ray hits, only works out the distance
+			// @param _kernel : The intersection kernel
+			// @param _scene : The scene the spheres were gathered from
+			// @param _origin : The ray origin
+			// @param _direction : The unit ray direction
+			// @param _length : The ray length, set to the hit distance if a sphere is hit closer
+			// @param _record : Returned record index of the hit sphere
+			// @returns bool : true if a sphere was hit
+			bool IntersectLength(IntersectSpheresKernel _kernel, const SceneView& _scene, const rvec3& _origin, const rvec3& _direction, real& _length, int& _record) const
+			{
+				const float origin[3]{ _origin.x, _origin.y, _origin.z }, direction[3]{ _direction.x, _direction.y, _direction.z };
+				int closest = count == 1 ? 0 : _kernel(centerX, centerY, centerZ, radiusSqr, count, origin, direction, (float)_length);
+				if (closest < 0 || !Sphere::IntersectRecordLength(_scene.spheres[records[closest]], _origin, _direction, _length)) return false;
+				_record = records[closest];
+				return true;
+			}
+		};
+#endif
+	}
+
+	ColorPixel RayTracer::Shade(Ray& _ray, real _pixelSpread)
+	{
+		// Get the hit information from the ray
+		HitInformation hitInfo = _ray.GetHitInfo();
+		// Calculate the facing ratio by getting the dot product of the hitnormal and viewing direction (-rayDir)
+		// having it clamped to 0 lets the final ratio be between 0 and 1.0f
+		float facingRatio = (float)glm::max((real)0.05f, glm::dot(hitInfo.hitNormal, -_ray.GetDirection()));
+
+		ColorPixel color = hitInfo.hitColor;
+		if (hitInfo.texture >= 0 && hitInfo.texture < (int)textures.size())
+		{
+			// The ray footprint is the width of a pixel at the hit distance, stretched at grazing angles
+			float footprint = (float)(hitInfo.length * _pixelSpread) / (hitInfo.uvScale * facingRatio);
+			ColorPixel texel = textures[hitInfo.texture].Sample(hitInfo.uv.x, hitInfo.uv.y, footprint);
+			color = { color.r * texel.r, color.g * texel.g, color.b * texel.b };
+		}
+
+		float ambient = facingRatio * headlight;
+		// Ambient occlusion darkens the headlight in corners and under objects
+		if (occlusionDistance > 0 && ambient > 0 && !streamed.IsOpen()) ambient *= SampleOcclusion(_ray, _pixelSpread);
+		ColorPixel light{ ambient, ambient, ambient };
+		// Shadow rays cant reach streamed chunks, so streamed scenes are only lit by the headlight
+		if (!lightTree.IsEmpty() && !streamed.IsOpen())
+		{
+			ColorPixel direct = SampleLights(_ray);
+			light = { light.r + direct.r, light.g + direct.g, light.b + direct.b };
+		}
+
+		return { light.r * color.r, light.g * color.g, light.b * color.b };
+	}
+
+	ColorPixel RayTracer::SampleLights(Ray& _ray)
+	{
+		const real pi = (real)3.14159265f;
+		HitInformation hitInfo = _ray.GetHitInfo();
+		rvec3 point = _ray.GetOrigin() + _ray.GetDirection() * hitInfo.length;
+		// Light the side of the surface the camera sees
+		rvec3 normal = glm::dot(hitInfo.hitNormal, _ray.GetDirection()) > 0 ? -hitInfo.hitNormal : hitInfo.hitNormal;
+		// Offset shadow rays off the surface so they dont hit it again
+		rvec3 shadowOrigin = point + normal * (shadowBias * glm::max((real)1, hitInfo.length));
+
+		unsigned int state = SeedFromDirection(_ray.GetDirection());
+		ColorPixel direct;
+		for (int s = 0; s < lightSamples; ++s)
+		{
+			float probability;
+			int index = lightTree.Sample(point, NextRandom(state), probability);
+			if (index < 0) break;
+			const LightRecord& light = lights[index];
+
+			// Sphere lights are sampled uniformly over their surface
+			rvec3 target = light.position, lightNormal(0);
+			if (light.radius > 0)
+			{
+				real z = 1 - 2 * (real)NextRandom(state);
+				real ring = glm::sqrt(glm::max((real)0, 1 - z * z));
+				real angle = 2 * pi * (real)NextRandom(state);
+				lightNormal = rvec3(ring * glm::cos(angle), ring * glm::sin(angle), z);
+				target += lightNormal * light.radius;
+			}
+
+			rvec3 toLight = target - point;
+			real distanceSqr = glm::dot(toLight, toLight);
+			if (distanceSqr <= 0) continue;
+			real distance = glm::sqrt(distanceSqr);
+			rvec3 direction = toLight / distance;
+
+			real geometry = glm::dot(normal, direction) / distanceSqr;
+			if (geometry <= 0) continue;
+			if (light.radius > 0)
+			{
+				// Cosine at the light over the probability of the surface point (1 / area)
+				real cosLight = -glm::dot(direction, lightNormal);
+				if (cosLight <= 0) continue;
+				geometry *= cosLight * 4 * pi * light.radius * light.radius;
+			}
+
+			// Shadow ray, stops just short of the light
+			Ray shadow(shadowOrigin, direction);
+			HitInformation shadowInfo;
+			shadowInfo.length = distance * (1 - shadowBias);
+			shadow.SetHitInfo(shadowInfo);
+			if (IntersectScene(shadow)) continue;
+
+			// Dividing by the chance of picking the light keeps the sum unbiased
+			float weight = (float)geometry / (probability * lightSamples);
+			direct.r += light.emission.r * weight;
+			direct.g += light.emission.g * weight;
+			direct.b += light.emission.b * weight;
+		}
+		return direct;
+	}
+
+	OcclusionRecord RayTracer::TraceOcclusionRecord(const rvec3& _point, const rvec3& _normal, real _length, real _pixelSpread)
+	{
+		const real pi = (real)3.14159265f;
+		rvec3 tangent = glm::normalize(glm::cross(glm::abs(_normal.x) > (real)0.5f ? rvec3(0, 1, 0) : rvec3(1, 0, 0), _normal));
+		rvec3 bitangent = glm::cross(_normal, tangent);
+		rvec3 origin = _point + _normal * (shadowBias * glm::max((real)1, _length));
+
+		// The sample pattern is shifted by an offset seeded from the point, so a record only depends on where it is
+		unsigned int state = SeedFromDirection(_point);
+		float offsetX = NextRandom(state), offsetY = NextRandom(state);
+		int blocked = 0;
+		real inverseSum = 0;
+		for (int s = 0; s < occlusionSamples; ++s)
+		{
+			float u, v;
+			SamplePosition(s, u, v);
+			u += offsetX;
+			v += offsetY;
+			u -= (int)u;
+			v -= (int)v;
+
+			// Cosine weighted directions, counting the blocked ones weights them by the cosine
+			real ring = glm::sqrt((real)u), angle = 2 * pi * (real)v;
+			rvec3 direction = tangent * (ring * glm::cos(angle)) + bitangent * (ring * glm::sin(angle)) + _normal * glm::sqrt(glm::max((real)0, 1 - (real)u));
+
+			real length = occlusionDistance;
+			unsigned int ref;
+			if (QueryScene(origin, direction, length, false, ref))
+			{
+				++blocked;
+				inverseSum += 1 / glm::max(length, occlusionCache.GetMinRadius());
+			}
+			else inverseSum += 1 / occlusionDistance;
+		}
+
+		OcclusionRecord record;
+		record.position = _point;
+		record.normal = _normal;
+		record.visibility = 1.f - (float)blocked / occlusionSamples;
+		// Records reach at least a few pixels of the view that traced them
+		record.radius = glm::max((real)occlusionSamples / inverseSum, _length * _pixelSpread * (real)4);
+		return record;
+	}
+
+	float RayTracer::SampleOcclusion(Ray& _ray, real _pixelSpread)
+	{
+		rvec3 point, normal;
+		GetOcclusionPoint(_ray, point, normal);
+		float visibility;
+		if (occlusionCache.Lookup(point, normal, visibility)) return visibility;
+
+		// Records are only placed before shading (see PrepareOcclusion), a point none reaches is traced on its own
+		return TraceOcclusionRecord(point, normal, _ray.GetHitInfo().length, _pixelSpread).visibility;
+	}
+
+	bool RayTracer::PrepareOcclusion(int _count, const std::function<real(int, Ray&)>& _cast, const std::atomic<bool>* _cancel)
+	{
+		if (occlusionDistance <= 0 || headlight <= 0 || streamed.IsOpen() || !occlusionCache.IsReady() || _count <= 0) return false;
+		TimelineScope scope("Place occlusion records");
+
+		// Hits are visited in bit reversed order, spread over the frame so a batch rarely
+		// holds neighbours that one record reaches
+		int bits = 0;
+		while ((1 << bits) < _count) ++bits;
+		std::vector<int> order;
+		order.reserve(_count);
+		for (unsigned int i = 0; i < (1u << bits); ++i)
+		{
+			unsigned int reversed = 0;
+			for (int b = 0; b < bits; ++b)
+				reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+			if ((int)reversed < _count) order.push_back((int)reversed);
+		}
+
+		const int chunkSize = 256, batchSize = 4 * GetWorkerCount();
+		std::vector<OcclusionCandidate> candidates(_count);
+		std::vector<int> open, batch;
+		std::vector<OcclusionRecord> batchRecords;
+		// Find the hits no record reaches yet
+		ParallelFor((_count + chunkSize - 1) / chunkSize, [&](int _chunk)
+		{
+			const int end = glm::min(_count, (_chunk + 1) * chunkSize);
+			for (int i = _chunk * chunkSize; i < end; ++i)
+			{
+				OcclusionCandidate& candidate = candidates[i];
+				Ray ray;
+				candidate.spread = _cast(i, ray);
+				candidate.fOpen = IntersectScene(ray);
+				if (!candidate.fOpen) continue;
+				GetOcclusionPoint(ray, candidate.point, candidate.normal);
+				candidate.length = ray.GetHitInfo().length;
+				float visibility;
+				candidate.fOpen = !occlusionCache.Lookup(candidate.point, candidate.normal, visibility);
+			}
+		});
+		for (int i : order)
+			if (candidates[i].fOpen) open.push_back(i);
+
+		// Records are traced a batch at a time in parallel, then added in order, a record reached
+		// by one added before it is dropped, leaving the same records as adding them one by one
+		bool fAdded = false;
+		for (size_t next = 0; next < open.size();)
+		{
+			if (_cancel != nullptr && *_cancel) return fAdded;
+
+			float visibility;
+			batch.clear();
+			while (next < open.size() && (int)batch.size() < batchSize)
+			{
+				const int i = open[next++];
+				if (!occlusionCache.Lookup(candidates[i].point, candidates[i].normal, visibility)) batch.push_back(i);
+			}
+			batchRecords.resize(batch.size());
+			ParallelFor((int)batch.size(), [&](int _entry)
+			{
+				const OcclusionCandidate& candidate = candidates[batch[_entry]];
+				batchRecords[_entry] = TraceOcclusionRecord(candidate.point, candidate.normal, candidate.length, candidate.spread);
+			});
+
+			for (size_t b = 0; b < batch.size(); ++b)
+			{
+				const OcclusionCandidate& candidate = candidates[batch[b]];
+				if (occlusionCache.Lookup(candidate.point, candidate.normal, visibility)) continue;
+				// A full cache keeps the records it has, the points left over are traced as they are shaded
+				if (!occlusionCache.Insert(batchRecords[b])) return fAdded;
+				fAdded = true;
+			}
+		}
+		return fAdded;
+	}
+
+	bool RayTracer::PrepareCameraOcclusion(const std::atomic<bool>* _cancel)
+	{
+		if (occlusionDistance <= 0) return false;
+
+		// Nothing new to place while the camera, settings and cache are as the last pass left them
+		ContentHash hash;
+		const SnapshotCamera state = GetCameraState();
+		hash.AddVector(state.position);
+		for (int i = 0; i < 16; ++i)
+			hash.AddValue(state.camRotation[i]);
+		hash.AddValue(state.fov);
+		hash.AddValue(state.maxViewingDistance);
+		hash.AddValue(screenW);
+		hash.AddValue(screenH);
+		hash.AddValue(headlight);
+		hash.AddValue(occlusionCache.GetGeneration());
+		ContentHash prepared = hash;
+		hash.AddValue(occlusionCache.GetContentKey());
+		if (hash.value == occlusionPreparedKey) return false;
+
+		// Pixel centers place the records, the other samples land close enough to be reached by them
+		const real spread = camera.GetPixelSpread();
+		const bool fAdded = PrepareOcclusion(screenW * screenH, [&](int _index, Ray& _ray)
+		{
+			camera.CastRay(_index % screenW, _index / screenW, _ray, 0.5f, 0.5f);
+			return spread;
+		}, _cancel);
+
+		if (_cancel == nullptr || !*_cancel)
+		{
+			prepared.AddValue(occlusionCache.GetContentKey());
+			occlusionPreparedKey = prepared.value;
+		}
+		return fAdded;
+	}
+
+	bool RayTracer::TraceSample(int _x, int _y, int _sample, ColorPixel& _color, SurfacePixel& _surface, PixelCost* _cost)
+	{
+		float samplingX, samplingY;
+		SamplePosition(_sample, samplingX, samplingY);
+
+		// Create the drawing color
+		_color = backgroundDefault;
+		// Create an empty ray
+		Ray ray;
+		// Cast the ray in the direction of the camera from its position
+		camera.CastRay(_x, _y, ray, samplingX, samplingY);
+
+		bool hit = IntersectScene(ray, _cost);
+		if (_cost != nullptr) ++_cost->samples;
+		if (hit)
+		{
+			_color = Shade(ray);
+			HitInformation hitInfo = ray.GetHitInfo();
+			_surface = { (float)hitInfo.hitNormal.x, (float)hitInfo.hitNormal.y, (float)hitInfo.hitNormal.z, (float)hitInfo.length };
+		}
+		return hit;
+	}
+
+	bool RayTracer::IntersectScene(const SceneView& _scene, Ray& _ray, PixelCost* _cost)
+	{
+		if (_scene.nodeCount == 0) return false;
+
+		rvec3 rO = _ray.GetOrigin(), rD = _ray.GetDirection();
+		if (_scene.walk != nullptr)
+		{
+			// Baked scenes find the hit through their generated walk, the record fills in the hit information
+			real length = _ray.GetLength();
+			unsigned int ref;
+			if (!_scene.walk(rO, rD, length, false, ref)) return false;
+			if (GetRefType(ref) == PrimitiveType::Sphere) return Sphere::IntersectRecord(_scene.spheres[GetRefIndex(ref)], _ray);
+			return Circle::IntersectRecord(_scene.circles[GetRefIndex(ref)], _ray);
+		}
+		rvec3 invD(1 / rD.x, 1 / rD.y, 1 / rD.z);
+
+#if defined(MRT_KERNELS_INTERSECT)
+		// Spheres in a leaf are gathered and tested together through the intersection kernel
+		const IntersectSpheresKernel intersectSpheres = GetKernels().intersectSpheres;
+		SphereBatch batch;
+#endif
+
+		// Nodes waiting to be visited, with the distance the ray enters them
+		struct StackEntry { int node; real near; };
+		StackEntry stack[bvhMaxDepth + 1];
+		int top = 0;
+
+		real near;
+		if (!IntersectBounds(_scene.nodes[0], rO, invD, _ray.GetLength(), near))
+		{
+			if (_cost != nullptr) ++_cost->steps;
+			return false;
+		}
+		stack[top++] = { 0, near };
+
+		// Counted in registers, theyre only written out once at the end
+		int steps = 1, tests = 0;
+		bool hit = false;
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			// A closer hit was found since the node was queued
+			if (entry.near > _ray.GetLength()) continue;
+
+			const BVHNode& node = _scene.nodes[entry.node];
+			if (node.count > 0)
+			{
+				tests += node.count;
+				for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+				{
+					unsigned int ref = _scene.refs[i];
+					switch (GetRefType(ref))
+					{
+#if defined(MRT_KERNELS_INTERSECT)
+					case PrimitiveType::Sphere:
+					{
+						batch.Gather(_scene.spheres[GetRefIndex(ref)], (int)GetRefIndex(ref));
+						if (batch.count == SphereBatch::size) { hit |= batch.Intersect(intersectSpheres, _scene, _ray); batch.count = 0; }
+						break;
+					}
+#else
+					case PrimitiveType::Sphere: { hit |= Sphere::IntersectRecord(_scene.spheres[GetRefIndex(ref)], _ray); break; }
+#endif
+					case PrimitiveType::Circle: { hit |= Circle::IntersectRecord(_scene.circles[GetRefIndex(ref)], _ray); break; }
+					default: { hit |= primiManager[GetRefIndex(ref)]->Intersect(_ray); break; }
+					}
+				}
+#if defined(MRT_KERNELS_INTERSECT)
+				if (batch.count > 0) { hit |= batch.Intersect(intersectSpheres, _scene, _ray); batch.count = 0; }
+#endif
+				continue;
+			}
+
+			// Visit the closer child first so further nodes can be skipped
+			steps += 2;
+			real nearLeft, nearRight;
+			bool hitLeft = IntersectBounds(_scene.nodes[node.leftFirst], rO, invD, _ray.GetLength(), nearLeft);
+			bool hitRight = IntersectBounds(_scene.nodes[node.leftFirst + 1], rO, invD, _ray.GetLength(), nearRight);
+			if (hitLeft && hitRight)
+			{
+				if (nearLeft <= nearRight)
+				{
+					stack[top++] = { node.leftFirst + 1, nearRight };
+					stack[top++] = { node.leftFirst, nearLeft };
+				}
+				else
+				{
+					stack[top++] = { node.leftFirst, nearLeft };
+					stack[top++] = { node.leftFirst + 1, nearRight };
+				}
+			}
+			else if (hitLeft) stack[top++] = { node.leftFirst, nearLeft };
+			else if (hitRight) stack[top++] = { node.leftFirst + 1, nearRight };
+		}
+
+		if (_cost != nullptr)
+		{
+			_cost->steps += (float)steps;
+			_cost->tests += (float)tests;
+		}
+		return hit;
+	}
+
+	unsigned int RayTracer::IntersectPacket(const SceneView& _scene, Ray* _rays, int _count)
+	{
+		if (_scene.nodeCount == 0 || _count <= 0) return 0;
+		_count = glm::min(_count, rayPacketSize);
+
+#if defined(MRT_KERNELS_INTERSECT)
+		const KernelTable& kernels = GetKernels();
+		if (kernels.isa == KernelISA::Scalar || _scene.walk != nullptr)
+#endif
+		{
+			// Without SIMD bounds tests walking the BVH once per packet is slower than once per ray,
+			// baked scenes walk their own code
+			unsigned int hits = 0;
+			for (int r = 0; r < _count; ++r)
+			{
+				if (IntersectScene(_scene, _rays[r], nullptr)) hits |= 1u << r;
+			}
+			return hits;
+		}
+
+#if defined(MRT_KERNELS_INTERSECT)
+		// Every ray of the packet is tested against a node at once through the bounds kernel,
+		// unused rays are given a length of -1 so they never enter a node
+		RayPacket packet;
+		for (int r = 0; r < rayPacketSize; ++r)
+		{
+			rvec3 rO = _rays[glm::min(r, _count - 1)].GetOrigin(), rD = _rays[glm::min(r, _count - 1)].GetDirection();
+			packet.originX[r] = rO.x; packet.originY[r] = rO.y; packet.originZ[r] = rO.z;
+			packet.inverseX[r] = 1 / rD.x; packet.inverseY[r] = 1 / rD.y; packet.inverseZ[r] = 1 / rD.z;
+			packet.length[r] = r < _count ? _rays[r].GetLength() : -1;
+		}
+
+		// Get the rays of the packet that enter a node
+		// _near is set to the closest distance any of them enter it
+		auto enterNode = [&](int _node, unsigned int _active, real& _near)
+		{
+			const BVHNode& node = _scene.nodes[_node];
+			float nears[rayPacketSize];
+			unsigned int entered = kernels.intersectBounds(packet, &node.boundsMin.x, &node.boundsMax.x, nears) & _active;
+			_near = FLT_MAX;
+			for (int r = 0; r < _count; ++r)
+			{
+				if ((entered & (1u << r)) != 0) _near = glm::min(_near, nears[r]);
+			}
+			return entered;
+		};
+
+		// Nodes waiting to be visited, with the rays that entered them
+		struct StackEntry { int node; unsigned int active; };
+		StackEntry stack[bvhMaxDepth + 1];
+		int top = 0;
+
+		real near;
+		unsigned int active = enterNode(0, (1u << _count) - 1, near);
+		if (active == 0) return 0;
+		stack[top++] = { 0, active };
+
+		SphereBatch batch;
+		unsigned int hits = 0;
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			const BVHNode& node = _scene.nodes[entry.node];
+			if (node.count > 0)
+			{
+				// Drop the rays that found a closer hit since the leaf was queued
+				entry.active = enterNode(entry.node, entry.active, near);
+				if (entry.active == 0) continue;
+
+				// Spheres are gathered once and tested against every ray, split into the same batches
+				// IntersectScene uses so every ray gets the same hit it would on its own
+				for (int first = node.leftFirst, end = node.leftFirst + node.count; first < end;)
+				{
+					int last = first;
+					batch.count = 0;
+					for (; last < end && batch.count < SphereBatch::size; ++last)
+					{
+						unsigned int ref = _scene.refs[last];
+						if (GetRefType(ref) == PrimitiveType::Sphere) batch.Gather(_scene.spheres[GetRefIndex(ref)], (int)GetRefIndex(ref));
+					}
+
+					for (int r = 0; r < _count; ++r)
+					{
+						if ((entry.active & (1u << r)) == 0) continue;
+						bool hit = false;
+						for (int i = first; i < last; ++i)
+						{
+							unsigned int ref = _scene.refs[i];
+							switch (GetRefType(ref))
+							{
+							case PrimitiveType::Sphere: { break; }
+							case PrimitiveType::Circle: { hit |= Circle::IntersectRecord(_scene.circles[GetRefIndex(ref)], _rays[r]); break; }
+							default: { hit |= primiManager[GetRefIndex(ref)]->Intersect(_rays[r]); break; }
+							}
+						}
+						if (batch.count > 0) hit |= batch.Intersect(kernels.intersectSpheres, _scene, _rays[r]);
+						if (hit)
+						{
+							hits |= 1u << r;
+							packet.length[r] = _rays[r].GetLength();
+						}
+					}
+					first = last;
+				}
+				continue;
+			}
+
+			// Visit the child the packet reaches first first, like IntersectScene
+			real nearLeft, nearRight;
+			unsigned int activeLeft = enterNode(node.leftFirst, entry.active, nearLeft);
+			unsigned int activeRight = enterNode(node.leftFirst + 1, entry.active, nearRight);
+			if (activeLeft != 0 && activeRight != 0)
+			{
+				if (nearLeft <= nearRight)
+				{
+					stack[top++] = { node.leftFirst + 1, activeRight };
+					stack[top++] = { node.leftFirst, activeLeft };
+				}
+				else
+				{
+					stack[top++] = { node.leftFirst, activeLeft };
+					stack[top++] = { node.leftFirst + 1, activeRight };
+				}
+			}
+			else if (activeLeft != 0) stack[top++] = { node.leftFirst, activeLeft };
+			else if (activeRight != 0) stack[top++] = { node.leftFirst + 1, activeRight };
+		}
+		return hits;
+#endif
+	}
+
+	bool RayTracer::QueryScene(const rvec3& _origin, const rvec3& _direction, real& _length, bool _fAnyHit, unsigned int& _ref)
+	{
+		const SceneView& view = scene;
+		if (view.nodeCount == 0) return false;
+		if (view.walk != nullptr) return view.walk(_origin, _direction, _length, _fAnyHit, _ref);
+
+		const rvec3 invD(1 / _direction.x, 1 / _direction.y, 1 / _direction.z);
+#if defined(MRT_KERNELS_INTERSECT)
+		const IntersectSpheresKernel intersectSpheres = GetKernels().intersectSpheres;
+		SphereBatch batch;
+#endif
+
+		// Walked like IntersectScene, so queries find the same hits as renders
+		struct StackEntry { int node; real near; };
+		StackEntry stack[bvhMaxDepth + 1];
+		int top = 0;
+
+		real near;
+		if (!IntersectBounds(view.nodes[0], _origin, invD, _length, near)) return false;
+		stack[top++] = { 0, near };
+
+		bool hit = false;
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			if (entry.near > _length) continue;
+
+			const BVHNode& node = view.nodes[entry.node];
+			if (node.count > 0)
+			{
+				for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+				{
+					unsigned int ref = view.refs[i];
+					bool hitRef = false;
+					switch (GetRefType(ref))
+					{
+					case PrimitiveType::Sphere:
+					{
+#if defined(MRT_KERNELS_INTERSECT)
+						batch.Gather(view.spheres[GetRefIndex(ref)], (int)GetRefIndex(ref));
+						if (batch.count < SphereBatch::size) continue;
+						int record;
+						hitRef = batch.IntersectLength(intersectSpheres, view, _origin, _direction, _length, record);
+						if (hitRef) ref = MakePrimitiveRef(PrimitiveType::Sphere, (unsigned int)record);
+						batch.count = 0;
+#else
+						hitRef = Sphere::IntersectRecordLength(view.spheres[GetRefIndex(ref)], _origin, _direction, _length);
+#endif
+						break;
+					}
+					case PrimitiveType::Circle: { hitRef = Circle::IntersectRecordLength(view.circles[GetRefIndex(ref)], _origin, _direction, _length); break; }
+					default:
+					{
+						// Objects without a record need a full ray
+						Ray ray(_origin, _direction);
+						HitInformation info;
+						info.length = _length;
+						ray.SetHitInfo(info);
+						hitRef = primiManager[GetRefIndex(ref)]->Intersect(ray);
+						if (hitRef) _length = ray.GetLength();
+						break;
+					}
+					}
+					if (!hitRef) continue;
+					hit = true;
+					_ref = ref;
+					if (_fAnyHit) return true;
+				}
+#if defined(MRT_KERNELS_INTERSECT)
+				if (batch.count > 0)
+				{
+					int record;
+					if (batch.IntersectLength(intersectSpheres, view, _origin, _direction, _length, record))
+					{
+						hit = true;
+						_ref = MakePrimitiveRef(PrimitiveType::Sphere, (unsigned int)record);
+						if (_fAnyHit) return true;
+					}
+					batch.count = 0;
+				}
+#endif
+				continue;
+			}
+
+			real nearLeft, nearRight;
+			bool hitLeft = IntersectBounds(view.nodes[node.leftFirst], _origin, invD, _length, nearLeft);
+			bool hitRight = IntersectBounds(view.nodes[node.leftFirst + 1], _origin, invD, _length, nearRight);
+			if (hitLeft && hitRight)
+			{
+				if (nearLeft <= nearRight)
+				{
+					stack[top++] = { node.leftFirst + 1, nearRight };
+					stack[top++] = { node.leftFirst, nearLeft };
+				}
+				else
+				{
+					stack[top++] = { node.leftFirst, nearLeft };
+					stack[top++] = { node.leftFirst + 1, nearRight };
+				}
+			}
+			else if (hitLeft) stack[top++] = { node.leftFirst, nearLeft };
+			else if (hitRight) stack[top++] = { node.leftFirst + 1, nearRight };
+		}
+		return hit;
+	}
+
+	int RayTracer::GetRefPrimitive(unsigned int _ref)
+	{
+		const int index = (int)GetRefIndex(_ref);
+		switch (GetRefType(_ref))
+		{
+		// Mapped snapshots and baked scenes have no objects, ids follow the order UnmapSnapshot gives them
+		case PrimitiveType::Sphere: return (snapshot.IsOpen() || fBakedScene) ? index : sphereOwners[index];
+		case PrimitiveType::Circle: return (snapshot.IsOpen() || fBakedScene) ? scene.sphereCount + index : circleOwners[index];
+		default: return index;
+		}
+	}
+
+	bool RayTracer::QueryRays(const RayBatch& _batch, bool _fAnyHit)
+	{
+		if (!fInitialised || streamed.IsOpen() || _batch.count <= 0 ||
+			_batch.origins == nullptr || _batch.directions == nullptr || _batch.distances == nullptr) return false;
+
+		// Queries only read the scene, a background render is left running unless the scene
+		// has to be built or a finished rebuild swapped in first
+		if (fSceneDirty || fLightsDirty || (fRebuilding && fRebuildDone))
+		{
+			CancelRender();
+			PrepareScene();
+		}
+
+		const int blocks = (_batch.count + queryBlockSize - 1) / queryBlockSize;
+		ParallelFor(blocks, [&](int _block)
+		{
+			const int end = glm::min(_batch.count, (_block + 1) * queryBlockSize);
+			for (int r = _block * queryBlockSize; r < end; ++r)
+			{
+				const rvec3& origin = _batch.origins[r];
+				const rvec3& direction = _batch.directions[r];
+				real length = _batch.maxDistances != nullptr ? _batch.maxDistances[r] : (real)FLT_MAX;
+				unsigned int ref;
+				if (!QueryScene(origin, direction, length, _fAnyHit, ref))
+				{
+					_batch.distances[r] = -1;
+					if (_batch.primitives != nullptr) _batch.primitives[r] = -1;
+					continue;
+				}
+
+				_batch.distances[r] = length;
+				if (_batch.primitives != nullptr) _batch.primitives[r] = GetRefPrimitive(ref);
+				if (_fAnyHit || _batch.normals == nullptr) continue;
+
+				// Only the closest hit needs a normal
+				const unsigned int index = GetRefIndex(ref);
+				switch (GetRefType(ref))
+				{
+				case PrimitiveType::Sphere: { _batch.normals[r] = NormalizeFast((origin + direction * length) - scene.spheres[index].position); break; }
+				case PrimitiveType::Circle: { _batch.normals[r] = -glm::normalize(scene.circles[index].direction); break; }
+				default:
+				{
+					// Traced again with a little slack so the object is hit at the same distance
+					Ray ray(origin, direction);
+					HitInformation info;
+					info.length = length * (1 + (real)1e-4f);
+					ray.SetHitInfo(info);
+					if (primiManager[index]->Intersect(ray)) _batch.normals[r] = ray.GetHitInfo().hitNormal;
+					break;
+				}
+				}
+			}
+		});
+		return true;
+	}
+
+	void RayTracer::TracePixel(int _x, int _y)
+	{
+		ColorPixel pixelColor;
+		SurfacePixel surface;
+		int hits = 0;
+		PixelCost cost;
+		PixelCost* costTarget = fCostTracking ? &cost : nullptr;
+		const long long start = fCostTracking ? GetNanoseconds() : 0;
+
+		for (int s = 0; s < samplesPerPixel; ++s)
+		{
+			ColorPixel sampleColor;
+			SurfacePixel sampleSurface;
+			bool hit = TraceSample(_x, _y, s, sampleColor, sampleSurface, costTarget);
+
+			pixelColor.r += sampleColor.r; pixelColor.g += sampleColor.g; pixelColor.b += sampleColor.b;
+
+			// Only samples that hit an object add to the surface guides
+			if (hit)
+			{
+				surface.nx += sampleSurface.nx; surface.ny += sampleSurface.ny; surface.nz += sampleSurface.nz;
+				surface.depth += sampleSurface.depth;
+				++hits;
+			}
+		}
+
+		// Average all samples
+		float invSamples = 1.f / samplesPerPixel;
+		camera.DrawToPlane(_x, _y, { pixelColor.r * invSamples, pixelColor.g * invSamples, pixelColor.b * invSamples });
+		if (hits > 0)
+		{
+			float invHits = 1.f / hits;
+			surface = { surface.nx * invHits, surface.ny * invHits, surface.nz * invHits, surface.depth * invHits };
+		}
+		camera.DrawToSurfacePlane(_x, _y, surface);
+
+		if (fCostTracking)
+		{
+			cost.nanoseconds = (float)(GetNanoseconds() - start);
+			camera.costPlane[(_y * screenW) + _x] = cost;
+		}
+	}
+
+	bool RayTracer::TraceStreamed(const std::atomic<bool>* _cancel)
+	{
+		const int pixels = screenW * screenH;
+		const int chunkCount = streamed.GetChunkCount();
+		streamRays.resize(pixels);
+		streamRayHits.resize(pixels);
+		streamQueues.resize(chunkCount);
+		streamNearest.resize(chunkCount);
+		streamColors.assign(pixels, ColorPixel());
+		streamSurfaces.assign(pixels, SurfacePixel());
+		streamHits.assign(pixels, 0);
+		if (fCostTracking)
+		{
+			for (int i = 0; i < pixels; ++i)
+				camera.costPlane[i] = PixelCost();
+		}
+
+		bool complete = true;
+		for (int s = 0; s < samplesPerPixel; ++s)
+		{
+			float samplingX, samplingY;
+			SamplePosition(s, samplingX, samplingY);
+
+			// Cast every ray of the sample, a row at a time
+			ParallelFor(screenH, [&](int _y)
+			{
+				TimelineScope scope("Cast rays", _y);
+				camera.CastRow(_y, 0, screenW, streamRays.data() + (_y * screenW), samplingX, samplingY);
+				std::fill(streamRayHits.begin() + (_y * screenW), streamRayHits.begin() + ((_y + 1) * screenW), (unsigned char)0);
+			});
+
+			// Queue each ray on every chunk it reaches
+			streamOrder.clear();
+			for (int c = 0; c < chunkCount; ++c)
+			{
+				streamQueues[c].clear();
+				streamNearest[c] = FLT_MAX;
+			}
+			for (int i = 0; i < pixels; ++i)
+			{
+				Ray& ray = streamRays[i];
+				streamed.GatherChunks(ray.GetOrigin(), ray.GetDirection(), ray.GetLength(), [&](int _chunk, real _near)
+				{
+					if (streamQueues[_chunk].empty()) streamOrder.push_back(_chunk);
+					streamQueues[_chunk].push_back({ i, _near });
+					streamNearest[_chunk] = glm::min(streamNearest[_chunk], _near);
+				});
+			}
+
+			// Mapped chunks cost nothing, then nearer chunks hide the ones behind them
+			std::sort(streamOrder.begin(), streamOrder.end(), [&](int _a, int _b)
+			{
+				bool residentA = streamed.IsResident(_a), residentB = streamed.IsResident(_b);
+				if (residentA != residentB) return residentA;
+				return streamNearest[_a] < streamNearest[_b];
+			});
+
+			for (int chunk : streamOrder)
+			{
+				if (_cancel != nullptr && *_cancel) return false;
+
+				// Rays that hit something in front of the chunk cant hit anything in it
+				std::vector<StreamEntry>& queue = streamQueues[chunk];
+				queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const StreamEntry& _entry)
+				{
+					return _entry.near > streamRays[_entry.ray].GetLength();
+				}), queue.end());
+				if (queue.empty()) continue;
+
+				const SceneView* chunkScene = streamed.Acquire(chunk);
+				if (chunkScene == nullptr)
+				{
+					complete = false;
+					continue;
+				}
+
+				// Each ray is queued once per chunk, so blocks never share a ray (or pixel)
+				const int blocks = ((int)queue.size() + streamBlockSize - 1) / streamBlockSize;
+				ParallelFor(blocks, [&](int _block)
+				{
+					TimelineScope scope("Trace chunk", chunk);
+					const int first = _block * streamBlockSize;
+					const int end = glm::min((int)queue.size(), first + streamBlockSize);
+					const long long start = fCostTracking ? GetNanoseconds() : 0;
+					for (int q = first; q < end; ++q)
+					{
+						const int ray = queue[q].ray;
+						if (IntersectScene(*chunkScene, streamRays[ray], fCostTracking ? &camera.costPlane[ray] : nullptr)) streamRayHits[ray] = 1;
+					}
+
+					// Rays are traced together, so the block time is shared out evenly
+					if (!fCostTracking) return;
+					const float share = (float)(GetNanoseconds() - start) / (end - first);
+					for (int q = first; q < end; ++q)
+						camera.costPlane[queue[q].ray].nanoseconds += share;
+				});
+			}
+
+			// Shade the closest hits and add them to the pixel sums
+			ParallelFor(screenH, [&](int _y)
+			{
+				TimelineScope scope("Shade", _y);
+				for (int x = 0; x < screenW; ++x)
+				{
+					const int i = (_y * screenW) + x;
+					const long long start = fCostTracking ? GetNanoseconds() : 0;
+					ColorPixel color = backgroundDefault;
+					if (streamRayHits[i])
+					{
+						color = Shade(streamRays[i]);
+						HitInformation hitInfo = streamRays[i].GetHitInfo();
+						SurfacePixel& surface = streamSurfaces[i];
+						surface.nx += (float)hitInfo.hitNormal.x; surface.ny += (float)hitInfo.hitNormal.y; surface.nz += (float)hitInfo.hitNormal.z;
+						surface.depth += (float)hitInfo.length;
+						++streamHits[i];
+					}
+					ColorPixel& sum = streamColors[i];
+					sum.r += color.r; sum.g += color.g; sum.b += color.b;
+
+					if (fCostTracking)
+					{
+						++camera.costPlane[i].samples;
+						camera.costPlane[i].nanoseconds += (float)(GetNanoseconds() - start);
+					}
+				}
+			});
+		}
+
+		ResolveSampleSums();
+		return complete;
+	}
+
+	bool RayTracer::PrepareVisibility()
+	{
+		if (!fRasterVisibility || fCostTracking || streamed.IsOpen()) return false;
+		return visibility.Prepare(scene, camera, screenW, screenH);
+	}
+
+	bool RayTracer::TraceRasterized(const std::atomic<bool>* _cancel)
+	{
+		const int pixels = screenW * screenH;
+		streamColors.assign(pixels, ColorPixel());
+		streamSurfaces.assign(pixels, SurfacePixel());
+		streamHits.assign(pixels, 0);
+
+		for (int s = 0; s < samplesPerPixel; ++s)
+		{
+			if (_cancel != nullptr && *_cancel) return false;
+
+			float samplingX, samplingY;
+			SamplePosition(s, samplingX, samplingY);
+			visibility.Resolve(scene, camera, samplingX, samplingY);
+
+			// Shade the closest hits and add them to the pixel sums, the record fills in the hit information
+			ParallelFor(screenH, [&](int _y)
+			{
+				TimelineScope scope("Shade", _y);
+				for (int x = 0; x < screenW; ++x)
+				{
+					const int i = (_y * screenW) + x;
+					const unsigned int ref = visibility.GetObject(i);
+					Ray& ray = visibility.GetRay(i);
+					bool hit = false;
+					switch (GetRefType(ref))
+					{
+					case PrimitiveType::Sphere: { hit = Sphere::IntersectRecord(scene.spheres[GetRefIndex(ref)], ray); break; }
+					case PrimitiveType::Circle: { hit = Circle::IntersectRecord(scene.circles[GetRefIndex(ref)], ray); break; }
+					default: break;
+					}
+
+					ColorPixel color = backgroundDefault;
+					if (hit)
+					{
+						color = Shade(ray);
+						HitInformation hitInfo = ray.GetHitInfo();
+						SurfacePixel& surface = streamSurfaces[i];
+						surface.nx += (float)hitInfo.hitNormal.x; surface.ny += (float)hitInfo.hitNormal.y; surface.nz += (float)hitInfo.hitNormal.z;
+						surface.depth += (float)hitInfo.length;
+						++streamHits[i];
+					}
+					ColorPixel& sum = streamColors[i];
+					sum.r += color.r; sum.g += color.g; sum.b += color.b;
+				}
+			});
+		}
+
+		ResolveSampleSums();
+		return true;
+	}
+
+	void RayTracer::ResolveSampleSums()
+	{
+		// Average all samples, the same as TracePixel
+		const float invSamples = 1.f / samplesPerPixel;
+		for (int y = 0; y < screenH; ++y)
+		{
+			for (int x = 0; x < screenW; ++x)
+			{
+				const int i = (y * screenW) + x;
+				const ColorPixel& sum = streamColors[i];
+				camera.DrawToPlane(x, y, { sum.r * invSamples, sum.g * invSamples, sum.b * invSamples });
+
+				SurfacePixel surface = streamSurfaces[i];
+				if (streamHits[i] > 0)
+				{
+					float invHits = 1.f / streamHits[i];
+					surface = { surface.nx * invHits, surface.ny * invHits, surface.nz * invHits, surface.depth * invHits };
+				}
+				camera.DrawToSurfacePlane(x, y, surface);
+			}
+		}
+	}
+
+	bool RayTracer::RenderStreamedFrame()
+	{
+		// The last streamed image is still up to date
+		if (!fProgressiveReset && !fProgressiveReplaced && progress.complete)
+		{
+			camera.DisplayPlane();
+			return true;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		MCG::SetBackground({ backgroundDefault.r, backgroundDefault.g, backgroundDefault.b });
+		TraceStreamed(nullptr);
+		if (fDenoise) denoiser.Apply(camera.imagePlane, camera.surfacePlane, screenW, screenH);
+
+		// Report the frame as every pass done at once
+		progress = RenderProgress();
+		progress.passes = progress.pass = progressiveLevels + samplesPerPixel - 1;
+		progress.samplesCompleted = samplesPerPixel;
+		progress.completion = 1.f;
+		progress.complete = true;
+		progress.elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		progressiveTraces = (long long)screenW * screenH * samplesPerPixel;
+		fProgressiveReset = false;
+		fProgressiveReplaced = false;
+
+		camera.DisplayPlane();
+		return true;
+	}
+
+	void RayTracer::TraceProgressiveRow()
+	{
+		const int y = progressiveRow;
+		TimelineScope scope("Trace row", y);
+		// Resolution passes trace every step-th pixel, sample passes trace every pixel
+		const bool levelPass = progress.pass < progressiveLevels;
+		const int step = levelPass ? 1 << (progressiveLevels - 1 - progress.pass) : 1;
+		// Pixels on the previous (coarser) grid have already been traced
+		const bool skipCoarse = levelPass && progress.pass > 0 && (y % (step * 2)) == 0;
+		const int sample = levelPass ? 0 : progress.pass - progressiveLevels + 1;
+
+		for (int x = 0; x < screenW; x += step)
+		{
+			if (skipCoarse && (x % (step * 2)) == 0) continue;
+
+			ColorPixel color;
+			SurfacePixel surface;
+			int index = (y * screenW) + x;
+			if (fCostTracking)
+			{
+				// Costs add up over passes like the colors
+				PixelCost& cost = camera.costPlane[index];
+				const long long start = GetNanoseconds();
+				TraceSample(x, y, sample, color, surface, &cost);
+				cost.nanoseconds += (float)(GetNanoseconds() - start);
+			}
+			else TraceSample(x, y, sample, color, surface);
+			++progressiveTraces;
+
+			// Add the sample to the pixels running average
+			ColorPixel& sum = camera.accumulationPlane[index];
+			sum.r += color.r; sum.g += color.g; sum.b += color.b;
+			float invCount = 1.f / ++camera.samplePlane[index];
+			ColorPixel average{ sum.r * invCount, sum.g * invCount, sum.b * invCount };
+
+			// The first sample sets the surface guides
+			if (sample == 0) camera.surfacePlane[index] = surface;
+
+			// Coarse pixels cover their whole block until finer passes replace them
+			for (int by = y; by < y + step; ++by)
+				for (int bx = x; bx < x + step; ++bx)
+					camera.DrawToPlane(bx, by, average);
+		}
+	}
+
+	void RayTracer::SetBackgroundColor(ColorPixel _color)
+	{
+		CancelRender();
+		backgroundDefault = _color;
+		fProgressiveReset = true;
+	}
+
+	void RayTracer::SetSamples(int _samples)
+	{
+		CancelRender();
+		samplesPerPixel = glm::max(1, glm::min(64, _samples));
+		fProgressiveReset = true;
+	}
+
+	bool RayTracer::GrowPrimitives()
+	{
+		// Double the capacity, keeps adding objects amortised O(1)
+		int newMax = primiMax * 2;
+		Primitive** newManager = new Primitive * [newMax];
+		if (newManager == nullptr) return false;
+
+		for (int i = 0; i < primiAmount; ++i)
+		{
+			newManager[i] = primiManager[i];
+		}
+
+		delete[] primiManager;
+		primiManager = newManager;
+		primiMax = newMax;
+		return true;
+	}
+
+	void RayTracer::PrepareScene()
+	{
+		if (fLightsDirty)
+		{
+			TimelineScope scope("Build light tree");
+			lightTree.Build(lights);
+			fLightsDirty = false;
+		}
+
+		// Swap in a finished background rebuild, a full build replaces it anyway
+		if (!fSceneDirty) FinishRebuild();
+
+		// Mapped snapshots come with their BVH already built
+		if (!fSceneDirty || snapshot.IsOpen()) return;
+		TimelineScope scope("Build scene");
+		StopRebuild();
+
+		// Copy every object into the flat arrays, objects without a record are reached through the manager
+		sceneSpheres.clear();
+		sceneCircles.clear();
+		sphereOwners.clear();
+		circleOwners.clear();
+		sceneBuildItems.resize(primiAmount);
+		for (int i = 0; i < primiAmount; ++i)
+		{
+			BVHBuildItem& item = sceneBuildItems[i];
+			switch (primiManager[i]->GetType())
+			{
+			case PrimitiveType::Sphere:
+			{
+				item.ref = MakePrimitiveRef(PrimitiveType::Sphere, (unsigned int)sceneSpheres.size());
+				sceneSpheres.push_back(static_cast<Sphere*>(primiManager[i])->GetRecord());
+				sphereOwners.push_back(i);
+				Sphere::GetRecordBounds(sceneSpheres.back(), item.boundsMin, item.boundsMax);
+				break;
+			}
+			case PrimitiveType::Circle:
+			{
+				item.ref = MakePrimitiveRef(PrimitiveType::Circle, (unsigned int)sceneCircles.size());
+				sceneCircles.push_back(static_cast<Circle*>(primiManager[i])->GetRecord());
+				circleOwners.push_back(i);
+				Circle::GetRecordBounds(sceneCircles.back(), item.boundsMin, item.boundsMax);
+				break;
+			}
+			default:
+			{
+				item.ref = MakePrimitiveRef(PrimitiveType::Generic, (unsigned int)i);
+				primiManager[i]->GetBounds(item.boundsMin, item.boundsMax);
+				break;
+			}
+			}
+		}
+
+		BuildBVH(sceneBuildItems, sceneNodes, sceneRefs);
+		IndexScene();
+		UpdateSceneView();
+		fSceneDirty = false;
+	}
+
+	void RayTracer::IndexScene()
+	{
+		GetBVHParents(sceneNodes, sceneParents);
+
+		// Find the leaf of every reference
+		sceneRefLeaves.resize(sceneRefs.size());
+		for (int n = 0; n < (int)sceneNodes.size(); ++n)
+		{
+			const BVHNode& node = sceneNodes[n];
+			for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+				sceneRefLeaves[i] = n;
+		}
+
+		// Find the reference of every object
+		primiSlots.assign(primiAmount, -1);
+		for (int i = 0; i < (int)sceneRefs.size(); ++i)
+		{
+			const unsigned int index = GetRefIndex(sceneRefs[i]);
+			switch (GetRefType(sceneRefs[i]))
+			{
+			case PrimitiveType::Sphere: primiSlots[sphereOwners[index]] = i; break;
+			case PrimitiveType::Circle: primiSlots[circleOwners[index]] = i; break;
+			default: primiSlots[index] = i; break;
+			}
+		}
+
+		// Remember how good the fresh tree is, refitting is measured against it
+		sceneCost = GetBVHCost(sceneNodes);
+		const real rootArea = sceneNodes.empty() ? 0 : GetNodeArea(sceneNodes[0]);
+		sceneBuildQuality = rootArea > 0 ? sceneCost / rootArea : 0;
+	}
+
+	void RayTracer::UpdateSceneView()
+	{
+		scene.spheres = sceneSpheres.data();
+		scene.circles = sceneCircles.data();
+		scene.nodes = sceneNodes.data();
+		scene.refs = sceneRefs.data();
+		scene.sphereCount = (int)sceneSpheres.size();
+		scene.circleCount = (int)sceneCircles.size();
+		scene.nodeCount = (int)sceneNodes.size();
+		scene.refCount = (int)sceneRefs.size();
+	}
+
+	void RayTracer::RefitPrimitive(int _id)
+	{
+		const int slot = primiSlots[_id];
+		if (slot < 0) return;
+
+		BVHBuildItem& item = sceneBuildItems[slot];
+		const unsigned int index = GetRefIndex(item.ref);
+		switch (GetRefType(item.ref))
+		{
+		case PrimitiveType::Sphere:
+		{
+			sceneSpheres[index] = static_cast<Sphere*>(primiManager[_id])->GetRecord();
+			Sphere::GetRecordBounds(sceneSpheres[index], item.boundsMin, item.boundsMax);
+			break;
+		}
+		case PrimitiveType::Circle:
+		{
+			sceneCircles[index] = static_cast<Circle*>(primiManager[_id])->GetRecord();
+			Circle::GetRecordBounds(sceneCircles[index], item.boundsMin, item.boundsMax);
+			break;
+		}
+		default:
+		{
+			primiManager[_id]->GetBounds(item.boundsMin, item.boundsMax);
+			break;
+		}
+		}
+
+		sceneCost += RefitBVH(sceneNodes, sceneParents, sceneBuildItems, sceneRefLeaves[slot]);
+	}
+
+	void RayTracer::StartRebuild()
+	{
+		// The worker builds from a copy, so the refit tree can still be traced and refit
+		rebuildItems = sceneBuildItems;
+		rebuildChanged.clear();
+		fRebuildDone = false;
+		fRebuilding = true;
+		rebuildWorker = std::thread([this]()
+		{
+			TimelineScope scope("Rebuild BVH");
+			BuildBVH(rebuildItems, rebuildNodes, rebuildRefs);
+			fRebuildDone = true;
+		});
+	}
+
+	void RayTracer::FinishRebuild()
+	{
+		if (!fRebuilding || !fRebuildDone) return;
+		rebuildWorker.join();
+		fRebuilding = false;
+
+		sceneBuildItems.swap(rebuildItems);
+		sceneNodes.swap(rebuildNodes);
+		sceneRefs.swap(rebuildRefs);
+		IndexScene();
+
+		// Objects changed during the rebuild were built with their old bounds
+		for (int id : rebuildChanged) RefitPrimitive(id);
+		rebuildChanged.clear();
+
+		UpdateSceneView();
+	}
+
+	void RayTracer::StopRebuild()
+	{
+		if (rebuildWorker.joinable()) rebuildWorker.join();
+		fRebuilding = false;
+		fRebuildDone = false;
+		rebuildChanged.clear();
+	}
+
+	bool RayTracer::StorePrimitive(Primitive* _object)
+	{
+		// Grow the manager once its full
+		if (primiAmount >= primiMax && !GrowPrimitives()) return false;
+
+		primiManager[primiAmount] = _object;
+		++primiAmount;
+		return true;
+	}
+
+	void RayTracer::UnmapSnapshot()
+	{
+		if (!snapshot.IsOpen() && !fBakedScene) return;
+
+		for (int i = 0; i < scene.sphereCount; ++i)
+		{
+			const SphereRecord& record = scene.spheres[i];
+			Sphere* sphere = new Sphere(record.position, record.radius, record.color);
+			sphere->SetTexture(record.texture);
+			StorePrimitive(sphere);
+		}
+		for (int i = 0; i < scene.circleCount; ++i)
+		{
+			const CircleRecord& record = scene.circles[i];
+			Circle* circle = new Circle(record.position, record.direction, record.radius, record.color);
+			circle->SetTexture(record.texture);
+			StorePrimitive(circle);
+		}
+
+		scene = SceneView();
+		snapshot.Close();
+		fBakedScene = false;
+		fSceneDirty = true;
+	}
+
+	int RayTracer::AddPrimitive(Primitive* _object)
+	{
+		if (!fInitialised || _object == nullptr || streamed.IsOpen()) return -1;
+		CancelRender();
+		UnmapSnapshot();
+
+		// The BVH is built once before the next render, so adding many is cheap
+		if (!StorePrimitive(_object)) return -1;
+
+		fSceneDirty = true;
+		occlusionCache.Clear();
+		fProgressiveReset = true;
+		return primiAmount - 1;
+	}
+
+	bool RayTracer::MovePrimitive(int _id, rvec3 _position)
+	{
+		if (!fInitialised) return false;
+		CancelRender();
+		UnmapSnapshot();
+
+		Primitive* object = GetPrimitive(_id);
+		if (object == nullptr) return false;
+		object->SetPosition(_position);
+		return UpdatePrimitive(_id);
+	}
+
+	bool RayTracer::AddDistanceFieldPart(int _id, const SDFPart& _part)
+	{
+		if (!fInitialised) return false;
+		// Adding a part frees the bricks and parts a running render may be reading
+		CancelRender();
+		UnmapSnapshot();
+
+		DistanceField* field = dynamic_cast<DistanceField*>(GetPrimitive(_id));
+		if (field == nullptr) return false;
+		field->AddPart(_part);
+		return UpdatePrimitive(_id);
+	}
+
+	bool RayTracer::UpdatePrimitive(int _id)
+	{
+		if (!fInitialised) return false;
+		CancelRender();
+		UnmapSnapshot();
+		if (GetPrimitive(_id) == nullptr) return false;
+		occlusionCache.Clear();
+		fProgressiveReset = true;
+
+		// A full build is already waiting for the next render
+		if (fSceneDirty) return true;
+
+		RefitPrimitive(_id);
+
+		// The rebuild started from the old bounds, refit again once its swapped in
+		if (fRebuilding)
+		{
+			rebuildChanged.push_back(_id);
+			return true;
+		}
+
+		// Rebuild once the refit tree is too much worse than a fresh one
+		const real rootArea = GetNodeArea(sceneNodes[0]);
+		if (rootArea > 0 && sceneCost / rootArea > sceneBuildQuality * rebuildThreshold) StartRebuild();
+		return true;
+	}
+
+	void RayTracer::ClearPrimitives()
+	{
+		CancelRender();
+		StopRebuild();
+
+		// Free all elements from array
+		for (int i = 0; i < primiAmount; ++i)
+		{
+			delete primiManager[i];
+			primiManager[i] = nullptr;
+		}
+		// Set amount to none
+		primiAmount = 0;
+
+		scene = SceneView();
+		snapshot.Close();
+		fBakedScene = false;
+		streamed.Close();
+		fSceneDirty = true;
+		occlusionCache.Clear();
+
+		lights.clear();
+		fLightsDirty = true;
+		fProgressiveReset = true;
+	}
+
+	int RayTracer::AddLight(rvec3 _position, ColorPixel _emission, real _radius)
+	{
+		if (!fInitialised) return -1;
+		CancelRender();
+
+		LightRecord light;
+		light.position = _position;
+		light.radius = glm::max((real)0, _radius);
+		light.emission = _emission;
+		lights.push_back(light);
+
+		// The tree is built once before the next render
+		fLightsDirty = true;
+		fProgressiveReset = true;
+		return (int)lights.size() - 1;
+	}
+
+	void RayTracer::ClearLights()
+	{
+		CancelRender();
+		lights.clear();
+		fLightsDirty = true;
+		fProgressiveReset = true;
+	}
+
+	void RayTracer::SetLightSamples(int _samples)
+	{
+		CancelRender();
+		lightSamples = glm::max(1, glm::min(16, _samples));
+		fProgressiveReset = true;
+	}
+
+	void RayTracer::SetHeadlight(float _strength)
+	{
+		CancelRender();
+		headlight = glm::max(0.f, _strength);
+		fProgressiveReset = true;
+	}
+
+	void RayTracer::SetOcclusion(real _distance, int _samples)
+	{
+		CancelRender();
+		occlusionDistance = glm::max((real)0, _distance);
+		occlusionSamples = glm::max(4, glm::min(256, _samples));
+		// Records traced with other settings cant be reused
+		if (occlusionDistance > 0) occlusionCache.Reset(occlusionDistance);
+		else occlusionCache.Release();
+		fProgressiveReset = true;
+	}
+
+	void RayTracer::SetTileCache(bool _enabled, int _budgetMB, const std::string& _spillPath)
+	{
+		CancelRender();
+		fTileCache = _enabled;
+		tileCache.SetBudget((size_t)glm::max(0, _budgetMB) << 20);
+		tileCache.SetSpillPath(_spillPath);
+		if (!_enabled) tileCache.Clear();
+	}
+
+	int RayTracer::LoadTexture(const char* _path)
+	{
+		if (!fInitialised) return -1;
+		CancelRender();
+
+		Texture texture;
+		if (!texture.Load(_path)) return -1;
+		textures.push_back(std::move(texture));
+
+		// Cached tiles are keyed with the file contents, not the path
+		ContentHash hash;
+		hash.AddValue(textureKey);
+		HashFile(_path, hash);
+		textureKey = hash.value;
+
+		fProgressiveReset = true;
+		return (int)textures.size() - 1;
+	}
+
+	SnapshotCamera RayTracer::GetCameraState()
+	{
+		SnapshotCamera state;
+		state.position = camera.position;
+		std::memcpy(state.camRotation, &camera.camRotation[0][0], sizeof(state.camRotation));
+		state.fov = camera.fov;
+		state.maxViewingDistance = camera.maxViewingDistance;
+		state.background = backgroundDefault;
+		return state;
+	}
+
+	void RayTracer::SetCameraState(const SnapshotCamera& _state)
 	{
-		// Get the hit information from the ray
-		HitInformation hitInfo = _ray.GetHitInfo();
-		// Calculate the facing ratio by getting the dot product of the hitnormal and viewing direction (-rayDir)
-		// having it clamped to 0 lets the final ratio be between 0 and 1.0f
-		float facingRatio = glm::max(0.05f, glm::dot(hitInfo.hitNormal, -_ray.GetDirection()));
+		camera.position = _state.position;
+		std::memcpy(&camera.camRotation[0][0], _state.camRotation, sizeof(_state.camRotation));
+		camera.fov = _state.fov;
+		camera.maxViewingDistance = _state.maxViewingDistance;
+		camera.ConstructCamMatrix();
+		backgroundDefault = _state.background;
+	}
+
+	bool RayTracer::SaveCostMap(const char* _path, CostMetric _metric, float& _scale)
+	{
+		if (!fInitialised) return false;
+		// The costs have to be finished before theyre read
+		CancelRender();
 
-		return { facingRatio * hitInfo.hitColor.r, facingRatio * hitInfo.hitColor.g, facingRatio * hitInfo.hitColor.b };
+		const int pixels = screenW * screenH;
+		std::vector<ColorPixel> heatmap;
+		_scale = BuildCostHeatmap(camera.costPlane, pixels, _metric, heatmap);
+
+		std::string path(_path);
+		return WriteImagePPM((path + ".ppm").c_str(), heatmap.data(), screenW, screenH) &&
+			WriteCostBuffer((path + ".raw").c_str(), camera.costPlane, pixels);
 	}
 
-	void RayTracer::SetBackgroundColor(ColorPixel _color)
+	bool RayTracer::SaveSnapshot(const char* _path)
 	{
-		backgroundDefault = _color;
+		if (!fInitialised || streamed.IsOpen()) return false;
+		CancelRender();
+		PrepareScene();
+
+		TimelineScope scope("Save snapshot");
+		return WriteSnapshot(_path, scene, GetCameraState());
 	}
 
-	void RayTracer::AddPrimitive(Primitive* _object)
+	bool RayTracer::LoadSnapshot(const char* _path)
 	{
-		if (!fInitialised || primiAmount >= primiMax) return;
+		if (!fInitialised) return false;
+		CancelRender();
 
-		// Calculate the distance from the object to the camera 
-		glm::fvec3 pos = _object->GetPosition() - camera.position;
-		float dist = glm::sqrt((pos.x * pos.x) + (pos.y * pos.y) + (pos.z * pos.z));
+		// Check the file before the current scene is thrown away
+		MappedFile file;
+		SceneView mapped;
+		SnapshotCamera state;
+		if (!file.Open(_path) || !ReadSnapshot(file.GetData(), file.GetSize(), mapped, state)) return false;
 
-		// Compare primitive lengths to _object, insert into ordered list of lengths (primiMap)
-		int insert = primiAmount;
-		bool inserting = false;
-		for (int i = 0; i < primiAmount; ++i)
+		ClearPrimitives();
+		snapshot.Swap(file);
+		scene = mapped;
+		fSceneDirty = false;
+		SetCameraState(state);
+
+		fProgressiveReset = true;
+		return true;
+	}
+
+	bool RayTracer::BakeScene(const char* _path, const char* _name)
+	{
+		if (!fInitialised || streamed.IsOpen()) return false;
+		CancelRender();
+		PrepareScene();
+
+		return WriteBakedScene(_path, _name, scene);
+	}
+
+	bool RayTracer::LoadBakedScene(const BakedScene& _baked)
+	{
+		if (!fInitialised || _baked.walk == nullptr || _baked.nodeCount == 0) return false;
+		ClearPrimitives();
+
+		// The scene arrays hold a copy of the records, so shading, views and snapshots see the baked scene
+		sceneSpheres.resize(_baked.sphereCount);
+		for (int i = 0; i < _baked.sphereCount; ++i)
 		{
-			if (primiMap[i] > dist)
-			{
-				insert = i;
-				inserting = true;
-				break;
-			}
+			const BakedSphere& baked = _baked.spheres[i];
+			SphereRecord& sphere = sceneSpheres[i];
+			sphere.position = rvec3(baked.x, baked.y, baked.z);
+			sphere.radius = baked.radius;
+			sphere.radiusSqr = baked.radiusSqr;
+			sphere.color = { baked.r, baked.g, baked.b };
+			sphere.texture = baked.texture;
 		}
-
-		// If inserting, move all objects down in the primiManager
-		if (inserting)
+		sceneCircles.resize(_baked.circleCount);
+		for (int i = 0; i < _baked.circleCount; ++i)
 		{
-			for (int i = primiAmount; i >= insert; --i)
-			{
-				primiMap[i + 1] = primiMap[i];
-				primiManager[i + 1] = primiManager[i];
-			}
+			const BakedCircle& baked = _baked.circles[i];
+			CircleRecord& circle = sceneCircles[i];
+			circle.position = rvec3(baked.x, baked.y, baked.z);
+			circle.direction = rvec3(baked.directionX, baked.directionY, baked.directionZ);
+			circle.radius = baked.radius;
+			circle.radiusSqr = baked.radiusSqr;
+			circle.color = { baked.r, baked.g, baked.b };
+			circle.texture = baked.texture;
 		}
+		sceneNodes.resize(_baked.nodeCount);
+		for (int i = 0; i < _baked.nodeCount; ++i)
+		{
+			const BakedNode& baked = _baked.nodes[i];
+			BVHNode& node = sceneNodes[i];
+			node.boundsMin = rvec3(baked.minX, baked.minY, baked.minZ);
+			node.boundsMax = rvec3(baked.maxX, baked.maxY, baked.maxZ);
+			node.leftFirst = baked.leftFirst;
+			node.count = baked.count;
+		}
+		sceneRefs.assign(_baked.refs, _baked.refs + _baked.refCount);
 
-		primiManager[insert] = _object;
-		primiMap[insert] = dist;
-		++primiAmount;
+		UpdateSceneView();
+		scene.walk = _baked.walk;
+		fBakedScene = true;
+		fSceneDirty = false;
+		return true;
 	}
 
-	void RayTracer::ClearPrimitives()
+	bool RayTracer::SaveChunkedScene(const char* _path, int _gridSize)
 	{
-		// Free all elements from array
-		for (int i = 0; i < primiAmount; ++i)
+		if (!fInitialised || streamed.IsOpen()) return false;
+		CancelRender();
+		PrepareScene();
+
+		// Generic objects cant be stored
+		if (scene.refCount != scene.sphereCount + scene.circleCount) return false;
+
+		rvec3 boundsMin(0), boundsMax(0);
+		if (scene.nodeCount > 0)
 		{
-			delete primiManager[i];
-			primiManager[i] = nullptr;
-			primiMap[i] = 0;
+			boundsMin = scene.nodes[0].boundsMin;
+			boundsMax = scene.nodes[0].boundsMax;
 		}
-		// Set amount to none
-		primiAmount = 0;
+
+		ChunkBuilder builder;
+		if (!builder.Begin(_path, boundsMin, boundsMax, _gridSize)) return false;
+		for (int i = 0; i < scene.sphereCount; ++i)
+			if (!builder.AddSphere(scene.spheres[i])) return false;
+		for (int i = 0; i < scene.circleCount; ++i)
+			if (!builder.AddCircle(scene.circles[i])) return false;
+		return builder.Finish(GetCameraState());
+	}
+
+	bool RayTracer::OpenChunkedScene(const char* _path)
+	{
+		if (!fInitialised) return false;
+		CancelRender();
+
+		// Check the index before the current scene is thrown away
+		ChunkCache cache;
+		if (!cache.Open(_path)) return false;
+
+		ClearPrimitives();
+		streamed.Swap(cache);
+		SetCameraState(streamed.GetCamera());
+
+		fProgressiveReset = true;
+		return true;
 	}
 
 	void RayTracer::RenderScene()
 	{
+		CancelRender();
+		PrepareScene();
+
+		if (streamed.IsOpen())
+		{
+			RenderStreamedFrame();
+			return;
+		}
+
+		// Reuse pixels already traced by a preview or a budgeted render
+		if (!fProgressiveReset && !fProgressiveReplaced && progressiveTraces > 0)
+		{
+			RenderProgressive(FLT_MAX);
+			return;
+		}
+
+		PrepareCameraOcclusion();
 		// Set the background to the background color
 		MCG::SetBackground({ backgroundDefault.r, backgroundDefault.g, backgroundDefault.b });
 
-		// Hardcoded sampling coordinates (TODO, add sampling)
-		float samplingX = 0.5f, samplingY = 0.5f;
 		// Loop through every pixel on the screen
 		for (int y = 0; y < screenH; ++y)
 		{
 			for (int x = 0; x < screenW; ++x)
 			{
-				// Create the drawing color
-				ColorPixel drawingColor = backgroundDefault;
-				// Create an empty ray
-				Ray ray;
-				// Cast the ray in the direction of the camera from its position
-				camera.CastRay(x, y, ray, samplingX, samplingY);
+				TracePixel(x, y);
+
+				// Denoised images are displayed once the post-pass is done
+				if (!fDenoise) camera.DisplayPlanePixel(x, y);
+			}
+		}
+
+		if (fDenoise)
+		{
+			denoiser.Apply(camera.imagePlane, camera.surfacePlane, screenW, screenH);
+			camera.DisplayPlane();
+		}
+
+		// The image plane no longer holds progressive results, but is up to date with the scene and camera
+		fProgressiveReset = false;
+		fProgressiveReplaced = true;
+	}
+
+	void RayTracer::RenderImage()
+	{
+		TimelineScope scope("Render");
+		CancelRender();
+		PrepareScene();
+		PrepareCameraOcclusion();
+
+		std::uint64_t renderKey;
+		if (streamed.IsOpen()) TraceStreamed(nullptr);
+		else if (GetRenderKey(renderKey))
+		{
+			// Traced by tile so unchanged tiles come out of the tile cache
+			const int tiles = ((screenW + tileSize - 1) / tileSize) * ((screenH + tileSize - 1) / tileSize);
+			ParallelFor(tiles, [&](int _tile) { TraceTile(_tile, &renderKey); });
+		}
+		else if (PrepareVisibility()) TraceRasterized(nullptr);
+		else ParallelFor(screenH, [&](int _y)
+		{
+			TimelineScope scope("Trace row", _y);
+			for (int x = 0; x < screenW; ++x)
+				TracePixel(x, _y);
+		});
+
+		if (fDenoise) denoiser.Apply(camera.imagePlane, camera.surfacePlane, screenW, screenH);
+
+		// The image plane no longer holds progressive results, but is up to date with the scene and camera
+		fProgressiveReset = false;
+		fProgressiveReplaced = true;
+	}
+
+	void RayTracer::TraceViewBlocks(ViewSet& _views, int _first, int _count, int _y0)
+	{
+		const ViewDesc& desc = _views.GetView(_first);
+		const int blockW = 4, blockH = rayPacketSize / (blockW * _count);
+		const int y1 = glm::min(_y0 + blockH, desc.height);
+		real spreads[ViewSet::maxGroupSize];
+		for (int v = 0; v < _count; ++v) spreads[v] = _views.GetPixelSpread(_first + v);
+
+		Ray rays[rayPacketSize];
+		ColorPixel colors[rayPacketSize];
+		SurfacePixel surfaces[rayPacketSize];
+		int hits[rayPacketSize];
+		HitInformation start;
+		start.length = camera.maxViewingDistance;
+
+		for (int x0 = 0; x0 < desc.width; x0 += blockW)
+		{
+			const int x1 = glm::min(x0 + blockW, desc.width);
+			const int pixels = (x1 - x0) * (y1 - _y0), packet = pixels * _count;
+			for (int r = 0; r < packet; ++r) { colors[r] = {}; surfaces[r] = {}; hits[r] = 0; }
+
+			// Every view traces the same pixels with the same sample positions, so paired views stay coherent
+			for (int s = 0; s < samplesPerPixel; ++s)
+			{
+				float samplingX, samplingY;
+				SamplePosition(s, samplingX, samplingY);
+				for (int r = 0; r < packet; ++r)
+				{
+					int pixel = r % pixels;
+					_views.CastRay(_first + r / pixels, x0 + pixel % (x1 - x0), _y0 + pixel / (x1 - x0), samplingX, samplingY, rays[r]);
+					rays[r].SetHitInfo(start);
+				}
+
+				unsigned int hitMask = IntersectPacket(scene, rays, packet);
+				for (int r = 0; r < packet; ++r)
+				{
+					if ((hitMask & (1u << r)) == 0)
+					{
+						colors[r].r += backgroundDefault.r; colors[r].g += backgroundDefault.g; colors[r].b += backgroundDefault.b;
+						continue;
+					}
+					ColorPixel color = Shade(rays[r], spreads[r / pixels]);
+					HitInformation hitInfo = rays[r].GetHitInfo();
+					colors[r].r += color.r; colors[r].g += color.g; colors[r].b += color.b;
+					surfaces[r].nx += (float)hitInfo.hitNormal.x; surfaces[r].ny += (float)hitInfo.hitNormal.y; surfaces[r].nz += (float)hitInfo.hitNormal.z;
+					surfaces[r].depth += (float)hitInfo.length;
+					++hits[r];
+				}
+			}
+
+			// Average all samples like TracePixel
+			float invSamples = 1.f / samplesPerPixel;
+			for (int r = 0; r < packet; ++r)
+			{
+				int pixel = r % pixels;
+				ViewSet::View& view = _views.views[_first + r / pixels];
+				size_t index = (size_t)(_y0 + pixel / (x1 - x0)) * desc.width + x0 + pixel % (x1 - x0);
+				view.image[index] = { colors[r].r * invSamples, colors[r].g * invSamples, colors[r].b * invSamples };
+				SurfacePixel surface = surfaces[r];
+				if (hits[r] > 0)
+				{
+					float invHits = 1.f / hits[r];
+					surface = { surface.nx * invHits, surface.ny * invHits, surface.nz * invHits, surface.depth * invHits };
+				}
+				view.surface[index] = surface;
+			}
+		}
+	}
+
+	bool RayTracer::RenderViews(ViewSet& _views)
+	{
+		if (!fInitialised || streamed.IsOpen() || _views.GetCount() == 0) return false;
+		CancelRender();
+		PrepareScene();
+
+		// View pixels are numbered view after view
+		int viewPixels = 0;
+		for (int v = 0; v < _views.GetCount(); ++v)
+			viewPixels += _views.GetView(v).width * _views.GetView(v).height;
+		const bool fAdded = PrepareOcclusion(viewPixels, [&](int _index, Ray& _ray)
+		{
+			int view = 0;
+			for (; _index >= _views.GetView(view).width * _views.GetView(view).height; ++view)
+				_index -= _views.GetView(view).width * _views.GetView(view).height;
+			const int width = _views.GetView(view).width;
+			_views.CastRay(view, _index % width, _index / width, 0.5f, 0.5f, _ray);
+			HitInformation start;
+			start.length = camera.maxViewingDistance;
+			_ray.SetHitInfo(start);
+			return _views.GetPixelSpread(view);
+		});
+		// New records change what the camera sees too, a progressive render starts over
+		if (fAdded) fProgressiveReset = true;
+
+		// A job traces one row of blocks of a view and the views paired with it
+		struct ViewJob { int first, count, y0; };
+		std::vector<ViewJob> jobs;
+		for (int first = 0; first < _views.GetCount();)
+		{
+			int count = 1;
+			while (first + count < _views.GetCount() && _views.GetView(first + count).fPaired) ++count;
+			const int blockH = rayPacketSize / (4 * count);
+			for (int y0 = 0; y0 < _views.GetView(first).height; y0 += blockH) jobs.push_back({ first, count, y0 });
+			first += count;
+		}
+
+		// Every view is traced in one pass, the jobs of all views share the worker threads
+		ParallelFor((int)jobs.size(), [&](int _job)
+		{
+			TraceViewBlocks(_views, jobs[_job].first, jobs[_job].count, jobs[_job].y0);
+		});
+
+		if (fDenoise)
+		{
+			for (ViewSet::View& view : _views.views)
+				denoiser.Apply(view.image.data(), view.surface.data(), view.desc.width, view.desc.height);
+		}
+		return true;
+	}
+
+	ViewDesc RayTracer::GetCameraView()
+	{
+		ViewDesc view;
+		view.camToWorld = camera.camToWorld;
+		view.fov = camera.fov;
+		view.width = screenW;
+		view.height = screenH;
+		return view;
+	}
+
+	void RayTracer::ResetProgressive()
+	{
+		if (!fProgressiveReset && !fProgressiveReplaced) return;
+
+		// Start over from the coarsest pass
+		const int pixels = screenW * screenH;
+		for (int i = 0; i < pixels; ++i)
+		{
+			camera.accumulationPlane[i] = { 0, 0, 0 };
+			camera.samplePlane[i] = 0;
+			camera.costPlane[i] = PixelCost();
+		}
+		progress = RenderProgress();
+		progress.passes = progressiveLevels + samplesPerPixel - 1;
+		progressiveRow = 0;
+		progressiveTraces = 0;
+		checkpointMark = 0;
+		// Records are placed before the first pass, the cache stays the same for the whole render
+		PrepareCameraOcclusion();
+		fProgressiveReset = false;
+		fProgressiveReplaced = false;
+	}
+
+	bool RayTracer::StepProgressive()
+	{
+		TraceProgressiveRow();
+
+		// Move to the next row of the pass
+		progressiveRow += progress.pass < progressiveLevels ? 1 << (progressiveLevels - 1 - progress.pass) : 1;
+		if (progressiveRow < screenH) return false;
+
+		// Move to the next pass
+		progressiveRow = 0;
+		++progress.pass;
+		progress.complete = progress.pass >= progress.passes;
+		return true;
+	}
+
+	void RayTracer::UpdateProgress(float _elapsedMs)
+	{
+		progress.samplesCompleted = glm::max(0, progress.pass - progressiveLevels + 1);
+		progress.completion = (float)(progressiveTraces / ((double)screenW * screenH * samplesPerPixel));
+		progress.elapsedMs += _elapsedMs;
+	}
+
+	bool RayTracer::RenderProgressive(float _budgetMs)
+	{
+		CancelRender();
+		PrepareScene();
+		// Streamed scenes are traced in whole waves, there are no passes to stop between
+		if (streamed.IsOpen()) return RenderStreamedFrame();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		ResetProgressive();
+		MCG::SetBackground({ backgroundDefault.r, backgroundDefault.g, backgroundDefault.b });
+
+		const bool wasComplete = progress.complete;
+		float elapsed = 0;
+		while (!progress.complete)
+		{
+			StepProgressive();
+
+			// Stop once the budget has been used up, checked per row
+			elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (checkpointInterval > 0 && progress.elapsedMs + elapsed - checkpointMark >= checkpointInterval)
+				TakeCheckpoint(progress.elapsedMs + elapsed);
+			if (elapsed >= _budgetMs) break;
+		}
+		UpdateProgress(elapsed);
+
+		// The finished render is always checkpointed, before denoising like every other checkpoint
+		if (progress.complete && !wasComplete && checkpointInterval > 0)
+		{
+			checkpointWriter.Wait();
+			TakeCheckpoint(progress.elapsedMs);
+		}
+
+		// Denoising runs once, when the final pass is done
+		if (progress.complete && !wasComplete && fDenoise)
+			denoiser.Apply(camera.imagePlane, camera.surfacePlane, screenW, screenH);
+
+		camera.DisplayPlane();
+		return progress.complete;
+	}
+
+	bool RayTracer::GetCheckpointKey(std::uint64_t& _key)
+	{
+		if (streamed.IsOpen()) return false;
+
+		ContentHash hash;
+		HashRenderSettings(hash);
+		if (!HashSceneContent(hash)) return false;
+		_key = hash.value;
+		return true;
+	}
+
+	bool RayTracer::TakeCheckpoint(float _elapsedMs)
+	{
+		checkpointMark = _elapsedMs;
+		if (checkpointWriter.IsWriting() || !GetCheckpointKey(checkpointData.sceneKey)) return false;
+
+		checkpointData.camera = GetCameraState();
+		checkpointData.width = screenW;
+		checkpointData.height = screenH;
+		checkpointData.pass = progress.pass;
+		checkpointData.passes = progress.passes;
+		checkpointData.row = progressiveRow;
+		checkpointData.traces = progressiveTraces;
+		checkpointData.elapsedMs = _elapsedMs;
+
+		const int pixels = screenW * screenH;
+		checkpointData.image.assign(camera.imagePlane, camera.imagePlane + pixels);
+		checkpointData.accumulation.assign(camera.accumulationPlane, camera.accumulationPlane + pixels);
+		checkpointData.samples.assign(camera.samplePlane, camera.samplePlane + pixels);
+		checkpointData.surfaces.assign(camera.surfacePlane, camera.surfacePlane + pixels);
+		checkpointData.costs.assign(camera.costPlane, camera.costPlane + pixels);
+		// Passes only read the cache (see PrepareOcclusion), the records stay put while they are copied
+		const OcclusionRecord* records = occlusionCache.GetRecords();
+		if (records != nullptr) checkpointData.occlusion.assign(records, records + occlusionCache.GetRecordCount());
+		else checkpointData.occlusion.clear();
+		return checkpointWriter.Write(checkpointPath, checkpointData);
+	}
+
+	void RayTracer::SetCheckpoint(const std::string& _path, float _intervalMs)
+	{
+		CancelRender();
+		checkpointWriter.Wait();
+		checkpointPath = _path;
+		checkpointInterval = _path.empty() ? 0 : glm::max(0.f, _intervalMs);
+		checkpointMark = progress.elapsedMs;
+	}
+
+	bool RayTracer::ResumeCheckpoint(const char* _path)
+	{
+		if (!fInitialised) return false;
+		CancelRender();
+		PrepareScene();
+
+		RenderCheckpoint resumed;
+		std::uint64_t key;
+		if (!ReadCheckpoint(_path, resumed) || !GetCheckpointKey(key)) return false;
+		if (resumed.sceneKey != key || resumed.width != screenW || resumed.height != screenH) return false;
+		// The pass layout follows from the samples per pixel, which the key already covers
+		if (resumed.passes != progressiveLevels + samplesPerPixel - 1 || resumed.pass < 0 || resumed.pass > resumed.passes ||
+			resumed.row < 0 || resumed.row >= screenH) return false;
+		if (!resumed.occlusion.empty() && !occlusionCache.IsReady()) return false;
+
+		// The remaining passes are shaded from the same occlusion records as the interrupted render
+		if (occlusionCache.IsReady())
+		{
+			occlusionCache.Clear();
+			for (const OcclusionRecord& record : resumed.occlusion)
+				if (!occlusionCache.Insert(record)) return false;
+		}
+
+		SetCameraState(resumed.camera);
+		std::copy(resumed.image.begin(), resumed.image.end(), camera.imagePlane);
+		std::copy(resumed.accumulation.begin(), resumed.accumulation.end(), camera.accumulationPlane);
+		std::copy(resumed.samples.begin(), resumed.samples.end(), camera.samplePlane);
+		std::copy(resumed.surfaces.begin(), resumed.surfaces.end(), camera.surfacePlane);
+		std::copy(resumed.costs.begin(), resumed.costs.end(), camera.costPlane);
+
+		progress = RenderProgress();
+		progress.pass = resumed.pass;
+		progress.passes = resumed.passes;
+		progress.complete = resumed.pass >= resumed.passes;
+		progressiveRow = resumed.row;
+		progressiveTraces = resumed.traces;
+		UpdateProgress(resumed.elapsedMs);
+		checkpointMark = resumed.elapsedMs;
+		fProgressiveReset = false;
+		fProgressiveReplaced = false;
+
+		// Checkpoints hold the planes before denoising, a finished render is denoised as it was when it finished
+		if (progress.complete && fDenoise) denoiser.Apply(camera.imagePlane, camera.surfacePlane, screenW, screenH);
+		return true;
+	}
+
+	void RayTracer::GetTileBounds(int _tile, int& _x0, int& _y0, int& _x1, int& _y1)
+	{
+		const int tilesX = (screenW + tileSize - 1) / tileSize;
+		_x0 = (_tile % tilesX) * tileSize;
+		_y0 = (_tile / tilesX) * tileSize;
+		_x1 = glm::min(_x0 + tileSize, screenW);
+		_y1 = glm::min(_y0 + tileSize, screenH);
+	}
+
+	void RayTracer::HashRenderSettings(ContentHash& _hash)
+	{
+		// Images traced at another precision or through other kernels round differently
+		_hash.AddValue((unsigned int)sizeof(real));
+		_hash.AddValue((unsigned int)GetKernels().isa);
+		_hash.AddValue(screenW);
+		_hash.AddValue(screenH);
+
+		_hash.AddValue(samplesPerPixel);
+		_hash.AddValue(headlight);
+		_hash.AddValue(occlusionDistance);
+		_hash.AddValue(occlusionSamples);
+		_hash.AddValue((int)textures.size());
+		_hash.AddValue(textureKey);
+	}
+
+	bool RayTracer::HashSceneContent(ContentHash& _hash)
+	{
+		_hash.AddValue(lightSamples);
+		for (const LightRecord& light : lights)
+		{
+			_hash.AddVector(light.position);
+			_hash.AddValue(light.radius);
+			_hash.AddColor(light.emission);
+		}
+
+		std::uint64_t records = 0;
+		for (int i = 0; i < scene.refCount; ++i)
+		{
+			if (GetRefType(scene.refs[i]) == PrimitiveType::Generic) return false;
+			records += HashRecord(scene, scene.refs[i]);
+		}
+		_hash.AddValue(records);
+		_hash.AddValue(scene.refCount);
+		return true;
+	}
 
+	bool RayTracer::GetRenderKey(std::uint64_t& _key)
+	{
+		// Costs are measured per render, streamed scenes arent traced by tile
+		if (!fTileCache || fCostTracking || streamed.IsOpen()) return false;
+
+		ContentHash hash;
+		HashRenderSettings(hash);
+
+		const SnapshotCamera state = GetCameraState();
+		hash.AddVector(state.position);
+		for (int i = 0; i < 16; ++i)
+			hash.AddValue(state.camRotation[i]);
+		hash.AddValue(state.fov);
+		hash.AddValue(state.maxViewingDistance);
+		hash.AddColor(state.background);
+		// Occlusion depends on the records placed so far, not just the scene
+		if (occlusionDistance > 0) hash.AddValue(occlusionCache.GetContentKey());
+
+		// Shadow and occlusion rays leave the tile frustum, every light and record is part of every tile
+		if ((!lights.empty() || occlusionDistance > 0) && !HashSceneContent(hash)) return false;
+
+		_key = hash.value;
+		return true;
+	}
+
+	bool RayTracer::GetTileKey(int _tile, std::uint64_t _renderKey, std::uint64_t& _key)
+	{
+		int x0, y0, x1, y1;
+		GetTileBounds(_tile, x0, y0, x1, y1);
+
+		// The tile frustum, bounded by the rays through the outer edges of its corner pixels
+		Ray corners[4];
+		camera.CastRay(x0, y0, corners[0], 0, 0);
+		camera.CastRay(x1 - 1, y0, corners[1], 1, 0);
+		camera.CastRay(x1 - 1, y1 - 1, corners[2], 1, 1);
+		camera.CastRay(x0, y1 - 1, corners[3], 0, 1);
+		const rvec3 origin = corners[0].GetOrigin();
+		rvec3 center(0, 0, 0);
+		for (int i = 0; i < 4; ++i)
+			center += corners[i].GetDirection();
+		// Side planes through the camera, facing into the frustum
+		rvec3 planes[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			planes[i] = glm::normalize(glm::cross(corners[i].GetDirection(), corners[(i + 1) % 4].GetDirection()));
+			if (glm::dot(planes[i], center) < 0) planes[i] = -planes[i];
+		}
+
+		std::uint64_t records = 0;
+		int count = 0;
+		if (scene.nodeCount > 0)
+		{
+			int stack[bvhMaxDepth + 1];
+			int top = 0;
+			stack[top++] = 0;
+			while (top > 0)
+			{
+				const BVHNode& node = scene.nodes[stack[--top]];
+
+				// Outside if the corner furthest along a plane normal is behind it,
+				// with some slack for the rounding of the corner rays
+				bool fOutside = false;
+				for (int i = 0; i < 4 && !fOutside; ++i)
+				{
+					const rvec3 corner(planes[i].x >= 0 ? node.boundsMax.x : node.boundsMin.x,
+						planes[i].y >= 0 ? node.boundsMax.y : node.boundsMin.y,
+						planes[i].z >= 0 ? node.boundsMax.z : node.boundsMin.z);
+					const rvec3 offset = corner - origin;
+					fOutside = glm::dot(planes[i], offset) < -(real)1e-3f * glm::length(offset);
+				}
+				if (fOutside) continue;
 
-				for (int i = primiAmount - 1; i >= 0; --i)
+				if (node.count > 0)
 				{
-					if (primiManager[i]->Intersect(ray))
+					for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+					{
+						// Generic objects have no record to hash
+						if (GetRefType(scene.refs[i]) == PrimitiveType::Generic) return false;
+						records += HashRecord(scene, scene.refs[i]);
+						++count;
+					}
+					continue;
+				}
+				stack[top++] = node.leftFirst;
+				stack[top++] = node.leftFirst + 1;
+			}
+		}
+
+		ContentHash hash;
+		hash.AddValue(_renderKey);
+		hash.AddValue(x0); hash.AddValue(y0); hash.AddValue(x1); hash.AddValue(y1);
+		hash.AddValue(records);
+		hash.AddValue(count);
+		_key = hash.value;
+		return true;
+	}
+
+	void RayTracer::TraceTile(int _tile, const std::uint64_t* _renderKey)
+	{
+		TimelineScope scope("Trace tile", _tile);
+		int x0, y0, x1, y1;
+		GetTileBounds(_tile, x0, y0, x1, y1);
+
+		std::uint64_t key;
+		const bool fCached = _renderKey != nullptr && GetTileKey(_tile, *_renderKey, key);
+		const int width = x1 - x0, pixels = width * (y1 - y0);
+		std::vector<ColorPixel> colors;
+		std::vector<SurfacePixel> surfaces;
+		if (fCached)
+		{
+			colors.resize(pixels);
+			surfaces.resize(pixels);
+			if (tileCache.Fetch(key, pixels, colors.data(), surfaces.data()))
+			{
+				for (int y = y0; y < y1; ++y)
+					for (int x = x0; x < x1; ++x)
 					{
-						drawingColor = Shade(ray);
+						const int i = (y - y0) * width + (x - x0);
+						camera.DrawToPlane(x, y, colors[i]);
+						camera.DrawToSurfacePlane(x, y, surfaces[i]);
 					}
+				return;
+			}
+		}
+
+		for (int y = y0; y < y1; ++y)
+			for (int x = x0; x < x1; ++x)
+				TracePixel(x, y);
+
+		if (fCached)
+		{
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+				{
+					const int i = (y - y0) * width + (x - x0);
+					colors[i] = camera.imagePlane[(y * screenW) + x];
+					surfaces[i] = camera.surfacePlane[(y * screenW) + x];
 				}
+			tileCache.Store(key, pixels, colors.data(), surfaces.data());
+		}
+	}
+
+	void RayTracer::RunJob()
+	{
+		TimelineScope scope("Render job");
+		PrepareCameraOcclusion(&job.fCancel);
+		std::uint64_t renderKey;
+		const bool fCached = GetRenderKey(renderKey);
+
+		// Streamed and rasterized scenes are traced in whole waves, the tiles all finish together
+		if (streamed.IsOpen() || (!fCached && PrepareVisibility()))
+		{
+			if (streamed.IsOpen()) TraceStreamed(&job.fCancel);
+			else TraceRasterized(&job.fCancel);
+			if (!job.fCancel)
+			{
+				for (int tile = 0; tile < job.tilesTotal; ++tile)
+					job.FinishTile(tile);
+			}
+		}
+		else
+		{
+			ParallelFor(job.tilesTotal, [&](int _tile)
+			{
+				// Cooperative cancellation, remaining tiles are skipped
+				if (job.fCancel) return;
+
+				TraceTile(_tile, fCached ? &renderKey : nullptr);
+				job.FinishTile(_tile);
+			});
+		}
 
-				camera.DrawToPlane(x, y, drawingColor);
+		// Denoise once every tile is done, then present the whole image again
+		// Filtering only reads the image plane, the lock is held for the write back while no tile is copied
+		if (!job.fCancel && fDenoise && denoiser.Filter(camera.imagePlane, camera.surfacePlane, screenW, screenH))
+		{
+			std::lock_guard<std::mutex> lock(job.tileLock);
+			denoiser.Resolve(camera.imagePlane);
+			for (int tile = 0; tile < job.tilesTotal; ++tile)
+				job.finishedTiles.push_back(tile);
+		}
+
+		job.Finish();
+	}
+
+	void RayTracer::CancelRender()
+	{
+		const bool fWasRunning = job.IsRunning();
+		job.Cancel();
+
+		// The planes hold part of a render, they are neither a finished image nor progressive results
+		if (fWasRunning && job.IsCancelled())
+		{
+			fProgressiveReplaced = false;
+			fProgressiveReset = true;
+		}
+	}
+
+	RenderJob* RayTracer::RenderAsync()
+	{
+		if (!fInitialised) return nullptr;
+		// The previous job has to stop before the scene is touched, a finished
+		// background rebuild is swapped in by PrepareScene
+		CancelRender();
+		PrepareScene();
+
+		const int tiles = ((screenW + tileSize - 1) / tileSize) * ((screenH + tileSize - 1) / tileSize);
+		job.Reset(tiles);
+		// The image plane no longer holds progressive results, the preview leaves the job running
+		// as the render is of the current scene and camera (see IsPreviewComplete)
+		fProgressiveReset = false;
+		fProgressiveReplaced = true;
+
+		MCG::SetBackground({ backgroundDefault.r, backgroundDefault.g, backgroundDefault.b });
+		job.worker = std::thread(&RayTracer::RunJob, this);
+		return &job;
+	}
 
-				camera.DisplayPlanePixel(x, y);
+	bool RayTracer::PresentRender()
+	{
+		// Copy finished tiles to the front plane, the lock is only held for the copy
+		{
+			std::lock_guard<std::mutex> lock(job.tileLock);
+			presentTiles.clear();
+			presentTiles.swap(job.finishedTiles);
+			for (int tile : presentTiles)
+			{
+				int x0, y0, x1, y1;
+				GetTileBounds(tile, x0, y0, x1, y1);
+				camera.CopyToFront(x0, y0, x1, y1);
 			}
 		}
+
+		// Draw from the front plane while the workers carry on
+		for (int tile : presentTiles)
+		{
+			int x0, y0, x1, y1;
+			GetTileBounds(tile, x0, y0, x1, y1);
+			camera.DisplayFront(x0, y0, x1, y1);
+		}
+
+		return !presentTiles.empty();
+	}
+
+	bool RayTracer::RefinePreview(float _budgetMs)
+	{
+		CancelRender();
+		PrepareScene();
+		if (streamed.IsOpen()) return RenderStreamedFrame();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		ResetProgressive();
+		if (IsPreviewComplete()) return true;
+
+		// Carry on with the current resolution pass, pixels from coarser passes are kept
+		float elapsed = 0;
+		while (!StepProgressive())
+		{
+			elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (elapsed >= _budgetMs) break;
+		}
+		UpdateProgress(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		camera.DisplayPlane();
+		return IsPreviewComplete();
 	}
 
 	RayTracer::RayTracer(int _screenWidth, int _screenHeight)
@@ -113,14 +2503,16 @@ namespace MRT
 		fInitialised = camera.IsInit();
 		// Allocate memory for the primitive objects
 		primiManager = new Primitive * [primiMax];
-		primiMap = new float[primiMax] { 0 };
 		// Check that the memory was allocated
 		fInitialised &= (primiManager != nullptr);
-		fInitialised &= (primiMap != nullptr);
 	}
 
 	RayTracer::~RayTracer()
 	{
+		// Stop the background render and rebuild before freeing anything they use
+		CancelRender();
+		StopRebuild();
+
 		// Free all elements from array
 		for (int i = 0; i < primiAmount; ++i)
 		{
@@ -128,6 +2520,5 @@ namespace MRT
 		}
 		// Delete the primitive manager
 		delete[] primiManager;
-		delete[] primiMap;
 	}
 }
\ No newline at end of file
@@ -3,15 +3,73 @@
 
 // Included libraries
 #include "MCG_GFX_Lib.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
 
 // Core modules
 #include "UtilityModules.h"
 #include "Ray.h"
 #include "Camera.h"
 #include "Primitive.h"
+#include "DistanceField.h"
+#include "Denoiser.h"
+#include "RenderJob.h"
+#include "BVH.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include "ChunkedScene.h"
+#include "CostMap.h"
+#include "LightTree.h"
+#include "OcclusionCache.h"
+#include "TileCache.h"
+#include "VisibilityBuffer.h"
+#include "MultiView.h"
+#include "BakedScene.h"
+#include "Checkpoint.h"
 
 namespace MRT
 {
+	// RenderProgress
+	// - Progress of a time budgeted (progressive) render
+	// - Passes go from 1/8 resolution up to full resolution, then add extra samples
+	struct RenderProgress
+	{
+		// The pass being worked on and the total amount of passes
+		int pass{ 0 }, passes{ 0 };
+		// Samples per pixel completed over the whole image
+		int samplesCompleted{ 0 };
+		// Fraction of all work done (0 to 1.f)
+		float completion{ 0 };
+		// Time spent rendering since the image was last reset (milliseconds)
+		float elapsedMs{ 0 };
+		// true once every pass is done
+		bool complete{ false };
+	};
+
+	// RayBatch
+	// - Rays traced by RayTracer::IntersectRays and RayTracer::OccludedRays, and where the results go
+	// - Every array is owned by the caller and holds count entries, nothing is allocated per ray
+	// - Outputs marked optional can be nullptr to skip them
+	struct RayBatch
+	{
+		// Ray origins and unit directions
+		const rvec3* origins{ nullptr };
+		const rvec3* directions{ nullptr };
+		// Optional, the furthest each ray is traced (unlimited when nullptr)
+		const real* maxDistances{ nullptr };
+		int count{ 0 };
+
+		// Returned distance to the hit, -1 on a miss
+		real* distances{ nullptr };
+		// Optional, returned object id of the hit (see RayTracer::AddPrimitive), -1 on a miss
+		int* primitives{ nullptr };
+		// Optional, returned unit surface normal of the hit, left untouched on a miss
+		// Sphere normals point out of the sphere, circle normals back towards the ray (closest hit queries only)
+		rvec3* normals{ nullptr };
+	};
+
 	// The Raytracer
 	// - An all encompassing class that simplifies the raytracing process
 	// - Contains Primitive managing system
@@ -19,22 +77,164 @@ namespace MRT
 	// - Contains adjustable parameters to tweak simulation
 	class RayTracer
 	{
+		// Let MRT::KernelBenchmark time the private shading kernel
+		friend class KernelBenchmark;
+
 		// Adjustable parameters
 	private:
 		// Default background color
 		ColorPixel backgroundDefault;
 
+		// Samples taken per pixel (1 to 64)
+		int samplesPerPixel{ 1 };
+
+		// Run the denoiser over the image plane after rendering
+		bool fDenoise{ false };
+
+		// Record the render cost of every pixel in the cost plane
+		bool fCostTracking{ false };
+
+		// Strength of the light coming from the camera, the only light when the scene has none
+		float headlight{ 1.f };
+		// Lights sampled per shading point (1 to 16)
+		int lightSamples{ 2 };
+
+		// Distance ambient occlusion looks for objects blocking the headlight, 0 when off
+		real occlusionDistance{ 0 };
+		// Rays traced per occlusion record (4 to 256)
+		int occlusionSamples{ 32 };
+
+		// Serve tiles traced before from the tile cache (still images and background renders)
+		bool fTileCache{ false };
+
+		// Find primary hits by rasterizing spheres and circles instead of walking the BVH
+		bool fRasterVisibility{ false };
+
 		// Internal variables
 	private:
-		// Primitives manager (hard-capped to 100 objects)
+		// Primitives manager (starts at 100 objects, doubles when full)
 		Primitive** primiManager{ nullptr };
 		int primiMax{ 100 }, primiAmount{ 0 };
-		// An array to order objects closest to the camera
-		float* primiMap{ nullptr };
+
+		// Flat scene arrays built from the primitives manager, rays are traced against these
+		// through the BVH instead of checking every object
+		std::vector<SphereRecord> sceneSpheres;
+		std::vector<CircleRecord> sceneCircles;
+		std::vector<BVHNode> sceneNodes;
+		std::vector<unsigned int> sceneRefs;
+		// Primitive bounds in BVH leaf order, kept for refitting
+		std::vector<BVHBuildItem> sceneBuildItems;
+		// BVH bookkeeping for refitting
+		// Parent of every node, the leaf of every reference and the owning object of every record
+		std::vector<int> sceneParents, sceneRefLeaves, sphereOwners, circleOwners;
+		// Per object (indexed like primiManager) position in the BVH leaf order
+		std::vector<int> primiSlots;
+		// Surface area heuristic cost of the BVH (see GetBVHCost) and its cost per root area when built
+		real sceneCost{ 0 }, sceneBuildQuality{ 0 };
+		// How much worse the cost per root area can get through refitting before the BVH is rebuilt
+		real rebuildThreshold{ 1.5f };
+
+		// Background BVH rebuild, the refit BVH is used until the new one is swapped in
+		std::thread rebuildWorker;
+		std::vector<BVHBuildItem> rebuildItems;
+		std::vector<BVHNode> rebuildNodes;
+		std::vector<unsigned int> rebuildRefs;
+		// Objects changed while rebuilding, refit again once the new BVH is swapped in
+		std::vector<int> rebuildChanged;
+		std::atomic<bool> fRebuildDone{ false };
+		bool fRebuilding{ false };
+		// The scene being traced, points at the arrays above or into the mapped snapshot
+		SceneView scene;
+		// A loaded snapshot, traced in place while the primitives manager is empty
+		MappedFile snapshot;
+		// A baked scene is loaded, its records are copied into the scene arrays and rays
+		// walk its generated code while the primitives manager is empty
+		bool fBakedScene{ false };
+
+		// An out-of-core scene paged in chunk by chunk, traced in waves while the primitives manager is empty
+		ChunkCache streamed;
+		// A ray queued on a chunk, with the distance it enters the chunk bounds
+		struct StreamEntry { int ray; real near; };
+		// Wave state of a streamed render, kept to avoid reallocating every frame
+		std::vector<Ray> streamRays;
+		std::vector<unsigned char> streamRayHits;
+		std::vector<std::vector<StreamEntry>> streamQueues;
+		std::vector<int> streamOrder;
+		std::vector<real> streamNearest;
+		// Per pixel sums over every sample, rasterized renders sum into these too
+		std::vector<ColorPixel> streamColors;
+		std::vector<SurfacePixel> streamSurfaces;
+		std::vector<int> streamHits;
+		// Queued rays traced per job when a chunk is traced
+		static const int streamBlockSize{ 256 };
+		// Batch query rays traced per job
+		static const int queryBlockSize{ 256 };
+		// Check the scene arrays need rebuilding, set when objects are added
+		bool fSceneDirty{ false };
+
+		// Textures objects can sample, indexed by the objects texture index
+		std::vector<Texture> textures;
+		// Hash of every loaded texture file, tiles are keyed with it
+		std::uint64_t textureKey{ 0 };
+
+		// Scene lights, picked through the light tree while shading
+		std::vector<LightRecord> lights;
+		LightTree lightTree;
+		// Check the light tree needs rebuilding, set when lights are added
+		bool fLightsDirty{ false };
+
+		// Ambient occlusion records, kept across camera moves and cleared when the scene changes
+		OcclusionCache occlusionCache;
+		// Camera, settings and cache the last finished record pass was made for (see PrepareCameraOcclusion)
+		std::uint64_t occlusionPreparedKey{ 0 };
+
+		// Traced tiles stored by content hash, kept across scene changes
+		TileCache tileCache;
+
+		// Rasterized primary hits, kept to avoid reallocating every frame
+		VisibilityBuffer visibility;
 
 		// The raytracing camera
 		Camera camera;
 
+		// Edge-aware denoising post-pass
+		Denoiser denoiser;
+
+		// Progressive rendering state
+		// Amount of resolution passes (1/8, 1/4, 1/2, full)
+		static const int progressiveLevels{ 4 };
+		RenderProgress progress;
+		// The next row to trace in the current pass
+		int progressiveRow{ 0 };
+		// Pixel samples traced so far
+		long long progressiveTraces{ 0 };
+		// Set when the scene or camera changes, progressive renders start over
+		bool fProgressiveReset{ true };
+		// Set when a full render replaced the progressive planes, progressive renders start over
+		// but the preview is still up to date with the scene and camera
+		bool fProgressiveReplaced{ false };
+
+		// Progressive render checkpoints (see SetCheckpoint)
+		std::string checkpointPath;
+		// Render time between checkpoints, 0 when off (milliseconds)
+		float checkpointInterval{ 0 };
+		// Render time the last checkpoint was taken at (milliseconds)
+		float checkpointMark{ 0 };
+		CheckpointWriter checkpointWriter;
+		// Filled from the planes and swapped with the writers buffers, so checkpoints dont allocate
+		RenderCheckpoint checkpointData;
+
+		// Background rendering
+		// Size of a tile in pixels (tileSize x tileSize)
+		static const int tileSize{ 32 };
+		// The background render job
+		RenderJob job;
+		// Tiles being presented, kept to avoid reallocating every frame
+		std::vector<int> presentTiles;
+
+		// Rays traced together by IntersectPacket
+		static const int rayPacketSize{ rayPacketLanes };
+
 		// Screen dimensions
 		int screenW{ 0 }, screenH{ 0 };
 
@@ -48,8 +248,256 @@ namespace MRT
 		// Internal shading sub system
 		// Creates shading after rays have intersected objects
 		// @param _ray : The ray to be used to shade an object
+		// @param _pixelSpread : The width of a pixel one unit in front of the camera the ray came from
+		// @returns ColorPixel : The color of the object
+		ColorPixel Shade(Ray& _ray, real _pixelSpread);
+
+		// Shade a ray cast by the camera
+		// @param _ray : The ray to be used to shade an object
 		// @returns ColorPixel : The color of the object
-		ColorPixel Shade(Ray& _ray);
+		ColorPixel Shade(Ray& _ray) { return Shade(_ray, camera.GetPixelSpread()); }
+
+		// Light a hit point with a few lights picked from the light tree
+		// Each light sample is weighted by the chance of picking it, so the result is unbiased
+		// @param _ray : The ray that hit the point
+		// @returns ColorPixel : The light reaching the point, before the surface color
+		ColorPixel SampleLights(Ray& _ray);
+
+		// Get the ambient occlusion at a hit point
+		// Interpolated from the occlusion cache, traced on the spot (without caching it) when no record reaches the point
+		// @param _ray : The ray that hit the point
+		// @param _pixelSpread : The width of a pixel one unit in front of the camera the ray came from
+		// @returns float : The fraction of the hemisphere that isnt blocked (0 to 1.f)
+		float SampleOcclusion(Ray& _ray, real _pixelSpread);
+
+		// Trace an ambient occlusion record at a hit point
+		// @param _point : The hit point
+		// @param _normal : The unit normal on the side the ray came from
+		// @param _length : The hit distance, scales the gap the rays leave the surface at
+		// @param _pixelSpread : The width of a pixel one unit in front of the camera the ray came from
+		// @returns OcclusionRecord : The record, only depends on the point and settings
+		OcclusionRecord TraceOcclusionRecord(const rvec3& _point, const rvec3& _normal, real _length, real _pixelSpread);
+
+		// Place the occlusion records a frame needs before it is shaded
+		// - Hits are visited in a fixed order and a record is placed at every hit no earlier record reaches,
+		//   so the cache (and the image) comes out the same however many threads render
+		// - Records are traced in parallel batches, a record reached by one added before it in its
+		//   batch is dropped, which leaves the same records as adding them one at a time
+		// - Shading only reads the cache, the few points no record reaches are traced without caching them
+		// @param _count : The amount of rays
+		// @param _cast : Casts ray i, returns the pixel spread of the camera it came from
+		// @param _cancel : Optional, stops placing records once set
+		// @returns bool : true if any record was added
+		bool PrepareOcclusion(int _count, const std::function<real(int, Ray&)>& _cast, const std::atomic<bool>* _cancel = nullptr);
+
+		// Place the occlusion records the camera needs from its pixel centers (see PrepareOcclusion)
+		// Skipped while the camera, settings and cache are as the last finished pass left them
+		// @param _cancel : Optional, stops placing records once set
+		// @returns bool : true if any record was added
+		bool PrepareCameraOcclusion(const std::atomic<bool>* _cancel = nullptr);
+
+		// Double the capacity of the primitives manager
+		// @returns bool : true if the manager grew
+		bool GrowPrimitives();
+
+		// Get the scene ready for rendering, rebuilds the scene arrays and BVH if needed
+		void PrepareScene();
+
+		// Store an object in the primitives manager
+		// @param _object : The object to store
+		// @returns bool : false if the manager couldnt grow
+		bool StorePrimitive(Primitive* _object);
+
+		// Work out the refitting bookkeeping after the BVH changed
+		void IndexScene();
+
+		// Copy an object into its record and refit the BVH around it
+		// @param _id : The object id
+		void RefitPrimitive(int _id);
+
+		// Point the scene view at the scene arrays
+		void UpdateSceneView();
+
+		// Start rebuilding the BVH on a background thread
+		void StartRebuild();
+
+		// Swap in the rebuilt BVH once its done
+		void FinishRebuild();
+
+		// Wait for the background rebuild and throw it away
+		void StopRebuild();
+
+		// Turn the mapped snapshot (or baked scene) back into objects so the scene can be changed
+		void UnmapSnapshot();
+
+		// Find the closest object a ray hits
+		// @param _ray : The ray to trace, its hit information is set to the closest hit
+		// @param _cost : Optional, the intersection tests and traversal steps are added to it
+		// @returns bool : true if an object was hit
+		bool IntersectScene(Ray& _ray, PixelCost* _cost = nullptr) { return IntersectScene(scene, _ray, _cost); }
+
+		// Find the closest object a ray hits in a scene view
+		// @param _scene : The scene arrays and BVH to trace
+		// @param _ray : The ray to trace, only set if the hit is closer than its current length
+		// @param _cost : Optional, the intersection tests and traversal steps are added to it
+		// @returns bool : true if an object was hit
+		bool IntersectScene(const SceneView& _scene, Ray& _ray, PixelCost* _cost);
+
+		// Find the closest objects a packet of rays hit
+		// - The BVH is walked once for the whole packet, a node is visited if any ray enters it
+		//   and leaf spheres are gathered once for every ray
+		// - Each ray gets the hit IntersectScene would give it, so packets are best kept to rays
+		//   that take the same path (neighbouring pixels)
+		// - Nodes are tested through the bounds kernel, without SIMD kernels (or in the double tier)
+		//   the rays are traced one at a time instead
+		// @param _scene : The scene arrays and BVH to trace
+		// @param _rays : The rays to trace, each only set if its hit is closer than its current length
+		// @param _count : The amount of rays (1 to rayPacketSize)
+		// @returns unsigned int : A bit per ray, set if the ray hit an object
+		unsigned int IntersectPacket(const SceneView& _scene, Ray* _rays, int _count);
+
+		// Find the closest object a ray hits without filling in hit information, for batch queries
+		// @param _origin : The ray origin
+		// @param _direction : The unit ray direction
+		// @param _length : The ray length, set to the hit distance
+		// @param _fAnyHit : Stop at the first object hit instead of the closest
+		// @param _ref : Returned primitive reference of the hit
+		// @returns bool : true if an object was hit
+		bool QueryScene(const rvec3& _origin, const rvec3& _direction, real& _length, bool _fAnyHit, unsigned int& _ref);
+
+		// Trace a batch of rays for IntersectRays and OccludedRays
+		// @param _batch : The rays and outputs
+		// @param _fAnyHit : Stop at the first object each ray hits instead of the closest
+		// @returns bool : false if the batch is empty or a streamed scene is open
+		bool QueryRays(const RayBatch& _batch, bool _fAnyHit);
+
+		// Get the object id a primitive reference came from
+		// @param _ref : The primitive reference
+		// @returns int : The object id, spheres then circles for a mapped snapshot
+		int GetRefPrimitive(unsigned int _ref);
+
+		// Trace a row of pixel blocks of a view and the views paired with it
+		// Each block is traced as one packet, 4 pixels wide and as tall as fits every view
+		// @param _views : The views
+		// @param _first : The first view
+		// @param _count : The amount of views traced together (1 to ViewSet::maxGroupSize)
+		// @param _y0 : The top row of the blocks
+		void TraceViewBlocks(ViewSet& _views, int _first, int _count, int _y0);
+
+		// Get the camera state stored in snapshots
+		// @returns SnapshotCamera : The current camera and background
+		SnapshotCamera GetCameraState();
+
+		// Restore a camera state from a snapshot
+		// @param _state : The camera and background to use
+		void SetCameraState(const SnapshotCamera& _state);
+
+		// Trace every sample of every pixel against the streamed scene
+		// - Rays are queued on each chunk their path reaches, then every chunk is mapped once
+		//   and its whole queue traced together
+		// - Mapped chunks go first, the rest nearest first, rays that already hit something in
+		//   front of a chunk are dropped from its queue so hidden chunks are never loaded
+		// - Chunks that fail to load are skipped
+		// @param _cancel : Checked between chunks, the render stops once set (can be nullptr)
+		// @returns bool : false if cancelled or a chunk couldnt be loaded
+		bool TraceStreamed(const std::atomic<bool>* _cancel);
+
+		// Render and display the streamed scene for the progressive and preview renders
+		// Streamed scenes are traced in whole waves, so the image is complete after one call
+		// @returns bool : Always true
+		bool RenderStreamedFrame();
+
+		// Trace every sample of a single pixel
+		// Saves the averaged color to the image plane and averaged normal/depth to the surface plane
+		// @param _x : The pixel X coordinate (0 to screenW-1)
+		// @param _y : The pixel Y coordinate (0 to screenH-1)
+		void TracePixel(int _x, int _y);
+
+		// Trace a single sample of a pixel
+		// @param _x : The pixel X coordinate (0 to screenW-1)
+		// @param _y : The pixel Y coordinate (0 to screenH-1)
+		// @param _sample : The sample index, picks the position on the pixel
+		// @param _color : Returned color of the sample
+		// @param _surface : Returned normal and depth of the sample (untouched on a miss)
+		// @param _cost : Optional, the cost of the sample is added to it (without the time)
+		// @returns bool : true if an object was hit
+		bool TraceSample(int _x, int _y, int _sample, ColorPixel& _color, SurfacePixel& _surface, PixelCost* _cost = nullptr);
+
+		// Trace one row of the current progressive pass
+		// Coarse passes fill the block each traced pixel covers
+		void TraceProgressiveRow();
+
+		// Clear the progressive state if the scene or camera changed
+		void ResetProgressive();
+
+		// Trace the next row of the progressive render and move on to the next pass when needed
+		// @returns bool : true if a pass was finished
+		bool StepProgressive();
+
+		// Update the progress after tracing
+		// @param _elapsedMs : The time spent tracing (milliseconds)
+		void UpdateProgress(float _elapsedMs);
+
+		// Hash the scene and settings the progressive planes depend on, the camera is stored on its own
+		// @param _key : Returned hash
+		// @returns bool : false if the scene cant be checkpointed (streamed or holding generic objects)
+		bool GetCheckpointKey(std::uint64_t& _key);
+
+		// Copy the progressive state and hand it to the checkpoint writer
+		// Only called between rows, where the planes and the pass agree
+		// @param _elapsedMs : The render time so far (milliseconds)
+		// @returns bool : false if the scene cant be checkpointed or the last checkpoint is still being written
+		bool TakeCheckpoint(float _elapsedMs);
+
+		// Get the pixel bounds of a tile
+		// @param _tile : The tile index (row major)
+		// @param _x0, _y0 : Returned top left corner
+		// @param _x1, _y1 : Returned bottom right corner (exclusive)
+		void GetTileBounds(int _tile, int& _x0, int& _y0, int& _x1, int& _y1);
+
+		// Hash the render settings an image depends on (precision, kernels, size, samples and shading)
+		// @param _hash : The hash to add them to
+		void HashRenderSettings(ContentHash& _hash);
+
+		// Hash the lights and every object record
+		// @param _hash : The hash to add them to
+		// @returns bool : false if the scene holds generic objects (they have no record to hash)
+		bool HashSceneContent(ContentHash& _hash);
+
+		// Hash everything a render depends on besides the objects in each tile
+		// @param _key : Returned hash
+		// @returns bool : false if the render cant use the tile cache
+		bool GetRenderKey(std::uint64_t& _key);
+
+		// Hash a tile, the render key with the tile bounds and the objects overlapping the tile frustum
+		// @param _tile : The tile index (row major)
+		// @param _renderKey : The render key (see GetRenderKey)
+		// @param _key : Returned hash
+		// @returns bool : false if the tile cant be cached (a generic object overlaps it)
+		bool GetTileKey(int _tile, std::uint64_t _renderKey, std::uint64_t& _key);
+
+		// Trace every pixel of a tile, or copy it from the tile cache
+		// @param _tile : The tile index (row major)
+		// @param _renderKey : The render key, nullptr to trace without the cache
+		void TraceTile(int _tile, const std::uint64_t* _renderKey);
+
+		// Project the scene into the visibility buffer if rasterized primary visibility is on and usable
+		// Scenes with generic objects, streamed scenes and renders with cost tracking are traced
+		// @returns bool : true if primary hits are rasterized this frame
+		bool PrepareVisibility();
+
+		// Render the image from rasterized primary hits, the shading and everything after is traced
+		// Every sample position is resolved in the visibility buffer and shaded before the next one
+		// @param _cancel : Optional, checked between samples
+		// @returns bool : false if cancelled
+		bool TraceRasterized(const std::atomic<bool>* _cancel);
+
+		// Average the per pixel sums into the image and surface planes, the same as TracePixel
+		void ResolveSampleSums();
+
+		// Background render job, runs on the job thread
+		// Tiles are split across worker threads, cancellation is checked before every tile
+		void RunJob();
 
 		// Public functions
 	public:
@@ -62,37 +510,338 @@ namespace MRT
 		// @param _color : RGB normalised color value
 		void SetBackgroundColor(ColorPixel _color);
 
+		// Set the amount of samples taken per pixel
+		// @param _samples : The amount of samples (1 to 64)
+		void SetSamples(int _samples);
+
+		// Get the amount of samples taken per pixel
+		// @returns int : The amount of samples (1 to 64)
+		int GetSamples() { return samplesPerPixel; }
+
+		// Toggle the denoising post-pass
+		// @param _enabled : true to denoise after rendering
+		void SetDenoise(bool _enabled) { CancelRender(); fDenoise = _enabled; }
+
+		// Add a light to the scene
+		// - Shading picks a few lights per point through a light tree, so thousands of lights
+		//   cost about the same as a few (see LightTree)
+		// - Lights arent drawn, add a Sphere at the same place to see a sphere light
+		// - Streamed scenes arent lit by lights, only by the headlight (shadow rays cant reach chunks)
+		// @param _position : The light position (sphere light center)
+		// @param _emission : Point lights: intensity, sphere lights: surface radiance
+		// @param _radius : Optional, sphere light radius (0 for a point light)
+		// @returns int : The light index, -1 on failure
+		int AddLight(rvec3 _position, ColorPixel _emission, real _radius = 0);
+
+		// Remove every light
+		void ClearLights();
+
+		// Set the amount of lights sampled per shading point
+		// @param _samples : The amount of light samples (1 to 16)
+		void SetLightSamples(int _samples);
+
+		// Set the strength of the light coming from the camera
+		// @param _strength : The headlight strength (1 by default, 0 to only use scene lights)
+		void SetHeadlight(float _strength);
+
+		// Set up ambient occlusion of the headlight
+		// - Occlusion is traced at a few points and interpolated between them through a world space
+		//   cache (see OcclusionCache), the cache is kept when the camera moves so later frames
+		//   mostly reuse it
+		// - Records are only worked out where rays land, so the first frame costs the most
+		// - Streamed scenes arent occluded
+		// @param _distance : How far objects block the light (0 to turn it off)
+		// @param _samples : Optional, rays traced per record (4 to 256)
+		void SetOcclusion(real _distance, int _samples = 32);
+
+		// Get the amount of ambient occlusion records cached
+		// @returns int : The record count
+		int GetOcclusionRecordCount() { return occlusionCache.GetRecordCount(); }
+
+		// Set up the tile cache
+		// - Tiles are stored under a hash of the camera, tile bounds, sample and shading settings and the
+		//   records overlapping the tile frustum, a tile with the same hash is copied instead of traced
+		// - Moving an object only traces the tiles it was or is in again
+		// - Lights and occlusion reach outside the tile frustum, with either on every record is hashed
+		// - Tiles with generic objects in them, streamed scenes and renders with cost tracking are traced
+		// - Used by RenderImage and RenderAsync, progressive renders and views are always traced
+		// @param _enabled : true to use the cache
+		// @param _budgetMB : Optional, memory the cache can hold (megabytes)
+		// @param _spillPath : Optional, existing folder tiles over the budget are written to and read back from
+		void SetTileCache(bool _enabled, int _budgetMB = 256, const std::string& _spillPath = std::string());
+
+		// Get what the tile cache has served and holds
+		// @returns TileCacheStats : The statistics
+		TileCacheStats GetTileCacheStats() { return tileCache.GetStats(); }
+
+		// Toggle rasterized primary visibility
+		// - Spheres and circles are projected to the pixels their bounds cover and the closest
+		//   per pixel is kept in an id and depth buffer (see VisibilityBuffer), shading, shadows
+		//   and occlusion then start from those hits
+		// - Images come out the same as traced ones, the cost of finding primary hits grows with
+		//   the pixels objects cover, which suits scenes of many small objects
+		// - Used by RenderImage and RenderAsync when the tile cache isnt, scenes with generic objects are traced
+		// @param _enabled : true to rasterize primary visibility
+		void SetRasterVisibility(bool _enabled) { CancelRender(); fRasterVisibility = _enabled; }
+
+		// Toggle per pixel cost tracking
+		// - Renders record intersection tests, traversal steps, samples and time per pixel in the cost plane
+		// - Counting is always on, the only extra work is reading the clock once per pixel
+		// @param _enabled : true to record costs
+		void SetCostTracking(bool _enabled) { CancelRender(); fCostTracking = _enabled; fProgressiveReset = true; }
+
+		// Get the cost plane, holds the costs of the last render with cost tracking on
+		// @returns const PixelCost* : The costs, row major from the top left
+		const PixelCost* GetCostPlane() { return camera.costPlane; }
+
+		// Write the cost plane as a false color heatmap ("<path>.ppm") and a raw float buffer ("<path>.raw")
+		// @param _path : The file path without extension
+		// @param _metric : The metric the heatmap shows, the raw buffer holds every metric
+		// @param _scale : Returned metric value shown as white in the heatmap
+		// @returns bool : true on success
+		bool SaveCostMap(const char* _path, CostMetric _metric, float& _scale);
+
+		// Get the denoiser to tweak its parameters
+		// @returns Denoiser& : The denoiser used by the post-pass
+		Denoiser& GetDenoiser() { return denoiser; }
+
 		// Set camera position in world using its method
 		// @param _position : The new position of the camera
-		void SetCameraPosition(glm::fvec3 _position) { camera.SetPosition(_position); }
+		void SetCameraPosition(rvec3 _position) { CancelRender(); camera.SetPosition(_position); fProgressiveReset = true; }
 
 		// Rotate camera using its method
 		// @param _axis : The axis to apply the rotation around
 		// @param _angle : The angle to be applied (degrees)
-		void SetCameraRotation(glm::fvec3 _axis, float _angle) { camera.SetRotation(_axis, _angle); }
+		void SetCameraRotation(rvec3 _axis, real _angle) { CancelRender(); camera.SetRotation(_axis, _angle); fProgressiveReset = true; }
 
 		// Set camera to look at a point using its method
 		// @param _point : The position vector to look at
-		void SetCameraTarget(glm::fvec3 _point) { camera.LookAt(_point); }
+		void SetCameraTarget(rvec3 _point) { CancelRender(); camera.LookAt(_point); fProgressiveReset = true; }
 
 		// Set camera FOV
 		// @param _fov : The new fov (degrees)
-		void SetCameraFOV(float _fov) { camera.SetFOV(_fov); }
+		void SetCameraFOV(real _fov) { CancelRender(); camera.SetFOV(_fov); fProgressiveReset = true; }
 
 		// Set the max viewing render distance of the camera using its method
 		// @param _distance : The new distance
-		void SetCameraRenderDistance(float _distance) { camera.SetRenderDistance(_distance); }
+		void SetCameraRenderDistance(real _distance) { CancelRender(); camera.SetRenderDistance(_distance); fProgressiveReset = true; }
 
 		// Add a Primitive object to the scene
+		// Streamed scenes cant be changed, clear them first
 		// @param _object : The object to add to the scene (needs to be created from new)
-		void AddPrimitive(Primitive* _object);
+		// @returns int : The object id, used to move and update it (-1 on failure, the object is not taken)
+		int AddPrimitive(Primitive* _object);
 
-		// Delete all primitives from the manager
+		// Get an object in the scene
+		// Cancel the background render (CancelRender) before changing it and call UpdatePrimitive after
+		// @param _id : The object id
+		// @returns Primitive* : The object, nullptr if the id is unknown
+		Primitive* GetPrimitive(int _id) { return (_id >= 0 && _id < primiAmount) ? primiManager[_id] : nullptr; }
+
+		// Move an object in the scene
+		// The BVH is refit rather than rebuilt, see UpdatePrimitive
+		// @param _id : The object id
+		// @param _position : The new position
+		// @returns bool : false if the id is unknown
+		bool MovePrimitive(int _id, rvec3 _position);
+
+		// Blend a part into a distance field object
+		// The background render is cancelled before the field is changed, see UpdatePrimitive
+		// @param _id : The object id
+		// @param _part : The part to blend in
+		// @returns bool : false if the id is unknown or isnt a distance field
+		bool AddDistanceFieldPart(int _id, const SDFPart& _part);
+
+		// Apply changes made to an object through GetPrimitive
+		// - The background render has to be cancelled before the object is changed, it may still
+		//   be tracing it (MovePrimitive and AddDistanceFieldPart do both)
+		// - Refits the BVH bottom up from the objects leaf, O(log n) per object
+		// - Once refitting has made the BVH too slow to trace, it is rebuilt on a background
+		//   thread and swapped in by the next render
+		// @param _id : The object id
+		// @returns bool : false if the id is unknown
+		bool UpdatePrimitive(int _id);
+
+		// Set how much worse the BVH can get through refitting before its rebuilt
+		// @param _threshold : Allowed ratio of the current to the freshly built cost (at least 1)
+		void SetRebuildThreshold(real _threshold) { rebuildThreshold = glm::max((real)1, _threshold); }
+
+		// Delete all primitives from the manager and every light, object ids start from 0 again
 		void ClearPrimitives();
 
+		// Load a texture objects can use
+		// @param _path : The binary PPM image to load
+		// @returns int : The texture index to give to Primitive::SetTexture, -1 on failure
+		int LoadTexture(const char* _path);
+
+		// Save the scene and camera to a snapshot file
+		// - Stores the scene arrays and the built BVH so loading it skips parsing and building
+		// - Only spheres and circles can be stored
+		// @param _path : The file to write
+		// @returns bool : true on success
+		bool SaveSnapshot(const char* _path);
+
+		// Load a snapshot file in place of the current scene
+		// - The file is memory mapped and traced in place, nothing is copied or rebuilt
+		// - Adding or changing objects afterwards turns the snapshot back into objects first,
+		//   spheres get the first ids followed by circles
+		// - The current scene is kept if the file cant be loaded
+		// @param _path : The file to load
+		// @returns bool : true on success
+		bool LoadSnapshot(const char* _path);
+
+		// Bake the scene into a C++ header (see WriteBakedScene)
+		// - For small scenes that never change, compiling the header in and loading it with
+		//   LoadBakedScene traces the scene through generated code instead of the BVH arrays
+		// - Only spheres and circles can be baked, up to maxBakedPrimitives
+		// - Only the walk gets faster, and less so as the scene grows since the code becomes
+		//   larger than the scene arrays it replaces
+		// @param _path : The header to write
+		// @param _name : The scene name, the struct in MRT::Baked the header defines
+		// @returns bool : true on success
+		bool BakeScene(const char* _path, const char* _name);
+
+		// Load a scene baked into the program in place of the current scene
+		// - Rays walk the generated code, the BVH is not built or read
+		// - Like a snapshot, adding or changing objects afterwards turns the scene back into objects first,
+		//   spheres get the first ids followed by circles
+		// - Lights are cleared, cost tracking doesnt count steps or tests through baked scenes
+		// @param _baked : The scene, from MakeBakedScene
+		// @returns bool : false if the scene is empty
+		bool LoadBakedScene(const BakedScene& _baked);
+
+		// Save the scene as a chunked scene for streaming (see ChunkBuilder)
+		// - Only spheres and circles can be stored
+		// - Scenes too large to add as objects can be written with ChunkBuilder directly
+		// @param _path : The chunk index to write, chunks are written next to it
+		// @param _gridSize : Chunks per axis (1 to 16), empty chunks are dropped
+		// @returns bool : true on success
+		bool SaveChunkedScene(const char* _path, int _gridSize);
+
+		// Stream a chunked scene in place of the current scene
+		// - Chunks are mapped as rays reach them and unmapped once over the stream budget,
+		//   so scenes larger than memory can be rendered
+		// - Streamed scenes are read only, clear them before adding objects
+		// - The current scene is kept if the index cant be opened
+		// @param _path : The chunk index to open
+		// @returns bool : true on success
+		bool OpenChunkedScene(const char* _path);
+
+		// Get the streamed scene to set its budget or check its paging statistics
+		// @returns ChunkCache& : The chunk cache, closed when no scene is streamed
+		ChunkCache& GetStreamedScene() { return streamed; }
+
 		// Raytrace the entire scene
 		void RenderScene();
 
+		// Raytrace the entire scene into the image plane without touching the window
+		// Rows are split across worker threads, the denoiser runs afterwards if enabled
+		void RenderImage();
+
+		// Get the image plane, holds the last rendered image
+		// @returns const ColorPixel* : The image, row major from the top left
+		const ColorPixel* GetImage() { return camera.imagePlane; }
+
+		// Get the image dimensions
+		// @returns int : The width/height in pixels
+		int GetWidth() { return screenW; }
+		int GetHeight() { return screenH; }
+
+		// Raytrace several views into their own images in one pass
+		// - The scene is prepared once and every view shares it, the blocks of all views are
+		//   split across worker threads together
+		// - Neighbouring pixels (and the pixels of paired views) are traced as packets that walk
+		//   the BVH once, see ViewSet::AddView
+		// - Views use the camera render distance, the denoiser runs on every view if enabled
+		// - Streamed scenes cant be rendered as views, cost tracking doesnt cover them
+		// @param _views : The views to render, their images are overwritten
+		// @returns bool : false if there are no views or a streamed scene is open
+		bool RenderViews(ViewSet& _views);
+
+		// Find the closest object each ray of a batch hits
+		// - For visibility and collision queries, rays dont have to come from the camera
+		// - Rays are split across worker threads, leaf spheres are tested through the SIMD kernels
+		// - Hits are the same as rendering finds, circles are only hit from one side (see Plane)
+		// - Streamed scenes cant be queried, the scene must not change while a query runs
+		// - A background render keeps running, it is only cancelled when the scene has changed since it was built
+		// @param _batch : The rays to trace, distances (and optionally object ids and normals) are returned into it
+		// @returns bool : false if the batch is empty or a streamed scene is open
+		bool IntersectRays(const RayBatch& _batch) { return QueryRays(_batch, false); }
+
+		// Find whether each ray of a batch hits anything within its max distance
+		// - Stops at the first object found, cheaper than IntersectRays for shadow and line of sight tests
+		// - The returned distance and object id are of the object found, which isnt always the closest
+		// @param _batch : The rays to trace, distances (and optionally object ids) are returned into it
+		// @returns bool : false if the batch is empty or a streamed scene is open
+		bool OccludedRays(const RayBatch& _batch) { return QueryRays(_batch, true); }
+
+		// Get the camera as a view, to place the ViewSet presets
+		// @returns ViewDesc : The camera and the screen dimensions
+		ViewDesc GetCameraView();
+
+		// Progressively raytrace the scene within a time budget
+		// - Starts with 1/8 resolution, refines to full resolution and then adds samples
+		//   up to the samples per pixel setting
+		// - Calling it again continues where it stopped, unless the scene or camera changed
+		// - Always traces at least one row so repeated calls make progress
+		// @param _budgetMs : The maximum time to spend rendering (milliseconds)
+		// @returns bool : true once the image is complete
+		bool RenderProgressive(float _budgetMs);
+
+		// Get the progress of the progressive render
+		// @returns RenderProgress : The current progress
+		RenderProgress GetProgress() { return progress; }
+
+		// Checkpoint progressive renders as they go (see RenderCheckpoint)
+		// - Taken between rows once the interval of render time has passed, and when the render completes
+		// - The planes are copied and written on a background thread, tracing carries on meanwhile,
+		//   a checkpoint due while the last is still being written is skipped
+		// - Streamed scenes and scenes with generic objects arent checkpointed
+		// @param _path : The file to write, replaced atomically by every checkpoint
+		// @param _intervalMs : Render time between checkpoints (milliseconds), 0 turns checkpoints off
+		void SetCheckpoint(const std::string& _path, float _intervalMs);
+
+		// Continue a progressive render from a checkpoint
+		// - The scene and render settings have to be the same as when it was written,
+		//   the camera and the ambient occlusion records are restored from the checkpoint
+		// - The next RenderProgressive carries on from the stored row, and ends with the
+		//   same image as a render that was never stopped
+		// @param _path : The checkpoint file
+		// @returns bool : false if the file cant be read or was written for another scene or settings
+		bool ResumeCheckpoint(const char* _path);
+
+		// Wait for the checkpoint being written to finish
+		// @returns bool : true if the last checkpoint was written
+		bool FlushCheckpoint() { return checkpointWriter.Wait(); }
+
+		// Start rendering the scene on a background thread
+		// - Cancels any render thats already running
+		// - Changing the scene or camera, or starting any other render, cancels the job
+		// @returns RenderJob* : Handle to poll and cancel the render, nullptr on failure
+		RenderJob* RenderAsync();
+
+		// Cancel the background render and wait for it to stop
+		// A render stopped part way leaves the preview to refine the image again
+		void CancelRender();
+
+		// Present tiles the background render has finished since the last call
+		// Must be called from the thread that owns the window
+		// @returns bool : true if any tiles were presented
+		bool PresentRender();
+
+		// Refine the preview through its passes (1/8, 1/4, 1/2 then full resolution)
+		// - Traces rows until the budget is used up or the current pass is done, the next call carries on
+		// - Shares the progressive render state, pixels traced by earlier passes are reused
+		//   and a later render carries on from the preview
+		// - Starts over at 1/8 resolution as soon as the scene or camera changes
+		// @param _budgetMs : Time to spend tracing (milliseconds), checked per row
+		// @returns bool : true once full resolution has been reached
+		bool RefinePreview(float _budgetMs);
+
+		// Check the preview has reached full resolution for the current scene and camera
+		// @returns bool : true if there is nothing left to refine
+		bool IsPreviewComplete() { return !fProgressiveReset && (fProgressiveReplaced || progress.pass >= progressiveLevels); }
+
 		// Instantiation
 		// @param _screenWidth : The window screen width
 		// @param _screenHeight : The window screen height
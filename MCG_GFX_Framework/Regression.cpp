@@ -0,0 +1,237 @@
+#include "Regression.h"
+
+// Included libraries
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+// Core modules
+#include "Sphere.h"
+#include "Circle.h"
+#include "ImageFile.h"
+
+// Regression Suite
+namespace MRT
+{
+	namespace
+	{
+		const char* sceneNames[]{ "spheres", "circles", "dense", "denoised" };
+		const int sceneCount{ (int)(sizeof(sceneNames) / sizeof(sceneNames[0])) };
+
+		// Deterministic random numbers (0 to 1.f), rand() differs between platforms
+		float NextRandom(unsigned int& _state)
+		{
+			_state = (_state * 1664525u) + 1013904223u;
+			return (_state >> 8) * (1.f / 16777216.f);
+		}
+
+		// Round a channel to the 8 bits golden images are stored with
+		float Quantise(float _value)
+		{
+			if (!(_value > 0)) return 0;
+			if (_value >= 1) return 1;
+			return (float)(int)(_value * 255.f + 0.5f) / 255.f;
+		}
+
+		std::string ScenePath(const std::string& _directory, const char* _name, const char* _extension)
+		{
+			return _directory + "/" + _name + _extension;
+		}
+
+		// Read "<scene> <raysPerSecond>" lines
+		void ReadBaseline(const std::string& _path, std::map<std::string, double>& _baseline)
+		{
+			std::ifstream file(_path);
+			std::string scene;
+			double raysPerSecond;
+			while (file >> scene >> raysPerSecond)
+				_baseline[scene] = raysPerSecond;
+		}
+	}
+
+	int RegressionSuite::GetSceneCount()
+	{
+		return sceneCount;
+	}
+
+	const char* RegressionSuite::GetSceneName(int _scene)
+	{
+		return (_scene >= 0 && _scene < sceneCount) ? sceneNames[_scene] : "";
+	}
+
+	void RegressionSuite::SetImageTolerance(float _pixelTolerance, float _maxBadPixels)
+	{
+		pixelTolerance = glm::max(0.f, _pixelTolerance);
+		maxBadPixels = glm::max(0.f, glm::min(1.f, _maxBadPixels));
+	}
+
+	void RegressionSuite::SetSpeedThreshold(float _threshold)
+	{
+		speedThreshold = glm::max(0.f, glm::min(1.f, _threshold));
+	}
+
+	void RegressionSuite::BuildScene(RayTracer& _raytracer, int _scene)
+	{
+		_raytracer.SetCameraPosition({ 0, 0, 10 });
+		switch (_scene)
+		{
+			// spheres, overlapping spheres on a floor
+		case 0:
+		{
+			_raytracer.AddPrimitive(new Sphere({ 0, 0, 0 }, 2, { 1, 0, 0 }));
+			_raytracer.AddPrimitive(new Sphere({ 3, 1, -2 }, 1.5f, { 0, 1, 0 }));
+			_raytracer.AddPrimitive(new Sphere({ -2.5f, -1, 1 }, 1, { 0, 0, 1 }));
+			_raytracer.AddPrimitive(new Circle({ 0, -2, 0 }, { 0, 1, 0 }, 10, { 0.5f, 0.5f, 0.5f }));
+			break;
+		}
+			// circles, facing away from the camera at different angles
+		case 1:
+		{
+			for (int i = 0; i < 9; ++i)
+			{
+				float x = (float)((i % 3) - 1) * 3.f, y = (float)((i / 3) - 1) * 3.f;
+				_raytracer.AddPrimitive(new Circle({ x, y, -(float)i }, { x * 0.1f, y * 0.1f, -1 }, 1.2f, { 0.2f + i * 0.1f, 0.5f, 1 - i * 0.1f }));
+			}
+			break;
+		}
+			// dense, thousands of small spheres to stress the BVH
+		case 2:
+		{
+			unsigned int state = 1;
+			for (int i = 0; i < 20000; ++i)
+			{
+				rvec3 position((NextRandom(state) - 0.5f) * 16, (NextRandom(state) - 0.5f) * 12, -NextRandom(state) * 20);
+				float radius = 0.05f + NextRandom(state) * 0.2f;
+				_raytracer.AddPrimitive(new Sphere(position, radius, { NextRandom(state), NextRandom(state), NextRandom(state) }));
+			}
+			break;
+		}
+			// denoised, multiple samples per pixel with the denoising pass
+		case 3:
+		{
+			_raytracer.SetSamples(8);
+			_raytracer.SetDenoise(true);
+			_raytracer.AddPrimitive(new Sphere({ 0, 0, 0 }, 2, { 1, 0.5f, 0 }));
+			_raytracer.AddPrimitive(new Sphere({ 1.5f, 1.5f, 1 }, 0.5f, { 0, 1, 1 }));
+			_raytracer.AddPrimitive(new Circle({ 0, -2, 0 }, { 0, 1, 0.2f }, 8, { 0.8f, 0.8f, 0.8f }));
+			break;
+		}
+		}
+	}
+
+	double RegressionSuite::TimeRenders(RayTracer& _raytracer)
+	{
+		// The first render also builds the scene arrays, it isnt timed
+		_raytracer.RenderImage();
+
+		// Renders are repeated until enough time has been measured, the median
+		// ignores the few that were slowed down by the rest of the machine
+		std::vector<double> times;
+		double totalMs = 0;
+		while ((int)times.size() < minTimedRuns || (totalMs < minTimedMs && (int)times.size() < maxTimedRuns))
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			_raytracer.RenderImage();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			times.push_back(ms);
+			totalMs += ms;
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		const double medianMs = times[times.size() / 2];
+
+		double rays = (double)imageWidth * imageHeight * _raytracer.GetSamples();
+		return rays / (glm::max(medianMs, 1e-3) / 1000.0);
+	}
+
+	void RegressionSuite::CompareImage(const ColorPixel* _image, const std::string& _golden, RegressionResult& _result)
+	{
+		std::vector<ColorPixel> golden;
+		int width, height;
+		if (!ReadImagePPM(_golden.c_str(), golden, width, height) || width != imageWidth || height != imageHeight)
+		{
+			_result.fGoldenMissing = true;
+			return;
+		}
+
+		// Golden images are stored with 8 bits per channel, compare against the stored precision
+		const int pixels = imageWidth * imageHeight;
+		double errorSum = 0;
+		int bad = 0;
+		for (int i = 0; i < pixels; ++i)
+		{
+			ColorPixel stored{ Quantise(_image[i].r), Quantise(_image[i].g), Quantise(_image[i].b) };
+			float error = glm::max(glm::abs(stored.r - golden[i].r), glm::max(glm::abs(stored.g - golden[i].g), glm::abs(stored.b - golden[i].b)));
+			errorSum += error;
+			_result.maxError = glm::max(_result.maxError, error);
+			if (error > pixelTolerance) ++bad;
+		}
+
+		_result.meanError = (float)(errorSum / pixels);
+		_result.badPixels = (float)bad / pixels;
+		_result.fImagePassed = _result.badPixels <= maxBadPixels;
+	}
+
+	bool RegressionSuite::Run(const char* _directory, std::vector<RegressionResult>& _results)
+	{
+		std::string directory(_directory);
+		std::map<std::string, double> baseline;
+		ReadBaseline(directory + "/baseline.txt", baseline);
+
+		_results.clear();
+		bool passed = true;
+		for (int s = 0; s < sceneCount; ++s)
+		{
+			RegressionResult result;
+			result.scene = sceneNames[s];
+
+			RayTracer raytracer(imageWidth, imageHeight);
+			if (!raytracer.IsInit()) return false;
+			BuildScene(raytracer, s);
+
+			result.raysPerSecond = TimeRenders(raytracer);
+
+			CompareImage(raytracer.GetImage(), ScenePath(directory, sceneNames[s], ".ppm"), result);
+
+			std::map<std::string, double>::iterator stored = baseline.find(result.scene);
+			result.fBaselineMissing = stored == baseline.end();
+			if (!result.fBaselineMissing) result.baselineRaysPerSecond = stored->second;
+			result.fSpeedPassed = result.fBaselineMissing || result.raysPerSecond >= result.baselineRaysPerSecond * (1.0 - speedThreshold);
+
+			if (!result.fImagePassed)
+				WriteImagePPM(ScenePath(directory, sceneNames[s], ".out.ppm").c_str(), raytracer.GetImage(), imageWidth, imageHeight);
+
+			passed &= result.fImagePassed && result.fSpeedPassed;
+			_results.push_back(result);
+		}
+		return passed;
+	}
+
+	bool RegressionSuite::Update(const char* _directory, std::vector<RegressionResult>& _results)
+	{
+		std::string directory(_directory);
+		std::ofstream baseline(directory + "/baseline.txt", std::ios::trunc);
+		if (!baseline.is_open()) return false;
+
+		_results.clear();
+		bool written = true;
+		for (int s = 0; s < sceneCount; ++s)
+		{
+			RegressionResult result;
+			result.scene = sceneNames[s];
+
+			RayTracer raytracer(imageWidth, imageHeight);
+			if (!raytracer.IsInit()) return false;
+			BuildScene(raytracer, s);
+
+			result.raysPerSecond = TimeRenders(raytracer);
+
+			written &= WriteImagePPM(ScenePath(directory, sceneNames[s], ".ppm").c_str(), raytracer.GetImage(), imageWidth, imageHeight);
+			baseline << result.scene << " " << result.raysPerSecond << "\n";
+
+			result.fImagePassed = result.fSpeedPassed = written;
+			_results.push_back(result);
+		}
+		return written && baseline.good();
+	}
+}
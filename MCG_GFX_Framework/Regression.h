@@ -0,0 +1,110 @@
+#ifndef _REGRESSION_H_
+#define _REGRESSION_H_
+
+// Included libraries
+#include <string>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "RayTracer.h"
+
+namespace MRT
+{
+	// RegressionResult
+	// - Result of checking a single reference scene
+	struct RegressionResult
+	{
+		// The reference scene name
+		std::string scene;
+
+		// Image check, errors are per channel (0 to 1.f)
+		bool fImagePassed{ false };
+		// No golden image was found (or its dimensions differ)
+		bool fGoldenMissing{ false };
+		float meanError{ 0 }, maxError{ 0 };
+		// Fraction of pixels with a channel further than the pixel tolerance from the golden image
+		float badPixels{ 0 };
+
+		// Speed check, primary rays traced per second (median of the timed renders)
+		bool fSpeedPassed{ false };
+		// No baseline was stored for the scene
+		bool fBaselineMissing{ false };
+		double raysPerSecond{ 0 }, baselineRaysPerSecond{ 0 };
+	};
+
+	// RegressionSuite
+	// - Renders a fixed set of reference scenes headless, on its own RayTracer
+	// - Images are compared against golden images, throughput against a stored baseline
+	// - Goldens are stored as "<directory>/<scene>.ppm", the baseline as "<directory>/baseline.txt"
+	// - Neither is kept in the repository, throughput depends on the machine and the images on the
+	//   precision and kernels of the build, create them with Update (the 'regress <directory> update'
+	//   instruction) on a known good build of the same machine before making a change
+	// - Failed scenes write their image to "<directory>/<scene>.out.ppm" to compare by eye
+	class RegressionSuite
+	{
+	private:
+		// Reference scene resolution
+		static const int imageWidth{ 320 }, imageHeight{ 240 };
+		// Timed renders per scene, repeated until both minimums are reached (or the maximum runs),
+		// a single render of a reference scene is too short to time on its own
+		static const int minTimedRuns{ 5 }, maxTimedRuns{ 200 };
+		static constexpr double minTimedMs{ 1000.0 };
+
+		// Largest channel difference a pixel can have and still match (0 to 1.f)
+		float pixelTolerance{ 2.f / 255.f };
+		// Fraction of pixels allowed past the pixel tolerance
+		float maxBadPixels{ 0.001f };
+		// Fraction of the baseline throughput allowed to be lost, runs on a busy machine vary by more than 10%
+		float speedThreshold{ 0.25f };
+
+		// Set up a reference scene
+		// @param _raytracer : The raytracer to fill (empty)
+		// @param _scene : The scene index
+		void BuildScene(RayTracer& _raytracer, int _scene);
+
+		// Render a reference scene repeatedly and measure its throughput
+		// @param _raytracer : The raytracer holding the scene
+		// @returns double : Primary rays per second of the median render
+		double TimeRenders(RayTracer& _raytracer);
+
+		// Compare an image against its golden image
+		// @param _image : The rendered image
+		// @param _golden : The golden image path
+		// @param _result : Returned image errors
+		void CompareImage(const ColorPixel* _image, const std::string& _golden, RegressionResult& _result);
+
+	public:
+		// Get the amount of reference scenes
+		// @returns int : The amount of scenes
+		int GetSceneCount();
+
+		// Get the name of a reference scene
+		// @param _scene : The scene index
+		// @returns const char* : The name, used for the golden image file
+		const char* GetSceneName(int _scene);
+
+		// Set how close images have to match
+		// @param _pixelTolerance : Largest channel difference a pixel can have (0 to 1.f)
+		// @param _maxBadPixels : Fraction of pixels allowed past the tolerance (0 to 1.f)
+		void SetImageTolerance(float _pixelTolerance, float _maxBadPixels);
+
+		// Set how much throughput can drop before the speed check fails
+		// @param _threshold : Fraction of the baseline rays per second allowed to be lost (0 to 1.f)
+		void SetSpeedThreshold(float _threshold);
+
+		// Render every reference scene and check it
+		// @param _directory : Directory holding the golden images and baseline
+		// @param _results : Returned result per scene
+		// @returns bool : true if every scene passed
+		bool Run(const char* _directory, std::vector<RegressionResult>& _results);
+
+		// Render every reference scene and store them as the new golden images and baseline
+		// @param _directory : Directory to write the golden images and baseline to (must exist)
+		// @param _results : Returned result per scene (only the throughput is filled in)
+		// @returns bool : true if everything was written
+		bool Update(const char* _directory, std::vector<RegressionResult>& _results);
+	};
+}
+
+#endif // !_REGRESSION_H_
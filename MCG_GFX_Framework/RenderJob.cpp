@@ -0,0 +1,62 @@
+#include "RenderJob.h"
+
+// RenderJob
+namespace MRT
+{
+	void RenderJob::Reset(int _tiles)
+	{
+		// Never reset a job thats still running
+		Cancel();
+
+		tilesDone = 0;
+		tilesTotal = _tiles;
+		finishedTiles.clear();
+		finishedTiles.reserve(_tiles);
+		startTime = std::chrono::steady_clock::now();
+		elapsedMs = 0;
+		fCancel = false;
+		fRunning = true;
+	}
+
+	void RenderJob::FinishTile(int _tile)
+	{
+		std::lock_guard<std::mutex> lock(tileLock);
+		finishedTiles.push_back(_tile);
+		++tilesDone;
+	}
+
+	void RenderJob::Finish()
+	{
+		elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		fRunning = false;
+	}
+
+	float RenderJob::GetProgress()
+	{
+		return tilesTotal > 0 ? (float)tilesDone / tilesTotal : 0.f;
+	}
+
+	float RenderJob::GetElapsed()
+	{
+		if (!fRunning) return elapsedMs;
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	void RenderJob::Cancel()
+	{
+		fCancel = true;
+		Wait();
+	}
+
+	void RenderJob::Wait()
+	{
+		if (worker.joinable()) worker.join();
+	}
+
+	RenderJob::RenderJob()
+	{}
+	RenderJob::~RenderJob()
+	{
+		Cancel();
+	}
+}
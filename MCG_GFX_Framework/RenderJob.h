@@ -0,0 +1,86 @@
+#ifndef _RENDERJOB_H_
+#define _RENDERJOB_H_
+
+// Included libraries
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MRT
+{
+	// RenderJob
+	// - Handle to a render running on a background thread, started by MRT::RayTracer
+	// - The image is split into tiles, finished tiles are queued up for the UI thread to present
+	// - Cancellation is cooperative, workers check for it before starting every tile
+	class RenderJob
+	{
+		// Let MRT::RayTracer run the job
+		friend class RayTracer;
+
+	private:
+		// The thread running the job
+		std::thread worker;
+
+		// Tile counts
+		std::atomic<int> tilesDone{ 0 };
+		int tilesTotal{ 0 };
+
+		// Tiles finished but not yet presented, guarded by tileLock
+		// tileLock is also held while finished tiles are copied to the front buffer,
+		// and by the worker while it changes finished tiles (e.g denoising)
+		std::vector<int> finishedTiles;
+		std::mutex tileLock;
+
+		// Time the job started and how long it ran for (milliseconds)
+		std::chrono::steady_clock::time_point startTime;
+		std::atomic<float> elapsedMs{ 0 };
+
+		// RenderJob flags
+		// Check the job is still working
+		std::atomic<bool> fRunning{ false };
+		// Check the job has been asked to stop
+		std::atomic<bool> fCancel{ false };
+
+		// Reset the job for a new render
+		// @param _tiles : The amount of tiles to render
+		void Reset(int _tiles);
+
+		// Queue a finished tile to be presented
+		// @param _tile : The tile index
+		void FinishTile(int _tile);
+
+		// Mark the job as stopped, called by the worker when its done
+		void Finish();
+
+	public:
+		// Check the job is still rendering
+		// @returns bool : true while the worker is running
+		bool IsRunning() { return fRunning; }
+
+		// Check the job was cancelled before every tile was done
+		// @returns bool : true if cancelled
+		bool IsCancelled() { return fCancel && tilesDone < tilesTotal; }
+
+		// Get the render progress
+		// @returns float : Fraction of tiles finished (0 to 1.f)
+		float GetProgress();
+
+		// Get how long the job has been running
+		// @returns float : Time in milliseconds
+		float GetElapsed();
+
+		// Ask the job to stop and wait for the worker to leave
+		// Tiles already being traced are finished first
+		void Cancel();
+
+		// Wait for the job to finish
+		void Wait();
+
+		RenderJob();
+		~RenderJob();
+	};
+}
+
+#endif // !_RENDERJOB_H_
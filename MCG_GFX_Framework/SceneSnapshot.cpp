@@ -0,0 +1,127 @@
+#include "SceneSnapshot.h"
+
+// Included libraries
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// Core modules
+#include "MappedFile.h"
+
+// Scene Snapshot
+namespace MRT
+{
+	namespace
+	{
+		const char snapshotMagic[8]{ 'M', 'R', 'T', 'S', 'C', 'E', 'N', 'E' };
+		const std::uint32_t snapshotEndianTag{ 0x01020304u };
+		// Array alignment in the file
+		const std::uint64_t snapshotAlignment{ 64 };
+
+		std::uint64_t AlignOffset(std::uint64_t _offset)
+		{
+			return (_offset + snapshotAlignment - 1) & ~(snapshotAlignment - 1);
+		}
+
+		// Check an array fits inside the file and is aligned
+		bool CheckArray(std::uint64_t _offset, std::uint32_t _count, size_t _elementSize, size_t _fileSize)
+		{
+			if (_count == 0) return true;
+			if (_offset % snapshotAlignment != 0 || _offset > _fileSize) return false;
+			return (_fileSize - _offset) / _elementSize >= _count;
+		}
+
+		// Write an array at its offset, padding the gap before it
+		bool WriteArray(std::ofstream& _file, std::uint64_t _offset, const void* _data, size_t _bytes)
+		{
+			static const char padding[snapshotAlignment]{ 0 };
+			std::uint64_t position = (std::uint64_t)_file.tellp();
+			if (position > _offset) return false;
+			_file.write(padding, (std::streamsize)(_offset - position));
+			if (_bytes > 0) _file.write((const char*)_data, (std::streamsize)_bytes);
+			return _file.good();
+		}
+	}
+
+	bool WriteSnapshot(const char* _path, const SceneView& _scene, const SnapshotCamera& _camera)
+	{
+		// Every reference has to point at a stored record
+		if (_scene.refCount != _scene.sphereCount + _scene.circleCount) return false;
+
+		SnapshotHeader header;
+		std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+		header.version = snapshotVersion;
+		header.endianTag = snapshotEndianTag;
+		header.headerSize = sizeof(SnapshotHeader);
+		header.sphereSize = sizeof(SphereRecord);
+		header.circleSize = sizeof(CircleRecord);
+		header.nodeSize = sizeof(BVHNode);
+		header.realSize = sizeof(real);
+		header.camera = _camera;
+
+		header.sphereCount = (std::uint32_t)_scene.sphereCount;
+		header.circleCount = (std::uint32_t)_scene.circleCount;
+		header.nodeCount = (std::uint32_t)_scene.nodeCount;
+		header.refCount = (std::uint32_t)_scene.refCount;
+		header.sphereOffset = AlignOffset(sizeof(SnapshotHeader));
+		header.circleOffset = AlignOffset(header.sphereOffset + (std::uint64_t)header.sphereCount * sizeof(SphereRecord));
+		header.nodeOffset = AlignOffset(header.circleOffset + (std::uint64_t)header.circleCount * sizeof(CircleRecord));
+		header.refOffset = AlignOffset(header.nodeOffset + (std::uint64_t)header.nodeCount * sizeof(BVHNode));
+		header.fileSize = header.refOffset + (std::uint64_t)header.refCount * sizeof(unsigned int);
+
+		std::string tempPath = std::string(_path) + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) return false;
+
+			bool written = WriteArray(file, 0, &header, sizeof(header)) &&
+				WriteArray(file, header.sphereOffset, _scene.spheres, header.sphereCount * sizeof(SphereRecord)) &&
+				WriteArray(file, header.circleOffset, _scene.circles, header.circleCount * sizeof(CircleRecord)) &&
+				WriteArray(file, header.nodeOffset, _scene.nodes, header.nodeCount * sizeof(BVHNode)) &&
+				WriteArray(file, header.refOffset, _scene.refs, header.refCount * sizeof(unsigned int));
+			file.close();
+			if (!written || file.fail())
+			{
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+		// Swap the finished file in
+		return CommitFile(tempPath.c_str(), _path, true);
+	}
+
+	bool ReadSnapshot(const unsigned char* _data, size_t _size, SceneView& _scene, SnapshotCamera& _camera)
+	{
+		if (_data == nullptr || _size < sizeof(SnapshotHeader)) return false;
+		const SnapshotHeader& header = *(const SnapshotHeader*)_data;
+
+		// Check the file was written by a compatible build
+		if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) return false;
+		if (header.version != snapshotVersion || header.endianTag != snapshotEndianTag) return false;
+		if (header.headerSize != sizeof(SnapshotHeader) || header.sphereSize != sizeof(SphereRecord) ||
+			header.circleSize != sizeof(CircleRecord) || header.nodeSize != sizeof(BVHNode) ||
+			header.realSize != sizeof(real)) return false;
+		if (header.fileSize > _size) return false;
+
+		// Check every array is inside the file
+		if (!CheckArray(header.sphereOffset, header.sphereCount, sizeof(SphereRecord), _size) ||
+			!CheckArray(header.circleOffset, header.circleCount, sizeof(CircleRecord), _size) ||
+			!CheckArray(header.nodeOffset, header.nodeCount, sizeof(BVHNode), _size) ||
+			!CheckArray(header.refOffset, header.refCount, sizeof(unsigned int), _size)) return false;
+		if (header.refCount != header.sphereCount + header.circleCount) return false;
+		if ((header.nodeCount == 0) != (header.refCount == 0)) return false;
+
+		_camera = header.camera;
+		_scene.spheres = (const SphereRecord*)(_data + header.sphereOffset);
+		_scene.circles = (const CircleRecord*)(_data + header.circleOffset);
+		_scene.nodes = (const BVHNode*)(_data + header.nodeOffset);
+		_scene.refs = (const unsigned int*)(_data + header.refOffset);
+		_scene.sphereCount = (int)header.sphereCount;
+		_scene.circleCount = (int)header.circleCount;
+		_scene.nodeCount = (int)header.nodeCount;
+		_scene.refCount = (int)header.refCount;
+		return true;
+	}
+}
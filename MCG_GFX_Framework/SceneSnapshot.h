@@ -0,0 +1,74 @@
+#ifndef _SCENESNAPSHOT_H_
+#define _SCENESNAPSHOT_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <cstddef>
+#include <cstdint>
+
+// Core modules
+#include "UtilityModules.h"
+#include "BVH.h"
+
+namespace MRT
+{
+	// Current snapshot format version, bumped whenever a record or the header changes
+	const std::uint32_t snapshotVersion{ 3 };
+
+	// SnapshotCamera
+	// - Camera state stored in a snapshot
+	struct SnapshotCamera
+	{
+		rvec3 position;
+		// Column major rotation matrix
+		real camRotation[16]{ 0 };
+		// Stored as tan(fov / 2), the same as MRT::Camera
+		real fov{ 0 };
+		real maxViewingDistance{ 0 };
+		ColorPixel background;
+	};
+
+	// SnapshotHeader
+	// - Start of a scene snapshot file, followed by the record and BVH arrays
+	// - Arrays start on 64 byte boundaries so they can be traced straight from the mapping
+	// - Record and scalar sizes are stored so a build with a different layout or precision rejects the file
+	struct SnapshotHeader
+	{
+		char magic[8]{ 0 };
+		std::uint32_t version{ 0 };
+		// Written as 0x01020304, a different byte order reads back differently
+		std::uint32_t endianTag{ 0 };
+		std::uint32_t headerSize{ 0 }, sphereSize{ 0 }, circleSize{ 0 }, nodeSize{ 0 };
+		// Size of the scalar the file was written with (see Precision.h)
+		std::uint32_t realSize{ 0 };
+		SnapshotCamera camera;
+		// Array counts and byte offsets from the start of the file
+		std::uint32_t sphereCount{ 0 }, circleCount{ 0 }, nodeCount{ 0 }, refCount{ 0 };
+		std::uint64_t sphereOffset{ 0 }, circleOffset{ 0 }, nodeOffset{ 0 }, refOffset{ 0 };
+		std::uint64_t fileSize{ 0 };
+	};
+
+	// Write a scene snapshot
+	// - Records store texture indices but not the textures, load the same textures
+	//   in the same order before tracing a snapshot that uses them
+	// - Written to "<path>.tmp" first and renamed over the path once complete,
+	//   a failed write never leaves a half written snapshot behind
+	// - The scene cant contain generic primitives (only spheres and circles are stored)
+	// @param _path : The file to write
+	// @param _scene : The scene arrays and BVH to store
+	// @param _camera : The camera state to store
+	// @returns bool : true on success
+	bool WriteSnapshot(const char* _path, const SceneView& _scene, const SnapshotCamera& _camera);
+
+	// Read a mapped scene snapshot in place
+	// - Only the header is checked (magic, version, layout, array bounds), the arrays
+	//   are used as they are so pages are only loaded once rays touch them
+	// @param _data : The mapped file
+	// @param _size : The size of the mapping
+	// @param _scene : Returned scene, points into _data
+	// @param _camera : Returned camera state
+	// @returns bool : true if the snapshot is valid
+	bool ReadSnapshot(const unsigned char* _data, size_t _size, SceneView& _scene, SnapshotCamera& _camera);
+}
+
+#endif // !_SCENESNAPSHOT_H_
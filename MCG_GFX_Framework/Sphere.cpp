@@ -5,48 +5,43 @@ namespace MRT
 {
 	bool Sphere::Intersect(Ray& _ray)
 	{
-		// Get ray origin and direction
-		glm::fvec3 rO = _ray.GetOrigin(), rD = _ray.GetDirection();
-
-		// Calculate vector from ray origin to sphere origin
-		glm::fvec3 lRO = position - rO;
-		// Project lRO length onto ray direction
-		float lPD = glm::dot(lRO, rD);
-		// Ray wont intersect if the projected length is behind it
-		if (lPD < 0) return false;
-
-		// Get the length of the middle point of the ray to the sphere origin
-		float mL = glm::dot(lRO, lRO) - (lPD * lPD);
-		// Ray wont interesect if the length is greater than the radius
-		if (mL > radiusSqr) return false;
-
-		// Calculate half the length from mL mapped to the ray direction
-		float sHL = glm::sqrt(radiusSqr - mL);
+		return IntersectRecord(GetRecord(), _ray);
+	}
 
-		// Calculate the possible starting and ending intersects
-		float iStart = lPD - sHL,
-			iEnd = lPD + sHL;
+	void Sphere::GetBounds(rvec3& _min, rvec3& _max)
+	{
+		GetRecordBounds(GetRecord(), _min, _max);
+	}
 
-		float intersect = iStart;
+	bool Sphere::IntersectRecord(const SphereRecord& _sphere, Ray& _ray)
+	{
+		// Get ray origin and direction
+		rvec3 rO = _ray.GetOrigin(), rD = _ray.GetDirection();
+		real intersect = _ray.GetLength();
+		if (!IntersectRecordLength(_sphere, rO, rD, intersect)) return false;
 
-		// If either intersection lengths are less than 0, there is no intersect
-		if (iStart < 0)
+		// Send hit information to the ray
+		HitInformation hitInfo{ intersect, NormalizeFast((rO + rD * intersect) - _sphere.position), _sphere.color, _sphere.texture };
+		if (_sphere.texture >= 0)
 		{
-			intersect = iEnd;
-			if (iEnd < 0) return false;
+			// Spherical mapping, U goes around the equator and V from pole to pole
+			const rvec3& n = hitInfo.hitNormal;
+			hitInfo.uv = glm::fvec2((float)(0.5f + (glm::atan(n.z, n.x) * 0.159154943f)), (float)(glm::acos(glm::clamp(n.y, (real)-1, (real)1)) * 0.318309886f));
+			// The equator is the longest distance one UV unit covers
+			hitInfo.uvScale = (float)(6.28318531f * _sphere.radius);
 		}
-
-		// Check if intersect length is greater than current ray length
-		if (_ray.GetLength() < intersect) return false;
-
-		// Send hit information to the ray
-		HitInformation hitInfo{ intersect, glm::normalize((rO + rD * intersect) - position), color };
 		_ray.SetHitInfo(hitInfo);
 
 		return true;
 	}
 
-	Sphere::Sphere(glm::fvec3 _position, float _radius, ColorPixel _color)
+	void Sphere::GetRecordBounds(const SphereRecord& _sphere, rvec3& _min, rvec3& _max)
+	{
+		_min = _sphere.position - rvec3(_sphere.radius);
+		_max = _sphere.position + rvec3(_sphere.radius);
+	}
+
+	Sphere::Sphere(rvec3 _position, real _radius, ColorPixel _color)
 		:
 		Primitive(_position, _color),
 		radius{ _radius }
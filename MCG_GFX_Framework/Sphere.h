@@ -11,13 +11,24 @@
 
 namespace MRT
 {
+	// SphereRecord
+	// - Flat copy of a sphere used by the RayTracer scene arrays
+	// - Plain data, can be written to and mapped straight from disk
+	struct SphereRecord
+	{
+		rvec3 position;
+		real radius{ 0 }, radiusSqr{ 0 };
+		ColorPixel color;
+		int texture{ -1 };
+	};
+
 	// Sphere
 	// - Extends Primitive
 	// - Used for creating sphere shapes
 	class Sphere : public Primitive
 	{
 	private:
-		float radius{ 0 }, radiusSqr{ 0 };
+		real radius{ 0 }, radiusSqr{ 0 };
 
 	public:
 		// Check if ray intersects sphere
@@ -26,8 +37,122 @@ namespace MRT
 		// @returns bool : true if intersecting
 		bool Intersect(Ray& _ray) override;
 
-		Sphere(glm::fvec3 _position, float _radius, ColorPixel _color = { 1, 0, 0 });
+		// Get the bounding box of the sphere
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		void GetBounds(rvec3& _min, rvec3& _max) override;
+
+		// Set the radius
+		// @param _radius : The new radius
+		void SetRadius(real _radius) { radius = _radius; radiusSqr = _radius * _radius; }
+
+		// Get the radius
+		// @returns real : The radius
+		real GetRadius() { return radius; }
+
+		// Get the primitive type
+		// @returns PrimitiveType : Always PrimitiveType::Sphere
+		PrimitiveType GetType() override { return PrimitiveType::Sphere; }
+
+		// Get a flat copy of the sphere
+		// @returns SphereRecord : The sphere data
+		SphereRecord GetRecord() { return { position, radius, radiusSqr, color, texture }; }
+
+		// Check if ray intersects a sphere record
+		// Shared by Sphere objects and the RayTracer scene arrays
+		// @param _sphere : The sphere to check against
+		// @param _ray : The ray to check for an intersection
+		// @returns bool : true if intersecting
+		static bool IntersectRecord(const SphereRecord& _sphere, Ray& _ray);
+
+		// Check if a ray intersects a sphere record, only works out the distance
+		// Inline so baked scenes (see BakedScene.h) can fold their sphere constants into it
+		// @param _sphere : The sphere to check against
+		// @param _origin : The ray origin
+		// @param _direction : The unit ray direction
+		// @param _length : The ray length, set to the hit distance if the sphere is hit closer
+		// @returns bool : true if intersecting
+		static bool IntersectRecordLength(const SphereRecord& _sphere, const rvec3& _origin, const rvec3& _direction, real& _length);
+
+		// Check if a primary ray intersects a sphere, only works out the distance
+		// Primary rays all start at the camera, the terms that only depend on the origin are worked out once per frame
+		// Gives the same answer as IntersectRecordLength from the camera
+		// @param _sphere : The sphere to check against
+		// @param _offset : The camera to sphere center vector
+		// @param _offsetSqr : The squared length of _offset
+		// @param _direction : The unit ray direction
+		// @param _length : The ray length, set to the hit distance if the sphere is hit closer
+		// @returns bool : true if intersecting
+		static bool IntersectPrimaryLength(const SphereRecord& _sphere, const rvec3& _offset, real _offsetSqr, const rvec3& _direction, real& _length);
+
+		// Get the bounding box of a sphere record
+		// @param _sphere : The sphere to bound
+		// @param _min : Returned minimum corner
+		// @param _max : Returned maximum corner
+		static void GetRecordBounds(const SphereRecord& _sphere, rvec3& _min, rvec3& _max);
+
+		Sphere(rvec3 _position, real _radius, ColorPixel _color = { 1, 0, 0 });
 	};
+
+	inline bool Sphere::IntersectRecordLength(const SphereRecord& _sphere, const rvec3& _origin, const rvec3& _direction, real& _length)
+	{
+		const rvec3& rO = _origin;
+		const rvec3& rD = _direction;
+		const real radiusSqr = _sphere.radiusSqr;
+
+		// Calculate vector from ray origin to sphere origin
+		rvec3 lRO = _sphere.position - rO;
+		// Project lRO length onto ray direction
+		real lPD = glm::dot(lRO, rD);
+		// Ray wont intersect if the projected length is behind it
+		if (lPD < 0) return false;
+
+		// Get the length of the middle point of the ray to the sphere origin
+		real mL = glm::dot(lRO, lRO) - (lPD * lPD);
+		// Ray wont interesect if the length is greater than the radius
+		if (mL > radiusSqr) return false;
+
+		// Calculate half the length from mL mapped to the ray direction
+		real sHL = glm::sqrt(radiusSqr - mL);
+
+		// Calculate the possible starting and ending intersects
+		real iStart = lPD - sHL,
+			iEnd = lPD + sHL;
+
+		real intersect = iStart;
+
+		// If either intersection lengths are less than 0, there is no intersect
+		if (iStart < 0)
+		{
+			intersect = iEnd;
+			if (iEnd < 0) return false;
+		}
+
+		// Check if intersect length is greater than current ray length
+		if (_length < intersect) return false;
+
+		_length = intersect;
+		return true;
+	}
+
+	inline bool Sphere::IntersectPrimaryLength(const SphereRecord& _sphere, const rvec3& _offset, real _offsetSqr, const rvec3& _direction, real& _length)
+	{
+		// The same steps as IntersectRecordLength, folding the radius into the frame constant
+		// would round silhouettes differently to traced rays
+		real lPD = glm::dot(_offset, _direction);
+		if (lPD < 0) return false;
+		real mL = _offsetSqr - (lPD * lPD);
+		if (mL > _sphere.radiusSqr) return false;
+
+		real sHL = glm::sqrt(_sphere.radiusSqr - mL);
+		real intersect = lPD - sHL;
+		// The camera is inside the sphere, the far side is hit
+		if (intersect < 0) intersect = lPD + sHL;
+
+		if (_length < intersect) return false;
+		_length = intersect;
+		return true;
+	}
 }
 
 #endif // !_SPHERE_H_
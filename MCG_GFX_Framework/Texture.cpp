@@ -0,0 +1,140 @@
+#include "Texture.h"
+
+// Core modules
+#include "ImageFile.h"
+
+// Texture
+namespace MRT
+{
+	namespace
+	{
+		// Spread the low 3 bits of a value out to every other bit
+		inline int SpreadBits(int _value)
+		{
+			return (_value & 1) | ((_value & 2) << 1) | ((_value & 4) << 2);
+		}
+
+		// Wrap a texel coordinate into the image
+		inline int Wrap(int _value, int _size)
+		{
+			_value %= _size;
+			return _value < 0 ? _value + _size : _value;
+		}
+	}
+
+	size_t Texture::TexelIndex(const MipLevel& _level, int _x, int _y) const
+	{
+		// Tiles are row major, texels inside a tile are Morton ordered
+		size_t tile = (size_t)(_y >> tileShift) * _level.tilesX + (size_t)(_x >> tileShift);
+		int morton = SpreadBits(_x & (tileSize - 1)) | (SpreadBits(_y & (tileSize - 1)) << 1);
+		return _level.offset + (tile * tileTexels) + morton;
+	}
+
+	ColorPixel Texture::SampleLevel(int _level, float _u, float _v) const
+	{
+		const MipLevel& level = levels[_level];
+
+		// Texel centers are at half coordinates
+		float x = (_u * level.width) - 0.5f, y = (_v * level.height) - 0.5f;
+		float fx = glm::floor(x), fy = glm::floor(y);
+		float wx = x - fx, wy = y - fy;
+		int x0 = Wrap((int)fx, level.width), y0 = Wrap((int)fy, level.height);
+		int x1 = x0 + 1 < level.width ? x0 + 1 : 0, y1 = y0 + 1 < level.height ? y0 + 1 : 0;
+
+		const ColorPixel& c00 = texels[TexelIndex(level, x0, y0)];
+		const ColorPixel& c10 = texels[TexelIndex(level, x1, y0)];
+		const ColorPixel& c01 = texels[TexelIndex(level, x0, y1)];
+		const ColorPixel& c11 = texels[TexelIndex(level, x1, y1)];
+
+		float w00 = (1 - wx) * (1 - wy), w10 = wx * (1 - wy), w01 = (1 - wx) * wy, w11 = wx * wy;
+		return {
+			(c00.r * w00) + (c10.r * w10) + (c01.r * w01) + (c11.r * w11),
+			(c00.g * w00) + (c10.g * w10) + (c01.g * w01) + (c11.g * w11),
+			(c00.b * w00) + (c10.b * w10) + (c01.b * w01) + (c11.b * w11) };
+	}
+
+	bool Texture::Create(const ColorPixel* _image, int _width, int _height)
+	{
+		levels.clear();
+		texels.clear();
+		if (_image == nullptr || _width <= 0 || _height <= 0) return false;
+
+		// Lay out every level, each is padded to whole tiles
+		size_t offset = 0;
+		int width = _width, height = _height;
+		while (true)
+		{
+			MipLevel level;
+			level.width = width;
+			level.height = height;
+			level.tilesX = (width + tileSize - 1) >> tileShift;
+			level.offset = offset;
+			offset += (size_t)level.tilesX * ((height + tileSize - 1) >> tileShift) * tileTexels;
+			levels.push_back(level);
+
+			if (width == 1 && height == 1) break;
+			width = glm::max(1, width / 2);
+			height = glm::max(1, height / 2);
+		}
+		texels.resize(offset);
+
+		// Copy the image into level 0
+		for (int y = 0; y < _height; ++y)
+			for (int x = 0; x < _width; ++x)
+				texels[TexelIndex(levels[0], x, y)] = _image[((size_t)y * _width) + x];
+
+		// Box filter each level down from the one above it, odd edges are clamped
+		for (size_t l = 1; l < levels.size(); ++l)
+		{
+			const MipLevel& source = levels[l - 1];
+			const MipLevel& target = levels[l];
+			for (int y = 0; y < target.height; ++y)
+			{
+				int sy0 = glm::min(y * 2, source.height - 1), sy1 = glm::min((y * 2) + 1, source.height - 1);
+				for (int x = 0; x < target.width; ++x)
+				{
+					int sx0 = glm::min(x * 2, source.width - 1), sx1 = glm::min((x * 2) + 1, source.width - 1);
+					const ColorPixel& a = texels[TexelIndex(source, sx0, sy0)];
+					const ColorPixel& b = texels[TexelIndex(source, sx1, sy0)];
+					const ColorPixel& c = texels[TexelIndex(source, sx0, sy1)];
+					const ColorPixel& d = texels[TexelIndex(source, sx1, sy1)];
+					texels[TexelIndex(target, x, y)] = {
+						(a.r + b.r + c.r + d.r) * 0.25f,
+						(a.g + b.g + c.g + d.g) * 0.25f,
+						(a.b + b.b + c.b + d.b) * 0.25f };
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Texture::Load(const char* _path)
+	{
+		std::vector<ColorPixel> image;
+		int width, height;
+		if (!ReadImagePPM(_path, image, width, height)) return false;
+		return Create(image.data(), width, height);
+	}
+
+	ColorPixel Texture::Sample(float _u, float _v, float _footprint) const
+	{
+		if (levels.empty()) return { 1, 1, 1 };
+
+		// Pick the level where the footprint covers about one texel
+		float texelFootprint = _footprint * (float)glm::max(levels[0].width, levels[0].height);
+		float lod = texelFootprint > 1 ? glm::log2(texelFootprint) : 0;
+		const int lastLevel = (int)levels.size() - 1;
+		if (lod >= (float)lastLevel) return SampleLevel(lastLevel, _u, _v);
+
+		// Blend the two closest levels
+		int level = (int)lod;
+		float blend = lod - (float)level;
+		ColorPixel fine = SampleLevel(level, _u, _v);
+		if (blend <= 0) return fine;
+		ColorPixel coarse = SampleLevel(level + 1, _u, _v);
+		return {
+			fine.r + ((coarse.r - fine.r) * blend),
+			fine.g + ((coarse.g - fine.g) * blend),
+			fine.b + ((coarse.b - fine.b) * blend) };
+	}
+}
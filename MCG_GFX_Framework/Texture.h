@@ -0,0 +1,86 @@
+#ifndef _TEXTURE_H_
+#define _TEXTURE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+
+namespace MRT
+{
+	// Texture
+	// - An image texture with a full mip chain, sampled with trilinear filtering
+	// - Every mip level is split into 8x8 texel tiles, texels inside a tile are stored
+	//   in Z-order (Morton order) so a bilinear footprint nearly always stays in one tile
+	// - The mip level is picked from the ray footprint, distant objects read small levels
+	//   instead of skipping across the full resolution image
+	// - UVs wrap (repeat)
+	class Texture
+	{
+	private:
+		// Tile dimensions (tileSize x tileSize texels)
+		static const int tileShift{ 3 }, tileSize{ 1 << tileShift }, tileTexels{ tileSize * tileSize };
+
+		// A single mip level
+		struct MipLevel
+		{
+			int width{ 0 }, height{ 0 };
+			// Tiles per row
+			int tilesX{ 0 };
+			// Index of the first texel in the texel array
+			size_t offset{ 0 };
+		};
+
+		// Mip levels, level 0 is the full resolution image
+		std::vector<MipLevel> levels;
+		// Every levels tiles, one after another
+		std::vector<ColorPixel> texels;
+
+		// Get the index of a texel in the texel array
+		// @param _level : The mip level
+		// @param _x : The texel X coordinate (0 to width-1)
+		// @param _y : The texel Y coordinate (0 to height-1)
+		// @returns size_t : The texel index
+		size_t TexelIndex(const MipLevel& _level, int _x, int _y) const;
+
+		// Bilinearly sample a single mip level
+		// @param _level : The mip level index
+		// @param _u : The U coordinate (wraps)
+		// @param _v : The V coordinate (wraps)
+		// @returns ColorPixel : The filtered color
+		ColorPixel SampleLevel(int _level, float _u, float _v) const;
+
+	public:
+		// Create the texture from an image, builds every mip level
+		// @param _image : The image, row major from the top left
+		// @param _width : The image width
+		// @param _height : The image height
+		// @returns bool : true on success
+		bool Create(const ColorPixel* _image, int _width, int _height);
+
+		// Load the texture from a binary PPM file
+		// @param _path : The file to load
+		// @returns bool : true on success
+		bool Load(const char* _path);
+
+		// Sample the texture
+		// @param _u : The U coordinate (wraps)
+		// @param _v : The V coordinate (wraps)
+		// @param _footprint : The size the sample covers in UV units, picks the mip level
+		// @returns ColorPixel : The filtered color, white if the texture is empty
+		ColorPixel Sample(float _u, float _v, float _footprint) const;
+
+		// Get the texture dimensions (level 0)
+		// @returns int : The width/height in texels
+		int GetWidth() const { return levels.empty() ? 0 : levels[0].width; }
+		int GetHeight() const { return levels.empty() ? 0 : levels[0].height; }
+
+		// Get the amount of mip levels
+		// @returns int : The amount of levels, 0 if the texture is empty
+		int GetLevelCount() const { return (int)levels.size(); }
+	};
+}
+
+#endif // !_TEXTURE_H_
@@ -0,0 +1,242 @@
+#include "TileCache.h"
+
+// Included libraries
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+// Core modules
+#include "Timeline.h"
+#include "MappedFile.h"
+
+// Tile Cache
+namespace MRT
+{
+	namespace
+	{
+		// TileFileHeader
+		// - Start of a spilled tile, followed by the colors and then the surfaces
+		struct TileFileHeader
+		{
+			char magic[8]{ 'M', 'R', 'T', 'T', 'I', 'L', 'E', '\0' };
+			std::uint32_t version{ 1 };
+			// Pixel sizes, a build with a different layout rejects the file
+			std::uint32_t colorSize{ sizeof(ColorPixel) }, surfaceSize{ sizeof(SurfacePixel) };
+			std::int32_t pixels{ 0 };
+			std::uint64_t key{ 0 };
+		};
+	}
+
+	void ContentHash::Add(const void* _data, size_t _size)
+	{
+		const unsigned char* bytes = (const unsigned char*)_data;
+		for (size_t i = 0; i < _size; ++i)
+		{
+			value ^= bytes[i];
+			value *= 1099511628211ull;
+		}
+	}
+
+	size_t TileCache::GetEntryBytes(const Entry& _entry)
+	{
+		return sizeof(Entry) + _entry.colors.size() * sizeof(ColorPixel) + _entry.surfaces.size() * sizeof(SurfacePixel);
+	}
+
+	std::string TileCache::GetSpillFile(const std::string& _folder, std::uint64_t _key)
+	{
+		if (_folder.empty()) return std::string();
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.tile", (unsigned long long)_key);
+		return _folder + "/" + name;
+	}
+
+	bool TileCache::WriteSpill(const std::string& _folder, std::uint64_t _key, const Entry& _entry)
+	{
+		const std::string path = GetSpillFile(_folder, _key);
+		if (path.empty()) return false;
+		TimelineScope scope("Spill tile");
+
+		TileFileHeader header;
+		header.pixels = (std::int32_t)_entry.colors.size();
+		header.key = _key;
+
+		// Threads spilling the same tile write their own temporary file
+		char suffix[32];
+		std::snprintf(suffix, sizeof(suffix), ".%p.tmp", (const void*)&_entry);
+		const std::string tempPath = path + suffix;
+		bool written;
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)_entry.colors.data(), (std::streamsize)(_entry.colors.size() * sizeof(ColorPixel)));
+			file.write((const char*)_entry.surfaces.data(), (std::streamsize)(_entry.surfaces.size() * sizeof(SurfacePixel)));
+			file.close();
+			written = !file.fail();
+		}
+		if (!written)
+		{
+			std::remove(tempPath.c_str());
+			return false;
+		}
+		// Tiles are only a cache and a short or empty file is rejected when read, so they arent flushed
+		return CommitFile(tempPath.c_str(), path.c_str(), false);
+	}
+
+	bool TileCache::ReadSpill(const std::string& _folder, std::uint64_t _key, int _pixels, Entry& _entry)
+	{
+		const std::string path = GetSpillFile(_folder, _key);
+		if (path.empty()) return false;
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		TileFileHeader header, expected;
+		expected.pixels = _pixels;
+		expected.key = _key;
+		file.read((char*)&header, sizeof(header));
+		if (!file || std::memcmp(&header, &expected, sizeof(header)) != 0) return false;
+
+		_entry.colors.resize(_pixels);
+		_entry.surfaces.resize(_pixels);
+		file.read((char*)_entry.colors.data(), (std::streamsize)(_pixels * sizeof(ColorPixel)));
+		file.read((char*)_entry.surfaces.data(), (std::streamsize)(_pixels * sizeof(SurfacePixel)));
+		return (bool)file;
+	}
+
+	void TileCache::Evict(std::vector<std::pair<std::uint64_t, Entry>>& _evicted)
+	{
+		while (used > budget && !useOrder.empty())
+		{
+			std::unordered_map<std::uint64_t, Entry>::iterator oldest = entries.find(useOrder.back());
+			useOrder.pop_back();
+
+			used -= GetEntryBytes(oldest->second);
+			_evicted.emplace_back(oldest->first, std::move(oldest->second));
+			entries.erase(oldest);
+		}
+	}
+
+	void TileCache::Spill(const std::string& _folder, const std::vector<std::pair<std::uint64_t, Entry>>& _evicted)
+	{
+		long long spilled = 0;
+		for (const std::pair<std::uint64_t, Entry>& tile : _evicted)
+			if (!tile.second.fSpilled && WriteSpill(_folder, tile.first, tile.second)) ++spilled;
+		if (spilled > 0)
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			stats.spilled += spilled;
+		}
+	}
+
+	void TileCache::Insert(std::uint64_t _key, Entry&& _entry)
+	{
+		std::vector<std::pair<std::uint64_t, Entry>> evicted;
+		std::string folder;
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			std::pair<std::unordered_map<std::uint64_t, Entry>::iterator, bool> slot = entries.try_emplace(_key);
+			Entry& entry = slot.first->second;
+			if (slot.second)
+			{
+				useOrder.push_front(_key);
+				_entry.useSlot = useOrder.begin();
+			}
+			else
+			{
+				used -= GetEntryBytes(entry);
+				useOrder.splice(useOrder.begin(), useOrder, entry.useSlot);
+				_entry.useSlot = entry.useSlot;
+			}
+			entry = std::move(_entry);
+			used += GetEntryBytes(entry);
+			Evict(evicted);
+			folder = spillPath;
+		}
+
+		// Spilled once the lock is released
+		Spill(folder, evicted);
+	}
+
+	void TileCache::SetBudget(size_t _bytes)
+	{
+		std::vector<std::pair<std::uint64_t, Entry>> evicted;
+		std::string folder;
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			budget = _bytes;
+			Evict(evicted);
+			folder = spillPath;
+		}
+		Spill(folder, evicted);
+	}
+
+	void TileCache::SetSpillPath(const std::string& _path)
+	{
+		std::lock_guard<std::mutex> lock(entryLock);
+		spillPath = _path;
+		// Folders given with a trailing slash get a single one
+		while (!spillPath.empty() && (spillPath.back() == '/' || spillPath.back() == '\\')) spillPath.pop_back();
+	}
+
+	void TileCache::Clear()
+	{
+		std::lock_guard<std::mutex> lock(entryLock);
+		entries.clear();
+		useOrder.clear();
+		used = 0;
+	}
+
+	TileCacheStats TileCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(entryLock);
+		TileCacheStats current = stats;
+		current.tiles = (int)entries.size();
+		current.bytes = used;
+		return current;
+	}
+
+	bool TileCache::Fetch(std::uint64_t _key, int _pixels, ColorPixel* _colors, SurfacePixel* _surfaces)
+	{
+		std::string folder;
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			std::unordered_map<std::uint64_t, Entry>::iterator it = entries.find(_key);
+			if (it != entries.end() && (int)it->second.colors.size() == _pixels)
+			{
+				useOrder.splice(useOrder.begin(), useOrder, it->second.useSlot);
+				std::memcpy(_colors, it->second.colors.data(), _pixels * sizeof(ColorPixel));
+				std::memcpy(_surfaces, it->second.surfaces.data(), _pixels * sizeof(SurfacePixel));
+				++stats.hits;
+				return true;
+			}
+			folder = spillPath;
+		}
+
+		// Files are read without the lock, other threads carry on meanwhile
+		Entry entry;
+		if (!ReadSpill(folder, _key, _pixels, entry))
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			++stats.misses;
+			return false;
+		}
+		std::memcpy(_colors, entry.colors.data(), _pixels * sizeof(ColorPixel));
+		std::memcpy(_surfaces, entry.surfaces.data(), _pixels * sizeof(SurfacePixel));
+		{
+			std::lock_guard<std::mutex> lock(entryLock);
+			++stats.diskHits;
+		}
+		// Brought back into memory, its likely to be asked for again
+		entry.fSpilled = true;
+		Insert(_key, std::move(entry));
+		return true;
+	}
+
+	void TileCache::Store(std::uint64_t _key, int _pixels, const ColorPixel* _colors, const SurfacePixel* _surfaces)
+	{
+		Entry entry;
+		entry.colors.assign(_colors, _colors + _pixels);
+		entry.surfaces.assign(_surfaces, _surfaces + _pixels);
+		Insert(_key, std::move(entry));
+	}
+}
@@ -0,0 +1,163 @@
+#ifndef _TILECACHE_H_
+#define _TILECACHE_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+
+namespace MRT
+{
+	// ContentHash
+	// - 64 bit FNV-1a hash of the inputs a tile is traced from
+	// - Values are added one at a time so struct padding never reaches the hash
+	struct ContentHash
+	{
+		std::uint64_t value{ 14695981039346656037ull };
+
+		// Add raw bytes
+		// @param _data : The bytes
+		// @param _size : The amount of bytes
+		void Add(const void* _data, size_t _size);
+
+		// Add a scalar value
+		// @param _value : The value, hashed by its bytes
+		template<typename T>
+		void AddValue(const T& _value) { Add(&_value, sizeof(T)); }
+
+		// Add a vector
+		// @param _value : The vector, hashed by its components
+		void AddVector(const rvec3& _value) { AddValue(_value.x); AddValue(_value.y); AddValue(_value.z); }
+
+		// Add a color
+		// @param _value : The color, hashed by its channels
+		void AddColor(const ColorPixel& _value) { AddValue(_value.r); AddValue(_value.g); AddValue(_value.b); }
+	};
+
+	// TileCacheStats
+	// - What the tile cache has served and holds
+	struct TileCacheStats
+	{
+		// Tiles served from memory, from the spill folder and traced
+		long long hits{ 0 }, diskHits{ 0 }, misses{ 0 };
+		// Tiles written to the spill folder to stay in the memory budget
+		long long spilled{ 0 };
+		// Tiles and bytes held in memory
+		int tiles{ 0 };
+		size_t bytes{ 0 };
+	};
+
+	// TileCache
+	// - Traced tile results stored under a hash of everything the tile was traced from
+	//   (see RayTracer::SetTileCache), a tile with the same hash is copied instead of traced
+	// - Keys are content addresses, nothing is ever invalidated, changed inputs simply hash differently
+	// - Held in memory up to a budget, the least recently used tiles go to the spill folder
+	//   (when one is set) and are read back from it on a miss, so they also outlive the program
+	// - Safe to use from every render thread
+	class TileCache
+	{
+	private:
+		// A cached tile, pixels row major
+		struct Entry
+		{
+			std::vector<ColorPixel> colors;
+			std::vector<SurfacePixel> surfaces;
+			// Place of the tile in the use order
+			std::list<std::uint64_t>::iterator useSlot;
+			// The spill folder already holds the tile, its not written again when evicted
+			bool fSpilled{ false };
+		};
+
+		std::unordered_map<std::uint64_t, Entry> entries;
+		// Keys of the tiles in memory, most recently used first
+		std::list<std::uint64_t> useOrder;
+		std::mutex entryLock;
+		size_t budget{ 256u << 20 }, used{ 0 };
+		// Guarded by the lock like the entries, copied out before files are touched
+		std::string spillPath;
+		TileCacheStats stats;
+
+		// Get the bytes an entry holds
+		// @param _entry : The entry
+		// @returns size_t : The bytes
+		static size_t GetEntryBytes(const Entry& _entry);
+
+		// Get the spill file of a tile
+		// @param _folder : The spill folder, copied out under the lock
+		// @param _key : The tile hash
+		// @returns std::string : The file path, empty without a spill folder
+		static std::string GetSpillFile(const std::string& _folder, std::uint64_t _key);
+
+		// Write a tile to the spill folder
+		// Written to a temporary file and renamed over, so a reader never sees half a tile
+		// @param _folder : The spill folder
+		// @param _key : The tile hash
+		// @param _entry : The tile
+		// @returns bool : true on success
+		static bool WriteSpill(const std::string& _folder, std::uint64_t _key, const Entry& _entry);
+
+		// Read a tile from the spill folder
+		// @param _folder : The spill folder
+		// @param _key : The tile hash
+		// @param _pixels : The amount of pixels the tile has to hold
+		// @param _entry : Returned tile
+		// @returns bool : false if the tile isnt there or doesnt match
+		static bool ReadSpill(const std::string& _folder, std::uint64_t _key, int _pixels, Entry& _entry);
+
+		// Take the least recently used tiles out of memory until its within the budget
+		// Called with the lock held, the oldest tile is at the back of the use order
+		// @param _evicted : Returned tiles taken out, to be spilled once the lock is released
+		void Evict(std::vector<std::pair<std::uint64_t, Entry>>& _evicted);
+
+		// Spill evicted tiles, called without the lock
+		// @param _folder : The spill folder
+		// @param _evicted : The tiles taken out of memory
+		void Spill(const std::string& _folder, const std::vector<std::pair<std::uint64_t, Entry>>& _evicted);
+
+		// Put a tile in memory and spill what falls out of the budget
+		// @param _key : The tile hash
+		// @param _entry : The tile, moved into the cache
+		void Insert(std::uint64_t _key, Entry&& _entry);
+
+	public:
+		// Set the memory budget, tiles over it are spilled or dropped
+		// @param _bytes : The budget in bytes
+		void SetBudget(size_t _bytes);
+
+		// Set the folder tiles are spilled to
+		// @param _path : An existing folder, empty to drop tiles instead
+		void SetSpillPath(const std::string& _path);
+
+		// Drop every tile held in memory, the spill folder is left alone
+		void Clear();
+
+		// Get what the cache has served and holds
+		// @returns TileCacheStats : The statistics
+		TileCacheStats GetStats();
+
+		// Copy a cached tile out
+		// @param _key : The tile hash
+		// @param _pixels : The amount of pixels in the tile
+		// @param _colors : Returned colors, _pixels long
+		// @param _surfaces : Returned normals and depths, _pixels long
+		// @returns bool : false if the tile isnt cached
+		bool Fetch(std::uint64_t _key, int _pixels, ColorPixel* _colors, SurfacePixel* _surfaces);
+
+		// Cache a traced tile
+		// @param _key : The tile hash
+		// @param _pixels : The amount of pixels in the tile
+		// @param _colors : The colors, _pixels long
+		// @param _surfaces : The normals and depths, _pixels long
+		void Store(std::uint64_t _key, int _pixels, const ColorPixel* _colors, const SurfacePixel* _surfaces);
+	};
+}
+
+#endif // !_TILECACHE_H_
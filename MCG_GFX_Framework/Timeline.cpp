@@ -0,0 +1,181 @@
+#include "Timeline.h"
+
+// Included libraries
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Timeline
+namespace MRT
+{
+	namespace
+	{
+		// A finished event
+		struct TimelineEvent
+		{
+			const char* name;
+			long long begin, end;
+			int arg;
+		};
+
+		// TimelineLane
+		// - Ring buffer of events, only written by the thread holding it
+		struct TimelineLane
+		{
+			// Events a lane keeps (a power of 2)
+			static const int capacity{ 1 << 14 };
+			std::unique_ptr<TimelineEvent[]> events{ new TimelineEvent[capacity] };
+			// Events written this recording, moved on after every write so readers only see whole events
+			std::atomic<long long> written{ 0 };
+			// Recording the events belong to, readers skip lanes left over from an older one
+			std::atomic<int> epoch{ -1 };
+			// Thread id shown in the trace
+			int id{ 0 };
+		};
+
+		std::atomic<bool> fRecording{ false };
+		// Moved on every time recording starts, each lane clears itself on its next write after it
+		std::atomic<int> recordEpoch{ 0 };
+		// Clock reading recording started at, the trace starts at 0 from it
+		std::atomic<long long> traceStart{ 0 };
+
+		// Every lane ever made and the ones no thread holds, only locked to pick up and hand back lanes
+		std::mutex laneLock;
+		std::vector<std::unique_ptr<TimelineLane>> lanes;
+		std::vector<TimelineLane*> freeLanes;
+
+		// LaneHandle
+		// - The lane of a thread, handed back for reuse when the thread exits
+		struct LaneHandle
+		{
+			TimelineLane* lane{ nullptr };
+
+			~LaneHandle()
+			{
+				if (lane == nullptr) return;
+				std::lock_guard<std::mutex> lock(laneLock);
+				freeLanes.push_back(lane);
+			}
+		};
+		thread_local LaneHandle threadLane;
+
+		// Get the lane of the calling thread, picks one up the first time
+		// @returns TimelineLane* : The lane
+		TimelineLane* GetThreadLane()
+		{
+			if (threadLane.lane != nullptr) return threadLane.lane;
+
+			std::lock_guard<std::mutex> lock(laneLock);
+			if (!freeLanes.empty())
+			{
+				threadLane.lane = freeLanes.back();
+				freeLanes.pop_back();
+			}
+			else
+			{
+				lanes.emplace_back(new TimelineLane());
+				lanes.back()->id = (int)lanes.size() - 1;
+				threadLane.lane = lanes.back().get();
+			}
+			return threadLane.lane;
+		}
+	}
+
+	void SetTimelineEnabled(bool _enabled)
+	{
+		// Only the thread holding a lane writes it, so lanes are cleared by their own thread
+		if (_enabled)
+		{
+			traceStart.store(GetTimelineClock());
+			recordEpoch.fetch_add(1, std::memory_order_release);
+		}
+		fRecording.store(_enabled);
+	}
+
+	bool IsTimelineEnabled()
+	{
+		return fRecording.load(std::memory_order_relaxed);
+	}
+
+	long long GetTimelineClock()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void RecordTimelineEvent(const char* _name, long long _begin, long long _end, int _arg)
+	{
+		TimelineLane* lane = GetThreadLane();
+		const int epoch = recordEpoch.load(std::memory_order_acquire);
+		long long index = lane->written.load(std::memory_order_relaxed);
+		if (lane->epoch.load(std::memory_order_relaxed) != epoch)
+		{
+			// Cleared before the epoch is published, so readers never pair it with old events
+			index = 0;
+			lane->written.store(0, std::memory_order_relaxed);
+			lane->epoch.store(epoch, std::memory_order_release);
+		}
+		lane->events[index & (TimelineLane::capacity - 1)] = { _name, _begin, _end, _arg };
+		lane->written.store(index + 1, std::memory_order_release);
+	}
+
+	long long GetTimelineEventCount()
+	{
+		std::lock_guard<std::mutex> lock(laneLock);
+		const int epoch = recordEpoch.load(std::memory_order_acquire);
+		long long count = 0;
+		for (std::unique_ptr<TimelineLane>& lane : lanes)
+		{
+			if (lane->epoch.load(std::memory_order_acquire) != epoch) continue;
+			count += std::min(lane->written.load(std::memory_order_acquire), (long long)TimelineLane::capacity);
+		}
+		return count;
+	}
+
+	bool SaveTimeline(const char* _path)
+	{
+		std::ofstream file(_path, std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		// Times are written in microseconds from the start of the recording
+		const long long start = traceStart.load();
+		char line[256];
+		bool fFirst = true;
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		std::lock_guard<std::mutex> lock(laneLock);
+		const int epoch = recordEpoch.load(std::memory_order_acquire);
+		for (std::unique_ptr<TimelineLane>& lane : lanes)
+		{
+			// Lanes that havent written since recording started only hold older events
+			if (lane->epoch.load(std::memory_order_acquire) != epoch) continue;
+			const long long written = lane->written.load(std::memory_order_acquire);
+			if (written == 0) continue;
+
+			// Lanes are named and kept in order
+			std::snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}},"
+				"\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+				fFirst ? "" : ",", lane->id, lane->id, lane->id, lane->id);
+			file << line;
+			fFirst = false;
+
+			const long long first = std::max((long long)0, written - TimelineLane::capacity);
+			for (long long i = first; i < written; ++i)
+			{
+				const TimelineEvent& event = lane->events[i & (TimelineLane::capacity - 1)];
+				int length = std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+					event.name, lane->id, (event.begin - start) * 1e-3, (event.end - event.begin) * 1e-3);
+				if (event.arg >= 0) length += std::snprintf(line + length, sizeof(line) - length, ",\"args\":{\"index\":%d}", event.arg);
+				file << line << "}";
+			}
+		}
+
+		file << "\n]}\n";
+		file.close();
+		return !file.fail();
+	}
+}
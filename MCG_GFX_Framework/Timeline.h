@@ -0,0 +1,77 @@
+#ifndef _TIMELINE_H_
+#define _TIMELINE_H_
+
+// Core modules
+#include "UtilityModules.h"
+
+namespace MRT
+{
+	// Timeline
+	// - Opt-in trace of what every thread spends its time on, saved as Chrome Trace Event JSON
+	//   (open it in chrome://tracing or ui.perfetto.dev)
+	// - Every thread records into its own ring buffer, recording takes no locks and
+	//   costs a clock read per scope, a thread only locks once to pick up a buffer
+	// - Buffers are handed back when a thread exits and reused by the next one, so the
+	//   short lived ParallelFor workers share a few lanes instead of making one each
+	// - Each lane keeps its most recent events, older ones are overwritten once its full
+	// - Off by default, scopes cost a single flag check then
+
+	// Start or stop recording, starting throws away the events recorded before
+	// @param _enabled : true to record
+	void SetTimelineEnabled(bool _enabled);
+
+	// Check the timeline is recording
+	// @returns bool : true while recording
+	bool IsTimelineEnabled();
+
+	// Write every recorded event as Chrome Trace Event JSON
+	// Save once the traced work is done, events recorded while saving can be missed
+	// @param _path : The file to write
+	// @returns bool : true on success
+	bool SaveTimeline(const char* _path);
+
+	// Get the amount of events held across every lane
+	// @returns long long : The event count
+	long long GetTimelineEventCount();
+
+	// Record a finished event on the calling thread
+	// @param _name : The event name, has to outlive the timeline (a string literal)
+	// @param _begin : The start time (see GetTimelineClock)
+	// @param _end : The end time
+	// @param _arg : A number shown with the event (a tile or row index), -1 for none
+	void RecordTimelineEvent(const char* _name, long long _begin, long long _end, int _arg = -1);
+
+	// Get the clock timeline events are measured with
+	// @returns long long : The time in nanoseconds
+	long long GetTimelineClock();
+
+	// TimelineScope
+	// - Records an event from its construction to the end of the enclosing scope
+	// - Nothing is recorded if the timeline wasnt recording when it was made
+	class TimelineScope
+	{
+	private:
+		const char* name;
+		int arg;
+		long long begin{ 0 };
+		bool fActive;
+
+	public:
+		// @param _name : The event name, has to outlive the timeline (a string literal)
+		// @param _arg : Optional, a number shown with the event (a tile or row index)
+		TimelineScope(const char* _name, int _arg = -1)
+			: name{ _name }, arg{ _arg }, fActive{ IsTimelineEnabled() }
+		{
+			if (fActive) begin = GetTimelineClock();
+		}
+		~TimelineScope()
+		{
+			if (fActive) RecordTimelineEvent(name, begin, GetTimelineClock(), arg);
+		}
+
+		TimelineScope(const TimelineScope&) = delete;
+		TimelineScope& operator=(const TimelineScope&) = delete;
+	};
+}
+
+#endif // !_TIMELINE_H_
@@ -11,6 +11,28 @@ namespace MRT
 		float r{ 0 }, g{ 0 }, b{ 0 };
 	};
 
+	// SurfacePixel
+	// - Geometry guide data for a single pixel, filled in while rendering
+	// - Stores the averaged hit normal and depth (ray length) of the pixel samples
+	// - Depth is 0 when no sample hit an object (background)
+	struct SurfacePixel
+	{
+		float nx{ 0 }, ny{ 0 }, nz{ 0 }, depth{ 0 };
+	};
+
+	// PixelCost
+	// - Render cost of a single pixel, filled in while cost tracking is on
+	// - Summed over every sample traced for the pixel
+	struct PixelCost
+	{
+		// Primitive intersection tests and BVH nodes visited
+		float tests{ 0 }, steps{ 0 };
+		// Samples traced
+		float samples{ 0 };
+		// Time spent tracing and shading (nanoseconds)
+		float nanoseconds{ 0 };
+	};
+
 }
 
 #endif // !_UTILITY_MODULES_H_
\ No newline at end of file
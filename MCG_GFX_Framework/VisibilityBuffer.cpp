@@ -0,0 +1,112 @@
+#include "VisibilityBuffer.h"
+
+// Core modules
+#include "Parallel.h"
+#include "Sphere.h"
+#include "Circle.h"
+#include "Timeline.h"
+
+// Visibility Buffer
+namespace MRT
+{
+	bool VisibilityBuffer::Prepare(const SceneView& _scene, Camera& _camera, int _width, int _height)
+	{
+		width = _width;
+		height = _height;
+		binsX = (width + binSize - 1) / binSize;
+		binsY = (height + binSize - 1) / binSize;
+		bounds.clear();
+		bins.resize(binsX * binsY);
+		for (std::vector<int>& bin : bins)
+			bin.clear();
+
+		const rvec3 origin = _camera.GetRayOrigin();
+		for (int i = 0; i < _scene.refCount; ++i)
+		{
+			const unsigned int ref = _scene.refs[i];
+			ObjectBounds object;
+			object.ref = ref;
+			rvec3 min, max;
+			switch (GetRefType(ref))
+			{
+			case PrimitiveType::Sphere:
+			{
+				const SphereRecord& sphere = _scene.spheres[GetRefIndex(ref)];
+				Sphere::GetRecordBounds(sphere, min, max);
+				object.offset = sphere.position - origin;
+				object.term = glm::dot(object.offset, object.offset);
+				break;
+			}
+			case PrimitiveType::Circle:
+			{
+				const CircleRecord& circle = _scene.circles[GetRefIndex(ref)];
+				Circle::GetRecordBounds(circle, min, max);
+				object.term = glm::dot(circle.position - origin, circle.direction);
+				// Circles are one sided, the camera is behind this one
+				if (object.term <= 0) continue;
+				break;
+			}
+			default: return false;
+			}
+
+			if (!_camera.ProjectBounds(min, max, object.x0, object.y0, object.x1, object.y1)) continue;
+
+			// Binned in BVH leaf order, so every bin tests its objects in the same order each frame
+			const int index = (int)bounds.size();
+			bounds.push_back(object);
+			for (int by = object.y0 / binSize; by <= (object.y1 - 1) / binSize; ++by)
+				for (int bx = object.x0 / binSize; bx <= (object.x1 - 1) / binSize; ++bx)
+					bins[(by * binsX) + bx].push_back(index);
+		}
+		return true;
+	}
+
+	void VisibilityBuffer::Resolve(const SceneView& _scene, Camera& _camera, float _sampleX, float _sampleY)
+	{
+		rays.resize(width * height);
+		samples.resize(width * height);
+
+		// Cast every ray of the sample, a row at a time
+		ParallelFor(height, [&](int _y)
+		{
+			TimelineScope scope("Cast rays", _y);
+			_camera.CastRow(_y, 0, width, rays.data() + (_y * width), _sampleX, _sampleY);
+			for (int x = 0; x < width; ++x)
+			{
+				const int i = (_y * width) + x;
+				samples[i] = { noHit, rays[i].GetLength() };
+			}
+		});
+
+		// Bins dont share pixels, each is resolved by one thread
+		const rvec3 origin = _camera.GetRayOrigin();
+		ParallelFor(binsX * binsY, [&](int _bin)
+		{
+			TimelineScope scope("Resolve bin", _bin);
+			const int binX0 = (_bin % binsX) * binSize, binY0 = (_bin / binsX) * binSize;
+			for (int index : bins[_bin])
+			{
+				const ObjectBounds& object = bounds[index];
+				const int x0 = glm::max(object.x0, binX0), x1 = glm::min(object.x1, binX0 + binSize);
+				const int y0 = glm::max(object.y0, binY0), y1 = glm::min(object.y1, binY0 + binSize);
+				const bool fSphere = GetRefType(object.ref) == PrimitiveType::Sphere;
+				const unsigned int record = GetRefIndex(object.ref);
+
+				// Every ray starts at the camera, only the direction changes from pixel to pixel
+				for (int y = y0; y < y1; ++y)
+				{
+					for (int x = x0; x < x1; ++x)
+					{
+						const int i = (y * width) + x;
+						const rvec3 direction = rays[i].GetDirection();
+						Sample& sample = samples[i];
+						const bool hit = fSphere ?
+							Sphere::IntersectPrimaryLength(_scene.spheres[record], object.offset, object.term, direction, sample.length) :
+							Circle::IntersectPrimaryLength(_scene.circles[record], origin, object.term, direction, sample.length);
+						if (hit) sample.ref = object.ref;
+					}
+				}
+			}
+		});
+	}
+}
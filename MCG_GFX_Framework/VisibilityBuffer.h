@@ -0,0 +1,97 @@
+#ifndef _VISIBILITYBUFFER_H_
+#define _VISIBILITYBUFFER_H_
+
+// Included libraries
+#include "MCG_GFX_Lib.h"
+#include <vector>
+
+// Core modules
+#include "UtilityModules.h"
+#include "Precision.h"
+#include "Ray.h"
+#include "Camera.h"
+#include "BVH.h"
+
+namespace MRT
+{
+	// VisibilityBuffer
+	// - Finds the closest object behind every pixel by rasterizing instead of walking the BVH
+	// - Every sphere and circle is projected to the pixels its bounds cover, then only
+	//   the primary rays of those pixels are tested against it, the closest hit per pixel
+	//   is kept as an object id and depth
+	// - Objects are binned into screen tiles so tiles resolve in parallel, the work grows
+	//   with the pixels objects cover instead of the depth of the BVH per ray
+	// - Hits are exact, the record tests the BVH walk uses in a primary ray form, the terms
+	//   that only depend on the camera are worked out per object once per frame
+	class VisibilityBuffer
+	{
+	private:
+		// Size of a bin in pixels (binSize x binSize)
+		static const int binSize{ 32 };
+
+		// An object and the pixels it can cover
+		struct ObjectBounds
+		{
+			unsigned int ref;
+			int x0, y0, x1, y1;
+			// Primary ray terms, worked out once per frame (see Sphere::IntersectPrimaryLength)
+			// Spheres: the camera to center vector and its squared length
+			// Circles: the distance from the camera to the plane
+			rvec3 offset;
+			real term;
+		};
+
+		// The closest object of a pixel sample
+		struct Sample
+		{
+			unsigned int ref;
+			real length;
+		};
+
+		std::vector<ObjectBounds> bounds;
+		// Every bins objects, as indices into bounds
+		std::vector<std::vector<int>> bins;
+		int binsX{ 0 }, binsY{ 0 };
+
+		// Primary rays and their closest objects, row major
+		std::vector<Ray> rays;
+		std::vector<Sample> samples;
+		int width{ 0 }, height{ 0 };
+
+	public:
+		// Object id of a pixel sample that hits nothing
+		static const unsigned int noHit{ 0xFFFFFFFFu };
+
+		// Project and bin every object, done once per frame
+		// Circles facing away from the camera and objects behind it are left out
+		// @param _scene : The scene, spheres and circles only
+		// @param _camera : The camera the frame is rendered from
+		// @param _width : The image width
+		// @param _height : The image height
+		// @returns bool : false if the scene holds objects without a record (generic objects)
+		bool Prepare(const SceneView& _scene, Camera& _camera, int _width, int _height);
+
+		// Find the closest object behind every pixel for one sample position
+		// @param _scene : The scene given to Prepare
+		// @param _camera : The camera given to Prepare
+		// @param _sampleX : The sample X coordinate on every pixel (0 to 1.f)
+		// @param _sampleY : The sample Y coordinate on every pixel (0 to 1.f)
+		void Resolve(const SceneView& _scene, Camera& _camera, float _sampleX, float _sampleY);
+
+		// Get the closest object of a pixel
+		// @param _pixel : The pixel index (row major)
+		// @returns unsigned int : The primitive reference, noHit if nothing is hit
+		unsigned int GetObject(int _pixel) const { return samples[_pixel].ref; }
+
+		// Get the primary ray of a pixel
+		// @param _pixel : The pixel index (row major)
+		// @returns Ray& : The ray as cast, without hit information
+		Ray& GetRay(int _pixel) { return rays[_pixel]; }
+
+		// Get the amount of objects on screen after Prepare
+		// @returns int : The object count
+		int GetObjectCount() const { return (int)bounds.size(); }
+	};
+}
+
+#endif // !_VISIBILITYBUFFER_H_